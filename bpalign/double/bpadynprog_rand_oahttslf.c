@@ -115,7 +115,7 @@ static void oahttslf_insert_indices(uint16_t i, uint16_t j,
          ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
 //  printf("zz %d,%d,%d,%d\t\t%016lX\n",i,j,k,l,key);
   val = (value == 0 ? NEGINF : value);
-  oahttslf_insert_double(key, val, thread_id);
+  oahttslf_insert_double(bpaglobals.hashtable, key, val, thread_id);
 }
 
 
@@ -141,7 +141,7 @@ static double oahttslf_lookup_indices(uint16_t i, uint16_t j,
          ((uint64_t)i << 47) | ((uint64_t)(j & 0xffff) << 31) |
          ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
 
-  found =  oahttslf_lookup_double(key, &val);
+  found =  oahttslf_lookup_double(bpaglobals.hashtable, key, &val);
   if (found)
     return (val <= NEGINF ? 0 : val);
   else
@@ -40,4 +40,5 @@ bpaglobals_t bpaglobals =
   ,NULL   /* pairlistB */
   ,0      /* paircountA */
   ,0      /* paircountB */
+  ,NULL   /* hashtable */
 };
@@ -18,6 +18,7 @@
 #include "bpautils.h"
 #include "bpaipsilist.h"
 #include "bpaparse.h"
+#include "oahttslf.h"
 
 #define PMIN 1e-04 /* minimum base pairing probability considered significant */
 #define MINLOOP 5  /* minimum size of hairpin loop */
@@ -55,6 +56,7 @@ typedef struct bpaglobals_s
     basepair_t  *pairlistB; /* list of (i,j,p) for 2ns seq */
     int          paircountA;/* length of pairlistA */
     int          paircountB;/* length of pairlistB */
+    oahttslf_t  *hashtable; /* d.p. values for top-down hashtable versions */
 } bpaglobals_t;
 
 extern bpaglobals_t bpaglobals;
@@ -56,6 +56,7 @@
 #include "bpadynprog_cpu.h"
 #include "bpadynprog_hashthread.h"
 #include "ht.h"
+#include "oahttslf.h"
 
 
 
@@ -105,6 +106,7 @@
  *                    paircountB - length of pairlistB
  *                    ipsilistA - (j,psi) lists indexed by i for 1st seq
  *                    ipsilistB - (j,psi) lists indexed by i for 2nd seq
+ *                    hashtable - d.p. hashtable for top-down implementation
  *                    
  *
  * Return value:
@@ -200,6 +202,13 @@ static int bpalign(const char *filename1, const char *filename2)
 
     }
   }
+  else
+  {
+    /* only (i,j,k,l) with i <= j and k <= l are ever stored */
+    bpaglobals.hashtable = oahttslf_create(
+      (uint64_t)bpaglobals.seqlenA * (bpaglobals.seqlenA + 1) / 2 *
+      bpaglobals.seqlenB * (bpaglobals.seqlenB + 1) / 2);
+  }
 
   if (bpaglobals.use_bottomup)
   {
@@ -248,7 +257,8 @@ static int bpalign(const char *filename1, const char *filename2)
   bpa_free_ipsilist(bpaglobals.ipsilistB, bpaglobals.seqlenB);
   free(seripsiA);
   free(seripsiB);
-  /* TODO free hash table entries */
+  if (bpaglobals.hashtable)
+    oahttslf_destroy(bpaglobals.hashtable);
 
   return 0;
 }
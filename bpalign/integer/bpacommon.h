@@ -33,6 +33,14 @@ typedef long long  myint64_t;
 */
 
 
+/* hint the cache to fetch the line at addr for reading (no-op where the
+   compiler cannot) */
+#ifdef __GNUC__
+#define BPA_PREFETCH(addr) __builtin_prefetch((const void *)(addr), 0, 3)
+#else
+#define BPA_PREFETCH(addr)
+#endif
+
 /* integer absolute value */
 #define INTEGER_ABS(x) ((x < 0) ? -(x) : x)
 
@@ -54,7 +54,7 @@
 static map_t *hashtable; /* hash table from nbds */
 
 /* instrumentation is per-thread, each thread only writes to its own element */
-static volatile bpastats_t bpastats[MAX_NUM_THREADS];
+static shardcount_t bpastats;
 
 
 /* structures passed to each thread  as parameter */
@@ -376,7 +376,7 @@ void *bpa_dynprogm_thread(void *threadarg)
 
   bpa_log_msg(funcname, "%d\t\t%d\t%d\t%d\t%d\n",mydata->thread_id,i,j,k,l);
 
-  bpastats[mydata->thread_id].count_dynprogm_entry++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_DYNPROGM_ENTRY);
 
   /* memoization: if value here already computed then do nothing */
   key.i = i; key.j = j; key.k = k; key.l = l;
@@ -384,7 +384,7 @@ void *bpa_dynprogm_thread(void *threadarg)
     return NULL;
 
 
-  bpastats[mydata->thread_id].count_dynprogm_entry_notmemoed++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
 
   /*
    *  Initialization cases for the d.p. matrix S:
@@ -397,7 +397,7 @@ void *bpa_dynprogm_thread(void *threadarg)
     bpa_log_msg(funcname, "%d\tI\t%d\t%d\t%d\t%d\t%lld\n",mydata->thread_id,i,j,k,l,score);
     map_set(hashtable, (map_key_t)tuple2int(&key), (map_val_t)(i+j+k+l+1));
     map_set_indices(hashtable, i, j, k, l, score);
-    bpastats[mydata->thread_id].count_S++;
+    SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_S);
     return NULL;
   }
 
@@ -598,7 +598,7 @@ void *bpa_dynprogm_thread(void *threadarg)
 
   bpa_log_msg(funcname, "%d\tS\t%d\t%d\t%d\t%d\t%lld\n",mydata->thread_id,i,j,k,l,score);
   map_set_indices(hashtable, i, j, k, l, score);
-  bpastats[mydata->thread_id].count_S++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_S);
   return NULL;
 }
 
@@ -693,13 +693,17 @@ double bpa_dynprogm_thread_master(int i, int j, int k, int l)
     for (t = 0; t < bpaglobals.num_threads; t++)
     {
       printf("stats for thread %d:\n", t);
-      printf("  S cells computed = %lu\n", bpastats[t].count_S);
-      printf("  calls to dynprogm = %lu\n", bpastats[t].count_dynprogm_entry);
+      printf("  S cells computed = %lu\n",
+             SHARDCOUNT_GET(&bpastats, t, BPASTATS_S));
+      printf("  calls to dynprogm = %lu\n",
+             SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY));
       printf("  calls to dynprogm where not memoed = %lu\n",
-             bpastats[t].count_dynprogm_entry_notmemoed);
-      total_count_S += bpastats[t].count_S;
-      total_count_dynprogm_entry += bpastats[t].count_dynprogm_entry;
-      total_count_dynprogm_entry_notmemoed += bpastats[t].count_dynprogm_entry_notmemoed;
+             SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED));
+      total_count_S += SHARDCOUNT_GET(&bpastats, t, BPASTATS_S);
+      total_count_dynprogm_entry +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY);
+      total_count_dynprogm_entry_notmemoed +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
     }
     printf("totals:\n");
     printf("  S cells computed = %lu\n", total_count_S);
@@ -51,7 +51,7 @@
 
 #ifdef USE_INSTRUMENT
 /* instrumentation is per-thread, each thread only writes to its own element */
-static volatile bpastats_t bpastats[MAX_NUM_THREADS];
+static shardcount_t bpastats;
 #endif
 
 
@@ -82,6 +82,10 @@ static void oahttslf_insert_indices(uint16_t i, uint16_t j,
 static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
                                     uint16_t k, uint16_t l);
 
+/* value at (i,j,k,l), computing it again if it is no longer there */
+static myint64_t bpa_dynprogm_value(int thread_id,
+                                    int i, int j, int k, int l);
+
 /* dodgy: 0 is the OAHTTSLF_EMPTY_KEY and OAHTTSLF_EMPTY_VALUE value,
    so if key or value is 0 set it to MAGIC_ZERO instead */
 #define MAGIC_ZERO 0xffffffffffffffff
@@ -116,7 +120,7 @@ static void oahttslf_insert_indices(uint16_t i, uint16_t j,
          ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
 //  printf("zz %d,%d,%d,%d\t\t%016lX\n",i,j,k,l,key);
   val = (value == 0 ? NEGINF : value);
-  oahttslf_insert(key, val, thread_id);
+  oahttslf_insert(bpaglobals.hashtable, key, val, thread_id);
 }
 
 
@@ -142,7 +146,7 @@ static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
          ((uint64_t)i << 47) | ((uint64_t)(j & 0xffff) << 31) |
          ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
 
-  found =  oahttslf_lookup(key, &val);
+  found =  oahttslf_lookup(bpaglobals.hashtable, key, &val);
   if (found)
     return (val <= NEGINF ? 0 : val);
   else
@@ -151,6 +155,36 @@ static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
 
 
 
+/*
+ * bpa_dynprogm_value()
+ *
+ * Get the value at (i,j,k,l), which has been computed, from the
+ * hashtable. If it is a cache (-m) the value may have been evicted
+ * since, in which case it is computed again in this thread.
+ *
+ *      Parameters:   thread_id - our thread id
+ *                    i,j,k,l   - co-ords of the value
+ *
+ *      Return value: value of d.p. at (i,j,k,l)
+ */
+static myint64_t bpa_dynprogm_value(int thread_id,
+                                    int i, int j, int k, int l)
+{
+  thread_data_t dummy_thread_data; /* for passing parameter in same thread */
+  myint64_t value;
+
+  if ((value = oahttslf_lookup_indices(i, j, k, l)) > NEGINF)
+    return value;
+  dummy_thread_data.thread_id = thread_id;
+  dummy_thread_data.i = i;
+  dummy_thread_data.j = j;
+  dummy_thread_data.k = k;
+  dummy_thread_data.l = l;
+  bpa_dynprogm_thread((void *)&dummy_thread_data);
+  return dummy_thread_data.score;
+}
+
+
 /*
  * bpa_dynprogm_thread_call()
  *
@@ -279,6 +313,8 @@ static void bpa_dynprogm_thread_call(int thread_id,
  *
  *      Return value: NULL
  *                     (Declared void * for pthreads)
+ *                     The value of d.p. at (i,j,k,l) is set in
+ *                     threadarg->score
  *
  */
 void *bpa_dynprogm_thread(void *threadarg)
@@ -325,16 +361,16 @@ void *bpa_dynprogm_thread(void *threadarg)
   bpa_log_msg(funcname, "%d\t\t%d\t%d\t%d\t%d\n",mydata->thread_id,i,j,k,l);
 
 #ifdef USE_INSTRUMENT
-  bpastats[mydata->thread_id].count_dynprogm_entry++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_DYNPROGM_ENTRY);
 #endif
 
   /* memoization: if value here already computed then do nothing */
-  if (oahttslf_lookup_indices(i, j, k, l) > NEGINF)
+  if ((mydata->score = oahttslf_lookup_indices(i, j, k, l)) > NEGINF)
     return NULL;
 
 
 #ifdef USE_INSTRUMENT
-  bpastats[mydata->thread_id].count_dynprogm_entry_notmemoed++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
 #endif
 
   /*
@@ -349,8 +385,9 @@ void *bpa_dynprogm_thread(void *threadarg)
     oahttslf_insert_indices(i, j, k, l, score, mydata->thread_id);
 /*    assert(oahttslf_lookup_indices(i,j,k,l) == score); */
 #ifdef USE_INSTRUMENT
-    bpastats[mydata->thread_id].count_S++;
+    SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_S);
 #endif
+    mydata->score = score;
     return NULL;
   }
 
@@ -526,15 +563,19 @@ void *bpa_dynprogm_thread(void *threadarg)
 #endif
 
   /* get values from hashtable. In threads other than master,
-     these must be here as calls made synchronously in thread */
+     these must be here as calls made synchronously in thread
+     (unless evicted from a cache since, then they are computed again) */
   if (comp_gapB)
-    gapB = oahttslf_lookup_indices(i + 1, j, k, l) + bpaglobals.gamma;
+    gapB = bpa_dynprogm_value(mydata->thread_id, i + 1, j, k, l) +
+           bpaglobals.gamma;
   if (comp_gapA)
-    gapA = oahttslf_lookup_indices(i, j, k + 1, l) + bpaglobals.gamma;
+    gapA = bpa_dynprogm_value(mydata->thread_id, i, j, k + 1, l) +
+           bpaglobals.gamma;
   if (comp_unpaired)
   {
     sigma_ik = BPA_SIGMA(bpaglobals.seqA[i], bpaglobals.seqB[k]);
-    unpaired = oahttslf_lookup_indices(i+1, j, k+1, l) + sigma_ik;
+    unpaired = bpa_dynprogm_value(mydata->thread_id, i+1, j, k+1, l) +
+               sigma_ik;
   }
 
 /*   assert(gapB > NEGINF); */
@@ -545,7 +586,7 @@ void *bpa_dynprogm_thread(void *threadarg)
   score = MAX(gapmax, unpaired); /* max of first 3 cases */
 
   /* Now get all the sm and shq values from hashtable and find max */
-  /* All the values must be present as we have either joined the thread
+  /* All the values have been computed as we have either joined the thread
      that set them, or it was called synchronously in this thread */
   for (x = 0; x < bpaglobals.ipsilistA[i].num_elements; x++)
   {
@@ -564,8 +605,9 @@ void *bpa_dynprogm_thread(void *threadarg)
       
       pairedscore = psiA_ih + psiB_kq; /* TODO: add sigma_tau() score too */
       assert(pairedscore >= 0);
-      sm = oahttslf_lookup_indices( i+1, h-1, k+1, q-1) + pairedscore;
-      shq = sm + oahttslf_lookup_indices( h+1, j, q+1, l);
+      sm = bpa_dynprogm_value(mydata->thread_id, i+1, h-1, k+1, q-1) +
+           pairedscore;
+      shq = sm + bpa_dynprogm_value(mydata->thread_id, h+1, j, q+1, l);
 /*      assert(sm > NEGINF); */
       if (shq > max_shq)
         max_shq = shq;
@@ -578,8 +620,9 @@ void *bpa_dynprogm_thread(void *threadarg)
   oahttslf_insert_indices(i, j, k, l, score, mydata->thread_id);
 /*  assert(oahttslf_lookup_indices(i,j,k,l) == score); */
 #ifdef USE_INSTRUMENT
-  bpastats[mydata->thread_id].count_S++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_S);
 #endif
+  mydata->score = score;
   return NULL;
 }
 
@@ -667,16 +710,20 @@ int64_t bpa_dynprogm_thread_master(int i, int j, int k, int l)
       if (bpaglobals.verbose)
       {
         printf("stats for thread %d:\n", t);
-        printf("  S cells computed = %lu\n", bpastats[t].count_S);
-        printf("  calls to dynprogm = %lu\n", bpastats[t].count_dynprogm_entry);
+        printf("  S cells computed = %lu\n",
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_S));
+        printf("  calls to dynprogm = %lu\n",
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY));
         printf("  calls to dynprogm where not memoed = %lu\n",
-               bpastats[t].count_dynprogm_entry_notmemoed);
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED));
       }
-      total_count_S += bpastats[t].count_S;
-      total_count_dynprogm_entry += bpastats[t].count_dynprogm_entry;
-      total_count_dynprogm_entry_notmemoed += bpastats[t].count_dynprogm_entry_notmemoed;
+      total_count_S += SHARDCOUNT_GET(&bpastats, t, BPASTATS_S);
+      total_count_dynprogm_entry +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY);
+      total_count_dynprogm_entry_notmemoed +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
     }
-    num_keys = (counter_t)oahttslf_total_key_count();
+    num_keys = (counter_t)oahttslf_total_key_count(bpaglobals.hashtable);
     if (bpaglobals.verbose)
     {
       printf("totals:\n");
@@ -690,7 +737,7 @@ int64_t bpa_dynprogm_thread_master(int i, int j, int k, int l)
       printf("COMPILED WITHOUT -DUSE_INSTRUMENT\n");
 #endif
   }
-  return oahttslf_lookup_indices(i, j, k, l);
+  return master_thread_data.score;
 }
 
 
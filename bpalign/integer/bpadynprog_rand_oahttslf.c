@@ -31,6 +31,7 @@
 #include <pthread.h>
 
 #include "oahttslf.h"
+#include "l1memo.h"
 #include "bpacommon.h"
 #include "bpaglobals.h"
 #include "bpastats.h"
@@ -40,6 +41,10 @@
 
 #define MAX_IPSILIST_LEN 600 /* TODO: make this dynamic */
 
+/* number of ipsilistB elements whose child subproblems are prefetched
+   together, bounded so the batch fits on the stack */
+#define BPA_LOOKUP_BATCH 16
+
 /*****************************************************************************
  *
  * static data
@@ -48,7 +53,7 @@
 
 #ifdef USE_INSTRUMENT
 /* instrumentation is per-thread, each thread only writes to its own element */
-static volatile bpastats_t bpastats[MAX_NUM_THREADS];
+static shardcount_t bpastats;
 #endif
 
 
@@ -74,86 +79,124 @@ static unsigned int num_active_threads = 0; /* we do not count the master thread
  *****************************************************************************/
 
 
-/* insert by (i,j,k,l) into table */
-static void oahttslf_insert_indices(uint16_t i, uint16_t j, 
-                                    uint16_t k, uint16_t l,
-                                    myint64_t value, int thread_id);
+/* give (i,j,k,l) claimed by oahttslf_find_or_claim_indices() its value */
+static void oahttslf_publish_indices(const oahttslf_handle_t *handle,
+                                     myint64_t value, int thread_id);
 
-/* lookup by (i,j,k,l) */
-static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
-                                    uint16_t k, uint16_t l);
+/* lookup by (i,j,k,l), claiming its slot if not found */
+static oahttslf_state_t oahttslf_find_or_claim_indices(uint16_t i,
+                                                       uint16_t j,
+                                                       uint16_t k,
+                                                       uint16_t l,
+                                                       myint64_t *value,
+                                                       oahttslf_handle_t *handle,
+                                                       int thread_id);
 
 /* dodgy: 0 is the OAHTTSLF_EMPTY_KEY and OAHTTSLF_EMPTY_VALUE value,
    so if key or value is 0 set it to MAGIC_ZERO instead */
 #define MAGIC_ZERO 0xffffffffffffffff
 
 
+/*
+ * oahttslf_key_indices()
+ *
+ * Build the hashtable key for (i,j,k,l)
+ *
+ * Parameters:
+ *    i,j,k,l - indices to build key from
+ *
+ * Return value:
+ *    key for (i,j,k,l)
+ */
+static uint64_t oahttslf_key_indices(uint16_t i, uint16_t j,
+                                     uint16_t k, uint16_t l)
+{
+  return (i == 0 && j == 0 && k == 0 && l == 0 ? MAGIC_ZERO : 
+          ((uint64_t)i << 47) | ((uint64_t)(j & 0xffff) << 31) |
+          ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
+}
 
 
 /*
- * oahttslf_insert_indices()
+ * oahttslf_publish_indices()
  *
- * Insert value for (i,j,k,l) into the hashtable
+ * Give (i,j,k,l) its value in the slot claimed for it by
+ * oahttslf_find_or_claim_indices(), without probing for it again,
+ * and put it in the thread's own cache if there is one
  *
  * Parameters:
- *    i,j,k,l - indices to build insertion key
- *    value - value to insert for the key
+ *    handle - slot claimed for (i,j,k,l)
+ *    value - value for (i,j,k,l)
  *    thread_id - id (0,...n, not pthread id) of this thread
  *
  * Return value:
  *    None.
  */
-static void oahttslf_insert_indices(uint16_t i, uint16_t j, 
-                                    uint16_t k, uint16_t l,
-                                    myint64_t value,
-                                    int thread_id)
-
+static void oahttslf_publish_indices(const oahttslf_handle_t *handle,
+                                     myint64_t value, int thread_id)
 {
-  uint64_t key;
   myint64_t val;
 
-  key = (i == 0 && j == 0 && k == 0 && l == 0 ? MAGIC_ZERO : 
-         ((uint64_t)i << 47) | ((uint64_t)(j & 0xffff) << 31) |
-         ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
-//  printf("zz %d,%d,%d,%d\t\t%016lX\n",i,j,k,l,key);
   val = (value == 0 ? NEGINF : value);
-  oahttslf_insert(key, val, thread_id);
+  oahttslf_publish(bpaglobals.hashtable, handle, val, thread_id);
+  if (bpaglobals.l1memo)
+    L1MEMO_PUT(bpaglobals.l1memo, thread_id, handle->key, (uint64_t)value);
 }
 
 
 
 /*
- * oahttslf_lookup_indices()
+ * oahttslf_find_or_claim_indices()
  *
- * Get the value for (i,j,k,l) from the hashtable
+ * Get the value for (i,j,k,l) from the hashtable, or if it is not there
+ * claim the slot for it to be given its value by
+ * oahttslf_publish_indices(), all in one probe. Looks in the thread's
+ * own cache first if there is one, and puts what it finds in the
+ * hashtable there.
  *
  * Parameters:
  *     i,j,k,l - indices to build key for lookup
+ *     value - (OUTPUT) value for (i,j,k,l), only set if OAHTTSLF_FOUND
+ *             returned
+ *     handle - (OUTPUT) slot for (i,j,k,l), set unless OAHTTSLF_FOUND
+ *              returned
+ *     thread_id - id (0,...n, not pthread id) of this thread
  * 
  * Return value:
- *     value if key found, else NEGINF
+ *     OAHTTSLF_FOUND if found, else OAHTTSLF_PENDING if another thread
+ *     has claimed (i,j,k,l) and not yet published its value, else
+ *     OAHTTSLF_CLAIMED
  */
-static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
-                                    uint16_t k, uint16_t l)
+static oahttslf_state_t oahttslf_find_or_claim_indices(uint16_t i,
+                                                       uint16_t j,
+                                                       uint16_t k,
+                                                       uint16_t l,
+                                                       myint64_t *value,
+                                                       oahttslf_handle_t *handle,
+                                                       int thread_id)
 {
   uint64_t key;
   myint64_t val;
-  bool found;
-  key = (i == 0 && j == 0 && k == 0 && l == 0 ? MAGIC_ZERO : 
-         ((uint64_t)i << 47) | ((uint64_t)(j & 0xffff) << 31) |
-         ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
-
-  found =  oahttslf_lookup(key, &val);
-  if (found)
-    return (val <= NEGINF ? 0 : val);
-  else
-    return NEGINF;
+  oahttslf_state_t state;
+  key = oahttslf_key_indices(i, j, k, l);
+
+  if (bpaglobals.l1memo &&
+      L1MEMO_LOOKUP(bpaglobals.l1memo, thread_id, key, (uint64_t *)value))
+    return OAHTTSLF_FOUND;
+  state = oahttslf_find_or_claim(bpaglobals.hashtable, key,
+                                 (uint64_t *)&val, handle, thread_id);
+  if (state == OAHTTSLF_FOUND)
+  {
+    *value = (val <= NEGINF ? 0 : val);
+    if (bpaglobals.l1memo)
+      L1MEMO_PUT(bpaglobals.l1memo, thread_id, key, (uint64_t)*value);
+  }
+  return state;
 }
 
 
 
 
-
 /*****************************************************************************
  *
  * external functions
@@ -167,8 +210,53 @@ static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
 
 void *bpa_dynprogm_thread_wrapper(void *threadarg);
 
-static myint64_t bpa_dynprogm(int i, int j, int k, int l,
-                    int thread_id, unsigned int *seed);
+static myint64_t bpa_dynprogm_claimed(int i, int j, int k, int l,
+                                      const oahttslf_handle_t *handle,
+                                      int thread_id, unsigned int *seed);
+
+
+/*
+ * bpa_dynprogm()
+ *
+ *      The dynamic programming (top down memoization)
+ *      computation for base pair probability matrix alignment:
+ *      the value of S at (i,j,k,l) if already computed, else computed
+ *      by bpa_dynprogm_claimed(). One probe of the hashtable finds the
+ *      value, or claims (i,j,k,l) for us to compute, or finds that
+ *      another thread has claimed it and not yet finished. In that
+ *      last case, if the caller can do something else first it is
+ *      told so, otherwise we compute it too.
+ *
+ *      Parameters:   i,j,k,l - co-ords, as for bpa_dynprogm_claimed()
+ *                    defer  - if TRUE, return NEGINF without computing
+ *                             anything if another thread is computing
+ *                             (i,j,k,l), so the caller can come back to
+ *                             it later
+ *                  thread_id - id (0,...n, not pthread id) of this thread
+ *                  seed   - seed for rand_r()
+ *
+ *      Return value: The value of the dp at i,j,k,l, or NEGINF if
+ *                    defer and another thread is computing it
+ */
+static myint64_t bpa_dynprogm(int i, int j, int k, int l, bool defer,
+                              int thread_id, unsigned int *seed)
+{
+  oahttslf_handle_t handle; /* slot claimed for (i,j,k,l) on memo miss */
+  oahttslf_state_t state;
+  myint64_t value;
+
+  state = oahttslf_find_or_claim_indices(i, j, k, l, &value, &handle,
+                                         thread_id);
+  if (state == OAHTTSLF_PENDING && defer)
+    return NEGINF;
+#ifdef USE_INSTRUMENT
+  SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_DYNPROGM_ENTRY);
+#endif
+  /* memoization: if value here already computed then just return it */
+  if (state == OAHTTSLF_FOUND)
+    return value;
+  return bpa_dynprogm_claimed(i, j, k, l, &handle, thread_id, seed);
+}
 
 
 /*
@@ -196,7 +284,7 @@ void *bpa_dynprogm_thread_wrapper(void *threadarg)
 
   unsigned int seed = (unsigned int)pthread_self() * time(NULL);
   mydata->score = bpa_dynprogm(mydata->i, mydata->j, mydata->k, mydata->l,
-                               mydata->thread_id, &seed);
+                               FALSE, mydata->thread_id, &seed);
 
   /* signal thread termination so master can detect a thread finished */
   pthread_mutex_lock(&term_mutex);
@@ -209,7 +297,7 @@ void *bpa_dynprogm_thread_wrapper(void *threadarg)
 
 
 /*
- * bpa_dynprogm()
+ * bpa_dynprogm_claimed()
  *
  *      The dynamic programming (top down memoization)
  *      computation for base pair probability matrix alignment.
@@ -224,6 +312,12 @@ void *bpa_dynprogm_thread_wrapper(void *threadarg)
  *
  *      Choice of subproblem order is randomized so that all threads
  *      run this same code, but diverge in thei rprocessing randomly.
+ *      Subproblems that another thread has claimed but not finished
+ *      are left until last, by which time they are usually done.
+ *      Each subproblem is looked up, and claimed if not found, with one
+ *      probe by bpa_dynprogm(); the child keys of the gap cases and of
+ *      each batch of pair cases are prefetched first so that their
+ *      cache misses overlap.
  *      This version uses no bounding.
  *
  *
@@ -237,6 +331,8 @@ void *bpa_dynprogm_thread_wrapper(void *threadarg)
  *                    l     - right co-ord in second sequence
  *                            0 <= i < j <= n1 - 1
  *                            0 <= k < l <= n2 - 1
+ *                  handle - slot claimed for (i,j,k,l) by bpa_dynprogm(),
+ *                           which the value is published in
  *                  thread_id - id (0,...n, not pthread id) of this thread
  *                  seed   - seed for rand_r()
  *
@@ -258,21 +354,28 @@ void *bpa_dynprogm_thread_wrapper(void *threadarg)
  *      Return value: The value of the dp at i,j,k,l
  *
  */
-static myint64_t bpa_dynprogm(int i, int j, int k, int l,
-                    int thread_id, unsigned int *seed)
+static myint64_t bpa_dynprogm_claimed(int i, int j, int k, int l,
+                                      const oahttslf_handle_t *handle,
+                                      int thread_id, unsigned int *seed)
 {
   static const char *funcname = "bpa_dynprogm";
   myint64_t score = NEGINF;
-  myint64_t gapA, gapB, unpaired, gapmax, pairedscore;
+  myint64_t gapA = NEGINF, gapB = NEGINF, unpaired = NEGINF;
+  myint64_t gapmax, pairedscore;
   myint64_t sigma_ik;
   int h,q; /* h and q are the pairing co-ords used in the recurrence */
   int x,y,xprime,yprime,z; /* just loop indices, no meaning */
   myint64_t psiA_ih, psiB_kq; /* psi value at seqA[i,h] and seqB[k,q] */
   myint64_t sm, shq, max_shq;
-  myint64_t value;
   int ipsilistA_permutation[MAX_IPSILIST_LEN];
   int ipsilistB_permutation[MAX_IPSILIST_LEN];
   bool done_gapA = FALSE, done_gapB = FALSE, done_unpaired = FALSE;
+  uint64_t keys[2 * BPA_LOOKUP_BATCH]; /* child keys to prefetch */
+  myint64_t child;
+  bool defer;
+  unsigned int nbatch;
+  int numA, numB;  /* number of ipsilistA (+3) and ipsilistB cases */
+  int num_deferredA, num_deferredB; /* cases left until the end */
 
   assert(i >= 0);
   assert(i < bpaglobals.seqlenA);
@@ -288,15 +391,7 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
   bpa_log_msg(funcname, "\t%d\t%d\t%d\t%d\n",i,j,k,l);
 
 #ifdef USE_INSTRUMENT
-  bpastats[thread_id].count_dynprogm_entry++;
-#endif
-
-  /* memoization: if value here already computed then just return it */
-  if ((value =  oahttslf_lookup_indices(i, j, k, l)) > NEGINF)
-    return value;
-
-#ifdef USE_INSTRUMENT
-  bpastats[thread_id].count_dynprogm_entry_notmemoed++;
+  SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
 #endif
 
   /*
@@ -308,9 +403,9 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
   {
     score = fabs((j - i) - (l - k)) * bpaglobals.gamma;
     bpa_log_msg(funcname, "I\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
-    oahttslf_insert_indices(i, j, k, l, score, thread_id);
+    oahttslf_publish_indices(handle, score, thread_id);
 #ifdef USE_INSTRUMENT
-    bpastats[thread_id].count_S++;
+    SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_S);
 #endif
     return score;
   }
@@ -336,6 +431,15 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
    *                                tau[Ai,Aj,Bk,Bl]
    */
   max_shq = NEGINF;
+
+  /* start the cache misses for the gap and unpaired children together
+     (and below, for the children of a batch of pairs together) so they
+     overlap; each is then looked up or claimed by bpa_dynprogm() */
+  keys[0] = oahttslf_key_indices(i + 1, j, k, l);
+  keys[1] = oahttslf_key_indices(i, j, k + 1, l);
+  keys[2] = oahttslf_key_indices(i + 1, j, k + 1, l);
+  oahttslf_prefetch(bpaglobals.hashtable, keys, 3);
+
   /* iterate over  ipsilistA  elements in random order */
   /* The additional 3 indices stand for gapB, gapA and unpaired
      respectively, so we are randomly ordering not just the ipsilist
@@ -355,39 +459,53 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
     for (z = 3; z < bpaglobals.ipsilistA[i].num_elements + 3; z++)
       ipsilistA_permutation[z] = z - 3;
   }
-  for (x = 0; x < bpaglobals.ipsilistA[i].num_elements + 3; x++)
+  numA = bpaglobals.ipsilistA[i].num_elements + 3;
+  num_deferredA = 0;
+  for (x = 0; x < numA + num_deferredA; x++)
   {
-    xprime = ipsilistA_permutation[x];
+    xprime = ipsilistA_permutation[x < numA ? x : x - numA];
+    defer = (x < numA);
     if (xprime >= bpaglobals.ipsilistA[i].num_elements)
     {
       /* one of the two gap cases or the unpaired cases, not an ipsilist case*/
+      child = 0;
       switch (xprime - bpaglobals.ipsilistA[i].num_elements)
       {
         case 0:
           if (i + 1 < bpaglobals.seqlenA && i + 1 < j)
-            gapB = bpa_dynprogm(i + 1, j, k, l, thread_id, seed) + bpaglobals.gamma;
+          {
+            if ((child = bpa_dynprogm(i + 1, j, k, l, defer,
+                                      thread_id, seed)) > NEGINF)
+              gapB = child + bpaglobals.gamma;
+          }
           else
             gapB = NEGINF;
-          done_gapB = TRUE;
+          done_gapB = (child > NEGINF);
           break;
 
         case 1:
           if (k + 1 < bpaglobals.seqlenB && k + 1 < l)
-            gapA = bpa_dynprogm(i, j, k + 1, l, thread_id, seed) + bpaglobals.gamma;
+          {
+            if ((child = bpa_dynprogm(i, j, k + 1, l, defer,
+                                      thread_id, seed)) > NEGINF)
+              gapA = child + bpaglobals.gamma;
+          }
           else
             gapA = NEGINF;
-          done_gapA = TRUE;
+          done_gapA = (child > NEGINF);
           break;
 
         case 2:
           if (i+1 < bpaglobals.seqlenA && i+1 < j && k+1 < bpaglobals.seqlenB && k+1 < l)
           {
             sigma_ik = BPA_SIGMA(bpaglobals.seqA[i], bpaglobals.seqB[k]);
-            unpaired = bpa_dynprogm(i+1, j, k+1, l, thread_id, seed) + sigma_ik;
+            if ((child = bpa_dynprogm(i+1, j, k+1, l, defer,
+                                      thread_id, seed)) > NEGINF)
+              unpaired = child + sigma_ik;
           }
           else
             unpaired = NEGINF;
-          done_unpaired = TRUE;
+          done_unpaired = (child > NEGINF);
           break;
 
         default:
@@ -395,6 +513,13 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
                           xprime - bpaglobals.ipsilistA[i].num_elements);
           break;
       }
+      /* a case whose subproblem another thread has claimed but not yet
+         finished is left until after all the others, so that we do not
+         compute it too: it is moved into the part of the permutation we
+         have already been through, which is gone through again at the
+         end */
+      if (child <= NEGINF)
+        ipsilistA_permutation[num_deferredA++] = xprime;
       continue; /* done with this case */
     }
 
@@ -414,9 +539,24 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
     else
       for (z = 0; z < bpaglobals.ipsilistB[k].num_elements; z++)
         ipsilistB_permutation[z] = z;
-    for (y = 0; y < bpaglobals.ipsilistB[k].num_elements; y++)
+    numB = bpaglobals.ipsilistB[k].num_elements;
+    num_deferredB = 0;
+    for (y = 0; y < numB + num_deferredB; y++)
     {
-      yprime = ipsilistB_permutation[y];
+      if (y < numB && y % BPA_LOOKUP_BATCH == 0)
+      {
+        /* start the cache misses for the children of the next batch of
+           pairs together */
+        nbatch = 0;
+        for (z = y; z < numB && z < y + BPA_LOOKUP_BATCH; z++)
+        {
+          q = bpaglobals.ipsilistB[k].ipsi[ipsilistB_permutation[z]].right;
+          keys[nbatch++] = oahttslf_key_indices(i+1, h-1, k+1, q-1);
+          keys[nbatch++] = oahttslf_key_indices(h+1, j, q+1, l);
+        }
+        oahttslf_prefetch(bpaglobals.hashtable, keys, nbatch);
+      }
+      yprime = ipsilistB_permutation[y < numB ? y : y - numB];
       q = bpaglobals.ipsilistB[k].ipsi[yprime].right;
 //      if (q >= l)
 //        break; /* similarly have finished in (k,l) interval */
@@ -432,8 +572,20 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
        * here not +1 and +1 (j+1 and l+1 in the paper's
        * formulation).
        */
-      sm = bpa_dynprogm(i+1, h-1, k+1, q-1, thread_id, seed) + pairedscore;
-      shq = sm + bpa_dynprogm(h+1, j, q+1, l, thread_id, seed);
+      /* as for the gap cases, a pair either of whose subproblems another
+         thread is computing is left until the end (the first one, if we
+         did compute it, is then just found) */
+      defer = (y < numB);
+      if ((sm = bpa_dynprogm(i+1, h-1, k+1, q-1, defer,
+                             thread_id, seed)) <= NEGINF ||
+          (child = bpa_dynprogm(h+1, j, q+1, l, defer,
+                                thread_id, seed)) <= NEGINF)
+      {
+        ipsilistB_permutation[num_deferredB++] = yprime;
+        continue;
+      }
+      sm += pairedscore;
+      shq = sm + child;
       if (shq > max_shq)
         max_shq = shq;
     }
@@ -446,9 +598,9 @@ static myint64_t bpa_dynprogm(int i, int j, int k, int l,
   score = MAX(score, max_shq);
 
   bpa_log_msg(funcname, "S\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
-  oahttslf_insert_indices(i, j, k, l, score, thread_id);
+  oahttslf_publish_indices(handle, score, thread_id);
 #ifdef USE_INSTRUMENT
-  bpastats[thread_id].count_S++;
+  SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_S);
 #endif
   return score;
 }
@@ -593,16 +745,20 @@ int64_t bpa_dynprogm_thread_master(int i, int j, int k, int l)
       if (bpaglobals.verbose)
       {
         printf("stats for thread %d:\n", t);
-        printf("  S cells computed = %lu\n", bpastats[t].count_S);
-        printf("  calls to dynprogm = %lu\n", bpastats[t].count_dynprogm_entry);
+        printf("  S cells computed = %lu\n",
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_S));
+        printf("  calls to dynprogm = %lu\n",
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY));
         printf("  calls to dynprogm where not memoed = %lu\n",
-               bpastats[t].count_dynprogm_entry_notmemoed);
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED));
       }
-      total_count_S += bpastats[t].count_S;
-      total_count_dynprogm_entry += bpastats[t].count_dynprogm_entry;
-      total_count_dynprogm_entry_notmemoed += bpastats[t].count_dynprogm_entry_notmemoed;
+      total_count_S += SHARDCOUNT_GET(&bpastats, t, BPASTATS_S);
+      total_count_dynprogm_entry +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY);
+      total_count_dynprogm_entry_notmemoed +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
     }
-    num_keys = (counter_t)oahttslf_total_key_count();
+    num_keys = (counter_t)oahttslf_total_key_count(bpaglobals.hashtable);
     if (bpaglobals.verbose) 
     {
       printf("totals:\n");
@@ -755,7 +911,7 @@ static myint64_t bpa_dynprogm_thread_array(int i, int j, int k, int l,
   bpa_log_msg(funcname, "\t%d\t%d\t%d\t%d\n",i,j,k,l);
 
 #ifdef USE_INSTRUMENT
-  bpastats[thread_id].count_dynprogm_entry++;
+  SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_DYNPROGM_ENTRY);
 #endif
 
   /* memoization: if value here already computed then just return it */
@@ -763,7 +919,7 @@ static myint64_t bpa_dynprogm_thread_array(int i, int j, int k, int l,
     return score;
 
 #ifdef USE_INSTRUMENT
-  bpastats[thread_id].count_dynprogm_entry_notmemoed++;
+  SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
 #endif
 
   /*
@@ -777,7 +933,7 @@ static myint64_t bpa_dynprogm_thread_array(int i, int j, int k, int l,
     bpa_log_msg(funcname, "I\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
     S[INDEX4D(i,j,k,l,n1,n2)] = score;
 #ifdef USE_INSTRUMENT
-    bpastats[thread_id].count_S++;
+    SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_S);
 #endif
     return score;
   }
@@ -804,6 +960,17 @@ static myint64_t bpa_dynprogm_thread_array(int i, int j, int k, int l,
    *                                tau[Ai,Aj,Bk,Bl]
    */
   max_shq = NEGINF;
+
+  /* start the cache misses for the gap and unpaired children now (and
+     below, for the children of a batch of pairs) so they overlap with
+     each other and with the recursion */
+  if (i + 1 < n1)
+    BPA_PREFETCH(&S[INDEX4D(i+1,j,k,l,n1,n2)]);
+  if (k + 1 < n2)
+    BPA_PREFETCH(&S[INDEX4D(i,j,k+1,l,n1,n2)]);
+  if (i + 1 < n1 && k + 1 < n2)
+    BPA_PREFETCH(&S[INDEX4D(i+1,j,k+1,l,n1,n2)]);
+
   /* iterate over  ipsilistA  elements in random order */
   /* The additional 3 indices stand for gapB, gapA and unpaired
      respectively, so we are randomly ordering not just the ipsilist
@@ -883,6 +1050,18 @@ static myint64_t bpa_dynprogm_thread_array(int i, int j, int k, int l,
         ipsilistB_permutation[z] = z;
     for (y = 0; y < bpaglobals.ipsilistB[k].num_elements; y++)
     {
+      if (y % BPA_LOOKUP_BATCH == 0)
+      {
+        /* prefetch the children of the next batch of pairs */
+        for (z = y; z < bpaglobals.ipsilistB[k].num_elements &&
+               z < y + BPA_LOOKUP_BATCH; z++)
+        {
+          q = bpaglobals.ipsilistB[k].ipsi[ipsilistB_permutation[z]].right;
+          if (q >= l) continue;
+          BPA_PREFETCH(&S[INDEX4D(i+1,h-1,k+1,q-1,n1,n2)]);
+          BPA_PREFETCH(&S[INDEX4D(h+1,j,q+1,l,n1,n2)]);
+        }
+      }
       yprime = ipsilistB_permutation[y];
       q = bpaglobals.ipsilistB[k].ipsi[yprime].right;
 //      if (q >= l)
@@ -915,7 +1094,7 @@ static myint64_t bpa_dynprogm_thread_array(int i, int j, int k, int l,
   bpa_log_msg(funcname, "S\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
   S[INDEX4D(i,j,k,l,n1,n2)] = score;
 #ifdef USE_INSTRUMENT
-  bpastats[thread_id].count_S++;
+  SHARDCOUNT_INC(&bpastats, thread_id, BPASTATS_S);
 #endif
   return score;
 }
@@ -1060,14 +1239,18 @@ int64_t bpa_dynprogm_thread_array_master(int i, int j, int k, int l, myint64_t *
       if (bpaglobals.verbose)
       {
         printf("stats for thread %d:\n", t);
-        printf("  S cells computed = %lu\n", bpastats[t].count_S);
-        printf("  calls to dynprogm = %lu\n", bpastats[t].count_dynprogm_entry);
+        printf("  S cells computed = %lu\n",
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_S));
+        printf("  calls to dynprogm = %lu\n",
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY));
         printf("  calls to dynprogm where not memoed = %lu\n",
-               bpastats[t].count_dynprogm_entry_notmemoed);
+               SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED));
       }
-      total_count_S += bpastats[t].count_S;
-      total_count_dynprogm_entry += bpastats[t].count_dynprogm_entry;
-      total_count_dynprogm_entry_notmemoed += bpastats[t].count_dynprogm_entry_notmemoed;
+      total_count_S += SHARDCOUNT_GET(&bpastats, t, BPASTATS_S);
+      total_count_dynprogm_entry +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY);
+      total_count_dynprogm_entry_notmemoed +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
     }
     if (bpaglobals.verbose)
     {
@@ -30,6 +30,7 @@
 #include <pthread.h>
 
 #include "oahttslf.h"
+#include "oaht.h"
 #include "bpacommon.h"
 #include "bpaglobals.h"
 #include "bpastats.h"
@@ -40,7 +41,7 @@
 
 
 /* instrumentation is per-thread, each thread only writes to its own element */
-bpastats_t bpastats[MAX_NUM_THREADS];
+shardcount_t bpastats;
 
 
 /*****************************************************************************
@@ -59,8 +60,9 @@ static void oahttslf_insert_indices(uint16_t i, uint16_t j,
 static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
                                     uint16_t k, uint16_t l);
 
-/* dodgy: 0 is the OAHTTSLF_EMPTY_KEY and OAHTTSLF_EMPTY_VALUE value,
-   so if key or value is 0 set it to MAGIC_ZERO instead */
+/* dodgy: 0 is the OAHTTSLF_EMPTY_KEY and OAHTTSLF_EMPTY_VALUE value
+   (and the OAHT_ ones), so if key or value is 0 set it to MAGIC_ZERO
+   instead */
 #define MAGIC_ZERO 0xffffffffffffffff
 
 
@@ -69,7 +71,8 @@ static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
 /*
  * oahttslf_insert_indices()
  *
- * Insert value for (i,j,k,l) into the hashtable
+ * Insert value for (i,j,k,l) into the hashtable (the serial one, oaht,
+ * if there is one, else the thread-safe one, oahttslf)
  *
  * Parameters:
  *    i,j,k,l - indices to build insertion key
@@ -91,7 +94,10 @@ static void oahttslf_insert_indices(uint16_t i, uint16_t j,
          ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
 //  printf("zz %d,%d,%d,%d\t\t%016lX\n",i,j,k,l,key);
   val = (value == 0 ? NEGINF : value);
-  oahttslf_insert(key, val, 0);
+  if (bpaglobals.serialtable)
+    oaht_insert(bpaglobals.serialtable, key, val);
+  else
+    oahttslf_insert(bpaglobals.hashtable, key, val, 0);
 }
 
 
@@ -99,7 +105,8 @@ static void oahttslf_insert_indices(uint16_t i, uint16_t j,
 /*
  * oahttslf_lookup_indices()
  *
- * Get the value for (i,j,k,l) from the hashtable
+ * Get the value for (i,j,k,l) from the hashtable (the serial one if
+ * there is one, as for oahttslf_insert_indices())
  *
  * Parameters:
  *     i,j,k,l - indices to build key for lookup
@@ -117,7 +124,10 @@ static myint64_t oahttslf_lookup_indices(uint16_t i, uint16_t j,
          ((uint64_t)i << 47) | ((uint64_t)(j & 0xffff) << 31) |
          ((uint64_t)(k & 0xffff) << 15) | (uint64_t)(l & 0xffff));
 
-  found =  oahttslf_lookup(key, &val);
+  if (bpaglobals.serialtable)
+    found = oaht_lookup(bpaglobals.serialtable, key, (uint64_t *)&val);
+  else
+    found =  oahttslf_lookup(bpaglobals.hashtable, key, &val);
   if (found)
     return (val <= NEGINF ? 0 : val);
   else
@@ -321,7 +331,7 @@ int64_t bpa_dynprogm(int i, int j, int k, int l)
   bpa_log_msg(funcname, "\t%d\t%d\t%d\t%d\n",i,j,k,l);
 
 #ifdef USE_INSTRUMENT
-  bpastats[0].count_dynprogm_entry++;
+  SHARDCOUNT_INC(&bpastats, 0, BPASTATS_DYNPROGM_ENTRY);
 #endif
 
   /* memoization: if value here already computed then do nothing */
@@ -329,7 +339,7 @@ int64_t bpa_dynprogm(int i, int j, int k, int l)
     return score;
 
 #ifdef USE_INSTRUMENT
-  bpastats[0].count_dynprogm_entry_notmemoed++;
+  SHARDCOUNT_INC(&bpastats, 0, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
 #endif
 
   /*
@@ -343,7 +353,7 @@ int64_t bpa_dynprogm(int i, int j, int k, int l)
     bpa_log_msg(funcname, "I\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
     oahttslf_insert_indices(i, j, k, l, score);
 #ifdef USE_INSTRUMENT
-    bpastats[0].count_S++;
+    SHARDCOUNT_INC(&bpastats, 0, BPASTATS_S);
 #endif
     return score;
   }
@@ -424,7 +434,7 @@ int64_t bpa_dynprogm(int i, int j, int k, int l)
   bpa_log_msg(funcname, "S\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
   oahttslf_insert_indices(i, j, k, l, score);
 #ifdef USE_INSTRUMENT
-  bpastats[0].count_S++;
+  SHARDCOUNT_INC(&bpastats, 0, BPASTATS_S);
 #endif
   return score;
 }
@@ -509,7 +519,7 @@ int64_t bpa_dynprogm_array(int i, int j, int k, int l, myint64_t *S)
   bpa_log_msg(funcname, "\t%d\t%d\t%d\t%d\n",i,j,k,l);
 
 #ifdef USE_INSTRUMENT
-  bpastats[0].count_dynprogm_entry++;
+  SHARDCOUNT_INC(&bpastats, 0, BPASTATS_DYNPROGM_ENTRY);
 #endif
 
   /* memoization: if value here already computed then just return it */
@@ -518,7 +528,7 @@ int64_t bpa_dynprogm_array(int i, int j, int k, int l, myint64_t *S)
     return score;
 
 #ifdef USE_INSTRUMENT
-  bpastats[0].count_dynprogm_entry_notmemoed++;
+  SHARDCOUNT_INC(&bpastats, 0, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
 #endif
 
   /*
@@ -532,7 +542,7 @@ int64_t bpa_dynprogm_array(int i, int j, int k, int l, myint64_t *S)
     bpa_log_msg(funcname, "I\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
     S[INDEX4D(i,j,k,l,n1,n2)] = score;
 #ifdef USE_INSTRUMENT
-    bpastats[0].count_S++;
+    SHARDCOUNT_INC(&bpastats, 0, BPASTATS_S);
 #endif
     return score;
   }
@@ -613,7 +623,7 @@ int64_t bpa_dynprogm_array(int i, int j, int k, int l, myint64_t *S)
   bpa_log_msg(funcname, "S\t%d\t%d\t%d\t%d\t%lld\n",i,j,k,l,score);
   S[INDEX4D(i,j,k,l,n1,n2)] = score;
 #ifdef USE_INSTRUMENT
-  bpastats[0].count_S++;
+  SHARDCOUNT_INC(&bpastats, 0, BPASTATS_S);
 #endif
   return score;
 }
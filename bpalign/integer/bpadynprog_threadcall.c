@@ -68,7 +68,7 @@ typedef struct thread_array_data_s
 
 #ifdef USE_INSTRUMENT
 /* instrumentation is per-thread, each thread only writes to its own element */
-static volatile bpastats_t bpastats[MAX_NUM_THREADS];
+static shardcount_t bpastats;
 #endif
 
 
@@ -326,7 +326,7 @@ void *bpa_dynprogm_thread_array(void *threadarg)
   bpa_log_msg(funcname, "%d\t\t%d\t%d\t%d\t%d\n",mydata->thread_id,i,j,k,l);
 
 #ifdef USE_INSTRUMENT
-  bpastats[mydata->thread_id].count_dynprogm_entry++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_DYNPROGM_ENTRY);
 #endif
 
   /* memoization: if value here already computed then do nothing */
@@ -335,7 +335,7 @@ void *bpa_dynprogm_thread_array(void *threadarg)
     return NULL;
 
 #ifdef USE_INSTRUMENT
-  bpastats[mydata->thread_id].count_dynprogm_entry_notmemoed++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
 #endif
 
   /*
@@ -349,7 +349,7 @@ void *bpa_dynprogm_thread_array(void *threadarg)
     bpa_log_msg(funcname, "%d\tI\t%d\t%d\t%d\t%d\t%lld\n",mydata->thread_id,i,j,k,l,score);
     S[INDEX4D(i,j,k,l,n1,n2)] = score;
 #ifdef USE_INSTRUMENT
-    bpastats[mydata->thread_id].count_S++;
+    SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_S);
 #endif
     return NULL;
   }
@@ -572,7 +572,7 @@ void *bpa_dynprogm_thread_array(void *threadarg)
   bpa_log_msg(funcname, "%d\tS\t%d\t%d\t%d\t%d\t%lld\n",mydata->thread_id,i,j,k,l,score);
   S[INDEX4D(i,j,k,l,n1,n2)] = score;
 #ifdef USE_INSTRUMENT
-  bpastats[mydata->thread_id].count_S++;
+  SHARDCOUNT_INC(&bpastats, mydata->thread_id, BPASTATS_S);
 #endif
   return NULL;
 }
@@ -658,13 +658,17 @@ int64_t bpa_dynprogm_thread_array_master(int i, int j, int k, int l, myint64_t *
     for (t = 0; t < bpaglobals.num_threads; t++)
     {
       printf("stats for thread %d:\n", t);
-      printf("  S cells computed = %lu\n", bpastats[t].count_S);
-      printf("  calls to dynprogm = %lu\n", bpastats[t].count_dynprogm_entry);
+      printf("  S cells computed = %lu\n",
+             SHARDCOUNT_GET(&bpastats, t, BPASTATS_S));
+      printf("  calls to dynprogm = %lu\n",
+             SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY));
       printf("  calls to dynprogm where not memoed = %lu\n",
-             bpastats[t].count_dynprogm_entry_notmemoed);
-      total_count_S += bpastats[t].count_S;
-      total_count_dynprogm_entry += bpastats[t].count_dynprogm_entry;
-      total_count_dynprogm_entry_notmemoed += bpastats[t].count_dynprogm_entry_notmemoed;
+             SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED));
+      total_count_S += SHARDCOUNT_GET(&bpastats, t, BPASTATS_S);
+      total_count_dynprogm_entry +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY);
+      total_count_dynprogm_entry_notmemoed +=
+        SHARDCOUNT_GET(&bpastats, t, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
     }
     printf("totals:\n");
     printf("  S cells computed = %lu\n", total_count_S);
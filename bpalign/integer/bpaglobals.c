@@ -26,6 +26,11 @@ bpaglobals_t bpaglobals =
   ,FALSE /* use_array */
   ,TRUE  /* use_random */
   ,NULL  /* ubounddata_fp */
+  ,NULL  /* load_snapshot */
+  ,NULL  /* save_snapshot */
+  ,0     /* cache_mbytes */
+  ,0     /* l1_kbytes */
+  ,FALSE /* check_table */
 
   ,-60*SIGMA_MATCH     /* gamma */  
   ,SIGMA_MATCH   /* sigma_match */ /* FIXME unused */
@@ -41,4 +46,7 @@ bpaglobals_t bpaglobals =
   ,NULL   /* pairlistB */
   ,0      /* paircountA */
   ,0      /* paircountB */
+  ,NULL   /* hashtable */
+  ,NULL   /* serialtable */
+  ,NULL   /* l1memo */
 };
@@ -18,6 +18,9 @@
 #include "bpautils.h"
 #include "bpaipsilist.h"
 #include "bpaparse.h"
+#include "oahttslf.h"
+#include "oaht.h"
+#include "l1memo.h"
 
 #define PMIN 1e-04 /* minimum base pairing probability considered significant */
 #define MINLOOP 5  /* minimum size of hairpin loop */
@@ -37,6 +40,12 @@ typedef struct bpaglobals_s
     bool   use_array;      /* use array not hashtable for top-down */
     bool   use_random;     /* randomize choices in multithread version */
     FILE  *ubounddata_fp;  /* file to write ubound data for gnuplot to */
+    const char *load_snapshot; /* hashtable snapshot to start with or NULL */
+    const char *save_snapshot; /* file to save hashtable snapshot to or NULL */
+    unsigned long cache_mbytes; /* if > 0, hashtable is a cache this size */
+    unsigned long l1_kbytes;  /* if > 0, size of per-thread l1memo caches */
+    bool   check_table;    /* if true, validate hashtable and print its
+                              statistics when done */
 
     /* constants which should probably be settable from command line (TODO) */
 
@@ -56,6 +65,10 @@ typedef struct bpaglobals_s
     basepair_t  *pairlistB; /* list of (i,j,p) for 2ns seq */
     int          paircountA;/* length of pairlistA */
     int          paircountB;/* length of pairlistB */
+    oahttslf_t  *hashtable; /* d.p. values for top-down hashtable versions */
+    oaht_t      *serialtable; /* d.p. values for top-down without threads,
+                                 if not in hashtable */
+    l1memo_t    *l1memo;    /* per-thread caches in front of hashtable or NULL */
 } bpaglobals_t;
 
 extern bpaglobals_t bpaglobals;
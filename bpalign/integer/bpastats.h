@@ -14,16 +14,20 @@
  *
  *****************************************************************************/
 
+#include "shardcount.h"
+
 typedef unsigned long counter_t;
 
-typedef struct bpastats_s 
+/* indices of the per-thread counters in each engine's bpastats
+   shardcount_t (one cache line per thread, see shardcount.h) */
+enum
 {
-    counter_t count_dynprogm_entry;  /* calls of dynprogm */
-    counter_t count_dynprogm_entry_notmemoed; /* where not memo value return */
-    counter_t count_S;               /* matrix S cells computed */
-    counter_t count_U;               /* matrix U cells computed */
-    counter_t count_recomputations; /* global bounding recomputations */
-} bpastats_t;
+  BPASTATS_DYNPROGM_ENTRY,           /* calls of dynprogm */
+  BPASTATS_DYNPROGM_ENTRY_NOTMEMOED, /* where not memo value return */
+  BPASTATS_S,                        /* matrix S cells computed */
+  BPASTATS_U,                        /* matrix U cells computed */
+  BPASTATS_RECOMPUTATIONS            /* global bounding recomputations */
+};
 
 
 
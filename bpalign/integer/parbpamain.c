@@ -16,7 +16,9 @@
  * in order not to overflow the .bss due with static data (hash table);
  * they both use this module as main().
  *
- * Usage: parbpalign [-avsz] [ -t num_threads | -b ] file1.bplist file2.bplist
+ * Usage: parbpalign [-avszHNBpV] [ -t num_threads | -b ] [-l snapshot]
+ *                   [-w snapshot] [-m megabytes] [-c kbytes]
+ *                   file1.bplist file2.bplist
  *
  *   Input files are sequence and base pair probability list output from
  *   the rnafold2list.py script (which extracts it from the _dp.ps output
@@ -30,6 +32,23 @@
  *  -b             : use bottom-up implementeation rather than top-down
  *  -a             : use top-down implementation but with array not hashtable
  *  -z             : do NOT randomize choices in multithread (-t) version
+ *  -H             : use huge pages for the hashtable
+ *  -N             : interleave the hashtable over all NUMA nodes
+ *  -B             : put an equal part of the hashtable on each NUMA node
+ *  -p             : prefault the hashtable in parallel with num_threads threads
+ *  -l snapshot    : start with the hashtable saved by -w in an earlier run
+ *                   on the same two inputs (refused for other inputs)
+ *  -w snapshot    : save the hashtable to snapshot when done
+ *  -m megabytes   : keep the hashtable in this much memory, evicting
+ *                   (and later recomputing) the cheapest values to make
+ *                   room, rather than growing it as needed. The time
+ *                   grows steeply once this holds much less than all
+ *                   the states (e.g. 3 times as long at 1/10 of them,
+ *                   8 times at 1/20), see oahttslf.c
+ *  -c kbytes      : with -t, each thread looks in its own cache of this
+ *                   size (e.g. its L2) before the shared hashtable
+ *  -V             : when done, validate the hashtable and print its
+ *                   statistics, scanning it with num_threads threads
  *
  *
  * Platform and dependencies:
@@ -53,14 +72,23 @@
 
 #include "bpacommon.h"
 #include "bpautils.h"
+#include "bigmem.h"
 #include "bpaglobals.h"
 #include "bpaparse.h"
 #include "bpaipsilist.h"
 #include "bpadynprog_cpu.h"
 #include "bpadynprog_hashthread.h"
 #include "ht.h"
+#include "oahttslf.h"
+#include "hashfn.h"
 #include "bpastats.h"
 
+/* warn about -m if the cache holds fewer keys than this fraction of
+   the (i,j,k,l) with i <= j and k <= l. An alignment stores about 1/8 of
+   those, and takes many times as long when the cache holds less than
+   about 1/8 of what it stores */
+#define BPA_CACHE_WARN_FRACTION 64
+
 
 
 /*****************************************************************************
@@ -69,7 +97,72 @@
  *
  *****************************************************************************/
 
+/*
+ * bpa_problem_id()
+ *
+ * Id of the alignment of two bplist files for -l and -w snapshots, so a
+ * snapshot saved for other inputs is not loaded: a hash of what was read
+ * from them, the sequences and the base pairs (with probability at
+ * least PMIN) in order.
+ *
+ * Parameters:
+ *    bplistA - base pairs of first sequence
+ *    bplenA  - length of bplistA
+ *    bplistB - base pairs of second sequence
+ *    bplenB  - length of bplistB
+ *
+ *      Uses global data:
+ *                  readonly:
+ *                    seqA    - first sequence
+ *                    seqB    - second sequence
+ *                    seqlenA - length of first sequence
+ *                    seqlenB - length of second sequence
+ *
+ * Return value:
+ *    id of the problem
+ */
+static uint64_t bpa_problem_id(const basepair_t *bplistA, int bplenA,
+                               const basepair_t *bplistB, int bplenB)
+{
+  uint64_t h = HASHFN_BYTES_INIT;
 
+  /* each sequence with its terminating nul, so they cannot run together */
+  h = hashfn_bytes(h, bpaglobals.seqA, (size_t)bpaglobals.seqlenA + 1);
+  h = hashfn_bytes(h, bplistA, (size_t)bplenA * sizeof(basepair_t));
+  h = hashfn_bytes(h, bpaglobals.seqB, (size_t)bpaglobals.seqlenB + 1);
+  return hashfn_bytes(h, bplistB, (size_t)bplenB * sizeof(basepair_t));
+}
+
+
+/*
+ * bpa_key_cost()
+ *
+ * Cost of computing S(i,j,k,l) again if it is evicted from the hashtable
+ * made with -m, for oahttslf_create_cache(). It is the span
+ * (j-i)+(l-k) scaled to 0..OAHTTSLF_MAX_COST, since the work under a
+ * subproblem grows with its span. The key is built as in
+ * oahttslf_key_indices() in the bpadynprog_*.c modules.
+ *
+ * Parameters:
+ *    key - hashtable key for (i,j,k,l)
+ *
+ * Return value:
+ *    cost of key, 0..OAHTTSLF_MAX_COST
+ */
+static unsigned int bpa_key_cost(uint64_t key)
+{
+  unsigned int i, j, k, l, span;
+
+  if (key == 0xffffffffffffffffULL)
+    return 0; /* MAGIC_ZERO for (0,0,0,0) */
+  i = (unsigned int)(key >> 47) & 0xffff;
+  j = (unsigned int)(key >> 31) & 0xffff;
+  k = (unsigned int)(key >> 15) & 0xffff;
+  l = (unsigned int)key & 0x7fff;
+  span = (j > i ? j - i : 0) + (l > k ? l - k : 0);
+  return (unsigned int)((uint64_t)span * OAHTTSLF_MAX_COST /
+                        (bpaglobals.seqlenA + bpaglobals.seqlenB));
+}
 
 
 
@@ -100,6 +193,8 @@ counter_t total_count_S = 0, total_count_dynprogm_entry = 0,
  *                    num_threads   - number of threads to use
  *                    use_array     - use array not hashtable on top-down
  *                    printstats    - print stats about data
+ *                    cache_mbytes  - if > 0 limit hashtable to this size
+ *                    l1_kbytes     - if > 0 size of per-thread caches
  *                  read/write:
  *                    seqA    - first sequence
  *                    seqB    - second sequence
@@ -111,6 +206,10 @@ counter_t total_count_S = 0, total_count_dynprogm_entry = 0,
  *                    paircountB - length of pairlistB
  *                    ipsilistA - (j,psi) lists indexed by i for 1st seq
  *                    ipsilistB - (j,psi) lists indexed by i for 2nd seq
+ *                    hashtable - d.p. hashtable for top-down implementation
+ *                    serialtable - d.p. hashtable for top-down without
+ *                                  threads (unless saving a snapshot)
+ *                    l1memo    - per-thread caches in front of hashtable
  *                    
  *
  * Return value:
@@ -129,12 +228,13 @@ static int bpalign(const char *filename1, const char *filename2)
   ipsi_element_t *dev_seripsiA, *dev_seripsiB;
   myint64_t *dev_S;
   volatile myint64_t *matrixS;
+  uint64_t max_keys, cache_bytes, problem_id;
 
   int otime, ttime, etime;
   struct rusage starttime,totaltime,runtime,endtime,opttime;
   struct timeval start_timeval,end_timeval,elapsed_timeval;
 
-  extern bpastats_t bpastats[]; /* for bpadynprog_single only */
+  extern shardcount_t bpastats; /* for bpadynprog_single only */
 
   /*
    * read sequences and base pair probabilities and build data structures
@@ -160,6 +260,7 @@ static int bpalign(const char *filename1, const char *filename2)
   bpaglobals.pairlistB = bplistB;
   bpaglobals.paircountA = bplenA;
   bpaglobals.paircountB = bplenB;
+  problem_id = bpa_problem_id(bplistA, bplenA, bplistB, bplenB);
 
 /*  bpa_dump_bp_list(bplenA, bplistA, seqA);  */
 /*  bpa_dump_bp_list(bplenB, bplistB, seqB); */
@@ -192,6 +293,10 @@ static int bpalign(const char *filename1, const char *filename2)
     bpa_dump_seripsilist(seripsiB, bpaglobals.seqlenB, ld_seripsiB);  
   }
 
+  /* only (i,j,k,l) with i <= j and k <= l are ever stored */
+  max_keys = (uint64_t)bpaglobals.seqlenA * (bpaglobals.seqlenA + 1) / 2 *
+    bpaglobals.seqlenB * (bpaglobals.seqlenB + 1) / 2;
+
   if (bpaglobals.use_bottomup || bpaglobals.use_array)
   {
     /* allocate workarea for dp matrix */
@@ -212,6 +317,40 @@ static int bpalign(const char *filename1, const char *filename2)
 
     }
   }
+  else if (bpaglobals.cache_mbytes > 0)
+  {
+    /* for problems with more states than fit in memory */
+    cache_bytes = (uint64_t)bpaglobals.cache_mbytes << 20;
+    if (oahttslf_cache_slots(cache_bytes) < max_keys / BPA_CACHE_WARN_FRACTION)
+      fprintf(stderr,
+              "WARNING: -m %lu holds only %llu keys, far fewer than this "
+              "alignment is likely to need (about %llu): expect it to take "
+              "many times as long\n", bpaglobals.cache_mbytes,
+              (unsigned long long)oahttslf_cache_slots(cache_bytes),
+              (unsigned long long)(max_keys / 8));
+    bpaglobals.hashtable = oahttslf_create_cache(cache_bytes, bpa_key_cost);
+  }
+  else if (bpaglobals.load_snapshot)
+  {
+    /* d.p. values from an earlier run on the same inputs */
+    if (!(bpaglobals.hashtable = oahttslf_load(bpaglobals.load_snapshot,
+                                               problem_id)))
+      return -1;
+  }
+  else
+  {
+    /* without threads (the baseline) no need for thread-safe table,
+       unless it is to be saved as a snapshot */
+    if (!bpaglobals.use_threading && !bpaglobals.save_snapshot)
+      bpaglobals.serialtable = oaht_create(max_keys);
+    else
+      bpaglobals.hashtable = oahttslf_create(max_keys);
+  }
+
+  if (bpaglobals.hashtable && bpaglobals.use_threading &&
+      bpaglobals.l1_kbytes > 0)
+    bpaglobals.l1memo = l1memo_create(bpaglobals.num_threads,
+                                      (size_t)bpaglobals.l1_kbytes * 1024);
 
   gettimeofday(&start_timeval, NULL);
   getrusage(RUSAGE_SELF, &starttime);
@@ -249,11 +388,16 @@ static int bpalign(const char *filename1, const char *filename2)
     {
       score = bpa_dynprogm(0, bpaglobals.seqlenA-1, 0, bpaglobals.seqlenB-1);
     }
-    total_count_S = bpastats[0].count_S;
-    total_count_dynprogm_entry = bpastats[0].count_dynprogm_entry;
-    total_count_dynprogm_entry_notmemoed = bpastats[0].count_dynprogm_entry_notmemoed;
+    total_count_S = SHARDCOUNT_GET(&bpastats, 0, BPASTATS_S);
+    total_count_dynprogm_entry =
+      SHARDCOUNT_GET(&bpastats, 0, BPASTATS_DYNPROGM_ENTRY);
+    total_count_dynprogm_entry_notmemoed =
+      SHARDCOUNT_GET(&bpastats, 0, BPASTATS_DYNPROGM_ENTRY_NOTMEMOED);
+    if (bpaglobals.serialtable)
+      num_keys = (counter_t)oaht_num_entries(bpaglobals.serialtable);
 #ifdef USE_INSTRUMENT
-    num_keys = (counter_t)oahttslf_total_key_count();
+    else if (!bpaglobals.use_array)
+      num_keys = (counter_t)oahttslf_total_key_count(bpaglobals.hashtable);
 #endif
   }
 
@@ -266,6 +410,12 @@ static int bpalign(const char *filename1, const char *filename2)
           + 1000 * runtime.ru_stime.tv_sec + runtime.ru_stime.tv_usec/1000;
   etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
 
+  if (bpaglobals.save_snapshot && bpaglobals.hashtable &&
+      oahttslf_save(bpaglobals.hashtable, bpaglobals.save_snapshot,
+                    problem_id,
+                    bpaglobals.use_threading ? bpaglobals.num_threads : 1) != 0)
+    return -1;
+
   if (bpaglobals.printstats)
   {
     /* print in one line space-sepearted format for later parsing */
@@ -281,6 +431,33 @@ static int bpalign(const char *filename1, const char *filename2)
     printf("score = %lld\n", score);
   }
 
+  if (bpaglobals.check_table)
+  {
+    /* after the timing, and with as many threads as computed it */
+    if (bpaglobals.hashtable)
+    {
+      oahttslf_printstats_par(bpaglobals.hashtable,
+                              bpaglobals.use_threading ?
+                              bpaglobals.num_threads : 1);
+      if (!oahttslf_validate_par(bpaglobals.hashtable,
+                                 bpaglobals.use_threading ?
+                                 bpaglobals.num_threads : 1))
+      {
+        bpa_error_msg(funcname, "hashtable validation failed\n");
+        return -1;
+      }
+    }
+    else if (bpaglobals.serialtable)
+    {
+      oaht_printstats(bpaglobals.serialtable);
+      if (!oaht_validate(bpaglobals.serialtable))
+      {
+        bpa_error_msg(funcname, "hashtable validation failed\n");
+        return -1;
+      }
+    }
+  }
+
 
   /* free memory */
   free(bpaglobals.seqA);
@@ -291,7 +468,12 @@ static int bpalign(const char *filename1, const char *filename2)
   bpa_free_ipsilist(bpaglobals.ipsilistB, bpaglobals.seqlenB);
   free(seripsiA);
   free(seripsiB);
-  /* TODO free hash table entries */
+  if (bpaglobals.hashtable)
+    oahttslf_destroy(bpaglobals.hashtable);
+  if (bpaglobals.serialtable)
+    oaht_destroy(bpaglobals.serialtable);
+  if (bpaglobals.l1memo)
+    l1memo_destroy(bpaglobals.l1memo);
 
   return 0;
 }
@@ -306,11 +488,25 @@ static int bpalign(const char *filename1, const char *filename2)
 static void usage(const char *program)
 {
   fprintf(stderr,
-          "usage: %s  [-svaz] [-t num_threads | -b] file1.bplist file2_bplist\n"
+          "usage: %s  [-svazHNBpV] [-t num_threads | -b] [-l snapshot] "
+          "[-w snapshot] [-m megabytes] [-c kbytes] file1.bplist "
+          "file2_bplist\n"
           "   -s  :  write instrumentation data to stdout\n"
           "   -v  :  write verbose debug information to stderr\n"
           "   -t num_threads  : use threaded implementation\n"
           "   -a  :  usee array not hashtable for top-down implementations\n"
+          "   -H  :  use huge pages for the hashtable\n"
+          "   -N  :  interleave the hashtable over all NUMA nodes\n"
+          "   -B  :  put an equal part of the hashtable on each NUMA node\n"
+          "   -p  :  prefault the hashtable in parallel with num_threads threads\n"
+          "   -l snapshot : start with hashtable saved by -w for these inputs\n"
+          "   -w snapshot : save the hashtable to snapshot when done\n"
+          "   -m megabytes : limit the hashtable to megabytes, recomputing "
+          "what does not fit\n"
+          "                  (many times slower if much smaller than needed)\n"
+          "   -c kbytes : with -t, look in a per-thread cache of kbytes "
+          "(e.g. 256) first\n"
+          "   -V  :  validate the hashtable and print its statistics when done\n"
           "   -b  :  use bottom-up not top-down dynamic programming\n",
           "   -z  :  do NOT randomize choices in multithreaded version\n",
           program);
@@ -326,12 +522,15 @@ int main(int argc, char *argv[])
   int c;
   char *filename1, *filename2;
   int exit_status;
+  bigmem_huge_t huge = BIGMEM_HUGE_NONE;
+  bigmem_numa_t numa = BIGMEM_NUMA_FIRSTTOUCH;
+  bool prefault = FALSE;
   
   bpa_set_verbose(FALSE);
 
   /* process command line options */
 
-  while ((c = getopt(argc, argv, "ast:bvzh?")) != -1)
+  while ((c = getopt(argc, argv, "ast:bvzHNBpVl:w:m:c:h?")) != -1)
   {
     switch (c)
     {
@@ -371,6 +570,52 @@ int main(int argc, char *argv[])
         bpaglobals.use_random = FALSE;
         break;
 
+      case 'H':
+        huge = BIGMEM_HUGE_HUGETLB;
+        break;
+
+      case 'N':
+        numa = BIGMEM_NUMA_INTERLEAVE;
+        break;
+
+      case 'B':
+        numa = BIGMEM_NUMA_BIND;
+        break;
+
+      case 'p':
+        prefault = TRUE;
+        break;
+
+      case 'V':
+        bpaglobals.check_table = TRUE;
+        break;
+
+      case 'l':
+        bpaglobals.load_snapshot = optarg;
+        break;
+
+      case 'w':
+        bpaglobals.save_snapshot = optarg;
+        break;
+
+      case 'm':
+        if (atol(optarg) < 1)
+        {
+          fprintf(stderr, "hashtable megabytes must be >= 1\n");
+          usage(argv[0]);
+        }
+        bpaglobals.cache_mbytes = (unsigned long)atol(optarg);
+        break;
+
+      case 'c':
+        if (atol(optarg) < 1)
+        {
+          fprintf(stderr, "per-thread cache kbytes must be >= 1\n");
+          usage(argv[0]);
+        }
+        bpaglobals.l1_kbytes = (unsigned long)atol(optarg);
+        break;
+
       case 'h':
       case '?':
         usage(argv[0]);
@@ -404,6 +649,32 @@ int main(int argc, char *argv[])
     fprintf(stderr,
             "WARNING: -a (use array) ignored with -b: bottom-up always uses array\n");
 
+  if ((bpaglobals.load_snapshot || bpaglobals.save_snapshot) &&
+      (bpaglobals.use_array || bpaglobals.use_bottomup))
+    fprintf(stderr,
+            "WARNING: -l and -w (snapshot) ignored with -a or -b: no hashtable\n");
+
+  if (bpaglobals.cache_mbytes > 0 &&
+      (bpaglobals.use_array || bpaglobals.use_bottomup))
+    fprintf(stderr,
+            "WARNING: -m (megabytes) ignored with -a or -b: no hashtable\n");
+  else if (bpaglobals.cache_mbytes > 0 && bpaglobals.load_snapshot)
+    fprintf(stderr,
+            "WARNING: -l (snapshot) ignored with -m: the snapshot table grows\n");
+
+  if (bpaglobals.check_table &&
+      (bpaglobals.use_array || bpaglobals.use_bottomup))
+    fprintf(stderr,
+            "WARNING: -V (validate) ignored with -a or -b: no hashtable\n");
+
+  if (bpaglobals.l1_kbytes > 0 &&
+      (!bpaglobals.use_threading || bpaglobals.use_array))
+    fprintf(stderr,
+            "WARNING: -c (kbytes) ignored without -t or with -a: no shared hashtable\n");
+
+  /* hashtable is allocated in bpalign() so set this up first */
+  bigmem_set_policy(huge, numa, prefault ? bpaglobals.num_threads : 1);
+
   /* main toplevel program logic is in bpalign() */
 
   if (bpalign(filename1, filename2) == 0)
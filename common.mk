@@ -46,6 +46,11 @@ CFLAGS     += -Wextra -Wfloat-equal  \
               -Wmissing-declarations -Wunreachable-code
 
 PTHREAD_CLFAGS = -pthread -DUSE_THREADING
+# x86-64 needs this for the double-width CAS (cmpxchg16b) in oahttslf128
+CAS128_CFLAGS = -mcx16
+# AVX2 (Haswell or later) to compare a bucket of oahttslf keys at once;
+# comment out for older x86 and it uses a scalar loop instead
+SIMD_CFLAGS = -mavx2
 LD         = gcc
 LDFLAGS    = 
 ifeq ($(MODE),DEBUG)
@@ -12,13 +12,17 @@
  * for some number of initial levels.
  *
  *
- *  Usage: knapsack_diverge_oahttslf [-ntvyz] [-r threads]  < problemspec
+ *  Usage: knapsack_diverge_oahttslf [-ntvyzHNBp] [-r threads]  < problemspec
  *          -r threads: number of worker threads to run
  *          -t: show statistics of operations
  *          -v: Verbose output 
  *          -n: assume no name in the first line of the file
  *          -y: show instrumentatino summary line (like -t but one line summary)
  *          -z: do NOT randomize choices, make same path in every thread.
+ *          -H: use huge pages for the hash table
+ *          -N: interleave the hash table over all NUMA nodes
+ *          -B: put an equal part of the hash table on each NUMA node
+ *          -p: prefault the hash table in parallel with the worker threads
  *
  * The problemspec is in the format generated by gen2.c from David Pisinger
  * (http://www.diku.dk/hjemmesider/ansatte/pisinger/codes.html):
@@ -53,6 +57,8 @@
 
 
 #include "bpautils.h"
+#include "shardcount.h"
+#include "bigmem.h"
 #include "oahttslf.h"
 
 
@@ -70,11 +76,12 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
 
 typedef unsigned long counter_t;
 
-typedef struct stats_s 
+/* indices of the per-thread counters in stats */
+enum
 {
-    counter_t reuse;  /* number of times value already found in hashtable */
-    counter_t hashcount; /* number of times value computed & stored in ht */
-} stats_t;
+  STATS_REUSE,    /* number of times value already found in hashtable */
+  STATS_HASHCOUNT /* number of times value computed & stored in ht */
+};
 
 
 
@@ -150,10 +157,12 @@ static unsigned int CAPACITY; /* total capacity for the problem */
 static unsigned int NUM_ITEMS; /* number of items */
 static item_t *ITEMS;         /* array of item profits and weights (0 unused)*/
 
+static oahttslf_t *hashtable; /* shared lock-free hashtable for d.p. values */
+
 
 #ifdef USE_INSTRUMENT
 /* per-thread instrumentation */
-static stats_t stats[MAX_NUM_THREADS];
+static shardcount_t stats;
 
 /* instrumentatino totals (summed over all threads) */
 counter_t  total_reuse = 0, total_hashcount = 0;
@@ -216,7 +225,7 @@ static void oahttslf_insert_indices(unsigned int i, unsigned int j,
   key = (i == 0 && j == 0 ? MAGIC_ZERO : 
          ((uint64_t)i << 32) | (j & 0xffffffff));
   val64 = (value == 0 ? MAGIC_ZERO : (uint64_t)value);
-  oahttslf_insert(key, val64, thread_id);
+  oahttslf_insert(hashtable, key, val64, thread_id);
 }
 
 
@@ -241,7 +250,7 @@ static bool oahttslf_lookup_indices(unsigned int i, unsigned int j,
 
   key = (i == 0 && j == 0 ? MAGIC_ZERO :
          ((uint64_t)i << 32) | (j & 0xffffffff));
-  found =  oahttslf_lookup(key, &val64);
+  found =  oahttslf_lookup(hashtable, key, &val64);
   if (found)
     *pvalue = ((val64 == MAGIC_ZERO) ? 0 : (unsigned int)val64);
   return found;
@@ -329,6 +338,7 @@ void *dp_knapsack_thread(void *threadarg)
  *
  *                   read/write:
  *                     stats
+ *                     hashtable
  *
  *      Return value: 
  *                    value of d.p. at (i,w)
@@ -349,7 +359,7 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
   if (oahttslf_lookup_indices(i, w, &p))
   {
 #ifdef USE_INSTRUMENT
-    stats[thread_id].reuse++;
+    SHARDCOUNT_INC(&stats, thread_id, STATS_REUSE);
 #endif
     return p;
   }
@@ -421,7 +431,7 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
   bpa_log_msg(funcname, "S\t%d\t%d\t%d\n",i,w,p);
 #endif
 #ifdef USE_INSTRUMENT
-  stats[thread_id].hashcount++;
+  SHARDCOUNT_INC(&stats, thread_id, STATS_HASHCOUNT);
 #endif
   oahttslf_insert_indices(i, w, p, thread_id);
   return p;
@@ -525,18 +535,11 @@ static int dp_knapsack_thread_master(unsigned int i, unsigned int w)
  *                    total_hashcount
  *                  readonly:
  *                    stats
- *                    max_threads -max number of threads allowed
  */
 static void compute_total_counts()
 {
-  unsigned int t;
-  total_reuse = 0;
-  total_hashcount = 0;
-  for (t = 0; t < max_threads; t++)
-  {
-    total_reuse += stats[t].reuse;
-    total_hashcount += stats[t].hashcount;
-  }
+  total_reuse = shardcount_total(&stats, STATS_REUSE);
+  total_hashcount = shardcount_total(&stats, STATS_HASHCOUNT);
 }
 
 #endif
@@ -600,13 +603,17 @@ static void readdata(void)
 static void usage(const char *program)
 {
   fprintf(stderr, 
-          "Usage: %s [-ntvyz] [-r threads] < problemspec\n"
+          "Usage: %s [-ntvyzHNBp] [-r threads] < problemspec\n"
           "  -n: assume no name in the first line of the file\n"
           "  -r threads: number of worker threads to run (default %d)\n"
           "  -t: show statistics of operations\n"
           "  -v: Verbose output\n"
           "  -y: show instrumentatino summary line (like -t but one line summary)\n"
-          "  -z: do NOT randomize choices, make same path in every thread\n",
+          "  -z: do NOT randomize choices, make same path in every thread\n"
+          "  -H: use huge pages for the hash table\n"
+          "  -N: interleave the hash table over all NUMA nodes\n"
+          "  -B: put an equal part of the hash table on each NUMA node\n"
+          "  -p: prefault the hash table in parallel with the worker threads\n",
           program, DEFAULT_MAX_THREADS);
   
   exit(EXIT_FAILURE);
@@ -630,6 +637,9 @@ int main(int argc, char *argv[])
   unsigned int t;
   char name[100];
   int noname = 0;
+  bigmem_huge_t huge = BIGMEM_HUGE_NONE;
+  bigmem_numa_t numa = BIGMEM_NUMA_FIRSTTOUCH;
+  bool prefault = FALSE;
 #ifdef USE_INSTRUMENT
   unsigned int num_keys;
 #endif
@@ -644,7 +654,7 @@ int main(int argc, char *argv[])
 
   gettimeofday(&start_timeval, NULL);
 
-  while ((c = getopt(argc, argv, "nvyztr:?")) != -1)
+  while ((c = getopt(argc, argv, "nvyztHNBpr:?")) != -1)
   {
     switch(c) {
       case 'r':
@@ -683,6 +693,22 @@ int main(int argc, char *argv[])
         /* do not randomize choices */
         use_random = 0;
         break;
+      case 'H':
+        /* huge pages for hash table */
+        huge = BIGMEM_HUGE_HUGETLB;
+        break;
+      case 'N':
+        /* interleave hash table over NUMA nodes */
+        numa = BIGMEM_NUMA_INTERLEAVE;
+        break;
+      case 'B':
+        /* bind a part of hash table to each NUMA node */
+        numa = BIGMEM_NUMA_BIND;
+        break;
+      case 'p':
+        /* prefault hash table with as many threads as workers */
+        prefault = TRUE;
+        break;
       default:
         usage(argv[0]);
    	    break;
@@ -716,7 +742,10 @@ int main(int argc, char *argv[])
 
   getrusage(RUSAGE_SELF, &starttime);
 
+  bigmem_set_policy(huge, numa, prefault ? (int)max_threads : 1);
   readdata(); /* read into the ITEMS array and set CAPACITY, NUM_ITEMS */
+  /* at most one key per (i,w) subproblem */
+  hashtable = oahttslf_create((uint64_t)(NUM_ITEMS + 1) * (CAPACITY + 1));
   profit = dp_knapsack_thread_master(NUM_ITEMS, CAPACITY);
 
   getrusage(RUSAGE_SELF, &endtime);
@@ -730,7 +759,7 @@ int main(int argc, char *argv[])
 
 #ifdef USE_INSTRUMENT
   compute_total_counts();
-  num_keys = oahttslf_total_key_count();
+  num_keys = oahttslf_total_key_count(hashtable);
 #endif
 
  if (show_stats_summary)
@@ -749,8 +778,11 @@ int main(int argc, char *argv[])
   {
     for (t = 0; t < max_threads; t++)
     {
-      printf("thread id %d [re=%lu,hc=%lu,re/hc=%f]\n", t, stats[t].reuse, 
-              stats[t].hashcount, (float)stats[t].reuse/stats[t].hashcount);
+      printf("thread id %d [re=%lu,hc=%lu,re/hc=%f]\n", t,
+             SHARDCOUNT_GET(&stats, t, STATS_REUSE),
+             SHARDCOUNT_GET(&stats, t, STATS_HASHCOUNT),
+             (float)SHARDCOUNT_GET(&stats, t, STATS_REUSE) /
+             SHARDCOUNT_GET(&stats, t, STATS_HASHCOUNT));
     }
     printf("totals [re=%lu,hc=%lu,re/hc=%f,hn=%u]\n", total_reuse, total_hashcount,
            (float)total_reuse/total_hashcount, num_keys);
@@ -10,13 +10,17 @@
  * hashtable.
  *
  *
- *  Usage: knapsack_httslf [-ntvyz] [-r threads]  < problemspec
+ *  Usage: knapsack_httslf [-ntvyzHNBp] [-r threads]  < problemspec
  *          -r threads: number of worker threads to run
  *          -t: show statistics of operations
  *          -v: Verbose output 
  *          -n: assume no name in the first line of the file
  *          -y: show instrumentatino summary line (like -t but one line summary)
  *          -z: do NOT randomize choices, make same path in every thread.
+ *          -H: use huge pages for the hash table
+ *          -N: interleave the hash table over all NUMA nodes
+ *          -B: put an equal part of the hash table on each NUMA node
+ *          -p: prefault the hash table in parallel with the worker threads
  *
  * The problemspec is in the format generated by gen2.c from David Pisinger
  * (http://www.diku.dk/hjemmesider/ansatte/pisinger/codes.html):
@@ -51,7 +55,9 @@
 #include <sys/resource.h>
 
 #include "bpautils.h"
-#include "httslf.h"
+#include "shardcount.h"
+#include "bigmem.h"
+#include "hashfn.h"
 
 #define USE_GOOD_HASH
 
@@ -80,11 +86,12 @@ typedef struct tuple2_s
 
 typedef unsigned long counter_t;
 
-typedef struct stats_s 
+/* indices of the per-thread counters in stats */
+enum
 {
-    counter_t reuse;  /* number of times value already found in hashtable */
-    counter_t hashcount; /* number of times value computed & stored in ht */
-} stats_t;
+  STATS_REUSE,    /* number of times value already found in hashtable */
+  STATS_HASHCOUNT /* number of times value computed & stored in ht */
+};
 
 
 
@@ -157,7 +164,7 @@ static item_t *ITEMS;         /* array of item profits and weights (0 unused)*/
 
 #ifdef USE_INSTRUMENT
 /* per-thread instrumentation */
-static stats_t stats[MAX_NUM_THREADS];
+static shardcount_t stats;
 
 /* instrumentatino totals (summed over all threads) */
 counter_t  total_reuse = 0, total_hashcount = 0;
@@ -171,80 +178,31 @@ counter_t  total_reuse = 0, total_hashcount = 0;
  *****************************************************************************/
 
 
-#ifdef USE_GOOD_HASH
 /*
-  hash a 64 bit value into 32 bits. From:
-  (Thomas Wang, Jan 1997, Last update Mar 2007, Version 3.1)
-  http://www.concentric.net/~Ttwang/tech/inthash.htm
-  (found by reference in NIST Dictionary of Algorithms and Data Structures)
-*/
-static unsigned long hash6432shift(unsigned long long key)
-{
-  key = (~key) + (key << 18); /* key = (key << 18) - key - 1; */
-  key = key ^ (key >> 31);
-  key = key * 21; /* key = (key + (key << 2)) + (key << 4); */
-  key = key ^ (key >> 11);
-  key = key + (key << 6);
-  key = key ^ (key >> 22);
-  return (unsigned long) key;
-}
-
-#endif
-
-/*
- * httslf_hash()
- *
- * Compute hash value for the table.
- * We will simply shove the low 16 bits of each index in the tuple
- * into a word and return the value modulo the tablesize.
- *
- * Paramters:
- *     key - ptr to 2-tuple to compute hash value for
- *
- * Return value:
- *     hash value
+ * The d.p. table, an instantiation of httslft.h with the (i,j) key.
+ * With USE_GOOD_HASH the hash is the Wang hash of i and j together,
+ * else the low 16 bits of each index shoved into a word.
+ * The larger instances have tens of millions of (i,j) entries, so the
+ * table starts with 2^25 buckets (512 MB, as the fixed size table had)
+ * rather than making that many as it grows.
  */
-static unsigned int httslf_hash(const void *vkey) 
-{
-  int hashval;
-  const tuple2_t *key = (const tuple2_t *)vkey;
-
+#define HTTSLFT_MIN_BUCKETS_LOG2 25
+#define HTTSLFT_NAME     dptable
+#define HTTSLFT_KEY_T    tuple2_t
+#define HTTSLFT_VALUE_T  unsigned int
 #ifdef USE_GOOD_HASH
-  unsigned long long both = ((long long)key->i << 32) | (key->j & 0xffffffff);
-  hashval = hash6432shift(both);
+#define HTTSLFT_HASH(k)  hashfn_wang((uint64_t)(k)->i << 32 | (k)->j)
 #else
-  hashval = (key->i << 16) | (key->j & 0xffff);
+#define HTTSLFT_HASH(k)  ((k)->i << 16 | ((k)->j & 0xffff))
 #endif
-  return hashval & (HTTSLF_SIZE - 1); /* depends on HTTSLF_SIZE being 2^n */
-}
-
-
-/*
- * httslf_keymatch()
- *
- * Compare two key structures
- *
- * Parameters:
- *    s1 - key struct ptr for first
- *    s2 - key struct ptr for second
- *
- * Return value:
- *    nonzero if s1 and s2 are equal, else 0.
- *
- */
-static int httslf_keymatch(const void *vs1, const void *vs2)
-{
-  const tuple2_t *s1 = (const tuple2_t *)vs1;
-  const tuple2_t *s2 = (const tuple2_t *)vs2;
-
-  return (s1->i == s2->i && s1->j == s2->j);
-}
+#define HTTSLFT_KEYMATCH(k1, k2) ((k1)->i == (k2)->i && (k1)->j == (k2)->j)
+#include "httslft.h"
 
 
 
 /* insert by (i,j) into table */
 static void httslf_insert_indices(unsigned int i, unsigned int j, 
-                                  unsigned int value);
+                                  unsigned int value, int thread_id);
 
 /* lookup by (i,j) */
 static bool httslf_lookup_indices(unsigned int i, unsigned int j,
@@ -259,12 +217,13 @@ static bool httslf_lookup_indices(unsigned int i, unsigned int j,
  * Parameters:
  *    i,j - indices to build insertion key
  *    value - value to insert for the key
+ *    thread_id - id (0,1,2,..) of this thread
  *
  * Return value:
  *    None.
  */
 static void httslf_insert_indices(unsigned int i, unsigned int j,
-                                  unsigned int value)
+                                  unsigned int value, int thread_id)
 {
   tuple2_t key;
   unsigned int uvalue;
@@ -272,7 +231,7 @@ static void httslf_insert_indices(unsigned int i, unsigned int j,
   key.i = i;
   key.j = j;
   uvalue = value;
-  httslf_insert(&key, &uvalue);
+  dptable_insert(&key, &uvalue, thread_id);
 }
 
 
@@ -297,7 +256,7 @@ static bool httslf_lookup_indices(unsigned int i, unsigned int j,
 
   key.i = i;
   key.j = j;
-  pval = (unsigned int *)httslf_lookup(&key);
+  pval = dptable_lookup(&key);
   if (pval)
   {
     *pvalue = *pval;
@@ -404,7 +363,7 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
   if (httslf_lookup_indices(i, w, &p))
   {
 #ifdef USE_INSTRUMENT
-    stats[thread_id].reuse++;
+    SHARDCOUNT_INC(&stats, thread_id, STATS_REUSE);
 #endif
     return p;
   }
@@ -439,9 +398,9 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
   bpa_log_msg(funcname, "S\t%d\t%d\t%d\n",i,w,p);
 #endif
 #ifdef USE_INSTRUMENT
-  stats[thread_id].hashcount++;
+  SHARDCOUNT_INC(&stats, thread_id, STATS_HASHCOUNT);
 #endif
-  httslf_insert_indices(i, w, p);
+  httslf_insert_indices(i, w, p, thread_id);
   return p;
 }
 
@@ -538,18 +497,11 @@ static int dp_knapsack_thread_master(unsigned int i, unsigned int w)
  *                    total_hashcount
  *                  readonly:
  *                    stats
- *                    max_threads -max number of threads allowed
  */
 static void compute_total_counts()
 {
-  unsigned int t;
-  total_reuse = 0;
-  total_hashcount = 0;
-  for (t = 0; t < max_threads; t++)
-  {
-    total_reuse += stats[t].reuse;
-    total_hashcount += stats[t].hashcount;
-  }
+  total_reuse = shardcount_total(&stats, STATS_REUSE);
+  total_hashcount = shardcount_total(&stats, STATS_HASHCOUNT);
 }
 
 #endif
@@ -613,13 +565,17 @@ static void readdata(void)
 static void usage(const char *program)
 {
   fprintf(stderr, 
-          "Usage: %s [-ntvyz] [-r threads] < problemspec\n"
+          "Usage: %s [-ntvyzHNBp] [-r threads] < problemspec\n"
           "  -n: assume no name in the first line of the file\n"
           "  -r threads: number of worker threads to run (default %d)\n"
           "  -t: show statistics of operations\n"
           "  -v: Verbose output\n"
           "  -y: show instrumentatino summary line (like -t but one line summary)\n"
-          "  -z: do NOT randomize choices, make same path in every thread\n",
+          "  -z: do NOT randomize choices, make same path in every thread\n"
+          "  -H: use huge pages for the hash table\n"
+          "  -N: interleave the hash table over all NUMA nodes\n"
+          "  -B: put an equal part of the hash table on each NUMA node\n"
+          "  -p: prefault the hash table in parallel with the worker threads\n",
           program, DEFAULT_MAX_THREADS);
   
   exit(EXIT_FAILURE);
@@ -643,6 +599,9 @@ int main(int argc, char *argv[])
   unsigned int t;
   char name[100];
   int noname = 0;
+  bigmem_huge_t huge = BIGMEM_HUGE_NONE;
+  bigmem_numa_t numa = BIGMEM_NUMA_FIRSTTOUCH;
+  bool prefault = FALSE;
 #ifdef USE_INSTRUMENT
   unsigned int num_keys;
 #endif
@@ -651,7 +610,7 @@ int main(int argc, char *argv[])
 
   gettimeofday(&start_timeval, NULL);
 
-  while ((c = getopt(argc, argv, "nvyztr:?")) != -1)
+  while ((c = getopt(argc, argv, "nvyztHNBpr:?")) != -1)
   {
     switch(c) {
       case 'r':
@@ -690,6 +649,22 @@ int main(int argc, char *argv[])
         /* do not randomize choices */
         use_random = 0;
         break;
+      case 'H':
+        /* huge pages for hash table */
+        huge = BIGMEM_HUGE_HUGETLB;
+        break;
+      case 'N':
+        /* interleave hash table over NUMA nodes */
+        numa = BIGMEM_NUMA_INTERLEAVE;
+        break;
+      case 'B':
+        /* bind a part of hash table to each NUMA node */
+        numa = BIGMEM_NUMA_BIND;
+        break;
+      case 'p':
+        /* prefault hash table with as many threads as workers */
+        prefault = TRUE;
+        break;
       default:
         usage(argv[0]);
 	break;
@@ -709,9 +684,8 @@ int main(int argc, char *argv[])
   else
     fgets(name,sizeof(name)-1,stdin);
   
-  httslf_initialize(sizeof(tuple2_t), sizeof(unsigned int),
-                    httslf_hash, NULL, 
-                    httslf_keymatch, NULL);
+  bigmem_set_policy(huge, numa, prefault ? (int)max_threads : 1);
+  dptable_create();
 
   getrusage(RUSAGE_SELF, &starttime);
 
@@ -729,7 +703,7 @@ int main(int argc, char *argv[])
 
 #ifdef USE_INSTRUMENT
   compute_total_counts();
-  num_keys = 0; /* TODO */
+  num_keys = dptable_total_key_count();
 #endif
 
  if (show_stats_summary)
@@ -748,8 +722,11 @@ int main(int argc, char *argv[])
   {
     for (t = 0; t < max_threads; t++)
     {
-      printf("thread id %d [re=%lu,hc=%lu,re/hc=%f]\n", t, stats[t].reuse, 
-              stats[t].hashcount, (float)stats[t].reuse/stats[t].hashcount);
+      printf("thread id %d [re=%lu,hc=%lu,re/hc=%f]\n", t,
+             SHARDCOUNT_GET(&stats, t, STATS_REUSE),
+             SHARDCOUNT_GET(&stats, t, STATS_HASHCOUNT),
+             (float)SHARDCOUNT_GET(&stats, t, STATS_REUSE) /
+             SHARDCOUNT_GET(&stats, t, STATS_HASHCOUNT));
     }
     printf("totals [re=%lu,hc=%lu,re/hc=%f,hn=%u]\n", total_reuse, total_hashcount,
            (float)total_reuse/total_hashcount, num_keys);
@@ -10,13 +10,26 @@
  * hashtable.
  *
  *
- *  Usage: knapsack_oahttslf [-ntvyz] [-r threads]  < problemspec
+ *  Usage: knapsack_oahttslf [-ntvyzHNBpV] [-r threads] [-l snapshot]
+ *                            [-s snapshot] [-c kbytes] < problemspec
  *          -r threads: number of worker threads to run
  *          -t: show statistics of operations
  *          -v: Verbose output 
  *          -n: assume no name in the first line of the file
  *          -y: show instrumentatino summary line (like -t but one line summary)
  *          -z: do NOT randomize choices, make same path in every thread.
+ *          -H: use huge pages for the hash table
+ *          -N: interleave the hash table over all NUMA nodes
+ *          -B: put an equal part of the hash table on each NUMA node
+ *          -p: prefault the hash table in parallel with the worker threads
+ *          -l snapshot: start with the hash table saved by -s in an earlier
+ *                       run of the same problem (oahttslf table only;
+ *                       one saved for another problem is refused)
+ *          -s snapshot: save the hash table when done (oahttslf table only)
+ *          -c kbytes: each thread looks in its own cache of this size
+ *                     (e.g. its L2) before the shared hash table
+ *          -V: when done, validate the hash table and print its statistics,
+ *              scanning it with the worker threads (oahttslf table only)
  *
  * The problemspec is in the format generated by gen2.c from David Pisinger
  * (http://www.diku.dk/hjemmesider/ansatte/pisinger/codes.html):
@@ -38,6 +51,11 @@
  *                  Note that if this is not defined, then the -t and -i
  *                  options do not work.
  * USE_CONTENTION_INSTRUMENT - compile in (per-thread) oahttslf retry counts
+ * USE_OAHTTSLF6432 - use the oahttslft table with 64 bit keys and 32 bit
+ *                  values (12.8 rather than 16 bytes per entry), built
+ *                  as knapsack_oahttslf6432
+ * USE_OAHTTSLFQ  - use the quotiented oahttslfq table, which stores the key
+ *                  and profit in one 64 bit word, built as knapsack_oahttslfq
  *****************************************************************************/
 
 #include <stdlib.h>
@@ -50,7 +68,17 @@
 #include <sys/resource.h>
 
 #include "bpautils.h"
+#include "shardcount.h"
+#include "bigmem.h"
+#include "l1memo.h"
 #include "oahttslf.h"
+#include "hashfn.h"
+#ifdef USE_OAHTTSLF6432
+#include "oahttslf6432.h"
+#endif
+#ifdef USE_OAHTTSLFQ
+#include "oahttslfq.h"
+#endif
 
 
 unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
@@ -65,11 +93,12 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
 
 typedef unsigned long counter_t;
 
-typedef struct stats_s 
+/* indices of the per-thread counters in stats */
+enum
 {
-    counter_t reuse;  /* number of times value already found in hashtable */
-    counter_t hashcount; /* number of times value computed & stored in ht */
-} stats_t;
+  STATS_REUSE,    /* number of times value already found in hashtable */
+  STATS_HASHCOUNT /* number of times value computed & stored in ht */
+};
 
 
 
@@ -139,10 +168,35 @@ static unsigned int CAPACITY; /* total capacity for the problem */
 static unsigned int NUM_ITEMS; /* number of items */
 static item_t *ITEMS;         /* array of item profits and weights (0 unused)*/
 
+#ifdef USE_OAHTTSLF6432
+/* the profit is 32 bits, and 0 is not the empty key or value here */
+static oahttslf6432_t *hashtable; /* shared lock-free hashtable for d.p. values */
+/* so main() can use the oahttslf names for either table */
+#define oahttslf_create oahttslf6432_create
+#define oahttslf_total_key_count oahttslf6432_total_key_count
+#define oahttslf_total_retry_count oahttslf6432_total_retry_count
+#elif defined(USE_OAHTTSLFQ)
+/* keys are i*(CAPACITY+1)+w so need only as many bits as there are
+   subproblems, and the 32 bit profit goes in the same word */
+static oahttslfq_t *hashtable; /* shared lock-free hashtable for d.p. values */
+#define oahttslf_total_key_count oahttslfq_total_key_count
+#define oahttslf_total_retry_count oahttslfq_total_retry_count
+#else
+static oahttslf_t *hashtable; /* shared lock-free hashtable for d.p. values */
+/* only this table can be saved to and loaded from a snapshot file */
+#define USE_SNAPSHOT
+/* and validated and scanned for statistics in parallel (-V) */
+#define USE_TABLE_CHECK
+#endif
+
+
+/* per-thread caches looked in before the hashtable, or NULL (-c) */
+static l1memo_t *l1memo = NULL;
+
 
 #ifdef USE_INSTRUMENT
 /* per-thread instrumentation */
-static stats_t stats[MAX_NUM_THREADS];
+static shardcount_t stats;
 
 /* instrumentatino totals (summed over all threads) */
 counter_t  total_reuse = 0, total_hashcount = 0;
@@ -156,6 +210,25 @@ counter_t  total_reuse = 0, total_hashcount = 0;
  *****************************************************************************/
 
 
+/* the oahttslf table can claim the slot for a key on a memo miss and
+   later publish the value there without probing for it again. The
+   other tables are looked up and then inserted into */
+#if !defined(USE_OAHTTSLF6432) && !defined(USE_OAHTTSLFQ)
+#define USE_RESERVE
+#endif
+
+/* where the value for (i,j) goes after a memo miss */
+typedef struct memo_handle_s
+{
+#ifdef USE_RESERVE
+    oahttslf_handle_t handle; /* slot claimed for (i,j) */
+#else
+    unsigned int i, j;        /* indices to insert by */
+#endif
+    uint64_t l1key;           /* key for (i,j) in l1memo */
+} memo_handle_t;
+
+#ifndef USE_RESERVE
 /* insert by (i,j) into table */
 static void oahttslf_insert_indices(unsigned int i, unsigned int j, 
                                     unsigned int value, int thread_id);
@@ -163,11 +236,28 @@ static void oahttslf_insert_indices(unsigned int i, unsigned int j,
 /* lookup by (i,j) */
 static bool oahttslf_lookup_indices(unsigned int i, unsigned int j,
                                      unsigned int *pvalue);
+#endif
+
+/* lookup by (i,j), or set up handle to publish its value if not found */
+static oahttslf_state_t oahttslf_find_or_claim_indices(unsigned int i,
+                                                       unsigned int j,
+                                                       unsigned int *pvalue,
+                                                       memo_handle_t *handle,
+                                                       int thread_id);
+
+/* give the (i,j) not found by oahttslf_find_or_claim_indices() its value */
+static void oahttslf_publish_indices(const memo_handle_t *handle,
+                                     unsigned int value, int thread_id);
 
 /* dodgy: 0 is the OAHTTSLF_EMPTY_KEY and OAHTTSLF_EMPTY_VALUE value,
    so if key or value is 0 set it to MAGIC_ZERO instead */
 #define MAGIC_ZERO 0xffffffffffffffff
 
+/* key for (i,j) in l1memo (whatever key the hashtable uses) */
+#define L1_KEY(i, j) \
+  ((i) == 0 && (j) == 0 ? MAGIC_ZERO : ((uint64_t)(i) << 32) | (j))
+
+#ifndef USE_RESERVE
 /*
  * oahttslf_insert_indices()
  *
@@ -186,10 +276,15 @@ static void oahttslf_insert_indices(unsigned int i, unsigned int j,
 {
   uint64_t key, val64;
 
-  key = (i == 0 && j == 0 ? MAGIC_ZERO : 
-         ((uint64_t)i << 32) | (j & 0xffffffff));
-  val64 = (value == 0 ? MAGIC_ZERO : (uint64_t)value);
-  oahttslf_insert(key, val64, thread_id);
+#ifdef USE_OAHTTSLF6432
+  (void)val64;
+  key = ((uint64_t)i << 32) | (j & 0xffffffff);
+  oahttslf6432_insert(hashtable, key, value, thread_id);
+#elif defined(USE_OAHTTSLFQ)
+  (void)val64;
+  key = (uint64_t)i * (CAPACITY + 1) + j;
+  oahttslfq_insert(hashtable, key, value, thread_id);
+#endif
 }
 
 
@@ -212,16 +307,109 @@ static bool oahttslf_lookup_indices(unsigned int i, unsigned int j,
   uint64_t key,val64;
   bool found;
 
+#ifdef USE_OAHTTSLF6432
+  (void)val64;
+  key = ((uint64_t)i << 32) | (j & 0xffffffff);
+  found = oahttslf6432_lookup(hashtable, key, pvalue);
+#elif defined(USE_OAHTTSLFQ)
+  key = (uint64_t)i * (CAPACITY + 1) + j;
+  found = oahttslfq_lookup(hashtable, key, &val64);
+  if (found)
+    *pvalue = (unsigned int)val64;
+#endif
+  return found;
+}
+#endif /* !USE_RESERVE */
+
+
+
+/*
+ * oahttslf_find_or_claim_indices()
+ *
+ * Get the value for (i,j) from the hashtable, or if it is not there
+ * set up a handle for oahttslf_publish_indices() to give it its value
+ * (claiming the slot for it where the table can), all in one probe.
+ * With -c, looks in the thread's own cache first, and puts what it
+ * finds in the hashtable there.
+ *
+ * Parameters:
+ *     i,j - indices to build key for lookup
+ *     pvalue - (OUTPUT) value for key, only set if OAHTTSLF_FOUND returned
+ *     handle - (OUTPUT) where the value goes, set unless OAHTTSLF_FOUND
+ *              returned
+ *     thread_id - id (0,...n, not pthread id) of this thread
+ * 
+ * Return value:
+ *     OAHTTSLF_FOUND if found, else OAHTTSLF_PENDING if another thread
+ *     has claimed (i,j) and not yet published its value, else
+ *     OAHTTSLF_CLAIMED (OAHTTSLF_ABSENT for the tables that cannot
+ *     claim a slot)
+ */
+static oahttslf_state_t oahttslf_find_or_claim_indices(unsigned int i,
+                                                       unsigned int j,
+                                                       unsigned int *pvalue,
+                                                       memo_handle_t *handle,
+                                                       int thread_id)
+{
+  uint64_t val64;
+  oahttslf_state_t state;
+#ifdef USE_RESERVE
+  uint64_t key;
+#endif
+
+  handle->l1key = L1_KEY(i, j);
+  if (l1memo && L1MEMO_LOOKUP(l1memo, thread_id, handle->l1key, &val64))
+  {
+    *pvalue = (unsigned int)val64;
+    return OAHTTSLF_FOUND;
+  }
+#ifdef USE_RESERVE
   key = (i == 0 && j == 0 ? MAGIC_ZERO :
          ((uint64_t)i << 32) | (j & 0xffffffff));
-  found =  oahttslf_lookup(key, &val64);
-  if (found)
+  if ((state = oahttslf_find_or_claim(hashtable, key, &val64,
+                                      &handle->handle, thread_id)) ==
+      OAHTTSLF_FOUND)
     *pvalue = ((val64 == MAGIC_ZERO) ? 0 : (unsigned int)val64);
-  return found;
+#else
+  handle->i = i;
+  handle->j = j;
+  state = oahttslf_lookup_indices(i, j, pvalue) ? OAHTTSLF_FOUND :
+    OAHTTSLF_ABSENT;
+#endif
+  if (state == OAHTTSLF_FOUND && l1memo)
+    L1MEMO_PUT(l1memo, thread_id, handle->l1key, *pvalue);
+  return state;
 }
 
 
 
+/*
+ * oahttslf_publish_indices()
+ *
+ * Give (i,j) its value after oahttslf_find_or_claim_indices() did
+ * not find it (and with -c, put it in the thread's own cache too)
+ *
+ * Parameters:
+ *    handle - set up by oahttslf_find_or_claim_indices()
+ *    value - value for (i,j)
+ *    thread_id - id (0,...n, not pthread id) of this thread
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf_publish_indices(const memo_handle_t *handle,
+                                     unsigned int value, int thread_id)
+{
+#ifdef USE_RESERVE
+  oahttslf_publish(hashtable, &handle->handle,
+                   (value == 0 ? MAGIC_ZERO : (uint64_t)value), thread_id);
+#else
+  oahttslf_insert_indices(handle->i, handle->j, value, thread_id);
+#endif
+  if (l1memo)
+    L1MEMO_PUT(l1memo, thread_id, handle->l1key, value);
+}
+
 
 
 /*****************************************************************************
@@ -269,6 +457,96 @@ void *dp_knapsack_thread(void *threadarg)
   return &mydata->profit;
 }
 
+/*
+ * dp_knapsack_claimed()
+ *
+ *      Compute the value of the d.p. at (i,w), which is not in the
+ *      hashtable, and give it its value there through the handle that
+ *      oahttslf_find_or_claim_indices() set up, without probing for it
+ *      again. Both children are claimed (or found) with one probe each
+ *      before either is computed, so the probe that finds a child
+ *      another thread is computing is the same one that claims it if
+ *      not: a child that is pending is left until after its sibling,
+ *      then looked up again (by which time it is usually done), and one
+ *      that is claimed is computed here without another probe.
+ *
+ *      Parameters:   i - item index
+ *                    w - total weight
+ *               handle - where the value for (i,w) goes
+ *            thread_id - our thread identifer (0,1,2,.. NOT pthread_t) 
+ *                 seed - seed for rand_r()
+ *
+ *      Uses global data: as dp_knapsack()
+ *
+ *      Return value: 
+ *                    value of d.p. at (i,w)
+ *
+ */
+static unsigned int dp_knapsack_claimed(unsigned int i, unsigned int w,
+                                        const memo_handle_t *handle,
+                                        int thread_id, unsigned int *seed)
+{
+  unsigned int p,pwithout,pwith;
+  unsigned int ci[2], cw[2], cp[2]; /* (i,w) and value of the children */
+  oahttslf_state_t cstate[2];         /* what the claim of each child found */
+  memo_handle_t chandle[2];
+  unsigned int first, c; /* which child to compute first, and the child */
+  unsigned int x;
+
+  if (i == 0 || w == 0)
+  {
+    p = 0;
+  }
+  else if (w < ITEMS[i].weight)
+  {
+    p = dp_knapsack(i - 1, w, thread_id, seed);
+  }
+  else
+  {
+    ci[0] = ci[1] = i - 1;
+    cw[0] = w;
+    cw[1] = w - ITEMS[i].weight;
+    for (c = 0; c < 2; c++)
+    {
+      cstate[c] = oahttslf_find_or_claim_indices(ci[c], cw[c], &cp[c],
+                                                 &chandle[c], thread_id);
+#ifdef USE_INSTRUMENT
+      if (cstate[c] == OAHTTSLF_FOUND)
+        SHARDCOUNT_INC(&stats, thread_id, STATS_REUSE);
+#endif
+    }
+    first = (!use_random || rand_r(seed) % 2) ? 0 : 1;
+    /* if another thread is already computing the child we would do
+       first, do the other one first and hope it is done by then */
+    if (cstate[first] == OAHTTSLF_PENDING &&
+        cstate[1 - first] != OAHTTSLF_PENDING)
+      first = 1 - first;
+    for (x = 0; x < 2; x++)
+    {
+      c = (x == 0 ? first : 1 - first);
+      if (cstate[c] == OAHTTSLF_PENDING)
+        cp[c] = dp_knapsack(ci[c], cw[c], thread_id, seed);
+      else if (cstate[c] != OAHTTSLF_FOUND)
+        cp[c] = dp_knapsack_claimed(ci[c], cw[c], &chandle[c],
+                                    thread_id, seed);
+    }
+    pwithout = cp[0];
+    pwith = cp[1] + ITEMS[i].profit;
+    p = MAX(pwithout, pwith);
+  }
+
+
+#ifdef DEBUG
+  bpa_log_msg("dp_knapsack", "S\t%d\t%d\t%d\n",i,w,p);
+#endif
+#ifdef USE_INSTRUMENT
+  SHARDCOUNT_INC(&stats, thread_id, STATS_HASHCOUNT);
+#endif
+  oahttslf_publish_indices(handle, p, thread_id);
+  return p;
+}
+
+
 /*
  * dp_knapsack()
  *
@@ -281,7 +559,10 @@ void *dp_knapsack_thread(void *threadarg)
  *      a random choice as to which of the paths we take first; we use
  *      parallelism to explore the search space concurrently with
  *      diverged paths due to this choice, but still reusing computed
- *      values by the shared lock-free hashtable.
+ *      values by the shared lock-free hashtable. A child that another
+ *      thread has claimed in the hashtable but not yet finished is
+ *      left until after its sibling, so we do not duplicate its work
+ *      (see dp_knapsack_claimed()).
  *
  *
  *      This version uses no bounding.
@@ -298,6 +579,7 @@ void *dp_knapsack_thread(void *threadarg)
  *
  *                   read/write:
  *                     stats
+ *                     hashtable
  *
  *      Return value: 
  *                    value of d.p. at (i,w)
@@ -307,55 +589,23 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
                          unsigned int *seed)
 {
   static const char *funcname = "dp_knapsack";
-  unsigned int p,pwithout,pwith;
+  unsigned int p;
+  memo_handle_t handle;
 
 #ifdef DEBUG
   bpa_log_msg(funcname, "\t%d\t%d\n",i,w);
 #endif
 
   /* memoization: if value here already computed then do nothing */
-  if (oahttslf_lookup_indices(i, w, &p))
+  if (oahttslf_find_or_claim_indices(i, w, &p, &handle, thread_id) ==
+      OAHTTSLF_FOUND)
   {
 #ifdef USE_INSTRUMENT
-    stats[thread_id].reuse++;
+    SHARDCOUNT_INC(&stats, thread_id, STATS_REUSE);
 #endif
     return p;
   }
-
-  if (i == 0 || w == 0)
-  {
-    p = 0;
-  }
-  else if (w < ITEMS[i].weight)
-  {
-    p = dp_knapsack(i - 1, w, thread_id, seed);
-  }
-  else
-  {
-    if (!use_random || rand_r(seed) % 2)
-    {
-      pwithout = dp_knapsack(i - 1, w, thread_id, seed);
-      pwith = dp_knapsack(i - 1, w - ITEMS[i].weight, thread_id, seed) + 
-        ITEMS[i].profit;
-    }
-    else
-    {
-      pwith = dp_knapsack(i - 1, w - ITEMS[i].weight, thread_id, seed) +
-        ITEMS[i].profit;
-      pwithout = dp_knapsack(i - 1, w, thread_id, seed);
-    }
-    p = MAX(pwithout, pwith);
-  }
-
-
-#ifdef DEBUG
-  bpa_log_msg(funcname, "S\t%d\t%d\t%d\n",i,w,p);
-#endif
-#ifdef USE_INSTRUMENT
-  stats[thread_id].hashcount++;
-#endif
-  oahttslf_insert_indices(i, w, p, thread_id);
-  return p;
+  return dp_knapsack_claimed(i, w, &handle, thread_id, seed);
 }
 
 
@@ -370,7 +620,9 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w, int thread_id,
  *    itself, as we want to just terminate when the first thread to
  *    compute the answer terminates, since all threads are to compute
  *    the whole problem (don't want the case where we in the
- *    master thread are still computing).
+ *    master thread are still computing). The other threads are then
+ *    cancelled and joined, so none is still changing the hashtable
+ *    (e.g. while it is saved with -s) when we return.
  *
  *
  *    Paramters:
@@ -387,7 +639,7 @@ static int dp_knapsack_thread_master(unsigned int i, unsigned int w)
   int actindex = 0;
   int new_thread_id;
   int finished_thread_id;
-  int rc;
+  int rc, t;
   unsigned int *profit;
   
   term_thread_id = -1;
@@ -428,7 +680,22 @@ static int dp_knapsack_thread_master(unsigned int i, unsigned int w)
   if ((rc = pthread_join(threads[finished_thread_id], &profit)))
       bpa_fatal_error(funcname, "pthread_join failed (%d)\n", rc);
 
-  /* TODO cleanup threads (some will still be running) */
+  /* cleanup threads (some will still be running), so that nothing is
+     changing the hashtable when it is saved */
+  for (t = 0; t < (int)num_active_threads; t++)
+  {
+    if (t == finished_thread_id)
+      continue;
+    /* safe to ignore an error --- thread may have finished by now */
+    (void)pthread_cancel(threads[t]);
+  }
+  for (t = 0; t < (int)num_active_threads; t++)
+  {
+    if (t == finished_thread_id)
+      continue;
+    if ((rc = pthread_join(threads[t], NULL)))
+      bpa_fatal_error(funcname, "pthread_join [2] failed (%d)\n", rc);
+  }
 
   return *profit;
 }
@@ -451,18 +718,11 @@ static int dp_knapsack_thread_master(unsigned int i, unsigned int w)
  *                    total_hashcount
  *                  readonly:
  *                    stats
- *                    max_threads -max number of threads allowed
  */
 static void compute_total_counts()
 {
-  unsigned int t;
-  total_reuse = 0;
-  total_hashcount = 0;
-  for (t = 0; t < max_threads; t++)
-  {
-    total_reuse += stats[t].reuse;
-    total_hashcount += stats[t].hashcount;
-  }
+  total_reuse = shardcount_total(&stats, STATS_REUSE);
+  total_hashcount = shardcount_total(&stats, STATS_HASHCOUNT);
 }
 
 #endif
@@ -519,6 +779,27 @@ static void readdata(void)
   }
 }
 
+#ifdef USE_SNAPSHOT
+/*
+ * Id of the problem read by readdata() for snapshot files, so that one
+ * saved for other items or another capacity is not loaded.
+ *
+ * Parameters:
+ *     None.
+ * Return value:
+ *     hash of the profits and weights of the items and the capacity
+ * Uses global data (read):
+ *      ITEMS, CAPACITY, NUM_ITEMS
+ */
+static uint64_t problem_id(void)
+{
+  uint64_t h = HASHFN_BYTES_INIT;
+
+  h = hashfn_bytes(h, &ITEMS[1], NUM_ITEMS * sizeof(item_t));
+  return hashfn_bytes(h, &CAPACITY, sizeof(CAPACITY));
+}
+#endif
+
 /*
  * print usage message and exit
  *
@@ -526,13 +807,23 @@ static void readdata(void)
 static void usage(const char *program)
 {
   fprintf(stderr, 
-          "Usage: %s [-ntvyz] [-r threads] < problemspec\n"
+          "Usage: %s [-ntvyzHNBpV] [-r threads] [-l snapshot] [-s snapshot]"
+          " [-c kbytes] < problemspec\n"
           "  -n: assume no name in the first line of the file\n"
           "  -r threads: number of worker threads to run (default %d)\n"
           "  -t: show statistics of operations\n"
           "  -v: Verbose output\n"
           "  -y: show instrumentatino summary line (like -t but one line summary)\n"
-          "  -z: do NOT randomize choices, make same path in every thread\n",
+          "  -z: do NOT randomize choices, make same path in every thread\n"
+          "  -H: use huge pages for the hash table\n"
+          "  -N: interleave the hash table over all NUMA nodes\n"
+          "  -B: put an equal part of the hash table on each NUMA node\n"
+          "  -p: prefault the hash table in parallel with the worker threads\n"
+          "  -l snapshot: start with hash table saved by -s for this problem\n"
+          "  -s snapshot: save the hash table to snapshot when done\n"
+          "  -c kbytes: look in a per-thread cache of kbytes (e.g. 256)"
+          " before the hash table\n"
+          "  -V: validate the hash table and print its statistics when done\n",
           program, DEFAULT_MAX_THREADS);
   
   exit(EXIT_FAILURE);
@@ -556,6 +847,20 @@ int main(int argc, char *argv[])
   unsigned int t;
   char name[100];
   int noname = 0;
+  bigmem_huge_t huge = BIGMEM_HUGE_NONE;
+  bigmem_numa_t numa = BIGMEM_NUMA_FIRSTTOUCH;
+  bool prefault = FALSE;
+  uint64_t max_keys;
+  unsigned long l1_kbytes = 0;
+#ifdef USE_OAHTTSLFQ
+  unsigned int key_bits;
+#endif
+#ifdef USE_SNAPSHOT
+  const char *load_file = NULL, *save_file = NULL;
+#endif
+#ifdef USE_TABLE_CHECK
+  bool check_table = FALSE;
+#endif
 #ifdef USE_INSTRUMENT
   unsigned int num_keys;
 #endif
@@ -564,7 +869,7 @@ int main(int argc, char *argv[])
 
   gettimeofday(&start_timeval, NULL);
 
-  while ((c = getopt(argc, argv, "nvyztr:?")) != -1)
+  while ((c = getopt(argc, argv, "nvyztHNBpVr:l:s:c:?")) != -1)
   {
     switch(c) {
       case 'r':
@@ -603,6 +908,47 @@ int main(int argc, char *argv[])
         /* do not randomize choices */
         use_random = 0;
         break;
+      case 'H':
+        /* huge pages for hash table */
+        huge = BIGMEM_HUGE_HUGETLB;
+        break;
+      case 'N':
+        /* interleave hash table over NUMA nodes */
+        numa = BIGMEM_NUMA_INTERLEAVE;
+        break;
+      case 'B':
+        /* bind a part of hash table to each NUMA node */
+        numa = BIGMEM_NUMA_BIND;
+        break;
+      case 'p':
+        /* prefault hash table with as many threads as workers */
+        prefault = TRUE;
+        break;
+#ifdef USE_SNAPSHOT
+      case 'l':
+        /* start with hash table from snapshot */
+        load_file = optarg;
+        break;
+      case 's':
+        /* save hash table to snapshot when done */
+        save_file = optarg;
+        break;
+#endif
+#ifdef USE_TABLE_CHECK
+      case 'V':
+        /* validate hash table and print its statistics when done */
+        check_table = TRUE;
+        break;
+#endif
+      case 'c':
+        /* per-thread cache in front of hash table */
+        if (atol(optarg) < 1)
+        {
+          fprintf(stderr, "per-thread cache kbytes must be >= 1\n");
+          usage(argv[0]);
+        }
+        l1_kbytes = (unsigned long)atol(optarg);
+        break;
       default:
         usage(argv[0]);
    	    break;
@@ -626,7 +972,26 @@ int main(int argc, char *argv[])
 
   getrusage(RUSAGE_SELF, &starttime);
 
+  bigmem_set_policy(huge, numa, prefault ? (int)max_threads : 1);
   readdata(); /* read into the ITEMS array and set CAPACITY, NUM_ITEMS */
+  /* at most one key per (i,w) subproblem */
+  max_keys = (uint64_t)(NUM_ITEMS + 1) * (CAPACITY + 1);
+#ifdef USE_OAHTTSLFQ
+  for (key_bits = 1; key_bits < 64 && (1ULL << key_bits) < max_keys; key_bits++)
+    /* bits for keys 0..max_keys-1 */ ;
+  hashtable = oahttslfq_create(max_keys, key_bits, 32);
+#else
+  hashtable = NULL;
+#ifdef USE_SNAPSHOT
+  /* d.p. values from an earlier run on the same problem */
+  if (load_file && !(hashtable = oahttslf_load(load_file, problem_id())))
+    exit(EXIT_FAILURE);
+#endif
+  if (!hashtable)
+    hashtable = oahttslf_create(max_keys);
+#endif
+  if (l1_kbytes > 0)
+    l1memo = l1memo_create((int)max_threads, (size_t)l1_kbytes * 1024);
   profit = dp_knapsack_thread_master(NUM_ITEMS, CAPACITY);
 
   getrusage(RUSAGE_SELF, &endtime);
@@ -638,9 +1003,15 @@ int main(int argc, char *argv[])
           + 1000 * runtime.ru_stime.tv_sec + runtime.ru_stime.tv_usec/1000;
   etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
 
+#ifdef USE_SNAPSHOT
+  if (save_file &&
+      oahttslf_save(hashtable, save_file, problem_id(), (int)max_threads) != 0)
+    exit(EXIT_FAILURE);
+#endif
+
 #ifdef USE_INSTRUMENT
   compute_total_counts();
-  num_keys = oahttslf_total_key_count();
+  num_keys = oahttslf_total_key_count(hashtable);
 #endif
 
  if (show_stats_summary)
@@ -649,7 +1020,7 @@ int main(int argc, char *argv[])
    printf("INSTRUMENT hc=%lu,re=%lu,re/hc=%f,hn=%u,or=%ld\n", total_hashcount, total_reuse,
           (float)total_reuse / total_hashcount, num_keys,
 #ifdef USE_CONTENTION_INSTRUMENT
-          oahttslf_total_retry_count()
+          oahttslf_total_retry_count(hashtable)
 #else
           (long)-1
 #endif
@@ -657,7 +1028,7 @@ int main(int argc, char *argv[])
 #elif defined(USE_CONTENTION_INSTRUMENT)
    printf("INSTRUMENT hc=%lu,re=%lu,re/hc=%f,hn=%u,or=%ld\n", 
            0, 0, 0.0, 0,
-          oahttslf_total_retry_count()
+          oahttslf_total_retry_count(hashtable)
           );
 #else
    printf("COMPILED WITHOUT -DUSE_INSTRUMENT : NO STATS AVAIL\n");
@@ -669,8 +1040,11 @@ int main(int argc, char *argv[])
   {
     for (t = 0; t < max_threads; t++)
     {
-      printf("thread id %d [re=%lu,hc=%lu,re/hc=%f]\n", t, stats[t].reuse, 
-              stats[t].hashcount, (float)stats[t].reuse/stats[t].hashcount);
+      printf("thread id %d [re=%lu,hc=%lu,re/hc=%f]\n", t,
+             SHARDCOUNT_GET(&stats, t, STATS_REUSE),
+             SHARDCOUNT_GET(&stats, t, STATS_HASHCOUNT),
+             (float)SHARDCOUNT_GET(&stats, t, STATS_REUSE) /
+             SHARDCOUNT_GET(&stats, t, STATS_HASHCOUNT));
     }
     printf("totals [re=%lu,hc=%lu,re/hc=%f,hn=%u]\n", total_reuse, total_hashcount,
            (float)total_reuse/total_hashcount, num_keys);
@@ -686,6 +1060,19 @@ int main(int argc, char *argv[])
 #endif
          ttime, etime, flags, name);
 
+#ifdef USE_TABLE_CHECK
+  /* after the timing, and with as many threads as computed it */
+  if (check_table)
+  {
+    oahttslf_printstats_par(hashtable, (int)max_threads);
+    if (!oahttslf_validate_par(hashtable, (int)max_threads))
+    {
+      fprintf(stderr, "hash table validation failed\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+#endif
+
   free(ITEMS);
   exit(0);
   
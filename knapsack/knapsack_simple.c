@@ -8,6 +8,11 @@
  *
  * simple implementation of knapsack d.p.
  *
+ * This is the single-threaded baseline the parallel versions' speedups
+ * are measured against, so it uses the serial open addressing table
+ * (oaht), with no atomic instructions, rather than ht.c with a malloc()
+ * (or cell) per entry and a chain to walk.
+ *
  *  Usage: knapsack_simple [-tvn]  < problemspec
  *          -t: show statistics of operations
  *          -v: Verbose output 
@@ -45,7 +50,7 @@
 #include <sys/resource.h>
 
 #include "bpautils.h"
-#include "ht.h"
+#include "oaht.h"
 
 
 unsigned int dp_knapsack(unsigned int i, unsigned int w, 
@@ -58,18 +63,6 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w,
  *****************************************************************************/
 
 
-/* definition of a type for a 2tuple */
-/* 
- * The key for the hashtable is a 2-tuple, i.e. we look up by an (i,j)
- * tuple, where i,j would have been the indices of our 2-dimensional matrix
- */
-typedef struct tuple2_s 
-{
-  unsigned int i;
-  unsigned int j;
-} tuple2_t;
-
-
 typedef unsigned long counter_t;
 
 typedef struct stats_s 
@@ -102,6 +95,8 @@ static unsigned int CAPACITY; /* total capacity for the problem */
 static unsigned int NUM_ITEMS; /* number of items */
 static item_t *ITEMS;         /* array of item profits and weights (0 unused)*/
 
+static oaht_t *hashtable;     /* hashtable for d.p. values, key is (i,w) */
+
 
 #ifdef USE_INSTRUMENT
 static stats_t stats;
@@ -115,64 +110,27 @@ static stats_t stats;
  *****************************************************************************/
 
 
-/*
- * ht_hash()
- *
- * Compute hash value for the table.
- * We will simply shove the low 16 bits of each index in the tuple
- * into a word and return the value modulo the tablesize.
- *
- * Paramters:
- *     key - ptr to 2-tuple to compute hash value for
- *
- * Return value:
- *     hash value
- */
-static unsigned int ht_hash(const void *vkey) 
-{
-  int hashval;
-  const tuple2_t *key = (const tuple2_t *)vkey;
-
-  hashval = (key->i << 16) | (key->j & 0xffff);
-  return hashval % HT_SIZE; 
-
-}
-
-
-/*
- * ht_keymatch()
- *
- * Compare two key structures
- *
- * Parameters:
- *    s1 - key struct ptr for first
- *    s2 - key struct ptr for second
- *
- * Return value:
- *    nonzero if s1 and s2 are equal, else 0.
- *
- */
-static int ht_keymatch(const void *vs1, const void *vs2)
-{
-  const tuple2_t *s1 = (const tuple2_t *)vs1;
-  const tuple2_t *s2 = (const tuple2_t *)vs2;
-
-  return (s1->i == s2->i && s1->j == s2->j);
-}
-
-
-
 /* insert by (i,j) into table */
-static void ht_insert_indices(unsigned int i, unsigned int j, 
-                                  unsigned int value);
+static void oaht_insert_indices(unsigned int i, unsigned int j,
+                                unsigned int value);
 
 /* lookup by (i,j) */
-static bool ht_lookup_indices(unsigned int i, unsigned int j,
-                              unsigned int *pvalue);
+static bool oaht_lookup_indices(unsigned int i, unsigned int j,
+                                unsigned int *pvalue);
+
+/* dodgy: 0 is the OAHT_EMPTY_VALUE value,
+   so if value is 0 set it to MAGIC_ZERO instead */
+#define MAGIC_ZERO 0xffffffffffffffff
+
+/* key for (i,w): the subproblems numbered row by row from 1 (so the key
+   is never OAHT_EMPTY_KEY), so the keys are dense and with the identity
+   hash the table is indexed directly by them, the (i-1,w) and (i-1,w-wi)
+   looked up by (i,w) being at fixed distances below it in the table */
+#define KNAP_KEY(i, w) ((uint64_t)(i) * (CAPACITY + 1) + (w) + 1)
 
 
 /*
- * ht_insert_indices()
+ * oaht_insert_indices()
  *
  * Insert value for (i,j) into the hashtable
  *
@@ -183,22 +141,19 @@ static bool ht_lookup_indices(unsigned int i, unsigned int j,
  * Return value:
  *    None.
  */
-static void ht_insert_indices(unsigned int i, unsigned int j,
-                                  unsigned int value)
+static void oaht_insert_indices(unsigned int i, unsigned int j,
+                                unsigned int value)
 {
-  tuple2_t key;
-  unsigned int uvalue;
+  uint64_t key;
 
-  key.i = i;
-  key.j = j;
-  uvalue = value;
-  ht_insert(&key, &uvalue);
+  key = KNAP_KEY(i, j);
+  oaht_insert(hashtable, key, (value == 0 ? MAGIC_ZERO : (uint64_t)value));
 }
 
 
 
 /*
- * ht_lookup_indices()
+ * oaht_lookup_indices()
  *
  * Get the value for (i,j) from the hashtable
  *
@@ -209,22 +164,16 @@ static void ht_insert_indices(unsigned int i, unsigned int j,
  * Return value:
  *     TRUE if found, FALSE otherwise
  */
-static bool ht_lookup_indices(unsigned int i, unsigned int j,
-                              unsigned int *pvalue)
+static bool oaht_lookup_indices(unsigned int i, unsigned int j,
+                                unsigned int *pvalue)
 {
-  tuple2_t key;
-  unsigned int *pval;
+  uint64_t key, val64;
 
-  key.i = i;
-  key.j = j;
-  pval = (unsigned int *)ht_lookup(&key);
-  if (pval)
-  {
-    *pvalue = *pval;
-    return TRUE;
-  }
-  else
+  key = KNAP_KEY(i, j);
+  if (!oaht_lookup(hashtable, key, &val64))
     return FALSE;
+  *pvalue = (val64 == MAGIC_ZERO ? 0 : (unsigned int)val64);
+  return TRUE;
 }
 
 
@@ -280,7 +229,7 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w,
 #endif
 
   /* memoization: if value here already computed then do nothing */
-  if (ht_lookup_indices(i, w, &p))
+  if (oaht_lookup_indices(i, w, &p))
   {
 #ifdef USE_INSTRUMENT
     stats.reuse++;
@@ -310,7 +259,7 @@ unsigned int dp_knapsack(unsigned int i, unsigned int w,
 #ifdef USE_INSTRUMENT
   stats.hashcount++;
 #endif
-  ht_insert_indices(i, w, p);
+  oaht_insert_indices(i, w, p);
   return p;
 }
 
@@ -478,13 +427,12 @@ int main(int argc, char *argv[])
   else
     fgets(name,sizeof(name)-1,stdin);
   
-  ht_initialize(sizeof(tuple2_t), sizeof(unsigned int),
-                    ht_hash, NULL, 
-                    ht_keymatch, NULL);
-
   getrusage(RUSAGE_SELF, &starttime);
 
   readdata(); /* read into the ITEMS array and set CAPACITY, NUM_ITEMS */
+  /* one key per (i,w) subproblem, 1 to (NUM_ITEMS+1)*(CAPACITY+1) */
+  hashtable = oaht_create_hash((uint64_t)(NUM_ITEMS + 1) * (CAPACITY + 1),
+                               HASHFN_IDENTITY);
 
 #ifdef DEBUG
   dumpproblem();
@@ -510,6 +458,7 @@ int main(int argc, char *argv[])
 #endif
          ttime, etime, flags, name);
 
+  oaht_destroy(hashtable);
   free(ITEMS);
   exit(0);
   
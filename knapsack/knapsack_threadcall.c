@@ -61,7 +61,7 @@
 #endif
 
 #include "bpautils.h"
-#include "httslf.h"
+#include "shardcount.h"
 
 
 #undef USE_MUTEX /* mutex slows down dramatically, slower with more threads */
@@ -95,11 +95,12 @@ typedef struct tuple2_s
 
 typedef unsigned long counter_t;
 
-typedef struct stats_s 
+/* indices of the per-thread counters in stats */
+enum
 {
-    counter_t count_dp_entry;  /* calls of dp */
-    counter_t count_dp_entry_notmemoed; /* where not memo value return */
-} stats_t;
+  STATS_DP_ENTRY,          /* calls of dp */
+  STATS_DP_ENTRY_NOTMEMOED /* where not memo value return */
+};
 
 
 
@@ -138,7 +139,7 @@ static item_t *ITEMS;         /* array of item profits and weights (0 unused)*/
 
 #ifdef USE_INSTRUMENT
 /* instrumentation is per-thread, each thread only writes to its own element */
-static stats_t stats[MAX_NUM_THREADS];
+static shardcount_t stats;
 #endif
 
 
@@ -161,55 +162,22 @@ counter_t  total_count_dp_entry = 0, total_count_dp_entry_notmemoed = 0;
 
 
 /*
- * httslf_hash()
- *
- * Compute hash value for the table.
- * We will simply shove the low 16 bits of each index in the tuple
- * into a word and return the value modulo the tablesize.
- *
- * Paramters:
- *     key - ptr to 2-tuple to compute hash value for
- *
- * Return value:
- *     hash value
+ * The d.p. table, an instantiation of httslft.h with the (i,j) key.
+ * The hash simply shoves the low 16 bits of each index in the tuple
+ * into a word.
  */
-static unsigned int httslf_hash(const void *vkey) 
-{
-  unsigned int hashval;
-  const tuple2_t *key = (const tuple2_t *)vkey;
-
-  hashval = (key->i << 16) | (key->j & 0xffff);
-  return hashval % HTTSLF_SIZE; 
-
-}
-
-
-/*
- * httslf_keymatch()
- *
- * Compare two key structures
- *
- * Parameters:
- *    s1 - key struct ptr for first
- *    s2 - key struct ptr for second
- *
- * Return value:
- *    nonzero if s1 and s2 are equal, else 0.
- *
- */
-static int httslf_keymatch(const void *vs1, const void *vs2)
-{
-  const tuple2_t *s1 = (const tuple2_t *)vs1;
-  const tuple2_t *s2 = (const tuple2_t *)vs2;
-
-  return (s1->i == s2->i && s1->j == s2->j);
-}
+#define HTTSLFT_NAME     dptable
+#define HTTSLFT_KEY_T    tuple2_t
+#define HTTSLFT_VALUE_T  unsigned int
+#define HTTSLFT_HASH(k)  ((k)->i << 16 | ((k)->j & 0xffff))
+#define HTTSLFT_KEYMATCH(k1, k2) ((k1)->i == (k2)->i && (k1)->j == (k2)->j)
+#include "httslft.h"
 
 
 
 /* insert by (i,j) into table */
 static void httslf_insert_indices(unsigned int i, unsigned int j, 
-                                  unsigned int value);
+                                  unsigned int value, int thread_id);
 
 /* lookup by (i,j) */
 static void *httslf_lookup_indices(unsigned int i, unsigned int j);
@@ -223,12 +191,13 @@ static void *httslf_lookup_indices(unsigned int i, unsigned int j);
  * Parameters:
  *    i,j - indices to build insertion key
  *    value - value to insert for the key
+ *    thread_id - id (0,1,2,..) of this thread
  *
  * Return value:
  *    None.
  */
 static void httslf_insert_indices(unsigned int i, unsigned int j,
-                                  unsigned int value)
+                                  unsigned int value, int thread_id)
 {
   tuple2_t key;
   unsigned int uvalue;
@@ -236,7 +205,7 @@ static void httslf_insert_indices(unsigned int i, unsigned int j,
   key.i = i;
   key.j = j;
   uvalue = value;
-  httslf_insert(&key, &uvalue);
+  dptable_insert(&key, &uvalue, thread_id);
 }
 
 
@@ -258,7 +227,7 @@ static void *httslf_lookup_indices(unsigned int i, unsigned int j)
 
   key.i = i;
   key.j = j;
-  return httslf_lookup(&key);
+  return dptable_lookup(&key);
 }
 
 
@@ -418,7 +387,7 @@ void *dp_knapsack_thread(void *threadarg)
 #endif
 
 #ifdef USE_INSTRUMENT
-  stats[mydata->thread_id].count_dp_entry++;
+  SHARDCOUNT_INC(&stats, mydata->thread_id, STATS_DP_ENTRY);
 #endif
 
   /* memoization: if value here already computed then do nothing */
@@ -426,7 +395,7 @@ void *dp_knapsack_thread(void *threadarg)
     return NULL;
 
 #ifdef USE_INSTRUMENT
-  stats[mydata->thread_id].count_dp_entry_notmemoed++;
+  SHARDCOUNT_INC(&stats, mydata->thread_id, STATS_DP_ENTRY_NOTMEMOED);
 #endif
 
   comp_notp = FALSE; comp_pwith = FALSE;
@@ -504,7 +473,7 @@ void *dp_knapsack_thread(void *threadarg)
 #ifdef DEBUG
   bpa_log_msg(funcname, "%d\tS\t%d\t%d\t%d\n",mydata->thread_id,i,w,p);
 #endif
-  httslf_insert_indices(i, w, p);
+  httslf_insert_indices(i, w, p, mydata->thread_id);
   return NULL;
 }
 
@@ -523,18 +492,12 @@ void *dp_knapsack_thread(void *threadarg)
  *                    total_count_dp_entry_notmemoed
  *                  readonly:
  *                    stats
- *                    max_threads -max number of threads allowed
  */
 static void compute_total_counts()
 {
-  unsigned int t;
-  total_count_dp_entry = 0;
-  total_count_dp_entry_notmemoed = 0;
-  for (t = 0; t < max_threads; t++)
-  {
-    total_count_dp_entry += stats[t].count_dp_entry;
-    total_count_dp_entry_notmemoed += stats[t].count_dp_entry_notmemoed;
-  }
+  total_count_dp_entry = shardcount_total(&stats, STATS_DP_ENTRY);
+  total_count_dp_entry_notmemoed = shardcount_total(&stats,
+                                                    STATS_DP_ENTRY_NOTMEMOED);
 }
 
 #endif
@@ -553,7 +516,7 @@ static void compute_total_counts()
  *
  *      Uses global data:
  *                  read/write:
- *                    hashtable in httslf.c
+ *                    the d.p. table dptable
  *                    total_count_dp_entry 
  *                    total_count_dp_entry_notmemoed
  *                  readonly:
@@ -566,7 +529,7 @@ static void compute_total_counts()
 unsigned int dp_knapsack_thread_master(unsigned int i, unsigned int w)
 {
   thread_data_t master_thread_data;
-  httslf_entry_t *ent;
+  dptable_entry_t *ent;
   unsigned int t;
 
 
@@ -583,9 +546,10 @@ unsigned int dp_knapsack_thread_master(unsigned int i, unsigned int w)
     for (t = 0; t < max_threads; t++)
     {
       printf("stats for thread %d:\n", t);
-      printf("  calls to dp = %lu\n", stats[t].count_dp_entry);
+      printf("  calls to dp = %lu\n",
+             SHARDCOUNT_GET(&stats, t, STATS_DP_ENTRY));
       printf("  calls to dp where not memoed = %lu\n",
-             stats[t].count_dp_entry_notmemoed);
+             SHARDCOUNT_GET(&stats, t, STATS_DP_ENTRY_NOTMEMOED));
     }
     compute_total_counts();
     printf("totals:\n");
@@ -725,9 +689,7 @@ int main(int argc, char *argv[])
   if (optind != argc)
     usage(argv[0]);
   
-  httslf_initialize(sizeof(tuple2_t), sizeof(unsigned int),
-                    httslf_hash, NULL, 
-                    httslf_keymatch, NULL);
+  dptable_create();
 
   getrusage(RUSAGE_SELF, &starttime);
 
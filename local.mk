@@ -0,0 +1 @@
+PTHREAD_LDFLAGS = -pthread
@@ -0,0 +1,199 @@
+/*****************************************************************************
+ *
+ * File:    atomicbench.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Benchmark of oahttslf with the two gcc backends of atomicdefs.h: this
+ * is built as atomicbench, with the __atomic builtins (acquire loads on
+ * lookup etc.), and as atomicbench_sync, with the table built with
+ * USE_SYNC_ATOMICS (full barrier __sync builtins and volatile loads).
+ * Run both with the same arguments to compare them.
+ *
+ * The table is first filled with keys 1..n, then each thread does a
+ * mix of lookups and inserts of random keys in 1..2n (so half the
+ * lookups miss), as in the d.p. where most operations are lookups.
+ *
+ * Usage:
+ *    atomicbench [-t threads] [-n keys] [-o ops] [-i insert_percent]
+ *
+ *    -t threads        : number of threads (default 1)
+ *    -n keys           : number of keys put in first (default 1000000)
+ *    -o ops            : operations per thread (default 10000000)
+ *    -i insert_percent : percentage of operations that are inserts
+ *                        (default 10)
+ *
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "bpautils.h"
+#include "oahttslf.h"
+#include "atomicdefs.h"
+
+
+/* one thread's share of the benchmark */
+typedef struct bench_thread_s
+{
+    int thread_id;            /* 0,1,2,.. */
+    uint64_t num_ops;         /* operations to do */
+    unsigned int insert_pct;  /* percentage of them that are inserts */
+    uint64_t num_keys;        /* keys are in 1..2*num_keys */
+    uint64_t num_found;       /* (OUT) number of lookups that hit */
+} bench_thread_t;
+
+static oahttslf_t *hashtable;  /* the table shared by all threads */
+
+
+/*****************************************************************************
+ *
+ * static functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * bench_thread()
+ *
+ * Do one thread's random lookups and inserts
+ *
+ * Parameters:
+ *    threadarg - pointer to bench_thread_t for this thread
+ *
+ * Return value:
+ *    NULL. Exits with error if a lookup finds a wrong value.
+ */
+static void *bench_thread(void *threadarg)
+{
+  bench_thread_t *bt = (bench_thread_t *)threadarg;
+  uint64_t x = 0x9e3779b97f4a7c15ULL * (bt->thread_id + 1);
+  uint64_t q, key, value;
+
+  for (q = 0; q < bt->num_ops; q++)
+  {
+    /* xorshift64, so the random numbers cost next to nothing */
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    key = (x >> 8) % (2 * bt->num_keys) + 1;
+    if ((unsigned int)(x % 100) < bt->insert_pct)
+      oahttslf_insert(hashtable, key, key * 3, bt->thread_id);
+    else if (oahttslf_lookup(hashtable, key, &value))
+    {
+      if (value != key * 3)
+      {
+        fprintf(stderr, "bad value %llX for key %llX\n", value, key);
+        exit(EXIT_FAILURE);
+      }
+      bt->num_found++;
+    }
+  }
+  return NULL;
+}
+
+
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s [-t threads] [-n keys] [-o ops] [-i insert_percent]\n",
+          program);
+  exit(EXIT_FAILURE);
+}
+
+
+/*****************************************************************************
+ *
+ * main
+ *
+ *****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  bench_thread_t bt[MAX_NUM_THREADS];
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  uint64_t num_keys = 1000000, num_ops = 10000000, key, num_found = 0;
+  unsigned int insert_pct = 10;
+  int num_threads = 1, c, t, rc;
+  double secs;
+
+  while ((c = getopt(argc, argv, "t:n:o:i:")) != -1)
+  {
+    switch (c)
+    {
+      case 't':
+        num_threads = atoi(optarg);
+        if (num_threads < 1 || num_threads > MAX_NUM_THREADS)
+        {
+          fprintf(stderr, "number of threads must be 1..%d\n",
+                  MAX_NUM_THREADS);
+          usage(argv[0]);
+        }
+        break;
+
+      case 'n':
+        if ((num_keys = strtoull(optarg, NULL, 10)) < 1)
+          usage(argv[0]);
+        break;
+
+      case 'o':
+        num_ops = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'i':
+        if ((insert_pct = (unsigned int)atoi(optarg)) > 100)
+          usage(argv[0]);
+        break;
+
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (optind != argc)
+    usage(argv[0]);
+
+  hashtable = oahttslf_create(2 * num_keys);
+  for (key = 1; key <= num_keys; key++)
+    oahttslf_insert(hashtable, key, key * 3, 0);
+
+  gettimeofday(&start_timeval, NULL);
+  for (t = 0; t < num_threads; t++)
+  {
+    bt[t].thread_id = t;
+    bt[t].num_ops = num_ops;
+    bt[t].insert_pct = insert_pct;
+    bt[t].num_keys = num_keys;
+    bt[t].num_found = 0;
+    if ((rc = pthread_create(&threads[t], NULL, bench_thread, &bt[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+    num_found += bt[t].num_found;
+  }
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  secs = elapsed_timeval.tv_sec + 1e-6 * elapsed_timeval.tv_usec;
+
+  printf("backend %s: %d threads, %llu keys, %u%% inserts\n",
+         ATOMICDEFS_BACKEND, num_threads, num_keys, insert_pct);
+  printf("%llu ops in %.3f s: %.2f Mops/s, %.2f ns/op per thread, "
+         "%llu lookups found\n",
+         num_ops * num_threads, secs, num_ops * num_threads / secs / 1e6,
+         secs * 1e9 / num_ops, num_found);
+  oahttslf_destroy(hashtable);
+  exit(0);
+}
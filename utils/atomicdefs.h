@@ -16,6 +16,32 @@
  * cas32()/caslong()/cas64()/casptr() in 
  * /usr/include/sys/atomic.h)
  *
+ * With gcc 4.7 or later (or clang) the __atomic builtins (the C11
+ * memory model) are used instead, unless USE_SYNC_ATOMICS is defined.
+ * The CAS and add macros are still full barriers either way, but the
+ * __atomic backend also gives each of the ordered loads and stores
+ * below just the ordering it is defined with, so e.g. a lookup does an
+ * acquire load (a plain load on x86, ldar on ARM) rather than relying on
+ * volatile and the processor's ordering. With the __sync builtins, and
+ * on Solaris, those macros are plain volatile accesses as before, which
+ * is only right on a machine with TSO such as x86 or SPARC.
+ *
+ *   ATOMIC_LOAD_ACQUIRE(ptr)     - no later access moves before it
+ *   ATOMIC_LOAD_SEQ_CST(ptr)     - nor does an earlier full-barrier store
+ *                                  or CAS (a store then load handshake)
+ *   ATOMIC_STORE_RELEASE(ptr, v) - no earlier access moves after it
+ *   CAS64_WEAK(ptr, expectedp, newval)
+ *                                - full barrier CAS that may fail even if
+ *                                  *ptr == *expectedp, for a retry loop.
+ *                                  TRUE if it set *ptr to newval, else
+ *                                  FALSE with *expectedp set to *ptr (as
+ *                                  an acquire load)
+ *   ATOMIC_ADD_32_NV_RELAXED(ptr, x) - add, with no ordering at all
+ *
+ * Preprocessor symbols:
+ *
+ * SOLARIS          - use the Solaris atomic.h functions
+ * USE_SYNC_ATOMICS - use the __sync builtins even if __atomic is there
  *
  * $Id: atomicdefs.h 2506 2009-06-11 08:12:43Z astivala $
  *
@@ -23,15 +49,71 @@
 
 #ifdef SOLARIS
 #include <atomic.h>
+#define ATOMICDEFS_BACKEND "solaris"
 #define CASPTR(ptr,oldval,newval) atomic_cas_ptr(ptr, oldval, newval)
 #define CAS64(ptr,oldval,newval) atomic_cas_64(ptr, oldval, newval)
 #define CAS32(ptr,oldval,newval) atomic_cas_32(ptr, oldval, newval)
+#define CAS8(ptr,oldval,newval) atomic_cas_8(ptr, oldval, newval)
 #define ATOMIC_OR_64(ptr, x) atomic_or_64(ptr, x)
+#define ATOMIC_ADD_32_NV(ptr, x) atomic_add_32_nv(ptr, x)
+#define ATOMIC_ADD_32_NV_RELAXED(ptr, x) atomic_add_32_nv(ptr, x)
+#define ATOMIC_LOAD_ACQUIRE(ptr) (*(ptr))
+#define ATOMIC_LOAD_SEQ_CST(ptr) (*(ptr))
+#define ATOMIC_STORE_RELEASE(ptr, v) (membar_producer(), *(ptr) = (v))
+#define CAS64_WEAK(ptr,expectedp,newval) \
+  atomicdefs_cas64_weak(ptr, expectedp, newval)
+static int atomicdefs_cas64_weak(volatile uint64_t *ptr, uint64_t *expectedp,
+                                 uint64_t newval)
+{
+  uint64_t expected = *expectedp;
+  return (*expectedp = atomic_cas_64(ptr, expected, newval)) == expected;
+}
+
+#elif defined(__ATOMIC_ACQUIRE) && !defined(USE_SYNC_ATOMICS)
+/* gcc __atomic builtins. The value returning CAS is still done with
+   __sync_val_compare_and_swap(), which gcc defines as the seq_cst
+   __atomic_compare_exchange_n(), since that needs a variable of the
+   unqualified type of *ptr, which C cannot name for a macro */
+#define ATOMICDEFS_BACKEND "atomic"
+#define CASPTR(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
+#define CAS64(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
+#define CAS32(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
+#define CAS8(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
+#define ATOMIC_OR_64(ptr ,x) __atomic_fetch_or(ptr, x, __ATOMIC_SEQ_CST)
+#define ATOMIC_ADD_32_NV(ptr, x) __atomic_add_fetch(ptr, x, __ATOMIC_SEQ_CST)
+#define ATOMIC_ADD_32_NV_RELAXED(ptr, x) \
+  __atomic_add_fetch(ptr, x, __ATOMIC_RELAXED)
+#define ATOMIC_LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define ATOMIC_LOAD_SEQ_CST(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE_RELEASE(ptr, v) __atomic_store_n(ptr, v, __ATOMIC_RELEASE)
+#define CAS64_WEAK(ptr,expectedp,newval) \
+  __atomic_compare_exchange_n(ptr, expectedp, newval, 1, __ATOMIC_SEQ_CST, \
+                              __ATOMIC_ACQUIRE)
+
 #else
+/* gcc __sync builtins: every one is a full barrier */
+#define ATOMICDEFS_BACKEND "sync"
 #define CASPTR(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
 #define CAS64(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
 #define CAS32(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
+#define CAS8(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
 #define ATOMIC_OR_64(ptr ,x) __sync_fetch_and_or(ptr, x)
+#define ATOMIC_ADD_32_NV(ptr, x) __sync_add_and_fetch(ptr, x)
+#define ATOMIC_ADD_32_NV_RELAXED(ptr, x) __sync_add_and_fetch(ptr, x)
+#define ATOMIC_LOAD_ACQUIRE(ptr) (*(ptr))
+#define ATOMIC_LOAD_SEQ_CST(ptr) (*(ptr))
+#define ATOMIC_STORE_RELEASE(ptr, v) (*(ptr) = (v))
+#define CAS64_WEAK(ptr,expectedp,newval) \
+  __extension__ ({ __typeof__(*(expectedp)) expected_ = *(expectedp); \
+                   (*(expectedp) = __sync_val_compare_and_swap(ptr, \
+                      expected_, newval)) == expected_; })
+#endif
+
+/* double-width (128 bit) CAS on a 16 byte aligned unsigned __int128.
+   Only on x86-64 (cmpxchg16b), and gcc needs -mcx16 to inline it.
+   SPARC does not have one so there is no Solaris version. */
+#if defined(__x86_64__) && !defined(SOLARIS)
+#define CAS128(ptr,oldval,newval) __sync_val_compare_and_swap(ptr, oldval, newval)
 #endif
 
 #endif /* ATOMICDEFS_H */
@@ -0,0 +1,437 @@
+/*****************************************************************************
+ *
+ * File:    bigmem.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Allocator for big (multi-GB) randomly accessed arrays such as the
+ * hash tables. With calloc() such an array is in normal 4K pages, so
+ * random access means a TLB miss almost every time, and the pages are
+ * all put on the NUMA node of the thread that first touches them, which
+ * is usually the one thread that creates or resets the table, so all
+ * the threads end up waiting on that one node's memory controller.
+ *
+ * Here big arrays are allocated with mmap() instead and can use huge
+ * pages (transparent huge pages or hugetlbfs), be interleaved over all
+ * NUMA nodes or split into one part bound to each node, and be
+ * pre-faulted (or zeroed for reset) in parallel by several threads
+ * rather than one. Which of these is done is set once
+ * by the program with bigmem_set_policy() before making its tables;
+ * the default is just the same as calloc().
+ *
+ * The NUMA placement uses the mbind() system call directly so we
+ * do not need libnuma. Interleaving or binding is set as the memory
+ * policy of the mapping before any page is touched, so it does not
+ * matter which threads fault the pages in. The prefault threads are
+ * short-lived and not pinned to any CPU, so with first touch placement
+ * which node they put each page on is up to the scheduler; use
+ * BIGMEM_NUMA_BIND (or BIGMEM_NUMA_INTERLEAVE) to control it.
+ *
+ * All this is Linux only; on other systems everything is just
+ * calloc()/memset()/free().
+ *
+ *****************************************************************************/
+
+#define _GNU_SOURCE  /* for MAP_ANONYMOUS, MAP_HUGETLB, madvise(), syscall() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+#include "bigmem.h"
+
+
+/* length of mapping is rounded up to a multiple of this so that it can
+   be made of huge pages */
+#define BIGMEM_HUGEPAGE_SIZE BIGMEM_MIN_SIZE
+
+/* largest number of NUMA nodes we handle */
+#define BIGMEM_MAX_NODES 1024
+
+#define BIGMEM_NODE_FILE "/sys/devices/system/node/online"
+
+
+/*****************************************************************************
+ *
+ * static data
+ *
+ *****************************************************************************/
+
+static bigmem_huge_t huge_policy = BIGMEM_HUGE_NONE;
+static bigmem_numa_t numa_policy = BIGMEM_NUMA_FIRSTTOUCH;
+static int num_prefault_threads = 1; /* 1 means do not prefault */
+
+
+/*****************************************************************************
+ *
+ * static functions
+ *
+ *****************************************************************************/
+
+#ifdef __linux__
+
+/* part of a mapping for one thread to fault in */
+typedef struct bigmem_touch_s
+{
+    char   *start;  /* first byte of our part */
+    size_t  len;    /* length of our part */
+    bool    zero;   /* TRUE to zero all of it, else just touch each page */
+} bigmem_touch_t;
+
+
+/* size of mapping made for an allocation of size bytes */
+static size_t bigmem_length(size_t size)
+{
+  return (size + BIGMEM_HUGEPAGE_SIZE - 1) &
+         ~(size_t)(BIGMEM_HUGEPAGE_SIZE - 1);
+}
+
+
+/*
+ * bigmem_touch_thread()
+ *
+ * Thread to fault in (and possibly zero) one part of a mapping, so that
+ * the kernel does its page zeroing in parallel
+ *
+ * Parameters:
+ *    threadarg - pointer to bigmem_touch_t for the part to touch
+ *
+ * Return value:
+ *    NULL
+ */
+static void *bigmem_touch_thread(void *threadarg)
+{
+  bigmem_touch_t *part = (bigmem_touch_t *)threadarg;
+  volatile char *p;
+  long pagesize = sysconf(_SC_PAGESIZE);
+
+  if (part->zero)
+  {
+    memset(part->start, 0, part->len);
+  }
+  else
+  {
+    /* a fresh anonymous page reads as zero, so writing zero to it
+       changes nothing but makes the kernel allocate it now */
+    for (p = part->start; p < part->start + part->len; p += pagesize)
+      *p = 0;
+  }
+  return NULL;
+}
+
+
+/*
+ * bigmem_touch()
+ *
+ * Fault in (and possibly zero) a mapping with num_prefault_threads
+ * threads
+ *
+ * Parameters:
+ *    ptr - start of mapping
+ *    len - length of mapping (multiple of BIGMEM_HUGEPAGE_SIZE)
+ *    zero - if TRUE zero all the memory, else only touch it
+ *
+ * Return value:
+ *    None.
+ */
+static void bigmem_touch(void *ptr, size_t len, bool zero)
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  bigmem_touch_t parts[MAX_NUM_THREADS];
+  bool started[MAX_NUM_THREADS];
+  size_t chunk, offset = 0;
+  int t;
+
+  /* split on huge page boundaries so no page is faulted by two threads */
+  chunk = bigmem_length(len / num_prefault_threads);
+  for (t = 0; t < num_prefault_threads; t++)
+  {
+    parts[t].start = (char *)ptr + offset;
+    parts[t].len = (offset >= len ? 0 :
+                    (len - offset < chunk ? len - offset : chunk));
+    parts[t].zero = zero;
+    offset += parts[t].len;
+    started[t] = (pthread_create(&threads[t], NULL, bigmem_touch_thread,
+                                 &parts[t]) == 0);
+    if (!started[t])
+      bigmem_touch_thread(&parts[t]); /* do it ourselves then */
+  }
+  for (t = 0; t < num_prefault_threads; t++)
+    if (started[t])
+      pthread_join(threads[t], NULL);
+}
+
+
+/*
+ * bigmem_online_nodes()
+ *
+ * Get the set of online NUMA nodes
+ *
+ * Parameters:
+ *    nodemask - (OUTPUT) bit n set for each online node n
+ *               (BIGMEM_MAX_NODES bits)
+ *
+ * Return value:
+ *    Number of online nodes (0 if they cannot be found).
+ */
+static int bigmem_online_nodes(unsigned long *nodemask)
+{
+  static const char *funcname = "bigmem_online_nodes";
+  const int bits = 8 * sizeof(unsigned long);
+  FILE *fp;
+  int lo, hi, n, num_nodes = 0;
+  char sep;
+
+  /* online nodes are listed like "0-3,6" */
+  memset(nodemask, 0, BIGMEM_MAX_NODES / 8);
+  if (!(fp = fopen(BIGMEM_NODE_FILE, "r")))
+  {
+    bpa_log_msg(funcname, "cannot open %s\n", BIGMEM_NODE_FILE);
+    return 0;
+  }
+  while (fscanf(fp, "%d", &lo) == 1)
+  {
+    hi = lo;
+    if ((sep = (char)fgetc(fp)) == '-')
+    {
+      if (fscanf(fp, "%d", &hi) != 1)
+        break;
+      sep = (char)fgetc(fp);
+    }
+    for (n = lo; n <= hi && n < BIGMEM_MAX_NODES; n++, num_nodes++)
+      nodemask[n / bits] |= 1UL << (n % bits);
+    if (sep != ',')
+      break;
+  }
+  fclose(fp);
+  return num_nodes;
+}
+
+
+/*
+ * bigmem_interleave()
+ *
+ * Set the memory policy of a mapping to interleave its pages over all
+ * the online NUMA nodes. This only fails (with a message in verbose
+ * mode) if there is something wrong, e.g. a kernel without NUMA.
+ *
+ * Parameters:
+ *    ptr - start of mapping
+ *    len - length of mapping
+ *
+ * Return value:
+ *    None.
+ */
+static void bigmem_interleave(void *ptr, size_t len)
+{
+  static const char *funcname = "bigmem_interleave";
+  unsigned long nodemask[BIGMEM_MAX_NODES / (8 * sizeof(unsigned long))];
+
+  if (bigmem_online_nodes(nodemask) < 2)
+    return; /* not a NUMA machine, nothing to do */
+  if (syscall(SYS_mbind, ptr, len, MPOL_INTERLEAVE, nodemask,
+              (unsigned long)BIGMEM_MAX_NODES, 0UL) != 0)
+    bpa_log_msg(funcname, "mbind() failed\n");
+}
+
+
+/*
+ * bigmem_bind()
+ *
+ * Split a mapping into one part (on huge page boundaries) for each
+ * online NUMA node, in node order, and set the memory policy of each
+ * part to put its pages on its node. The policy is MPOL_PREFERRED
+ * rather than MPOL_BIND, so that if a node runs out of memory its
+ * pages go on another node rather than the process being killed.
+ * Failures are as for bigmem_interleave().
+ *
+ * Parameters:
+ *    ptr - start of mapping
+ *    len - length of mapping (multiple of BIGMEM_HUGEPAGE_SIZE)
+ *
+ * Return value:
+ *    None.
+ */
+static void bigmem_bind(void *ptr, size_t len)
+{
+  static const char *funcname = "bigmem_bind";
+  unsigned long nodemask[BIGMEM_MAX_NODES / (8 * sizeof(unsigned long))];
+  unsigned long onenode[BIGMEM_MAX_NODES / (8 * sizeof(unsigned long))];
+  const int bits = 8 * sizeof(unsigned long);
+  size_t chunk, partlen, offset = 0;
+  int n, num_nodes;
+
+  if ((num_nodes = bigmem_online_nodes(nodemask)) < 2)
+    return; /* not a NUMA machine, nothing to do */
+  chunk = bigmem_length(len / num_nodes);
+  for (n = 0; n < BIGMEM_MAX_NODES && offset < len; n++)
+  {
+    if (!(nodemask[n / bits] & (1UL << (n % bits))))
+      continue;
+    partlen = (len - offset < chunk ? len - offset : chunk);
+    memset(onenode, 0, sizeof(onenode));
+    onenode[n / bits] = 1UL << (n % bits);
+    if (syscall(SYS_mbind, (char *)ptr + offset, partlen, MPOL_PREFERRED,
+                onenode, (unsigned long)BIGMEM_MAX_NODES, 0UL) != 0)
+      bpa_log_msg(funcname, "mbind() failed for node %d\n", n);
+    offset += partlen;
+  }
+}
+
+#endif /* __linux__ */
+
+
+/*****************************************************************************
+ *
+ * external functions
+ *
+ *****************************************************************************/
+
+/*
+ * bigmem_set_policy()
+ *
+ * Set how subsequent big allocations are made. Each option is just a
+ * request: if the system cannot do it, it is silently not done (or with
+ * a message in verbose mode).
+ *
+ * Parameters:
+ *    huge - what kind of huge pages to use, if any
+ *    numa - where to put pages on a NUMA machine
+ *    prefault_threads - if more than 1, this many threads fault in each
+ *                       new allocation at once and zero it on reset;
+ *                       use the number of worker threads
+ *
+ * Return value:
+ *    None.
+ */
+void bigmem_set_policy(bigmem_huge_t huge, bigmem_numa_t numa,
+                       int prefault_threads)
+{
+  huge_policy = huge;
+  numa_policy = numa;
+  num_prefault_threads = (prefault_threads < 1 ? 1 :
+                          (prefault_threads > MAX_NUM_THREADS ?
+                           MAX_NUM_THREADS : prefault_threads));
+}
+
+
+/*
+ * bigmem_alloc()
+ *
+ * Allocate zeroed memory according to the current policy. Small
+ * allocations are just done with calloc().
+ *
+ * Parameters:
+ *    size - number of bytes to allocate
+ *
+ * Return value:
+ *    Pointer to memory (page aligned if at least BIGMEM_MIN_SIZE).
+ *    Exits with error if out of memory.
+ */
+void *bigmem_alloc(size_t size)
+{
+#ifdef __linux__
+  static const char *funcname = "bigmem_alloc";
+  void *p = MAP_FAILED;
+  size_t len;
+
+  if (size < BIGMEM_MIN_SIZE)
+    return bpa_calloc(1, size);
+
+  len = bigmem_length(size);
+#ifdef MAP_HUGETLB
+  if (huge_policy == BIGMEM_HUGE_HUGETLB)
+  {
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED)
+      bpa_log_msg(funcname, "no hugetlbfs pages, using normal pages\n");
+  }
+#endif
+  if (p == MAP_FAILED)
+  {
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      bpa_fatal_error(funcname, "mmap of %lu bytes failed\n",
+                      (unsigned long)len);
+#ifdef MADV_HUGEPAGE
+    if (huge_policy != BIGMEM_HUGE_NONE && madvise(p, len, MADV_HUGEPAGE) != 0)
+      bpa_log_msg(funcname, "madvise(MADV_HUGEPAGE) failed\n");
+#endif
+  }
+  /* placement policy must be set before the pages are touched */
+  if (numa_policy == BIGMEM_NUMA_INTERLEAVE)
+    bigmem_interleave(p, len);
+  else if (numa_policy == BIGMEM_NUMA_BIND)
+    bigmem_bind(p, len);
+  if (num_prefault_threads > 1)
+    bigmem_touch(p, len, FALSE);
+  return p;
+#else
+  return bpa_calloc(1, size);
+#endif
+}
+
+
+/*
+ * bigmem_free()
+ *
+ * Free memory allocated with bigmem_alloc()
+ *
+ * Parameters:
+ *    ptr - memory to free
+ *    size - size it was allocated with
+ *
+ * Return value:
+ *    None.
+ */
+void bigmem_free(void *ptr, size_t size)
+{
+#ifdef __linux__
+  if (size >= BIGMEM_MIN_SIZE)
+  {
+    munmap(ptr, bigmem_length(size));
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+
+/*
+ * bigmem_zero()
+ *
+ * Set memory from bigmem_alloc() back to zero. If prefaulting, this is
+ * done by the prefault threads in parallel (so pages also stay where
+ * they are), otherwise we just give the pages back to the OS, which gives
+ * us new zero pages when they are touched again.
+ *
+ * Parameters:
+ *    ptr - memory to zero
+ *    size - size it was allocated with
+ *
+ * Return value:
+ *    None.
+ */
+void bigmem_zero(void *ptr, size_t size)
+{
+#ifdef __linux__
+  if (size >= BIGMEM_MIN_SIZE)
+  {
+    if (num_prefault_threads > 1)
+      bigmem_touch(ptr, bigmem_length(size), TRUE);
+    else if (madvise(ptr, bigmem_length(size), MADV_DONTNEED) != 0)
+      memset(ptr, 0, size); /* e.g. hugetlbfs on older kernels */
+    return;
+  }
+#endif
+  memset(ptr, 0, size);
+}
@@ -0,0 +1,61 @@
+#ifndef BIGMEM_H
+#define BIGMEM_H
+/*****************************************************************************
+ *
+ * File:    bigmem.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Declarations for allocator for big (multi-GB) randomly accessed
+ * arrays such as hash tables, with huge pages and NUMA placement.
+ *
+ *
+ *****************************************************************************/
+
+#include <stddef.h>
+#include "bpautils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* allocations smaller than this just use calloc() */
+#define BIGMEM_MIN_SIZE  2097152  /* 2 MB, one x86 huge page */
+
+/* how to get huge pages (fewer TLB misses) for big allocations */
+typedef enum bigmem_huge_e
+{
+  BIGMEM_HUGE_NONE,     /* normal pages */
+  BIGMEM_HUGE_THP,      /* transparent huge pages with madvise(MADV_HUGEPAGE) */
+  BIGMEM_HUGE_HUGETLB   /* hugetlbfs pages (MAP_HUGETLB, must be reserved
+                           by the administrator), THP if not available */
+} bigmem_huge_t;
+
+/* where to put the pages of big allocations on NUMA machines */
+typedef enum bigmem_numa_e
+{
+  BIGMEM_NUMA_FIRSTTOUCH, /* OS default: node of thread that touches it first*/
+  BIGMEM_NUMA_INTERLEAVE, /* round robin over all nodes */
+  BIGMEM_NUMA_BIND        /* one contiguous part (1/number of nodes of it)
+                             on each node in turn */
+} bigmem_numa_t;
+
+
+/* set how subsequent big allocations are made */
+void bigmem_set_policy(bigmem_huge_t huge, bigmem_numa_t numa,
+                       int prefault_threads);
+
+/* allocate zeroed memory, exiting on failure */
+void *bigmem_alloc(size_t size);
+
+/* free memory from bigmem_alloc() */
+void bigmem_free(void *ptr, size_t size);
+
+/* set memory from bigmem_alloc() back to zero */
+void bigmem_zero(void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BIGMEM_H */
@@ -16,6 +16,16 @@
 #include <stdlib.h>
 #include <sys/time.h>
 
+#ifdef __cplusplus
+/* C++ library headers (e.g. TBB) declare these already */
+#include <stdint.h>
+#else
+typedef unsigned long long uint64_t;
+typedef unsigned int       uint32_t;
+typedef unsigned short     uint16_t;
+typedef unsigned char      uint8_t;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
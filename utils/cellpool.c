@@ -1,127 +1,270 @@
 /*****************************************************************************
- * 
+ *
  * File:    cellpool.c
  * Author:  Alex Stivala
  * Created: April 2009
  *
- * Simple cell pool allocator. By allocating a big chunk of memory at
- * initialization time, we can just get one cell at a time from it
- * in a lock-free manner without having to call malloc() again,
- * so that multiple threads can allocate cells from the pool without
- * locking.
+ * Simple cell pool allocator. Cells are all the same size, and are taken
+ * from big chunks of memory, so multiple threads can allocate cells
+ * from the pool without locking and without calling malloc() for each.
+ *
+ * Each thread has its own magazine in the pool: the rest of the chunk it
+ * is taking cells from, and a list of the cells it has given back. So
+ * allocating a cell is just popping the list or bumping a pointer, with
+ * no atomic instruction and no cache line shared with another thread.
+ * Only when its chunk runs out does a thread malloc() a new chunk of
+ * chunk_cells cells, which it pushes on the pool's list of chunks with
+ * CAS, so the pool grows as much as it needs to. A cell given back is
+ * only reused by the thread that gave it back. All the cells of a pool
+ * are freed at once, by freeing its chunks, with cellpool_reset() or
+ * cellpool_destroy().
+ *
+ * (This used to be a single fixed size malloc() with one shared next
+ * cell pointer bumped with CAS, so every allocation by every thread
+ * contended on one cache line, and there was only one pool. On Solaris
+ * it could use umem_cache_*() instead, but that was slower.)
  *
  * On Linux,
  * gcc version 4.1.0 or greater is required, in order to use the
  * __sync_val_compare_and_swap() builtin
  * (this module was developed on Linux 2.6.22 (x86) with gcc 4.1.3).
- * On Solaris, we use the umem_cache_*() functions instead, rather
- * than implement a cell pool allocator ourselves.
- * (Actually, we don't since it turns out to be slower+less scalable than
- * the trivial cellpool implemented here). Define USE_SOLARIS_UMEM to use
- * the umem functions on Solaris.
- *
- * TODO don't even have  facility to free/reuse cells, don't need it
- * since we just terminate the process.
- * TODO only one cell pool allowed (file static data). Should change
- * to have handles so user can allocate different pools.
- * 
+ *
+ * Preprocessor symbols:
+ *
+ * USE_THREADING  - pools are shared by threads (else no CAS is needed)
  *
  * $Id: cellpool.c 2324 2009-05-06 02:44:04Z astivala $
  *
  *****************************************************************************/
 
-#undef USE_SOLARIS_UMEM /* slower than trivial celpool,. don't use */
-
 #include <stdlib.h>
+#include <assert.h>
+
+#include "bpautils.h"
 #include "cellpool.h"
-#ifdef USE_SOLARIS_UMEM
-#include <umem.h>
-#else
 #include "atomicdefs.h"
-#endif
 
-#ifdef USE_SOLARIS_UMEM
-static umem_cache_t *cache; /* The Solaris umem cache */
+/* each magazine is in its own cache lines (two, for the adjacent line
+   prefetcher), as for shardcount.h */
+#define CELLPOOL_ALIGN 128
+
+/* cells in a chunk start this far in, after the chunk list link, so
+   they are cache line aligned as malloc() aligns to 16 at least */
+#define CELLPOOL_CHUNK_HEADER 64
+
+
+/*****************************************************************************
+ *
+ * types
+ *
+ *****************************************************************************/
+
+/* start of a chunk of cells */
+typedef struct cellpool_chunk_s
+{
+    struct cellpool_chunk_s *next; /* chunk allocated before this one */
+} cellpool_chunk_t;
+
+/* one thread's cells. Only ever touched by its own thread */
+typedef struct cellpool_magazine_s
+{
+    char *next;           /* next unused cell in our chunk */
+    char *end;            /* end of our chunk */
+    void *freelist;       /* cells given back, linked through first word */
+} __attribute__((aligned(CELLPOOL_ALIGN))) cellpool_magazine_t;
+
+struct cellpool_s
+{
+    cellpool_magazine_t mag[MAX_NUM_THREADS]; /* indexed by thread id */
+    size_t cell_size;     /* size of each cell (multiple of a pointer) */
+    size_t chunk_cells;   /* number of cells in each chunk */
+    void *mem;            /* as allocated, for free() */
+    cellpool_chunk_t *volatile chunks; /* all chunks, newest first,
+                                          pushed with CAS */
+};
+
+
+/*****************************************************************************
+ *
+ * static functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * cellpool_refill()
+ *
+ * Give a thread's magazine a new chunk of cells, and record the chunk
+ * in the pool so it is freed with the pool
+ *
+ * Parameters:
+ *    pool - pool to get chunk for
+ *    mag  - magazine of the thread to give it to
+ *
+ * Return value:
+ *    TRUE if OK, FALSE if out of memory
+ */
+static bool cellpool_refill(cellpool_t *pool, cellpool_magazine_t *mag)
+{
+  cellpool_chunk_t *chunk;
+
+  if (!(chunk = (cellpool_chunk_t *)malloc(CELLPOOL_CHUNK_HEADER +
+                                           pool->chunk_cells *
+                                           pool->cell_size)))
+    return FALSE;
+#ifdef USE_THREADING
+  do
+    chunk->next = pool->chunks;
+  while (CASPTR(&pool->chunks, chunk->next, chunk) != chunk->next);
 #else
-static void  *cellpool; /* The cell pool. */
-static size_t cellsize; /* size of a cell */
-static size_t poolsize; /* total size of cell pool */
-static void  *nextcell; /* pointer to next cell in the pool
-                          serialized with CAS logic in cellpool_alloc() */
+  chunk->next = pool->chunks;
+  pool->chunks = chunk;
 #endif
+  mag->next = (char *)chunk + CELLPOOL_CHUNK_HEADER;
+  mag->end = mag->next + pool->chunk_cells * pool->cell_size;
+  return TRUE;
+}
+
+
+/*****************************************************************************
+ *
+ * external functions
+ *
+ *****************************************************************************/
 
 
 /*
- * cellpool_alloc()
+ * cellpool_create()
  *
- *   allocate a new cell of previously intialized size from pool
+ *   Create an empty cell pool. No cells are allocated until a thread
+ *   needs them.
  *
  *   Parameters:
- *      None.
+ *     cell_size - Size of each cell
+ *     chunk_cells - Number of cells a thread takes from the pool at
+ *                   a time (e.g. CELLPOOL_CHUNK_CELLS)
  *
  *   Return value:
- *      Pointer to new cell, or NULL if none available.
+ *     Pointer to new pool. Exits with error if out of memory.
+ */
+cellpool_t *cellpool_create(size_t cell_size, size_t chunk_cells)
+{
+  cellpool_t *pool;
+  void *mem;
+
+  assert(chunk_cells > 0);
+  /* calloc() does not align to CELLPOOL_ALIGN, so align it ourselves */
+  mem = bpa_calloc(1, sizeof(cellpool_t) + CELLPOOL_ALIGN);
+  pool = (cellpool_t *)(((unsigned long)mem + CELLPOOL_ALIGN - 1) &
+                        ~(unsigned long)(CELLPOOL_ALIGN - 1));
+  pool->mem = mem;
+  /* the free list is linked through the first word of each cell */
+  pool->cell_size = (cell_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+  if (pool->cell_size == 0)
+    pool->cell_size = sizeof(void *);
+  pool->chunk_cells = chunk_cells;
+  return pool;
+}
+
+
+/*
+ * cellpool_alloc()
+ *
+ *   allocate a new cell from pool: one the thread gave back if any,
+ *   else the next one from its chunk, else from a new chunk
  *
- *   Uses static data:
- *      nextcell -pointer to next cell in cellpool (read/write, CAS serialized)
+ *   Parameters:
+ *      pool - pool to allocate from
+ *      thread_id - our thread identifer (0,1,2,.. NOT pthread_t)
+ *
+ *   Return value:
+ *      Pointer to new cell, or NULL if out of memory.
  */
-void *cellpool_alloc(void)
+void *cellpool_alloc(cellpool_t *pool, int thread_id)
 {
-#ifdef USE_SOLARIS_UMEM
-  return umem_cache_alloc(cache, UMEM_DEFAULT);
-#else
-  void *cell, *newnextcell;
-#ifdef USE_THREADING
-  do
+  cellpool_magazine_t *mag = &pool->mag[thread_id];
+  void *cell;
+
+  if ((cell = mag->freelist))
   {
-    if ((char *)nextcell >= (char *)cellpool + poolsize)
-      return NULL;
-    cell = nextcell;
-    newnextcell = (char *)cell + cellsize;
+    mag->freelist = *(void **)cell;
+    return cell;
   }
-  while (CASPTR(&nextcell,cell,newnextcell) != cell);
-#else
-  if ((char *)nextcell >= (char *)cellpool + poolsize)
+  if (mag->next == mag->end && !cellpool_refill(pool, mag))
     return NULL;
-  cell = nextcell;
-  newnextcell = (char *)cell + cellsize;
-  nextcell = newnextcell;
-#endif
+  cell = mag->next;
+  mag->next += pool->cell_size;
   return cell;
-#endif 
 }
 
+
 /*
- * cellpool_initialize()
+ * cellpool_free()
  *
- *   initialize the cell pool
+ *   Give a cell back to the pool. It can be allocated again, but only by
+ *   the same thread. It need not be a cell that thread allocated.
  *
  *   Parameters:
- *     cell_size - Size of each cell
- *     num_cells - Number of cells to allocate
+ *      pool - pool the cell was allocated from
+ *      cell - cell to give back
+ *      thread_id - our thread identifer (0,1,2,.. NOT pthread_t)
  *
  *   Return value:
- *     Pointer to start of cell pool memory (first cell) or NULL
- *     on failure
- *
- *    Uses static data:
- *       cellpool - the cell pool (write)          
- *       cellsize - size of each cell (write)
- *       poolsize - total size of cell pool (write)
- *       nextcell - pointer to next cell in cellpool (write)
+ *      None.
  */
-void *cellpool_initialize(size_t cell_size, int num_cells)
+void cellpool_free(cellpool_t *pool, void *cell, int thread_id)
 {
-#ifdef USE_SOLARIS_UMEM
-  cache = umem_cache_create("cellpool", cell_size, 0, 
-                            NULL, NULL, NULL, NULL, NULL, 0);
-  return cache;
-#else
-  cellsize = cell_size;
-  poolsize = num_cells * cell_size;
-  if (!(cellpool = malloc(poolsize)))
-    return NULL;
-  nextcell = cellpool;
-  return cellpool;
-#endif
+  cellpool_magazine_t *mag = &pool->mag[thread_id];
+
+  *(void **)cell = mag->freelist;
+  mag->freelist = cell;
+}
+
+
+/*
+ * cellpool_reset()
+ *
+ *   Free all the cells allocated from the pool at once, leaving it
+ *   empty. Must not be called while other threads are using the pool.
+ *
+ *   Parameters:
+ *      pool - pool to empty
+ *
+ *   Return value:
+ *      None.
+ */
+void cellpool_reset(cellpool_t *pool)
+{
+  cellpool_chunk_t *chunk, *next;
+  int t;
+
+  for (chunk = pool->chunks; chunk; chunk = next)
+  {
+    next = chunk->next;
+    free(chunk);
+  }
+  pool->chunks = NULL;
+  for (t = 0; t < MAX_NUM_THREADS; t++)
+  {
+    pool->mag[t].next = pool->mag[t].end = NULL;
+    pool->mag[t].freelist = NULL;
+  }
+}
+
+
+/*
+ * cellpool_destroy()
+ *
+ *   Free all the cells allocated from the pool, and the pool
+ *
+ *   Parameters:
+ *      pool - pool to free
+ *
+ *   Return value:
+ *      None.
+ */
+void cellpool_destroy(cellpool_t *pool)
+{
+  cellpool_reset(pool);
+  free(pool->mem);
 }
@@ -1,22 +1,38 @@
 #ifndef CELLPOOL_H
 #define CELLPOOL_H
 /*****************************************************************************
- * 
+ *
  * File:    cellpool.h
  * Author:  Alex Stivala
  * Created: April 2009
  *
  * Declarations for simple cell pool allocator.
- * 
+ *
  *
  * $Id: cellpool.h 2264 2009-04-22 02:49:57Z astivala $
  *
  *****************************************************************************/
 
-/* allocate a new cell of previously intialized size from pool */
-void *cellpool_alloc(void);
+#include <stddef.h>
+
+/* cells each thread takes from the pool at a time, by default */
+#define CELLPOOL_CHUNK_CELLS 16384
+
+typedef struct cellpool_s cellpool_t;
+
+/* create an empty cell pool that grows by chunks of chunk_cells cells */
+cellpool_t *cellpool_create(size_t cell_size, size_t chunk_cells);
+
+/* allocate a new cell from pool for thread_id */
+void *cellpool_alloc(cellpool_t *pool, int thread_id);
+
+/* give a cell back to pool, for thread_id to allocate again */
+void cellpool_free(cellpool_t *pool, void *cell, int thread_id);
+
+/* free all the cells allocated from pool at once */
+void cellpool_reset(cellpool_t *pool);
 
-/* initizlie the cell pool */
-void *cellpool_initialize(size_t cell_size, int num_cells);
+/* free all the cells and pool itself */
+void cellpool_destroy(cellpool_t *pool);
 
 #endif /* CELLPOOL_H */
@@ -0,0 +1,382 @@
+/*****************************************************************************
+ *
+ * File:    hashbench.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Benchmark of the hash function families of hashfn.h on streams of d.p.
+ * keys, to choose the family for a workload (OAHTTSLF_HASH etc.): the
+ * fastest one that still spreads its keys well.
+ *
+ * For each family it reports the time to hash each key, and the probe
+ * lengths that result from putting all the keys into an oahttslf-style
+ * table: buckets of 4 slots with linear probing over buckets, the
+ * smallest power of 2 buckets that is at most the given load. The probe
+ * length of a key is the number of buckets past its home bucket it is
+ * put in; a key more than OAHTTSLF_MAX_PROBES (32) buckets from home
+ * would make oahttslf grow. The keys are assumed to be distinct.
+ *
+ * The key streams are:
+ *
+ *   knapsack n W   - (i,w) for 1 <= i <= n, 0 <= w <= W, as the key
+ *                    i << 32 | w of knapsack_oahttslf
+ *   bpalign m n    - (i,j,k,l) for 1 <= i <= j <= m, 1 <= k <= l <= n,
+ *                    packed as i << 47 | j << 31 | k << 15 | l as in
+ *                    bpalign/integer
+ *   seq n          - 1..n
+ *   file filename  - keys (decimal, or hex with 0x) one per line, e.g.
+ *                    dumped from a real run
+ *
+ * Usage:
+ *    hashbench [-l load] [-f family] stream args...
+ *
+ *    -l load   : table load factor, 0 < load <= 1 (default 0.5, the
+ *                most oahttslf_create() starts with)
+ *    -f family : only this family (identity, wang, fmix, crc32, mulshift)
+ *
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "bpautils.h"
+#include "hashfn.h"
+
+/* as in oahttslf.c */
+#define BUCKET_SLOTS 4
+#define MAX_PROBES   32
+
+/* hash all the keys this many times over at least, to time it */
+#define MIN_HASHES   100000000
+
+
+/*****************************************************************************
+ *
+ * static functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * add_key()
+ *
+ * Append a key to a growing array of keys
+ *
+ * Parameters:
+ *    keys - (IN/OUT) array of keys, reallocated as needed
+ *    num_keys - (IN/OUT) number of keys in it
+ *    max_keys - (IN/OUT) number of keys allocated
+ *    key - key to add
+ *
+ * Return value:
+ *    None. Exits with error if out of memory.
+ */
+static void add_key(uint64_t **keys, size_t *num_keys, size_t *max_keys,
+                    uint64_t key)
+{
+  if (*num_keys == *max_keys)
+  {
+    *max_keys = (*max_keys ? *max_keys * 2 : 1024);
+    *keys = (uint64_t *)bpa_realloc(*keys, *max_keys * sizeof(uint64_t));
+  }
+  (*keys)[(*num_keys)++] = key;
+}
+
+
+/*
+ * make_keys()
+ *
+ * Make the stream of keys named on the command line
+ *
+ * Parameters:
+ *    argc - number of stream arguments
+ *    argv - stream name and its arguments
+ *    num_keys - (OUT) number of keys
+ *
+ * Return value:
+ *    array of keys (NULL if the stream arguments are bad)
+ */
+static uint64_t *make_keys(int argc, char *argv[], size_t *num_keys)
+{
+  uint64_t *keys = NULL;
+  size_t max_keys = 0;
+  uint64_t i, j, k, l, m, n;
+  FILE *fp;
+  char line[256];
+
+  *num_keys = 0;
+  if (argc == 3 && strcmp(argv[0], "knapsack") == 0)
+  {
+    n = strtoull(argv[1], NULL, 10);
+    m = strtoull(argv[2], NULL, 10);
+    for (i = 1; i <= n; i++)
+      for (j = 0; j <= m; j++)
+        add_key(&keys, num_keys, &max_keys, i << 32 | j);
+  }
+  else if (argc == 3 && strcmp(argv[0], "bpalign") == 0)
+  {
+    m = strtoull(argv[1], NULL, 10);
+    n = strtoull(argv[2], NULL, 10);
+    for (i = 1; i <= m; i++)
+      for (j = i; j <= m; j++)
+        for (k = 1; k <= n; k++)
+          for (l = k; l <= n; l++)
+            add_key(&keys, num_keys, &max_keys,
+                    i << 47 | j << 31 | k << 15 | l);
+  }
+  else if (argc == 2 && strcmp(argv[0], "seq") == 0)
+  {
+    n = strtoull(argv[1], NULL, 10);
+    for (i = 1; i <= n; i++)
+      add_key(&keys, num_keys, &max_keys, i);
+  }
+  else if (argc == 2 && strcmp(argv[0], "file") == 0)
+  {
+    if (!(fp = fopen(argv[1], "r")))
+    {
+      perror(argv[1]);
+      exit(EXIT_FAILURE);
+    }
+    while (fgets(line, sizeof(line), fp))
+      add_key(&keys, num_keys, &max_keys, strtoull(line, NULL, 0));
+    fclose(fp);
+  }
+  else
+    return NULL;
+  return keys;
+}
+
+
+/*
+ * time_hash()
+ *
+ * Time hashing the keys with one hash family, one after the other
+ *
+ * Parameters:
+ *    f - hash family
+ *    keys - keys to hash
+ *    num_keys - number of keys
+ *
+ * Return value:
+ *    mean nanoseconds to hash a key
+ */
+static double time_hash(hashfn_family_t f, const uint64_t *keys,
+                        size_t num_keys)
+{
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  volatile uint32_t sink;
+  uint32_t sum = 0;
+  size_t i, reps, r;
+
+/* a loop for each family, so each is compiled with its hash inline.
+   Each key is xored with the hash before, so the hashes are not done in
+   parallel (or vectorized): this is the latency of the hash, which is
+   what a lookup waits for before it can load the bucket */
+#define HASH_LOOP(fn) \
+  for (r = 0; r < reps; r++) \
+    for (i = 0; i < num_keys; i++) \
+      sum = fn(keys[i] ^ sum)
+
+  reps = MIN_HASHES / num_keys + 1;
+  gettimeofday(&start_timeval, NULL);
+  switch (f)
+  {
+    case HASHFN_WANG:
+      HASH_LOOP(hashfn_wang);
+      break;
+    case HASHFN_FMIX:
+      HASH_LOOP(hashfn_fmix);
+      break;
+    case HASHFN_CRC32:
+      HASH_LOOP(hashfn_crc32);
+      break;
+    case HASHFN_MULSHIFT:
+      HASH_LOOP(hashfn_mulshift);
+      break;
+    default:
+      HASH_LOOP((uint32_t));
+      break;
+  }
+  gettimeofday(&end_timeval, NULL);
+  sink = sum; /* so the hashing is not optimized away */
+  (void)sink;
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  return (1e9 * elapsed_timeval.tv_sec + 1e3 * elapsed_timeval.tv_usec) /
+    ((double)reps * num_keys);
+}
+
+
+/*
+ * find_free()
+ *
+ * Find the first bucket from h on that is not full. Each full bucket has
+ * a pointer to a later bucket, which is shortcut to the free bucket
+ * found, so even a terrible hash with thousands of keys per home bucket
+ * takes about linear time.
+ *
+ * Parameters:
+ *    used - number of keys in each bucket
+ *    next - (IN/OUT) for a full bucket, a later bucket to look at
+ *    h - bucket to start at
+ *
+ * Return value:
+ *    first bucket from h (wrapping round) that is not full
+ */
+static size_t find_free(const unsigned char *used, size_t *next, size_t h)
+{
+  size_t r = h, t;
+
+  while (used[r] == BUCKET_SLOTS)
+    r = next[r];
+  while (h != r && used[h] == BUCKET_SLOTS)
+  {
+    t = next[h];
+    next[h] = r;
+    h = t;
+  }
+  return r;
+}
+
+
+/*
+ * probe_stats()
+ *
+ * Put the keys into a simulated oahttslf array and report the probe
+ * lengths
+ *
+ * Parameters:
+ *    f - hash family
+ *    keys - keys to put in
+ *    num_keys - number of keys
+ *    num_buckets - number of buckets in the array (power of 2)
+ *    mean - (OUT) mean probe length (buckets past home)
+ *    max - (OUT) longest probe length
+ *    num_over - (OUT) number of keys more than MAX_PROBES from home
+ *    num_empty - (OUT) number of buckets no key has as home
+ *
+ * Return value:
+ *    None.
+ */
+static void probe_stats(hashfn_family_t f, const uint64_t *keys,
+                        size_t num_keys, size_t num_buckets, double *mean,
+                        unsigned int *max, size_t *num_over,
+                        size_t *num_empty)
+{
+  unsigned char *used, *home;
+  size_t *next;
+  size_t i, h, r, dist;
+  double total = 0;
+
+  used = (unsigned char *)bpa_calloc(num_buckets, 1);
+  home = (unsigned char *)bpa_calloc(num_buckets, 1);
+  next = (size_t *)bpa_malloc(num_buckets * sizeof(size_t));
+  for (h = 0; h < num_buckets; h++)
+    next[h] = (h + 1) & (num_buckets - 1);
+  *max = 0;
+  *num_over = 0;
+  for (i = 0; i < num_keys; i++)
+  {
+    h = hashfn(f, keys[i]) & (num_buckets - 1);
+    home[h] = 1;
+    r = find_free(used, next, h);
+    dist = (r - h) & (num_buckets - 1);
+    used[r]++;
+    total += dist;
+    if (dist > *max)
+      *max = (unsigned int)dist;
+    if (dist > MAX_PROBES)
+      (*num_over)++;
+  }
+  *num_empty = 0;
+  for (h = 0; h < num_buckets; h++)
+    if (!home[h])
+      (*num_empty)++;
+  *mean = total / num_keys;
+  free(used);
+  free(home);
+  free(next);
+}
+
+
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s [-l load] [-f family] stream args...\n"
+          "  -l load   : table load factor (default 0.5)\n"
+          "  -f family : only hash family (identity, wang, fmix, crc32, "
+          "mulshift)\n"
+          "  streams: knapsack n W | bpalign m n | seq n | file filename\n",
+          program);
+  exit(EXIT_FAILURE);
+}
+
+
+/*****************************************************************************
+ *
+ * main
+ *
+ *****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  double load = 0.5, mean;
+  int c, f, only = -1;
+  uint64_t *keys;
+  size_t num_keys, num_buckets, num_over, num_empty;
+  unsigned int max;
+
+  while ((c = getopt(argc, argv, "l:f:")) != -1)
+  {
+    switch (c)
+    {
+      case 'l':
+        load = atof(optarg);
+        if (load <= 0 || load > 1)
+        {
+          fprintf(stderr, "load must be > 0 and <= 1\n");
+          usage(argv[0]);
+        }
+        break;
+
+      case 'f':
+        if ((only = hashfn_lookup_name(optarg)) < 0)
+        {
+          fprintf(stderr, "unknown hash family %s\n", optarg);
+          usage(argv[0]);
+        }
+        break;
+
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (!(keys = make_keys(argc - optind, &argv[optind], &num_keys)) ||
+      num_keys == 0)
+    usage(argv[0]);
+
+  num_buckets = 1;
+  while ((double)num_buckets * BUCKET_SLOTS * load < num_keys)
+    num_buckets *= 2;
+  printf("%lu keys, %lu buckets of %d slots (%.1f%% full)\n",
+         (unsigned long)num_keys, (unsigned long)num_buckets, BUCKET_SLOTS,
+         100.0 * num_keys / ((double)num_buckets * BUCKET_SLOTS));
+  printf("%-10s %8s %10s %6s %10s %10s\n", "family", "ns/key", "mean probe",
+         "max", "> 32", "no home");
+  for (f = 0; f < HASHFN_NUM_FAMILIES; f++)
+  {
+    if (only >= 0 && f != only)
+      continue;
+    probe_stats((hashfn_family_t)f, keys, num_keys, num_buckets,
+                &mean, &max, &num_over, &num_empty);
+    printf("%-10s %8.2f %10.3f %6u %10lu %10lu\n",
+           hashfn_name((hashfn_family_t)f),
+           time_hash((hashfn_family_t)f, keys, num_keys), mean, max,
+           (unsigned long)num_over, (unsigned long)num_empty);
+  }
+  free(keys);
+  exit(0);
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************
+ *
+ * File:    hashfn.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Names of the hash function families, for choosing one at run time.
+ * The functions themselves are inline in hashfn.h. Also a hash of a
+ * whole buffer, which is not used for hash table keys.
+ *
+ *
+ *****************************************************************************/
+
+#include <string.h>
+
+#include "hashfn.h"
+
+/* indexed by hashfn_family_t */
+static const char *hashfn_names[HASHFN_NUM_FAMILIES] =
+{
+  "identity", "wang", "fmix", "crc32", "mulshift"
+};
+
+
+/*
+ * hashfn_name()
+ *
+ * Name of a hash function family
+ *
+ * Parameters:
+ *    f - hash function family
+ *
+ * Return value:
+ *    its name, or "unknown" if f is not a family
+ */
+const char *hashfn_name(hashfn_family_t f)
+{
+  if ((int)f < 0 || f >= HASHFN_NUM_FAMILIES)
+    return "unknown";
+  return hashfn_names[f];
+}
+
+
+/*
+ * hashfn_bytes()
+ *
+ * 64 bit FNV-1a hash of a buffer. Since it continues from h, several
+ * buffers (e.g. the items and the capacity of a knapsack problem) can be
+ * hashed in turn. Not fast, but not meant for every d.p. key either.
+ *
+ * Parameters:
+ *    h    - hash so far, HASHFN_BYTES_INIT to start
+ *    data - bytes to hash
+ *    len  - number of bytes
+ *
+ * Return value:
+ *    hash of the bytes hashed to h followed by data
+ */
+uint64_t hashfn_bytes(uint64_t h, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    h = (h ^ p[i]) * 0x100000001b3ULL; /* the FNV prime */
+  return h;
+}
+
+
+/*
+ * hashfn_lookup_name()
+ *
+ * Find a hash function family by its name
+ *
+ * Parameters:
+ *    name - name of the family, as given by hashfn_name()
+ *
+ * Return value:
+ *    the family (hashfn_family_t), or -1 if there is none called name
+ */
+int hashfn_lookup_name(const char *name)
+{
+  int f;
+
+  for (f = 0; f < HASHFN_NUM_FAMILIES; f++)
+    if (strcmp(name, hashfn_names[f]) == 0)
+      return f;
+  return -1;
+}
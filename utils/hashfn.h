@@ -0,0 +1,153 @@
+#ifndef HASHFN_H
+#define HASHFN_H
+/*****************************************************************************
+ *
+ * File:    hashfn.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Hash functions from 64 bit keys to 32 bit hash values, shared by the
+ * hash tables (which used to each have their own copy of Thomas Wang's
+ * hash6432shift()).
+ *
+ * The tables take the home slot from the low bits of the hash, so every
+ * family here is arranged to have its well-mixed bits at the bottom.
+ *
+ *   HASHFN_IDENTITY - the low 32 bits of the key. Free, and perfect for
+ *                     keys that are already dense small integers, but
+ *                     d.p. keys packed from several indices cluster badly
+ *   HASHFN_WANG     - Thomas Wang's 64 to 32 bit shift hash
+ *   HASHFN_FMIX     - the finalizer of MurmurHash3 (fmix64), as also used
+ *                     (with other constants) by xxhash: fewer operations
+ *                     than Wang and a full avalanche
+ *   HASHFN_CRC32    - the SSE4.2 crc32 instruction (CRC-32C), one
+ *                     instruction of 3 cycles latency. Without SSE4.2
+ *                     (e.g. gcc -msse4.2 or -mavx2) it is computed
+ *                     bit by bit, so the hashes (and snapshot files) are
+ *                     the same, but it is then by far the slowest
+ *   HASHFN_MULSHIFT - multiply-shift: the high half of the key times an
+ *                     odd constant (2^64 / golden ratio). The best bits
+ *                     of a product are the highest, so its bytes are
+ *                     reversed to bring them to the bottom. A multiply
+ *                     and a byte swap, but the higher the key bit, the
+ *                     fewer hash bits it affects
+ *
+ * The family numbers are stable, since they are recorded in oahttslf
+ * snapshot files (IDENTITY and WANG are what USE_GOOD_HASH used to give).
+ *
+ * A table picks its family when it is compiled, and calls hashfn() with
+ * that constant, so the switch is compiled away. A program can also
+ * choose at run time (e.g. hashbench compares them all on d.p. key
+ * streams), by name with hashfn_lookup_name().
+ *
+ *****************************************************************************/
+
+#include "bpautils.h"   /* for uint64_t etc. */
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum hashfn_family_e
+{
+  HASHFN_IDENTITY = 0,
+  HASHFN_WANG     = 1,
+  HASHFN_FMIX     = 2,
+  HASHFN_CRC32    = 3,
+  HASHFN_MULSHIFT = 4,
+  HASHFN_NUM_FAMILIES
+} hashfn_family_t;
+
+
+/*
+  hash a 64 bit value into 32 bits. From:
+  (Thomas Wang, Jan 1997, Last update Mar 2007, Version 3.1)
+  http://www.concentric.net/~Ttwang/tech/inthash.htm
+  (found by reference in NIST Dictionary of Algorithms and Data Structures)
+*/
+static inline uint32_t hashfn_wang(uint64_t key)
+{
+  key = (~key) + (key << 18); /* key = (key << 18) - key - 1; */
+  key = key ^ (key >> 31);
+  key = key * 21; /* key = (key + (key << 2)) + (key << 4); */
+  key = key ^ (key >> 11);
+  key = key + (key << 6);
+  key = key ^ (key >> 22);
+  return (uint32_t)key;
+}
+
+/* finalizer of MurmurHash3 (Austin Appleby), a bijection on 64 bits */
+static inline uint32_t hashfn_fmix(uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return (uint32_t)key;
+}
+
+/* CRC-32C of the 8 bytes of the key, as the SSE4.2 crc32 instruction */
+static inline uint32_t hashfn_crc32(uint64_t key)
+{
+#if defined(__SSE4_2__)
+  return (uint32_t)_mm_crc32_u64(0xffffffffULL, key);
+#else
+  uint32_t crc = 0xffffffffU;
+  int i;
+
+  /* reflected polynomial 0x82f63b78, a bit at a time, low bit first */
+  for (i = 0; i < 64; i++, key >>= 1)
+    crc = (crc >> 1) ^ (((crc ^ (uint32_t)key) & 1) ? 0x82f63b78U : 0);
+  return crc;
+#endif
+}
+
+/* multiply-shift (Dietzfelbinger et al.) with the golden ratio: the top
+   32 bits of the product, highest byte first */
+static inline uint32_t hashfn_mulshift(uint64_t key)
+{
+  return (uint32_t)__builtin_bswap64(key * 0x9e3779b97f4a7c15ULL);
+}
+
+
+/* hash of key by family f (a constant for the switch to be compiled away) */
+static inline uint32_t hashfn(hashfn_family_t f, uint64_t key)
+{
+  switch (f)
+  {
+    case HASHFN_WANG:
+      return hashfn_wang(key);
+    case HASHFN_FMIX:
+      return hashfn_fmix(key);
+    case HASHFN_CRC32:
+      return hashfn_crc32(key);
+    case HASHFN_MULSHIFT:
+      return hashfn_mulshift(key);
+    default:
+      return (uint32_t)key;
+  }
+}
+
+
+/* start value for hashfn_bytes() (the FNV offset basis) */
+#define HASHFN_BYTES_INIT 0xcbf29ce484222325ULL
+
+/* 64 bit FNV-1a hash of len bytes of data continuing from h, e.g. to
+   identify the input of a problem */
+uint64_t hashfn_bytes(uint64_t h, const void *data, size_t len);
+
+/* name of hash family f, e.g. "wang" */
+const char *hashfn_name(hashfn_family_t f);
+
+/* hash family with name (as hashfn_name()), or -1 if none */
+int hashfn_lookup_name(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HASHFN_H */
@@ -20,9 +20,9 @@
 #include "cellpool.h"
 #include "atomicdefs.h"
 
-/* do not use cell-pool allocator on Linux (malloc() is faster) ,
-  but cell-pool allocator is faster on Solaris (SPARC) */
-#ifdef SOLARIS
+/* use the cell-pool allocator unless USE_MALLOC_ENTRIES is defined,
+   as in httslf.c */
+#ifndef USE_MALLOC_ENTRIES
 #define USE_CP_ALLOC 
 #endif
 
@@ -37,6 +37,10 @@
 /* TODO: change to allocate dynamically so can have multiple */
 static ht_entry_t *hashtable[HT_SIZE];
 
+#ifdef USE_CP_ALLOC
+static cellpool_t *entry_pool;    /* all the entries are allocated here */
+#endif
+
 /* user data sizes and callback functions set by ht_initialize() */
 static size_t key_size;             /* size of key data */
 static size_t value_size;           /* size of value data */
@@ -82,7 +86,9 @@ void ht_insert(void *key, void *value)
   if (!ent)
   {
 #ifdef USE_CP_ALLOC
-    ent = (ht_entry_t *)cellpool_alloc();
+    /* single threaded, so always the magazine of thread 0 */
+    if (!(ent = (ht_entry_t *)cellpool_alloc(entry_pool, 0)))
+      bpa_fatal_error("ht_insert", "cellpool_alloc() failed\n");
 #else
     ent = (ht_entry_t *)bpa_malloc(sizeof(ht_entry_t) + key_size + value_size);
 #endif
@@ -159,9 +165,6 @@ void ht_initialize(size_t keysize, size_t valuesize, hash_function_t hashfunc,
                    copy_function_t keycopy, keymatch_function_t keymatch,
                    copy_function_t valuecopy)
 {
-  static const char *funcname = "ht_initialize";
-  size_t cell_size;
-
   key_size = keysize;
   value_size = valuesize;
   hash_function = hashfunc;
@@ -169,10 +172,10 @@ void ht_initialize(size_t keysize, size_t valuesize, hash_function_t hashfunc,
   keymatch_function = keymatch;
   valuecopy_function = valuecopy;
 #ifdef USE_CP_ALLOC
-  cell_size = sizeof(ht_entry_t) + key_size + value_size;
-  /* FIXME need to pass number of cells as a parameter in this function */
-  if (!(cellpool_initialize(cell_size, (size_t)1*1024*1024*1024 / cell_size)))
-    bpa_fatal_error(funcname, "cellpool_initialize() failed\n");
+  if (entry_pool)
+    cellpool_destroy(entry_pool);
+  entry_pool = cellpool_create(sizeof(ht_entry_t) + key_size + value_size,
+                               CELLPOOL_CHUNK_CELLS);
 #endif
 }
 
@@ -16,17 +16,20 @@
 #include "bpautils.h"
 
 
-/* size of the hash table (must be a power of 2)*/
+/* most buckets the hash table can grow to (must be a power of 2). It
+   starts much smaller (HTTSLFT_MIN_BUCKETS in httslft.h) */
 /*#define HTTSLF_SIZE  134217728 */   /* 2^27 */ /* too large */
 #define HTTSLF_SIZE  67108864   /* 2^26 */
 
 typedef struct httslf_entry_s
 {
     struct httslf_entry_s *next;
+    unsigned int so_key; /* split order key (see httslft.h) */
     char data[1];  /* overlaid with key followed by value, 
                       sizes defined by user. 
                    FIXME: of course this is dodgy because of alignment padding
-                   etc., but it seems to work... */
+                   etc., but it seems to work... (the tables of
+                   httslft.h with fixed types do not do this) */
 } httslf_entry_t;
 
 /* hash function type */
@@ -44,15 +47,23 @@ void httslf_initialize(size_t keysize, size_t valuesize, hash_function_t hashfun
                    copy_function_t valuecopy);
 
 /* insert into hashtable */
-httslf_entry_t *httslf_insert(void *key, void *value);
+httslf_entry_t *httslf_insert(const void *key, const void *value, int thread_id);
 
 /* lookup in hashtable */
-void *httslf_lookup(void *key);
+void *httslf_lookup(const void *key);
 
 /* test for invalid structure */
 int httslf_validate(void);
 
+/* remove and free all entries */
+void httslf_reset(void);
+
 /* compute and print stats about hash table */
 void httslf_printstats(void);
 
+#ifdef USE_INSTRUMENT
+/* add up per-thread counters and return total number of keys */
+unsigned int httslf_total_key_count(void);
+#endif
+
 #endif /* HTTSLF_H */
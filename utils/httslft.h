@@ -0,0 +1,906 @@
+/*****************************************************************************
+ *
+ * File:    httslft.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Separate chaining thread-safe lock-free hash table as a C "template":
+ * including this header, with the macros below defined, generates a
+ * table with the key and value types, hash function and key comparison
+ * fixed at compile time. So the hash and comparison are inline rather
+ * than calls through function pointers for every entry of every chain,
+ * and each entry is a struct with properly aligned key and value fields
+ * rather than the two overlaid on a char array.
+ *
+ * httslf.c is itself an instantiation of this, with the hash and
+ * comparison being the callbacks passed to httslf_initialize().
+ *
+ * The table is resizable, using split-ordered lists (Shalev & Shavit
+ * 2006 "Split-ordered lists: lock-free extensible hash tables" J. ACM
+ * 53(3):379-405). All the entries are in one lock-free linked list,
+ * sorted by their hash value with its bits reversed (the split order),
+ * and a bucket is just a dummy node in the list, at the start of the
+ * entries whose hash is the bucket number modulo the number of buckets.
+ * Doubling the number of buckets splits each bucket's chain in two at a
+ * point that is already in the list, so no entry ever moves: a new
+ * bucket is made the first time an insert uses it, by putting its dummy
+ * node in the list starting from its parent bucket, the one it was
+ * split from, whose chain its entries are in until then (which is also
+ * where a lookup looks for a key whose bucket is not made yet). So the
+ * table starts with HTTSLFT_MIN_BUCKETS buckets (all made at once, with
+ * no searching as the list is empty) and doubles (up to HTTSLFT_SIZE)
+ * whenever the number of keys is more than HTTSLFT_LOAD times the number
+ * of buckets, and chains stay short while memory grows with the number
+ * of keys. The buckets are in segments each twice the size of the one
+ * before, allocated as needed. Making a bucket costs a search of its
+ * parent's chain, so the first segment is large.
+ *
+ * Each bucket in a segment is its dummy node (rather than a pointer to
+ * one) so finding the first entry of a bucket is one cache miss, not
+ * two. So two threads can't each make a dummy node and have one of them
+ * lose the race to put it in the list; instead a thread claims the
+ * bucket with CAS before putting it in the list, and a thread that
+ * finds a bucket claimed but not made yet just uses its parent, as if it
+ * had not been split yet. A pointer to a dummy node has its low bit set,
+ * so a search that comes to the end of its bucket can stop there without
+ * looking at (and taking a cache miss on) the next bucket's dummy node.
+ *
+ * A new entry is put in the list with CAS on the next pointer of the
+ * entry before it, and if the CAS fails (another thread has put an
+ * entry there) the list is searched again from that entry, in case the
+ * other thread inserted the same key. Entries are never removed
+ * (except all at once by reset), so no marked pointers are needed.
+ *
+ * The generated table is static data, one per instantiation.
+ * This header can be included more than once (with different
+ * HTTSLFT_NAME) to make more than one table.
+ *
+ * Usage:
+ *    #define HTTSLFT_NAME     knap
+ *    #define HTTSLFT_KEY_T    tuple2_t
+ *    #define HTTSLFT_VALUE_T  unsigned int
+ *    #define HTTSLFT_HASH(k)  hashfn_wang((uint64_t)(k)->i << 32 | (k)->j)
+ *    #define HTTSLFT_KEYMATCH(k1, k2) ((k1)->i == (k2)->i && (k1)->j == (k2)->j)
+ *    #include "httslft.h"
+ *    ...
+ *    knap_create();
+ *    knap_insert(&key, &value, thread_id);
+ *    if ((pvalue = knap_lookup(&key))) ...
+ *
+ * generates (all static inline):
+ *    knap_entry_t  - the entry type, with next, so_key, key and value fields
+ *    void knap_create(void)      - allocate (or empty) the table
+ *    knap_entry_t *knap_insert(const KEY_T *key, const VALUE_T *value,
+ *                              int thread_id)    (as httslf_insert())
+ *    VALUE_T *knap_lookup(const KEY_T *key)      (as httslf_lookup())
+ *    int knap_validate(void), void knap_reset(void),
+ *    void knap_printstats(void),
+ *    unsigned int knap_total_key_count(void) (with USE_INSTRUMENT)
+ *
+ * Macros defining the table (all #undef'd at the end):
+ *
+ *    HTTSLFT_NAME            - prefix of everything generated
+ *    HTTSLFT_KEY_T           - type of the key
+ *    HTTSLFT_VALUE_T         - type of the value
+ *    HTTSLFT_HASH(k)         - hash (unsigned int) of the key *k. The low
+ *                              bits choose the bucket, so they must be
+ *                              mixed. Bit 31 is not used.
+ *    HTTSLFT_KEYMATCH(k1,k2) - nonzero iff the keys *k1 and *k2 are equal
+ *    HTTSLFT_SIZE            - most buckets (a power of 2), default
+ *                              HTTSLF_SIZE
+ *
+ * and for a table with its own entry type (as httslf.c has), all of:
+ *
+ *    HTTSLFT_ENTRY_T         - entry type, a struct with next and so_key
+ *                              fields first (as NAME_bucket_t)
+ *    HTTSLFT_ENTRY_SIZE      - size to allocate for an entry
+ *    HTTSLFT_ENTRY_KEY(e)    - pointer to the key of entry e
+ *    HTTSLFT_ENTRY_VALUE(e)  - pointer to the value of entry e
+ *    HTTSLFT_SET_ENTRY(e,k,v) - set key and value of new entry e from
+ *                               pointers k and v
+ *    HTTSLFT_API             - storage class of the table functions
+ *                              (default static inline)
+ *
+ * Preprocessor symbols:
+ *
+ * USE_MALLOC_ENTRIES - allocate each entry with malloc() rather than from
+ *                      a cell pool
+ * USE_INSTRUMENT     - total_key_count() function
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bpautils.h"
+#include "httslf.h"
+#include "cellpool.h"
+#include "atomicdefs.h"
+#include "bigmem.h"
+#include "shardcount.h"
+
+#if !defined(HTTSLFT_NAME) || !defined(HTTSLFT_KEY_T) || \
+    !defined(HTTSLFT_VALUE_T) || !defined(HTTSLFT_HASH) || \
+    !defined(HTTSLFT_KEYMATCH)
+#error "httslft.h needs HTTSLFT_NAME, _KEY_T, _VALUE_T, _HASH and _KEYMATCH"
+#endif
+
+#ifndef HTTSLFT_COMMON
+#define HTTSLFT_COMMON
+/* the same for all instantiations */
+
+/* the table starts with 2^HTTSLFT_MIN_BUCKETS_LOG2 buckets, which is also
+   the size of the first segment of buckets, all made when the table is
+   created. May be defined before including this (for all the tables in
+   the file), e.g. larger for a table that will have tens of millions of
+   keys so it does not have to double (and make buckets) so many times */
+#ifndef HTTSLFT_MIN_BUCKETS_LOG2
+#define HTTSLFT_MIN_BUCKETS_LOG2 20
+#endif
+#define HTTSLFT_MIN_BUCKETS (1U << HTTSLFT_MIN_BUCKETS_LOG2)
+
+/* most segments of buckets there can be: segment s > 0 has
+   2^(HTTSLFT_MIN_BUCKETS_LOG2 + s - 1) buckets, up to 2^31 in all */
+#define HTTSLFT_NUM_SEGMENTS (32 - HTTSLFT_MIN_BUCKETS_LOG2)
+
+/* double the buckets when there are more than this many keys per bucket */
+#define HTTSLFT_LOAD 2
+
+/* each thread adds its new keys to the shared count (used to decide when
+   to double the buckets) this many at a time, so the count is not a
+   cache line every insert has to write */
+#define HTTSLFT_COUNT_BATCH 64
+
+/*
+ * httslft_reverse()
+ *
+ * Reverse the bits of a 32 bit word (bit 0 becomes bit 31, etc.)
+ */
+static inline unsigned int httslft_reverse(unsigned int x)
+{
+  x = ((x >> 1) & 0x55555555U) | ((x & 0x55555555U) << 1);
+  x = ((x >> 2) & 0x33333333U) | ((x & 0x33333333U) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fU) | ((x & 0x0f0f0f0fU) << 4);
+  return __builtin_bswap32(x);
+}
+
+/* split order key of a regular entry with hash h: its hash reversed, with
+   the low bit set so it comes after the dummy node of its bucket */
+#define HTTSLFT_SO_REGULAR(h) httslft_reverse((h) | 0x80000000U)
+
+/* split order key of the dummy node of bucket b */
+#define HTTSLFT_SO_DUMMY(b) httslft_reverse(b)
+
+#define HTTSLFT_IS_DUMMY(e) (((e)->so_key & 1) == 0)
+
+/* a next pointer to a dummy node has its low bit set, so a search can
+   see it has come to the next bucket without a cache miss on the dummy */
+#define HTTSLFT_TAG(p) ((void *)((unsigned long)(p) | 1))
+#define HTTSLFT_TAGGED(p) ((unsigned long)(p) & 1)
+#define HTTSLFT_UNTAG(p) ((void *)((unsigned long)(p) & ~1UL))
+
+/* state of a bucket */
+#define HTTSLFT_BUCKET_UNMADE  0  /* dummy node not in the list */
+#define HTTSLFT_BUCKET_CLAIMED 1  /* a thread is putting it in the list */
+#define HTTSLFT_BUCKET_MADE    2  /* in the list, entries can go after it */
+
+/* the bucket bucket b was split from (b without its top bit), for b > 0 */
+#define HTTSLFT_PARENT(b) ((b) & ~(0x80000000U >> __builtin_clz(b)))
+
+#endif /* HTTSLFT_COMMON */
+
+#ifndef HTTSLFT_SIZE
+#define HTTSLFT_SIZE HTTSLF_SIZE
+#endif
+
+#ifndef HTTSLFT_API
+#define HTTSLFT_API static inline
+#endif
+
+/* NAME_x for the generated names (two levels so NAME is expanded) */
+#define HTTSLFT_CAT2(a, b) a ## _ ## b
+#define HTTSLFT_CAT(a, b) HTTSLFT_CAT2(a, b)
+#define HTTSLFT_FN(f) HTTSLFT_CAT(HTTSLFT_NAME, f)
+
+#ifndef HTTSLFT_ENTRY_T
+/* the entry is a struct of the key and value */
+typedef struct HTTSLFT_CAT(HTTSLFT_NAME, entry_s)
+{
+    struct HTTSLFT_CAT(HTTSLFT_NAME, entry_s) *next;
+    unsigned int so_key;  /* split order key */
+    HTTSLFT_KEY_T key;
+    HTTSLFT_VALUE_T value;
+} HTTSLFT_FN(entry_t);
+#define HTTSLFT_ENTRY_T HTTSLFT_FN(entry_t)
+#define HTTSLFT_ENTRY_SIZE sizeof(HTTSLFT_ENTRY_T)
+#define HTTSLFT_ENTRY_KEY(e) (&(e)->key)
+#define HTTSLFT_ENTRY_VALUE(e) (&(e)->value)
+#define HTTSLFT_SET_ENTRY(e, k, v) ((e)->key = *(k), (e)->value = *(v))
+#endif
+
+/* a bucket, which is also the dummy node at the start of its entries in
+   the list: next and so_key are only accessed as those of an entry
+   (HTTSLFT_DUMMY()), and so must be at the same offsets */
+typedef struct HTTSLFT_CAT(HTTSLFT_NAME, bucket_s)
+{
+    HTTSLFT_ENTRY_T *next;
+    unsigned int so_key;
+    unsigned int state;        /* HTTSLFT_BUCKET_UNMADE etc. */
+} HTTSLFT_FN(bucket_t);
+
+#define HTTSLFT_DUMMY(bk) ((HTTSLFT_ENTRY_T *)(bk))
+
+/* fails to compile if the entry type does not start as the bucket does */
+typedef char HTTSLFT_FN(layout_check)[
+  (offsetof(HTTSLFT_ENTRY_T, next) == 0 &&
+   offsetof(HTTSLFT_ENTRY_T, so_key) ==
+   offsetof(HTTSLFT_FN(bucket_t), so_key)) ? 1 : -1];
+
+/* use the cell-pool allocator unless USE_MALLOC_ENTRIES is defined.
+   It used to be faster only on Solaris (SPARC), with malloc() faster on
+   Linux, but now each thread has its own magazine of cells in the pool it
+   is faster on Linux too */
+#ifndef USE_MALLOC_ENTRIES
+#define HTTSLFT_CP_ALLOC
+#endif
+
+/*****************************************************************************
+ *
+ * static data
+ *
+ *****************************************************************************/
+
+/* The buckets, in segments allocated (with CAS) as needed, with
+   bigmem_alloc() so the big ones can use huge pages etc. */
+static HTTSLFT_FN(bucket_t) *HTTSLFT_FN(segments)[HTTSLFT_NUM_SEGMENTS];
+
+/* number of buckets, doubled with CAS */
+static unsigned int HTTSLFT_FN(num_buckets);
+
+/* number of keys, to a multiple of HTTSLFT_COUNT_BATCH per thread */
+static unsigned int HTTSLFT_FN(count);
+
+#ifdef HTTSLFT_CP_ALLOC
+/* all the entries in the table are allocated from this pool, so they can
+   all be freed at once by NAME_reset() */
+static cellpool_t *HTTSLFT_FN(entry_pool);
+#endif
+
+/* per-thread count of new keys inserted (counter 0), so we have the
+   number of keys without a (slow) scan of the table */
+static shardcount_t HTTSLFT_FN(key_count);
+
+
+/*****************************************************************************
+ *
+ * functions
+ *
+ *****************************************************************************/
+
+/*
+ * NAME_segment_size()
+ *
+ * Number of buckets in a segment
+ *
+ * Parameters:
+ *    s - segment number
+ *
+ * Return value:
+ *    number of buckets in segment s
+ */
+static inline unsigned int HTTSLFT_FN(segment_size)(unsigned int s)
+{
+  return s == 0 ? HTTSLFT_MIN_BUCKETS :
+    1U << (HTTSLFT_MIN_BUCKETS_LOG2 + s - 1);
+}
+
+
+/*
+ * NAME_bucket_slot()
+ *
+ * Find a bucket, allocating the segment it is in if it is not already
+ *
+ * Parameters:
+ *    b - bucket number
+ *    alloc - if TRUE, allocate the segment if needed
+ *
+ * Return value:
+ *    pointer to the bucket, or NULL if its segment is not allocated
+ *    (and alloc is FALSE)
+ */
+static inline HTTSLFT_FN(bucket_t) *HTTSLFT_FN(bucket_slot)(unsigned int b,
+                                                            bool alloc)
+{
+  unsigned int s, msb;
+  HTTSLFT_FN(bucket_t) *seg, *newseg;
+
+  if (b < HTTSLFT_MIN_BUCKETS)
+    s = 0;
+  else
+  {
+    msb = 31 - __builtin_clz(b);
+    s = msb - HTTSLFT_MIN_BUCKETS_LOG2 + 1;
+    b -= 1U << msb;
+  }
+  if (!(seg = ATOMIC_LOAD_ACQUIRE(&HTTSLFT_FN(segments)[s])))
+  {
+    if (!alloc)
+      return NULL;
+    newseg = (HTTSLFT_FN(bucket_t) *)bigmem_alloc(
+      HTTSLFT_FN(segment_size)(s) * sizeof(HTTSLFT_FN(bucket_t)));
+    if ((seg = CASPTR(&HTTSLFT_FN(segments)[s], NULL, newseg)) != NULL)
+      /* another thread allocated it first */
+      bigmem_free(newseg, HTTSLFT_FN(segment_size)(s) *
+                  sizeof(HTTSLFT_FN(bucket_t)));
+    else
+      seg = newseg;
+  }
+  return &seg[b];
+}
+
+
+/*
+ * NAME_get_bucket()
+ *
+ * Get the dummy node of a bucket if it is made
+ *
+ * Parameters:
+ *    b - bucket number
+ *
+ * Return value:
+ *    dummy node of bucket b, or NULL if it is not made yet
+ */
+static inline HTTSLFT_ENTRY_T *HTTSLFT_FN(get_bucket)(unsigned int b)
+{
+  HTTSLFT_FN(bucket_t) *bk = HTTSLFT_FN(bucket_slot)(b, FALSE);
+
+  if (bk && ATOMIC_LOAD_ACQUIRE(&bk->state) == HTTSLFT_BUCKET_MADE)
+    return HTTSLFT_DUMMY(bk);
+  return NULL;
+}
+
+
+/*
+ * NAME_nearest_bucket()
+ *
+ * Get the dummy node of a bucket, or if it is not made yet, of the
+ * bucket it will be split from (or that bucket's parent...), whose
+ * chain its entries are in. Bucket 0 is always made.
+ *
+ * Parameters:
+ *    b - bucket number
+ *
+ * Return value:
+ *    dummy node of bucket b or its nearest made ancestor
+ */
+static inline HTTSLFT_ENTRY_T *HTTSLFT_FN(nearest_bucket)(unsigned int b)
+{
+  HTTSLFT_ENTRY_T *dummy;
+
+  while (!(dummy = HTTSLFT_FN(get_bucket)(b)))
+    b = HTTSLFT_PARENT(b);
+  return dummy;
+}
+
+
+/*
+ * NAME_is_bucket_end()
+ *
+ * Tell whether a next pointer is to the dummy node of a bucket after
+ * the one a search started at, and so past all the entries the search
+ * could find, without looking at the dummy node. That is so if it is to
+ * a dummy node (tagged) and the number of buckets is still what it was
+ * when the search found its bucket: every bucket made is then one of
+ * those, so its dummy comes after all the entries of the search's
+ * bucket. If the buckets have doubled since, it may be one split from
+ * the search's bucket, with some of its entries after it.
+ *
+ * Parameters:
+ *    next - next pointer (maybe tagged) from the list
+ *    n - number of buckets when the search started at the dummy node
+ *        of the key's bucket, or 0 if it started at an ancestor
+ *
+ * Return value:
+ *    nonzero if next is the end of the search's bucket
+ */
+static inline int HTTSLFT_FN(is_bucket_end)(const HTTSLFT_ENTRY_T *next,
+                                            unsigned int n)
+{
+  return HTTSLFT_TAGGED(next) &&
+    n == ATOMIC_LOAD_ACQUIRE(&HTTSLFT_FN(num_buckets));
+}
+
+
+/*
+ * NAME_alloc_entry()
+ *
+ * Allocate an entry (or dummy node)
+ *
+ * Parameters:
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t)
+ *
+ * Return value:
+ *    new entry. Exits with error if out of memory.
+ */
+static inline HTTSLFT_ENTRY_T *HTTSLFT_FN(alloc_entry)(int thread_id)
+{
+  HTTSLFT_ENTRY_T *ent;
+
+  /* bpa_malloc() is just malloc(). When compiling & linking
+     with -pthread (wtih gcc at least), malloc() is threadsafe but
+     it is not lock-free so there is a cost to using this, a
+     lock-free malloc() would be nice.  There is one in nbds
+     (http://code.google.com/p/nbds/) [could also just use that
+     library instead of using this at all I suppose anyway -
+     using separate chaining like this is inefficient in many ways,
+     the closed hash table as in nbds does no malloc() at all
+     on insertions so this problem goes away completely,
+     and it is faster and works better with cache]; see also
+     Michael 2004 "Scalable Lock-Free Dynamic Memory Allocation"
+     PLDI'04 [note reference to CAS first appearing in S/370 POP!]).
+     Although
+     http://developers.sun.com/solaris/articles/multiproc/multiproc.html
+     seems to show that the GNU libc malloc (ptmalloc) performs
+     pretty well in multithreaded code anyway so maybe this is fine
+     as it is (at least when using gcc on Solaris).
+     But we can't really claim the hashtable is lockfree if the
+     malloc() it uses is not...
+     so cellpool_alloc() uses a trivial cell pool allocator to just
+     get a new cell from this thread's magazine, completely lock-free
+     (except when it needs a new chunk of cells).
+  */
+#ifdef HTTSLFT_CP_ALLOC
+  if (!(ent = (HTTSLFT_ENTRY_T *)cellpool_alloc(HTTSLFT_FN(entry_pool),
+                                                thread_id)))
+    bpa_fatal_error("httslft alloc_entry", "cellpool_alloc() failed\n");
+#else
+  (void)thread_id;
+  ent = (HTTSLFT_ENTRY_T *)bpa_malloc(HTTSLFT_ENTRY_SIZE);
+#endif
+  return ent;
+}
+
+
+/*
+ * NAME_free_entry()
+ *
+ * Free an entry that was never put in the table
+ *
+ * Parameters:
+ *    ent - entry to free
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t)
+ *
+ * Return value:
+ *    None.
+ */
+static inline void HTTSLFT_FN(free_entry)(HTTSLFT_ENTRY_T *ent, int thread_id)
+{
+#ifdef HTTSLFT_CP_ALLOC
+  cellpool_free(HTTSLFT_FN(entry_pool), ent, thread_id);
+#else
+  (void)thread_id;
+  free(ent);
+#endif
+}
+
+
+/*
+ * NAME_init_bucket()
+ *
+ * Make a bucket, by putting its dummy node in the list, making the
+ * buckets it was split from first if they are not made yet. If another
+ * thread is making the bucket, don't wait for it.
+ *
+ * Parameters:
+ *    b - bucket number (> 0)
+ *
+ * Return value:
+ *    the dummy node of bucket b, or if another thread is still making
+ *    it, of its nearest made ancestor
+ */
+static HTTSLFT_ENTRY_T *HTTSLFT_FN(init_bucket)(unsigned int b)
+{
+  unsigned int parent = HTTSLFT_PARENT(b);
+  unsigned int so_key = HTTSLFT_SO_DUMMY(b);
+  HTTSLFT_FN(bucket_t) *bk;
+  HTTSLFT_ENTRY_T *prev, *curr, *ent, *dummy;
+
+  if (!HTTSLFT_FN(get_bucket)(parent))
+    (void)HTTSLFT_FN(init_bucket)(parent);
+  bk = HTTSLFT_FN(bucket_slot)(b, TRUE);
+  prev = HTTSLFT_FN(nearest_bucket)(parent);
+  if (CAS32(&bk->state, HTTSLFT_BUCKET_UNMADE, HTTSLFT_BUCKET_CLAIMED) !=
+      HTTSLFT_BUCKET_UNMADE)
+    /* made, or being made by another thread */
+    return HTTSLFT_FN(nearest_bucket)(b);
+  dummy = HTTSLFT_DUMMY(bk);
+  dummy->so_key = so_key;
+  for (;;)
+  {
+    curr = ATOMIC_LOAD_ACQUIRE(&prev->next);
+    while ((ent = HTTSLFT_UNTAG(curr)) && ent->so_key < so_key)
+    {
+      prev = ent;
+      curr = ATOMIC_LOAD_ACQUIRE(&ent->next);
+    }
+    dummy->next = curr;
+    if (CASPTR(&prev->next, curr, HTTSLFT_TAG(dummy)) == curr)
+      break;
+    /* lost the race, so look again from prev */
+  }
+  ATOMIC_STORE_RELEASE(&bk->state, HTTSLFT_BUCKET_MADE);
+  return dummy;
+}
+
+
+/*
+ * NAME_make_empty()
+ *
+ * Set up an empty table in already allocated (and zeroed) segment 0:
+ * make all its buckets, the dummy node of bucket 0 being the head of
+ * the list
+ *
+ * Parameters:
+ *    None
+ *
+ * Return value:
+ *    None.
+ */
+static inline void HTTSLFT_FN(make_empty)(void)
+{
+  HTTSLFT_FN(bucket_t) *seg = HTTSLFT_FN(segments)[0];
+  unsigned int b, so_next;
+
+  /* link each dummy node to the one after it in split order, going
+     through the segment in order rather than along the list */
+  for (b = 0; b < HTTSLFT_MIN_BUCKETS; b++)
+  {
+    seg[b].so_key = HTTSLFT_SO_DUMMY(b);
+    so_next = seg[b].so_key + (1U << (32 - HTTSLFT_MIN_BUCKETS_LOG2));
+    seg[b].next = so_next == 0 ? NULL :
+      HTTSLFT_TAG(&seg[httslft_reverse(so_next)]);
+    seg[b].state = HTTSLFT_BUCKET_MADE;
+  }
+  HTTSLFT_FN(num_buckets) = HTTSLFT_MIN_BUCKETS;
+  HTTSLFT_FN(count) = 0;
+  shardcount_reset(&HTTSLFT_FN(key_count));
+}
+
+
+/*
+ * NAME_free_all()
+ *
+ * Free all the entries and all but the first segment
+ * of buckets, and zero the first segment
+ *
+ * Parameters:
+ *    None
+ *
+ * Return value:
+ *    None.
+ */
+static inline void HTTSLFT_FN(free_all)(void)
+{
+  unsigned int s;
+#ifndef HTTSLFT_CP_ALLOC
+  HTTSLFT_ENTRY_T *ent, *next;
+
+  for (ent = HTTSLFT_DUMMY(&HTTSLFT_FN(segments)[0][0]); ent != NULL;
+       ent = next)
+  {
+    next = HTTSLFT_UNTAG(ent->next);
+    if (!HTTSLFT_IS_DUMMY(ent))
+      free(ent);
+  }
+#else
+  cellpool_reset(HTTSLFT_FN(entry_pool));
+#endif
+  for (s = 1; s < HTTSLFT_NUM_SEGMENTS; s++)
+    if (HTTSLFT_FN(segments)[s])
+    {
+      bigmem_free(HTTSLFT_FN(segments)[s],
+                  HTTSLFT_FN(segment_size)(s) * sizeof(HTTSLFT_FN(bucket_t)));
+      HTTSLFT_FN(segments)[s] = NULL;
+    }
+  bigmem_zero(HTTSLFT_FN(segments)[0],
+              HTTSLFT_MIN_BUCKETS * sizeof(HTTSLFT_FN(bucket_t)));
+}
+
+
+/*
+ * NAME_create()
+ *
+ * Allocate the table (using the current bigmem_set_policy() policy),
+ * with HTTSLFT_MIN_BUCKETS buckets, and the cell pool for the entries.
+ * If it is already allocated, free all the entries instead, leaving it
+ * empty.
+ *
+ * Parameters:
+ *    None
+ *
+ * Return value:
+ *    None.
+ */
+static inline void HTTSLFT_FN(create)(void)
+{
+  if (!HTTSLFT_FN(segments)[0])
+    HTTSLFT_FN(segments)[0] = (HTTSLFT_FN(bucket_t) *)
+      bigmem_alloc(HTTSLFT_MIN_BUCKETS * sizeof(HTTSLFT_FN(bucket_t)));
+  else
+    HTTSLFT_FN(free_all)();
+#ifdef HTTSLFT_CP_ALLOC
+  /* the entry size may be different, so always a new pool */
+  if (HTTSLFT_FN(entry_pool))
+    cellpool_destroy(HTTSLFT_FN(entry_pool));
+  HTTSLFT_FN(entry_pool) = cellpool_create(HTTSLFT_ENTRY_SIZE,
+                                           CELLPOOL_CHUNK_CELLS);
+#endif
+  HTTSLFT_FN(make_empty)();
+}
+
+
+/*
+ * NAME_insert()
+ *
+ * Insert a key/value pair into the hashtable
+ * NB This only allows insertion of a NEW key - if the key already
+ * exists, we do nothing (and do NOT update the value if it is different).
+ * This is for use in dynamic programming with multiple threads
+ * simple case (no bounding) where a particular key once its value is set
+ * is the optimal - any other thread can only ever compute the same value
+ * anyway.
+ *
+ * Parameters:
+ *    key   - ptr to key to insert
+ *    value - ptr to value to insert for the key
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 for the cell pool and key count
+ *
+ * Return value:
+ *    Pointer to entry inserted (or already there).
+ */
+HTTSLFT_API HTTSLFT_ENTRY_T *HTTSLFT_FN(insert)(const HTTSLFT_KEY_T *key,
+                                                const HTTSLFT_VALUE_T *value,
+                                                int thread_id)
+{
+  unsigned int h, b, so_key, n, c;
+  HTTSLFT_ENTRY_T *prev, *curr, *ent, *newent = NULL;
+
+  h = HTTSLFT_HASH(key);
+  so_key = HTTSLFT_SO_REGULAR(h);
+  n = ATOMIC_LOAD_ACQUIRE(&HTTSLFT_FN(num_buckets));
+  b = h & (n - 1);
+  if (!(prev = HTTSLFT_FN(get_bucket)(b)) &&
+      (prev = HTTSLFT_FN(init_bucket)(b))->so_key != HTTSLFT_SO_DUMMY(b))
+    n = 0; /* starting from an ancestor, so dummy nodes may come first */
+  for (;;)
+  {
+    /* the entries with the same split order key (the same hash) are
+       together, so look at them all for this key, and put it after them */
+    curr = ATOMIC_LOAD_ACQUIRE(&prev->next);
+    while (!HTTSLFT_FN(is_bucket_end)(curr, n) &&
+           (ent = HTTSLFT_UNTAG(curr)) && ent->so_key <= so_key)
+    {
+      if (ent->so_key == so_key && HTTSLFT_KEYMATCH(key,
+                                                    HTTSLFT_ENTRY_KEY(ent)))
+      {
+        /* key already exists, just ignore the new one
+           NB we do NOT update the value here, see header comment */
+        if (newent)
+          HTTSLFT_FN(free_entry)(newent, thread_id);
+        return ent;
+      }
+      prev = ent;
+      curr = ATOMIC_LOAD_ACQUIRE(&ent->next);
+    }
+    if (!newent)
+    {
+      newent = HTTSLFT_FN(alloc_entry)(thread_id);
+      newent->so_key = so_key;
+      HTTSLFT_SET_ENTRY(newent, key, value);
+    }
+    newent->next = curr;
+    if (CASPTR(&prev->next, curr, newent) == curr)
+      break;
+    /* lost the race (another thread is inserting after prev also, maybe
+       this key), so look again from prev */
+  }
+
+  SHARDCOUNT_INC(&HTTSLFT_FN(key_count), thread_id, 0);
+  if (SHARDCOUNT_GET(&HTTSLFT_FN(key_count), thread_id, 0) %
+      HTTSLFT_COUNT_BATCH == 0)
+  {
+    c = ATOMIC_ADD_32_NV_RELAXED(&HTTSLFT_FN(count), HTTSLFT_COUNT_BATCH);
+    n = HTTSLFT_FN(num_buckets);
+    if (c > HTTSLFT_LOAD * n && n < HTTSLFT_SIZE)
+      (void)CAS32(&HTTSLFT_FN(num_buckets), n, 2 * n); /* fails if done
+                                                          already */
+  }
+  return newent;
+}
+
+
+/*
+ * NAME_lookup()
+ *
+ * Get the value for a key from the hashtable. If its bucket is not made
+ * yet, the key is looked for from the nearest made bucket it will be
+ * split from (the lookup does not make it, as an insert does)
+ *
+ * Parameters:
+ *     key - ptr to key to look up
+ *
+ * Return value:
+ *      pointer to value or NULL if not present
+ */
+HTTSLFT_API HTTSLFT_VALUE_T *HTTSLFT_FN(lookup)(const HTTSLFT_KEY_T *key)
+{
+  unsigned int h, b, so_key, n;
+  HTTSLFT_ENTRY_T *ent, *curr;
+
+  h = HTTSLFT_HASH(key);
+  so_key = HTTSLFT_SO_REGULAR(h);
+  n = ATOMIC_LOAD_ACQUIRE(&HTTSLFT_FN(num_buckets));
+  b = h & (n - 1);
+  if (!(ent = HTTSLFT_FN(get_bucket)(b)))
+  {
+    ent = HTTSLFT_FN(nearest_bucket)(HTTSLFT_PARENT(b));
+    n = 0; /* starting from an ancestor, so dummy nodes may come first */
+  }
+  curr = ATOMIC_LOAD_ACQUIRE(&ent->next);
+  while (!HTTSLFT_FN(is_bucket_end)(curr, n) &&
+         (ent = HTTSLFT_UNTAG(curr)) && ent->so_key <= so_key)
+  {
+    if (ent->so_key == so_key && HTTSLFT_KEYMATCH(key, HTTSLFT_ENTRY_KEY(ent)))
+      return HTTSLFT_ENTRY_VALUE(ent);
+    curr = ATOMIC_LOAD_ACQUIRE(&ent->next);
+  }
+  return NULL;
+}
+
+
+/*
+ * NAME_validate()
+ *
+ * Test that the list is in split order, that each bucket made has its
+ * dummy node in it, that the pointers to dummy nodes (and only those)
+ * are tagged, and that there are no duplicate keys
+ *
+ * This is one walk of the list, so linear in the number of entries (a
+ * duplicate can only be among the entries with the same split-order
+ * key, which are next to each other), but it is not done in parallel as
+ * oahttslf_validate_par() is: each thread would have to start at the
+ * dummy node of a bucket, and only httslftest validates one of these.
+ *
+ * Parameters:
+ *    None
+ *
+ * Return value:
+ *    0 if invalid (e.g. duplicate keys found) else 1
+ */
+HTTSLFT_API int HTTSLFT_FN(validate)(void)
+{
+  HTTSLFT_ENTRY_T *ent1, *ent2, *dummy;
+  unsigned int b;
+
+  for (ent1 = HTTSLFT_DUMMY(&HTTSLFT_FN(segments)[0][0]); ent1 != NULL;
+       ent1 = HTTSLFT_UNTAG(ent1->next))
+  {
+    ent2 = HTTSLFT_UNTAG(ent1->next);
+    if (ent2 && (ent2->so_key < ent1->so_key ||
+                 !HTTSLFT_TAGGED(ent1->next) != !HTTSLFT_IS_DUMMY(ent2)))
+      return 0;
+    if (!HTTSLFT_IS_DUMMY(ent1))
+      for (; ent2 && ent2->so_key == ent1->so_key;
+           ent2 = HTTSLFT_UNTAG(ent2->next))
+        if (HTTSLFT_KEYMATCH(HTTSLFT_ENTRY_KEY(ent1), HTTSLFT_ENTRY_KEY(ent2)))
+          return 0;
+  }
+  for (b = 0; b < HTTSLFT_FN(num_buckets); b++)
+    if ((dummy = HTTSLFT_FN(get_bucket)(b)) &&
+        dummy->so_key != HTTSLFT_SO_DUMMY(b))
+      return 0;
+  return 1;
+}
+
+
+/*
+ * NAME_reset()
+ *
+ * Remove all the entries from the hash table and free them, leaving it
+ * empty, with HTTSLFT_MIN_BUCKETS buckets again. With the cell pool
+ * allocator they are all freed at once, else each is free()d.
+ * Must not be called while other threads are using the table.
+ *
+ * Parameters:
+ *    None
+ *
+ * Return value:
+ *    None
+ */
+HTTSLFT_API void HTTSLFT_FN(reset)(void)
+{
+  HTTSLFT_FN(free_all)();
+  HTTSLFT_FN(make_empty)();
+}
+
+
+/*
+ * NAME_printstats()
+ *
+ *   Compute and print statistics about the hash table to stdout
+ *
+ *   Parameters: None
+ *   Return value: None
+ */
+HTTSLFT_API void HTTSLFT_FN(printstats)(void)
+{
+  unsigned int num_items=0, num_entries=0, num_dummies=0;
+  unsigned int chain_length=0,max_chain_length=0,sum_chain_length=0;
+  float avg_chain_length;
+  HTTSLFT_ENTRY_T *ent;
+
+  for (ent = HTTSLFT_DUMMY(&HTTSLFT_FN(segments)[0][0]); ent != NULL;
+       ent = HTTSLFT_UNTAG(ent->next))
+  {
+    if (HTTSLFT_IS_DUMMY(ent))
+    {
+      num_dummies++;
+      chain_length = 0;
+    }
+    else
+    {
+      num_items++;
+      if (++chain_length == 1)
+        num_entries++;
+      sum_chain_length++;
+      if (chain_length > max_chain_length)
+        max_chain_length = chain_length;
+    }
+  }
+  avg_chain_length = (float)sum_chain_length / num_entries;
+  printf("num buckets     : %u (%u made)\n", HTTSLFT_FN(num_buckets),
+         num_dummies);
+  printf("num slots used  : %u\n", num_entries);
+  printf("num items       : %u (%f per bucket)\n", num_items,
+         (float)num_items / HTTSLFT_FN(num_buckets));
+  printf("max chain length: %u\n", max_chain_length);
+  printf("avg chain length: %f\n", avg_chain_length);
+}
+
+
+#ifdef USE_INSTRUMENT
+/*
+ * NAME_total_key_count()
+ *
+ *  add up the per-thread key counters and return total
+ *
+ * Parameters: None
+ * Return value: Total number of keys in the hash table
+ */
+HTTSLFT_API unsigned int HTTSLFT_FN(total_key_count)(void)
+{
+  return (unsigned int)shardcount_total(&HTTSLFT_FN(key_count), 0);
+}
+#endif
+
+
+#undef HTTSLFT_NAME
+#undef HTTSLFT_KEY_T
+#undef HTTSLFT_VALUE_T
+#undef HTTSLFT_HASH
+#undef HTTSLFT_KEYMATCH
+#undef HTTSLFT_SIZE
+#undef HTTSLFT_ENTRY_T
+#undef HTTSLFT_ENTRY_SIZE
+#undef HTTSLFT_ENTRY_KEY
+#undef HTTSLFT_ENTRY_VALUE
+#undef HTTSLFT_SET_ENTRY
+#undef HTTSLFT_API
+#undef HTTSLFT_CP_ALLOC
+#undef HTTSLFT_DUMMY
+#undef HTTSLFT_CAT2
+#undef HTTSLFT_CAT
+#undef HTTSLFT_FN
@@ -214,7 +214,7 @@ static void *insert_random(void *threadarg)
       }
 
       value = (int)s.low;
-      httslf_insert(&s, &value);
+      httslf_insert(&s, &value, mydata->thread_id);
       /*assert(*(int *)httslf_lookup(&s) == (int)s.low);*/
 
     }
@@ -236,6 +236,8 @@ int main(int argc, char *argv[])
   struct timeval start_timeval,end_timeval,elapsed_timeval;  
   int etime;
   int c,i;
+  SET s;
+  int value, *pvalue;
 
 
   c = 1;
@@ -296,6 +298,24 @@ int main(int argc, char *argv[])
 
   httslf_printstats();
 
+  /* free all the entries at once, and the table must be empty but usable */
+  httslf_reset();
+  s.low = 12345;
+  s.high = 0;
+  value = 54321;
+  if (httslf_lookup(&s) || !httslf_validate())
+  {
+      fprintf(stderr, "hash table not empty after reset\n");
+      exit(EXIT_FAILURE);
+  }
+  httslf_insert(&s, &value, 0);
+  if (!(pvalue = httslf_lookup(&s)) || *pvalue != value)
+  {
+      fprintf(stderr, "insert after reset failed\n");
+      exit(EXIT_FAILURE);
+  }
+  printf("reset ok\n");
+
   pthread_exit(NULL);
 }
 
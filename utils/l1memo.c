@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *
+ * File:    l1memo.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Small per-thread memo caches in front of a shared hash table.
+ * See l1memo.h.
+ *
+ *
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "l1memo.h"
+
+
+/*
+ * l1memo_create()
+ *
+ * Create an empty cache for each thread, with the biggest power of 2
+ * entries that fit in bytes (but at least one). The pages of each are
+ * first touched by the thread that uses it, so on a NUMA machine they
+ * are on its own node.
+ *
+ * Parameters:
+ *    num_threads - number of thread ids (0..num_threads-1) to have a cache
+ *    bytes - size of each thread's cache, e.g. its share of L2
+ *
+ * Return value:
+ *    Pointer to new caches. Exits with error if out of memory.
+ */
+l1memo_t *l1memo_create(int num_threads, size_t bytes)
+{
+  l1memo_t *m;
+  size_t n = 1;
+  int t;
+
+  assert(num_threads >= 1 && num_threads <= MAX_NUM_THREADS);
+  while (2 * n * sizeof(l1memo_entry_t) <= bytes)
+    n <<= 1;
+  m = (l1memo_t *)bpa_calloc(1, sizeof(l1memo_t));
+  m->mask = (unsigned int)(n - 1);
+  m->num_threads = num_threads;
+  for (t = 0; t < num_threads; t++)
+    m->entries[t] = (l1memo_entry_t *)bpa_calloc(n, sizeof(l1memo_entry_t));
+  return m;
+}
+
+
+/*
+ * l1memo_destroy()
+ *
+ * Free the caches made by l1memo_create()
+ *
+ * Parameters:
+ *    m - caches to free
+ *
+ * Return value:
+ *    None.
+ */
+void l1memo_destroy(l1memo_t *m)
+{
+  int t;
+
+  for (t = 0; t < m->num_threads; t++)
+    free(m->entries[t]);
+  free(m);
+}
+
+
+/*
+ * l1memo_reset()
+ *
+ * Empty the cache of every thread. Must not be called while other
+ * threads are using them.
+ *
+ * Parameters:
+ *    m - caches to empty
+ *
+ * Return value:
+ *    None.
+ */
+void l1memo_reset(l1memo_t *m)
+{
+  int t;
+
+  assert(L1MEMO_EMPTY_KEY == 0);
+  for (t = 0; t < m->num_threads; t++)
+    memset(m->entries[t], 0, ((size_t)m->mask + 1) * sizeof(l1memo_entry_t));
+}
@@ -0,0 +1,102 @@
+#ifndef L1MEMO_H
+#define L1MEMO_H
+/*****************************************************************************
+ *
+ * File:    l1memo.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Declarations for small per-thread memo caches in front of a shared
+ * hash table.
+ *
+ * Most lookups in the top-down d.p. are of values the same thread
+ * computed moments before, but every one of them still goes to the big
+ * shared table, usually a cache miss and, for a line another thread
+ * has written, a coherence miss too. So each thread has its own small
+ * direct-mapped cache of (key, value) pairs, sized to fit in its L2
+ * cache, which is looked in first. It is write-through: values are still
+ * always put in the shared table, which is left for reuse between
+ * threads, and values found there are put in the looking thread's cache.
+ *
+ * Only another thread ever writing a different value for a key could
+ * make a cached value stale, so this is only for memo tables, where the
+ * value of a key, once there, never changes. Keys are the same as in the
+ * shared table, and cannot be 0.
+ *
+ * Usage:
+ *
+ *   l1memo_t *l1 = l1memo_create(num_threads, 256 * 1024);
+ *   ...
+ *   if (!L1MEMO_LOOKUP(l1, thread_id, key, &value))
+ *   {
+ *     ... get value from shared table (or compute and put it there) ...
+ *     L1MEMO_PUT(l1, thread_id, key, value);
+ *   }
+ *
+ * Each thread only ever touches its own cache, so there is no
+ * synchronization at all.
+ *
+ *
+ *****************************************************************************/
+
+#include "bpautils.h"
+#include "oahttslf.h"   /* for uint64_t etc. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* marks unused entry (a key cannot have this value) */
+#define L1MEMO_EMPTY_KEY 0
+
+/* Fibonacci hashing: the high bits of key times 2^64 / golden ratio */
+#define L1MEMO_HASH(key) \
+  ((unsigned int)(((uint64_t)(key) * 0x9e3779b97f4a7c15ULL) >> 32))
+
+typedef struct l1memo_entry_s
+{
+    uint64_t key;
+    uint64_t value;
+} l1memo_entry_t;
+
+/* the caches of all the threads. Only the entries are written, each
+   thread's in its own allocation, so this is read-only and shared */
+typedef struct l1memo_s
+{
+    unsigned int mask;            /* entries per thread - 1 (2^n - 1) */
+    int num_threads;              /* threads that have a cache */
+    l1memo_entry_t *entries[MAX_NUM_THREADS]; /* cache of each thread */
+} l1memo_t;
+
+
+/* entry of the cache of thread_id (0,1,2,.. NOT pthread_t) for key */
+#define L1MEMO_ENTRY(m, thread_id, k) \
+  (&(m)->entries[(thread_id)][L1MEMO_HASH(k) & (m)->mask])
+
+/* TRUE (and *valuep set) if key k is in the cache of thread_id */
+#define L1MEMO_LOOKUP(m, thread_id, k, valuep) \
+  (L1MEMO_ENTRY(m, thread_id, k)->key == (k) ? \
+   (*(valuep) = L1MEMO_ENTRY(m, thread_id, k)->value, TRUE) : FALSE)
+
+/* put key k with value v in the cache of thread_id, replacing the key
+   that was in its entry if any */
+#define L1MEMO_PUT(m, thread_id, k, v) \
+  (L1MEMO_ENTRY(m, thread_id, k)->key = (k), \
+   L1MEMO_ENTRY(m, thread_id, k)->value = (v))
+
+
+/* create empty caches of at most bytes each for thread ids
+   0..num_threads-1 */
+l1memo_t *l1memo_create(int num_threads, size_t bytes);
+
+/* free the caches */
+void l1memo_destroy(l1memo_t *m);
+
+/* empty all the caches (when the shared table is reset) */
+void l1memo_reset(l1memo_t *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* L1MEMO_H */
@@ -139,6 +139,8 @@ typedef struct thread_data_s
 
 static thread_data_t thread_data[MAX_NUM_THREADS];
 
+static oahttslf_t *hashtable;  /* the table shared by all threads */
+
 
 
 /***************************************************************************
@@ -226,7 +228,7 @@ static void *actions_fromlist(void *threadarg)
 #ifdef DEBUG
           printf("lookup(%16llX)", actions[q].key);
 #endif
-          found = oahttslf_lookup(actions[q].key, &ivalue);
+          found = oahttslf_lookup(hashtable, actions[q].key, &ivalue);
 #ifdef DEBUG
           if (found)
               printf(" = %llu\n", ivalue);
@@ -239,7 +241,7 @@ static void *actions_fromlist(void *threadarg)
 #ifdef DEBUG
           printf("insert(%16llX, %llu)\n", actions[q].key, actions[q].value);
 #endif
-          oahttslf_insert(actions[q].key, actions[q].value, mydata->thread_id);
+          oahttslf_insert(hashtable, actions[q].key, actions[q].value, mydata->thread_id);
           break;
 
       default:
@@ -351,7 +353,12 @@ int main(int argc, char *argv[])
   }
 
   if (readstdin)
+  {
     num_actions = read_actions(stdin, actions);
+    hashtable = oahttslf_create(num_actions);
+  }
+  else
+    hashtable = oahttslf_create(NUM_INSERTIONS);
 
 
   gettimeofday(&start_timeval, NULL);
@@ -404,17 +411,17 @@ int main(int argc, char *argv[])
   printf("elapsed time %d ms\n", etime);
 
 #ifdef DEBUG 
-  if (!oahttslf_validate())
+  if (!oahttslf_validate(hashtable))
   {
       fprintf(stderr, "hash table validation failed\n");
       exit(EXIT_FAILURE);
   }
 
-  oahttslf_printstats();
+  oahttslf_printstats(hashtable);
 #endif
 
 #ifdef USE_CONTENTION_INSTRUMENT
-  printf("total retry count = %ld\n", oahttslf_total_retry_count());
+  printf("total retry count = %ld\n", oahttslf_total_retry_count(hashtable));
 #endif
 
 
@@ -0,0 +1,392 @@
+/*****************************************************************************
+ *
+ * File:    oaht.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Open addressing (closed hashing) hash table for one thread only, with
+ * linear probing. It has the same keys and values (nonzero 64 bit
+ * words) and the same calls as oahttslf, so a serial d.p. can use it
+ * in place of oahttslf, but it is a plain array of key/value slots,
+ * with no atomic instructions, volatile or per-thread counters. So it
+ * is the table the single-threaded baseline runs should use, with their
+ * times not including the thread-safety costs of oahttslf (or the
+ * malloc() per entry and chain walking of ht.c).
+ *
+ * Each slot is a key and its value, so a probe is one cache line. The
+ * table is kept at most half full: when an insert would make it more,
+ * it is doubled and all the keys put in the new array again, which
+ * only needs to be safe with respect to this one thread.
+ *
+ * Preprocessor symbols:
+ *
+ * USE_GOOD_HASH  - use mixing hash function rather than trivial one
+ * OAHT_HASH      - hash function family (hashfn.h) of oaht_create(), e.g.
+ *                  HASHFN_CRC32, overriding USE_GOOD_HASH
+ * ALLOW_UPDATE   - allow insert to update value of existing key
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bpautils.h"
+#include "oaht.h"
+#include "hashfn.h"
+
+
+#define USE_GOOD_HASH
+#define ALLOW_UPDATE
+
+/* hash function family (hashfn.h) of oaht_create(), as oahttslf. A
+   caller whose keys are already dense small integers can have the
+   identity with oaht_create_hash(), so nearby keys are in nearby slots */
+#ifndef OAHT_HASH
+#ifdef USE_GOOD_HASH
+#define OAHT_HASH HASHFN_WANG
+#else
+#define OAHT_HASH HASHFN_IDENTITY
+#endif
+#endif
+
+/* largest the table can grow to (the hash is 32 bits) */
+#define OAHT_GROW_LIMIT 0x80000000U  /* 2^31 */
+
+
+/*****************************************************************************
+ *
+ * types
+ *
+ *****************************************************************************/
+
+typedef struct oaht_slot_s
+{
+    uint64_t key;     /* OAHT_EMPTY_KEY if slot unused */
+    uint64_t value;
+} oaht_slot_t;
+
+/*
+ * The hash table itself. Callers only ever see a pointer to this.
+ */
+struct oaht_s
+{
+    oaht_slot_t *slots;       /* size slots */
+    uint64_t size;            /* number of slots, a power of 2 */
+    uint64_t num_entries;     /* number of keys in slots */
+    hashfn_family_t hash;     /* hash function family of keys */
+};
+
+
+/*****************************************************************************
+ *
+ * static functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * oaht_home()
+ *
+ * Home slot of a key: its hash modulo the table size
+ *
+ * Parameters:
+ *    table - hashtable
+ *    key - key to hash
+ *
+ * Return value:
+ *    index of slot to start probing for key at
+ */
+static inline uint64_t oaht_home(const oaht_t *table, uint64_t key)
+{
+  return hashfn(table->hash, key) & (table->size - 1); /* size is 2^n */
+}
+
+
+/*
+ * oaht_find_slot()
+ *
+ * Find the slot a key is in, or the empty slot it would go in
+ *
+ * Parameters:
+ *    table - hashtable to look in
+ *    key - key to find
+ *
+ * Return value:
+ *    pointer to the slot with key, or else to the first empty slot
+ *    probing from its home slot
+ */
+static inline oaht_slot_t *oaht_find_slot(const oaht_t *table, uint64_t key)
+{
+  uint64_t mask = table->size - 1;
+  uint64_t i = oaht_home(table, key);
+
+  while (table->slots[i].key != key &&
+         table->slots[i].key != OAHT_EMPTY_KEY)
+    i = (i + 1) & mask;
+  return &table->slots[i];
+}
+
+
+/*
+ * oaht_grow()
+ *
+ * Double the size of the table, putting all its keys in the new array
+ *
+ * Parameters:
+ *    table - hashtable to grow
+ *
+ * Return value:
+ *    None. Exits with error if out of memory or already at
+ *    OAHT_GROW_LIMIT slots.
+ */
+static void oaht_grow(oaht_t *table)
+{
+  static const char *funcname = "oaht_grow";
+  oaht_slot_t *oldslots = table->slots;
+  uint64_t oldsize = table->size;
+  uint64_t i;
+
+  if (oldsize >= OAHT_GROW_LIMIT)
+    bpa_fatal_error(funcname, "hash table full\n");
+  table->size = 2 * oldsize;
+  table->slots = (oaht_slot_t *)bpa_calloc(table->size, sizeof(oaht_slot_t));
+  for (i = 0; i < oldsize; i++)
+    if (oldslots[i].key != OAHT_EMPTY_KEY)
+      *oaht_find_slot(table, oldslots[i].key) = oldslots[i];
+  free(oldslots);
+}
+
+
+/*****************************************************************************
+ *
+ * external functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * oaht_create()
+ *
+ * Allocate a new empty hashtable, hashing keys with the OAHT_HASH family.
+ * The initial size is the smallest power of 2 that keeps the table at
+ * most half full with max_keys keys in it, clamped to
+ * [OAHT_MIN_SIZE, OAHT_MAX_SIZE], as for oahttslf_create().
+ * The table grows if it does fill up.
+ *
+ * Parameters:
+ *    max_keys - (estimate of) the maximum number of keys to be inserted
+ *
+ * Return value:
+ *    Pointer to new hashtable. Exits with error if out of memory.
+ */
+oaht_t *oaht_create(uint64_t max_keys)
+{
+  return oaht_create_hash(max_keys, OAHT_HASH);
+}
+
+
+/*
+ * oaht_create_hash()
+ *
+ * Allocate a new empty hashtable as oaht_create(), but hashing keys
+ * with a given hash function family. With HASHFN_IDENTITY and keys
+ * 1..max_keys, each key is in its own slot (the table is direct
+ * indexed) and keys close together are in slots close together.
+ *
+ * Parameters:
+ *    max_keys - (estimate of) the maximum number of keys to be inserted
+ *    hash - hash function family (hashfn.h) to hash keys with
+ *
+ * Return value:
+ *    Pointer to new hashtable. Exits with error if out of memory.
+ */
+oaht_t *oaht_create_hash(uint64_t max_keys, hashfn_family_t hash)
+{
+  oaht_t *table;
+  uint64_t size = OAHT_MIN_SIZE;
+
+  while (size < OAHT_MAX_SIZE && size < 2 * max_keys)
+    size <<= 1;
+  table = (oaht_t *)bpa_calloc(1, sizeof(oaht_t));
+  table->size = size;
+  table->hash = hash;
+  table->slots = (oaht_slot_t *)bpa_calloc(size, sizeof(oaht_slot_t));
+  return table;
+}
+
+
+/*
+ * oaht_destroy()
+ *
+ * Free all memory used by a hashtable
+ *
+ * Parameters:
+ *    table - hashtable to free
+ *
+ * Return value:
+ *    None.
+ */
+void oaht_destroy(oaht_t *table)
+{
+  free(table->slots);
+  free(table);
+}
+
+
+/*
+ * oaht_insert()
+ *
+ * Insert a key/value pair into the hashtable, or update the value
+ * for existing key.
+ *
+ * Parameters:
+ *    table - hashtable to insert into
+ *    key   - key to insert (not OAHT_EMPTY_KEY)
+ *    value - value to insert for the key (not OAHT_EMPTY_VALUE)
+ *
+ * Return value:
+ *    Value for the key prior to the new insertion (OAHT_EMPTY_VALUE
+ *    for a new key)
+ */
+uint64_t oaht_insert(oaht_t *table, uint64_t key, uint64_t value)
+{
+  oaht_slot_t *slot = oaht_find_slot(table, key);
+  uint64_t oldvalue;
+
+  if (slot->key == key)
+  {
+    oldvalue = slot->value;
+#ifdef ALLOW_UPDATE
+    slot->value = value;
+#endif
+    return oldvalue;
+  }
+  if (2 * (table->num_entries + 1) > table->size)
+  {
+    oaht_grow(table);
+    slot = oaht_find_slot(table, key);
+  }
+  slot->key = key;
+  slot->value = value;
+  table->num_entries++;
+  return OAHT_EMPTY_VALUE;
+}
+
+
+/*
+ * oaht_lookup()
+ *
+ * Get the value for a key from the hashtable
+ *
+ * Parameters:
+ *     table - hashtable to look in
+ *     key - key to look up
+ *     value - (output) value for key, only set if TRUE returned.
+ *
+ * Return value:
+ *     TRUE if key found, FALSE otherwise.
+ */
+bool oaht_lookup(oaht_t *table, uint64_t key, uint64_t *value)
+{
+  oaht_slot_t *slot = oaht_find_slot(table, key);
+
+  if (slot->key != key)
+    return FALSE;
+  *value = slot->value;
+  return TRUE;
+}
+
+
+/*
+ * oaht_validate()
+ *
+ * Test that every key can be found from its home slot (no empty slot
+ * between), and that there are no duplicate keys
+ *
+ * Parameters:
+ *    table - hashtable to validate
+ *
+ * Return value:
+ *    0 if duplicate or unreachable keys found, or the count of keys is
+ *    wrong, else 1
+ */
+int oaht_validate(oaht_t *table)
+{
+  uint64_t i, num_keys = 0;
+
+  for (i = 0; i < table->size; i++)
+  {
+    if (table->slots[i].key == OAHT_EMPTY_KEY)
+      continue;
+    num_keys++;
+    /* the probe for the key stops at the first slot it is in */
+    if (oaht_find_slot(table, table->slots[i].key) != &table->slots[i])
+      return 0;
+  }
+  return num_keys == table->num_entries;
+}
+
+
+/*
+ * oaht_printstats()
+ *
+ *   Compute and print statistics about the hash table to stdout:
+ *   occupancy, and probe lengths (slots each key is past its home slot)
+ *
+ *   Parameters:
+ *      table - hashtable to compute stats for
+ *   Return value: None
+ */
+void oaht_printstats(oaht_t *table)
+{
+  uint64_t i, probes, max_probes = 0, sum_probes = 0;
+
+  for (i = 0; i < table->size; i++)
+  {
+    if (table->slots[i].key == OAHT_EMPTY_KEY)
+      continue;
+    probes = (i - oaht_home(table, table->slots[i].key)) & (table->size - 1);
+    sum_probes += probes;
+    if (probes > max_probes)
+      max_probes = probes;
+  }
+  printf("num slots       : %llu\n", table->size);
+  printf("num items       : %llu (%f full)\n", table->num_entries,
+         (double)table->num_entries / table->size);
+  printf("max probe length: %llu\n", max_probes);
+  printf("avg probe length: %f\n",
+         table->num_entries ? (double)sum_probes / table->num_entries : 0.0);
+}
+
+
+/*
+ * oaht_reset()
+ *
+ *   reset all table entries to empty (keeping the size it has grown to)
+ *
+ *   Parameters:
+ *      table - hashtable to reset
+ *   Return value: None
+ */
+void oaht_reset(oaht_t *table)
+{
+  memset(table->slots, 0, table->size * sizeof(oaht_slot_t));
+  table->num_entries = 0;
+}
+
+
+/*
+ * oaht_num_entries()
+ *
+ *   number of keys in the hash table (this one has a counter, so it is
+ *   not the scan of the whole table that oahttslf_num_entries() is)
+ *
+ *   Parameters:
+ *      table - hashtable to count entries in
+ *   Return value: Number of keys in the hash table
+ */
+uint64_t oaht_num_entries(oaht_t *table)
+{
+  return table->num_entries;
+}
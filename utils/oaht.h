@@ -0,0 +1,69 @@
+#ifndef OAHT_H
+#define OAHT_H
+/*****************************************************************************
+ *
+ * File:    oaht.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Declarations for open addressing hash table for one thread only.
+ * The same keys, values and calls as oahttslf (without the thread ids).
+ *
+ *
+ *****************************************************************************/
+
+#include "bpautils.h"
+#include "hashfn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* the initial table size is chosen at run time by oaht_create() and
+   is a power of 2 at least this. The table doubles as needed */
+#define OAHT_MIN_SIZE  1024       /* 2^10 */
+#define OAHT_MAX_SIZE  67108864   /* 2^26 */ /* (initial size only) */
+
+/* marks unused slot (a key cannot have this value) */
+#define OAHT_EMPTY_KEY 0
+
+/* marks unset value (a value cannot have this value) */
+#define OAHT_EMPTY_VALUE 0
+
+/* handle for a hash table; contents are private to oaht.c */
+typedef struct oaht_s oaht_t;
+
+
+/* create a new empty hashtable sized to hold max_keys keys */
+oaht_t *oaht_create(uint64_t max_keys);
+
+/* create a new empty hashtable using hash function family hash */
+oaht_t *oaht_create_hash(uint64_t max_keys, hashfn_family_t hash);
+
+/* free all memory used by a hashtable */
+void oaht_destroy(oaht_t *table);
+
+/* insert into hashtable. Returns old value. */
+uint64_t oaht_insert(oaht_t *table, uint64_t key, uint64_t value);
+
+/* lookup in hashtable */
+bool oaht_lookup(oaht_t *table, uint64_t key, uint64_t *value);
+
+/* test for invalid structure */
+int oaht_validate(oaht_t *table);
+
+/* compute and print stats about hash table */
+void oaht_printstats(oaht_t *table);
+
+/* reset all table entries to empty */
+void oaht_reset(oaht_t *table);
+
+/* return number of keys in table */
+uint64_t oaht_num_entries(oaht_t *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OAHT_H */
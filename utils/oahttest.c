@@ -0,0 +1,110 @@
+/*****************************************************************************
+ *
+ * File:    oahttest.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Test harness for the single-thread open addressing hash table (oaht).
+ * Starts from the smallest table so it grows several times, checks
+ * every key inserted (and some that were not) can be looked up, then
+ * updates, reset and validate. Then the same for a table with the
+ * identity hash and dense keys, as knapsack_simple has.
+ *
+ * Usage:
+ *    oahttest [num_keys]
+ *
+ *
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "bpautils.h"
+#include "oaht.h"
+
+#define NUM_KEYS 4000000
+
+
+/* the q'th test key: distinct and nonzero for q < 2^32, with the bits
+   of q in two fields as packed d.p. indices are */
+static uint64_t test_key(uint64_t q)
+{
+  return ((q & 0xffff) << 32) | ((q >> 16) << 1) | 1;
+}
+
+
+static void fail(const char *msg)
+{
+  fprintf(stderr, "%s\n", msg);
+  exit(EXIT_FAILURE);
+}
+
+
+int main(int argc, char *argv[])
+{
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  uint64_t num_keys = NUM_KEYS, q, value;
+  oaht_t *table;
+  int etime;
+
+  if (argc > 2)
+  {
+    fprintf(stderr, "usage: %s [num_keys]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  if (argc == 2)
+    num_keys = strtoull(argv[1], NULL, 10);
+
+  table = oaht_create(0);
+  gettimeofday(&start_timeval, NULL);
+  for (q = 0; q < num_keys; q++)
+    if (oaht_insert(table, test_key(q), q + 1) != OAHT_EMPTY_VALUE)
+      fail("new key already in table");
+  for (q = 0; q < num_keys; q++)
+    if (!oaht_lookup(table, test_key(q), &value) || value != q + 1)
+      fail("inserted key not found");
+  for (q = num_keys; q < 2 * num_keys; q++)
+    if (oaht_lookup(table, test_key(q), &value))
+      fail("key found that was not inserted");
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+  printf("elapsed time %d ms\n", etime);
+
+  if (oaht_num_entries(table) != num_keys)
+    fail("wrong number of entries");
+  if (oaht_insert(table, test_key(0), 42) != 1 ||
+      !oaht_lookup(table, test_key(0), &value) || value != 42)
+    fail("bad update of existing key");
+  if (!oaht_validate(table))
+    fail("INVALID");
+  oaht_printstats(table);
+
+  oaht_reset(table);
+  if (oaht_num_entries(table) != 0 || oaht_lookup(table, test_key(1), &value))
+    fail("table not empty after reset");
+  if (oaht_insert(table, test_key(1), 2) != OAHT_EMPTY_VALUE ||
+      !oaht_lookup(table, test_key(1), &value) || value != 2 ||
+      !oaht_validate(table))
+    fail("bad insert after reset");
+  printf("reset ok\n");
+  oaht_destroy(table);
+
+  /* dense keys 1..num_keys with the identity hash: one per slot */
+  table = oaht_create_hash(num_keys, HASHFN_IDENTITY);
+  for (q = 1; q <= num_keys; q++)
+    if (oaht_insert(table, q, q) != OAHT_EMPTY_VALUE)
+      fail("new dense key already in table");
+  for (q = 1; q <= num_keys; q++)
+    if (!oaht_lookup(table, q, &value) || value != q)
+      fail("inserted dense key not found");
+  if (oaht_lookup(table, num_keys + 1, &value) ||
+      oaht_num_entries(table) != num_keys || !oaht_validate(table))
+    fail("bad dense table");
+  oaht_printstats(table);
+  printf("dense ok\n");
+
+  oaht_destroy(table);
+  exit(0);
+}
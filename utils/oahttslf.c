@@ -5,7 +5,7 @@
  * Created: April 2009
  *
  * Open addressing (closed hashing) thread-safe lock-free hash table.
- * Uses linear probing.
+ * Uses linear probing, over buckets of OAHTTSLF_BUCKET_SLOTS slots.
  * 
  * gcc version 4.1.0 or greater is required, in order to use the
  * __sync_val_compare_and_swap()
@@ -17,71 +17,367 @@
  *
  * $Id: oahttslf.c 3148 2009-12-27 04:15:31Z alexs $
  *
+ * The table grows online, without locking. It is a chain of arrays,
+ * each twice the size of the one before. When an insert cannot find a
+ * slot for its key within OAHTTSLF_MAX_PROBES probes of the home slot,
+ * it allocates the next array (the thread that wins the CAS on the next
+ * pointer installs it) and from then on every insert also copies a chunk
+ * of OAHTTSLF_COPY_CHUNK slots (claimed with fetch-and-add) from the
+ * oldest array to the newer one, until it is all migrated.
+ *
+ * Keys are never removed from an old array, so nothing needs to be
+ * frozen there: new keys always go into the newest array, copies never
+ * overwrite a key already present in the newer array, and a write
+ * into an array that acquired a successor while we were writing to it
+ * is repeated in the successor. Lookups look in every array not yet fully
+ * migrated and take the value from the newest one that has the key.
+ * Since other threads may still be reading an old array, old arrays are
+ * only freed by oahttslf_reset() or oahttslf_destroy(); their total size
+ * is less than the size of the newest array.
+ *
+ * Each bucket is one 64 byte cache line holding 4 keys followed by their
+ * 4 values, so a lookup usually costs exactly one cache miss. Within a
+ * bucket slots are claimed in order and never freed, so the empty slots
+ * in a bucket are always at the end: the first slot that has either the
+ * key or is empty decides the probe, as for one slot in plain linear
+ * probing. With AVX2 (e.g. gcc -mavx2) all 4 keys are compared at once.
+ *
+ * oahttslf_reset() does not clear the table, it just increments the
+ * array's generation number. Each block of OAHTTSLF_GEN_BLOCK buckets
+ * has the generation it was last cleared in, and a block from an older
+ * generation counts as empty. The first insert to touch a stale block
+ * clears it: it sets its generation to OAHTTSLF_GEN_BUSY with CAS,
+ * clears the block, then sets it to the current generation. Other
+ * inserters wait for that, lookups just treat it as empty. The block
+ * generations are a small array (4 bytes per 4K of table) that
+ * usually stays in cache, so the check costs little.
+ *
+ * With USE_BOUNDED_PROBES each bucket also has a reach: the furthest
+ * (in buckets) any key whose home is that bucket has been put from it.
+ * Inserts raise it (with CAS, before claiming the slot) and lookups
+ * probe no further than the reach of the home bucket, so a miss in a
+ * nearly full table stops early instead of probing all max_probes
+ * buckets. This is a bounded-displacement form of Robin Hood hashing
+ * that never moves keys, so it stays lock-free. It costs a byte per
+ * bucket, which is another cache miss on a big table, so it only pays
+ * when lookups that miss are common at high load. The reaches of a block
+ * are cleared with the block after a reset.
+ * OAHTTSLF_MAX_PROBES (which can be set when compiling) bounds the
+ * displacement of every key; a smaller bound gives shorter probes but
+ * makes the table grow at a lower load.
+ *
+ * oahttslf_insert_max() and oahttslf_insert_min() combine the new value
+ * with the old one in the same CAS loop that sets the value, so several
+ * threads can each contribute a partial result to one key.
+ *
+ * oahttslf_save() writes a snapshot of the table to a file, as a header
+ * page followed by a single array of buckets laid out just as in memory.
+ * Threads each take a part of the table with oahttslf_foreach_part() and
+ * put its entries into the file through a shared mapping, so the keys
+ * of all the arrays end up in the one array and any migration is done
+ * in the file. oahttslf_load() maps the file copy-on-write and uses it
+ * as the first array of a new table, so nothing is read until it is
+ * looked up, and pages are only copied when written. The file is in the
+ * byte order of the machine and for the hash function it was built with,
+ * which the header records, along with an id of the problem (e.g. a
+ * hash of its input) from the caller, so that the values of one problem
+ * are never loaded as those of another.
+ *
+ * oahttslf_create_cache() makes a lossy memo table in a fixed amount of
+ * memory instead: a single array that never grows. When an insert finds
+ * no empty slot within OAHTTSLF_CACHE_PROBES buckets of the home bucket
+ * it evicts a key from that window instead, so a lookup of an evicted
+ * key just misses and the caller computes it again. Each slot has a
+ * cost byte, set from the caller's cost function (e.g. the span of a
+ * subproblem, roughly what it would cost to compute again) when the key
+ * is put. The victim is the slot in the window with the lowest cost,
+ * so an expensive key is only evicted by a key at least as expensive.
+ * Costs are not aged (as in the generalized clock algorithm) and the
+ * window is just the home bucket: in a top-down dynamic program the
+ * expensive subproblems are the ancestors of much of what is still to
+ * be computed, and evicting one means computing its descendants again,
+ * so with aging the recomputation blew up as soon as the cache was a
+ * fraction of the states, and a wider window (which keeps the most
+ * expensive keys of more buckets) also made it compute more again on
+ * the bpalign inputs. A slot with no value yet (a key claimed by a
+ * thread that is still computing it, which may be an ancestor of what
+ * it is computing now) is never evicted.
+ *
+ * Even so the time grows steeply as the cache gets smaller than the
+ * states of the problem: on a bpalign pair with 648K states (about
+ * 1 s with an unlimited table) a cache of 1/5 of the states took about
+ * the same time, 1/10 about 3 times as long and 1/20 about 8 times,
+ * and on a pair with 2.7M states 1/5 took 4 times as long and 1/10
+ * 18 times. So size the cache to as many of the states as will fit;
+ * it is for problems that would not otherwise fit at all.
+ *
+ * To evict, a thread locks the slot by replacing its key with
+ * OAHTTSLF_BUSY_KEY with CAS, empties the value, sets the cost and then
+ * puts the new key there. Since a slot can change keys, in a cache only
+ * the thread that claimed a slot ever writes its value (so a value never
+ * changes once it is set, and insert is the same as insert-if-absent),
+ * and a reader checks the slot still has the key after reading its
+ * value. (A reader could still be fooled if the slot changed keys twice
+ * and got the same key back, with the same value since values are
+ * memos, in between.) Two threads evicting for the same key at once can
+ * both put it in, which just wastes a slot until one of them is evicted.
+ *
+ * oahttslf_delete() leaves the key in its slot, so the probes for other
+ * keys still pass it, and gives it the value OAHTTSLF_DELETED_VALUE (a
+ * tombstone), which lookups treat as no value. The tombstone is put just
+ * like any other value, into the newest array and again into any newer
+ * one that appears meanwhile, and the migration never copies a value over
+ * one already in the newer array, tombstone or not, so an old value
+ * cannot come back. Inserting the key again replaces the tombstone.
+ * The migration does not copy tombstones, so they are compacted away
+ * each time the table grows. oahttslf_compact(), which like reset must
+ * not be called while other threads are using the table, rebuilds it
+ * into a single array sized for the keys that are left, dropping the
+ * tombstones and any keys a predicate picks (e.g. every knapsack state
+ * of the items already done), and frees the old arrays, so memory stays
+ * flat over a long run of problems instead of growing. A cache has no
+ * deletion, it evicts instead.
+ *
+ * Memory ordering (atomicdefs.h): a value is set with a full barrier
+ * CAS, which releases the key and anything the caller wrote before, and
+ * lookups read it with an acquire load, as they do the array pointers
+ * and block generations, so lookups themselves never need a fence. The
+ * one place a store must not pass a later load is the handshake with the
+ * migration: a put sets the value and then looks for a newer array,
+ * while the migration installs the newer array and then reads the
+ * value, so at least one of them must see the other. Both loads there
+ * are sequentially consistent, after sequentially consistent CASes.
+ * Claiming a chunk to migrate is a relaxed add. With the __sync
+ * builtins all these loads are plain volatile reads, relying on x86
+ * ordering as before.
+ *
+ * oahttslf_validate_par() and oahttslf_printstats_par() scan each array
+ * in equal parts, one per thread. Since a key can only be in the few
+ * buckets from its home bucket on, a key is checked just by looking it
+ * up from home and seeing that we get back to the same slot, so the
+ * check is linear in the size of the table, not quadratic.
+ *
  *
  * Preprocessor symbols:
  *
  *
  * USE_GOOD_HASH  - use mixing hash function rather than trivial one
+ * OAHTTSLF_HASH  - hash function family (hashfn.h), e.g. HASHFN_CRC32,
+ *                  overriding USE_GOOD_HASH
  * DEBUG          - include extra assertion checks etc.
  * ALLOW_UPDATE  - allow insert to update value of existing key
  * USE_INSTRUMENT - compile in (per-thread) instrumentation counts.
  * USE_CONTENTION_INSTRUMENT - per-thread contention counts (only).
+ * USE_BOUNDED_PROBES - lookups stop at the reach of the home bucket
+ * OAHTTSLF_MAX_PROBES - max buckets a key is put from its home (<= 255)
+ * __AVX2__       - (set by compiler) compare a bucket of keys with AVX2
  *
  *****************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "bpautils.h"
 #include "oahttslf.h"
 #include "cellpool.h"
 #include "atomicdefs.h"
+#include "shardcount.h"
+#include "bigmem.h"
+#include "hashfn.h"
 
 
 #define USE_GOOD_HASH
 #define ALLOW_UPDATE
 
-/* linear probing step size */
+/* linear probing step size (in buckets) */
 #define OAHTTSLF_PROBE_STEP 1
 
+/* slots per bucket: 4 keys + 4 values is one 64 byte cache line */
+#define OAHTTSLF_BUCKET_SLOTS 4
+#define OAHTTSLF_BUCKET_ALIGN 64
 
-/*****************************************************************************
- *
- * types
- *
- *****************************************************************************/
+/* maximum number of buckets probed past the home bucket before an insert
+   gives up on an array and grows into a new one. So lookups can stop
+   here too. 32 buckets is the same 128 slots as before bucketizing. */
+#ifndef OAHTTSLF_MAX_PROBES
+#define OAHTTSLF_MAX_PROBES 32
+#endif
+#if defined(USE_BOUNDED_PROBES) && OAHTTSLF_MAX_PROBES > 255
+#error "OAHTTSLF_MAX_PROBES must fit in the uint8_t reach of a bucket"
+#endif
+
+/* hint the cache to fetch the line at addr for reading. Only a hint, so
+   it is a no-op where the compiler has no way of giving it */
+#ifdef __GNUC__
+#define OAHTTSLF_PREFETCH(addr) \
+  __builtin_prefetch((const void *)(unsigned long)(addr), 0, 3)
+#else
+#define OAHTTSLF_PREFETCH(addr)
+#endif
+
+/* number of slots a thread claims at a time when helping to migrate */
+#define OAHTTSLF_COPY_CHUNK 1024
+
+/* number of buckets (of 64 bytes) cleared at once after a reset */
+#define OAHTTSLF_GEN_BLOCK 64
+
+/* block generation while the block is being cleared. Generations
+   start at 1 and the table is really cleared if it wraps around */
+#define OAHTTSLF_GEN_BUSY 0
+
+/* snapshot file header. The buckets start one page in so they are page
+   (and cache line) aligned when the file is mapped */
+#define OAHTTSLF_FILE_MAGIC "OAHTTSLF"
+#define OAHTTSLF_FILE_VERSION 2
+#define OAHTTSLF_FILE_HEADER_SIZE 4096
+
+/* hash function family (hashfn.h), also recorded in the snapshot header */
+#ifndef OAHTTSLF_HASH
+#ifdef USE_GOOD_HASH
+#define OAHTTSLF_HASH HASHFN_WANG
+#else
+#define OAHTTSLF_HASH HASHFN_IDENTITY
+#endif
+#endif
+#define OAHTTSLF_FILE_HASH OAHTTSLF_HASH
+
+/* buckets past the home bucket a cache looks in for a key or a victim.
+   Every miss in a full cache probes all of them, and with a wider window
+   more states had to be computed again (see comments at top) */
+#define OAHTTSLF_CACHE_PROBES 0
 
+/* largest array we can grow to (slot indices are unsigned int) */
+#define OAHTTSLF_GROW_LIMIT 0x80000000U  /* 2^31 */
+
+/* per-thread instrumentation counters in table->counts */
+enum
+{
+  OAHTTSLF_COUNT_KEYS,    /* new keys inserted */
+  OAHTTSLF_COUNT_RETRIES, /* CAS failures claiming a slot */
+  OAHTTSLF_COUNT_EVICTIONS /* keys evicted from a cache */
+};
 
-typedef struct oahttslf_entry_s
+/* what oahttslf_put() does with the value of a key already present */
+typedef enum oahttslf_putmode_e
 {
-    uint64_t key;   /* TODO need to be able to have a SET (128 bit) key */
-    uint64_t value;
-} oahttslf_entry_t;
+  OAHTTSLF_PUT_IFABSENT,  /* leave it */
+  OAHTTSLF_PUT_OVERWRITE, /* replace it */
+  OAHTTSLF_PUT_MAX,       /* replace it if new value greater (signed) */
+  OAHTTSLF_PUT_MIN,       /* replace it if new value less (signed) */
+  OAHTTSLF_PUT_MIGRATE    /* leave it, even a tombstone */
+} oahttslf_putmode_t;
+
+/* TRUE if v is a value, not empty or a tombstone */
+#define OAHTTSLF_IS_VALUE(v) \
+  ((v) != OAHTTSLF_EMPTY_VALUE && (v) != OAHTTSLF_DELETED_VALUE)
+
+/* TRUE if value v replaces present (non-empty) value old in mode m */
+#define OAHTTSLF_REPLACES(m, v, old) \
+  ((m) == OAHTTSLF_PUT_OVERWRITE ? (v) != (old) : \
+   (m) == OAHTTSLF_PUT_MAX ? (long long)(v) > (long long)(old) : \
+   (m) == OAHTTSLF_PUT_MIN ? (long long)(v) < (long long)(old) : FALSE)
 
 
 /*****************************************************************************
  *
- * static data
+ * types
  *
  *****************************************************************************/
 
 
-/* The hash table */
-/* Each entry is a key-value pair. Writing is synchornized with CAS logic */
-/* Note we depend on the empty key/value being 0 since this is declared */
-/* static and therefore initilized to zero */
-/* TODO: change to allocate dynamically so can have multiple */
-static oahttslf_entry_t hashtable[OAHTTSLF_SIZE];
+/* A bucket of slots: slot i is key[i] with value value[i]. The keys are
+   together so they can be compared in one vector instruction. */
+typedef struct oahttslf_bucket_s
+{
+    uint64_t key[OAHTTSLF_BUCKET_SLOTS];
+    uint64_t value[OAHTTSLF_BUCKET_SLOTS];
+} __attribute__((aligned(OAHTTSLF_BUCKET_ALIGN))) oahttslf_bucket_t;
+
+
+/* One array of buckets. Each new array in the chain is twice as big */
+typedef struct oahttslf_array_s
+{
+    /* Writing is synchornized with CAS logic */
+    /* Note we depend on the empty key/value being 0 since this is */
+    /* allocated with calloc() and therefore initilized to zero */
+    oahttslf_bucket_t *buckets; /* cache line aligned, within mem */
+    void *mem;                /* as allocated, for bigmem_free() */
+    size_t mem_size;          /* bytes allocated at mem */
+    bool mapped;              /* mem is a snapshot file mapping, not bigmem */
+    unsigned int size;        /* number of slots (power of 2) */
+    unsigned int num_buckets; /* size / OAHTTSLF_BUCKET_SLOTS */
+    unsigned int max_probes;  /* buckets past home bucket before giving up */
+    volatile unsigned int *gens; /* generation each block was cleared in */
+    unsigned int num_blocks;  /* num_buckets / OAHTTSLF_GEN_BLOCK */
+    unsigned int generation;  /* current generation, only changes on reset */
+#ifdef USE_BOUNDED_PROBES
+    volatile uint8_t *reach;  /* furthest any key is from each home bucket */
+#endif
+    volatile uint8_t *cost;   /* cost of each slot if a cache, else NULL */
+    struct oahttslf_array_s *volatile next; /* newer array, or NULL */
+    volatile unsigned int copy_idx;  /* next slot to claim for migration */
+    volatile unsigned int copy_done; /* number of slots migrated so far */
+} oahttslf_array_t;
+
+/* the array after a, and the oldest array of table t, for going through
+   the arrays: the acquire pairs with the CAS that installed the array,
+   so it is seen set up */
+#define NEXT_ARRAY(a) ATOMIC_LOAD_ACQUIRE(&(a)->next)
+#define CURRENT_ARRAY(t) ATOMIC_LOAD_ACQUIRE(&(t)->current)
+
+/* TRUE if the value just read from slot s of bucket b of array a is
+   still the value of key k: only a cache can give a slot another key */
+#define SLOT_STILL_HAS(a, b, s, k) \
+  (!(a)->cost || (b)->key[(s)] == (k))
+
+/* key and value of slot i (0..size-1) of array a, for code that just
+   iterates over all the slots. Only meaningful if SLOT_FRESH(a, i) */
+#define SLOT_KEY(a, i) \
+  ((a)->buckets[(i) / OAHTTSLF_BUCKET_SLOTS].key[(i) % OAHTTSLF_BUCKET_SLOTS])
+#define SLOT_VALUE(a, i) \
+  ((a)->buckets[(i) / OAHTTSLF_BUCKET_SLOTS].value[(i) % OAHTTSLF_BUCKET_SLOTS])
+#define SLOT_FRESH(a, i) \
+  ((a)->gens[(i) / (OAHTTSLF_BUCKET_SLOTS * OAHTTSLF_GEN_BLOCK)] == \
+   (a)->generation)
+
+
+/* start of a snapshot file, padded to OAHTTSLF_FILE_HEADER_SIZE */
+typedef struct oahttslf_file_header_s
+{
+    char magic[8];             /* OAHTTSLF_FILE_MAGIC, not terminated */
+    uint32_t version;          /* OAHTTSLF_FILE_VERSION */
+    uint32_t bucket_slots;     /* OAHTTSLF_BUCKET_SLOTS */
+    uint32_t hash;             /* OAHTTSLF_FILE_HASH */
+    uint32_t size;             /* number of slots in the array */
+    uint64_t num_entries;      /* number of keys saved */
+    uint64_t problem_id;       /* caller's id of the problem (e.g. a hash
+                                  of its input) the values are for */
+} oahttslf_file_header_t;
 
 
-/***************************************************************************
+/*
+ * The hash table itself. Callers only ever see a pointer to this,
+ * so we can have as many tables as we like, each sized for its problem.
  *
- * Instrumentation, per thread (each thread only writes to its own array 
- * element), and the total_ values which are computed only in the master
- * thread, by summing over the per-thread arrays.
- * Note that using this can really slow thigns down (e.g. on PPC and Intel)
- * due to 'false sharing' so only compiled in if USE_INSTRUMENT is defined.
+ * Instrumentation, per thread (each thread only writes to its own
+ * counters), and the total_ values which are computed only in the master
+ * thread, by summing over the threads.
+ * This used to really slow things down (e.g. on PPC and Intel) due to
+ * 'false sharing' of adjacent per-thread counters, but now each thread's
+ * counters are in their own cache lines (shardcount.h) so it costs no
+ * more than an increment. It is still only compiled in if USE_INSTRUMENT
+ * is defined.
  * pthreads "thread local storage" 
  * seems way to complicated to even experiment with
  * (for all I know has the same problem anyway).
@@ -96,12 +392,53 @@ static oahttslf_entry_t hashtable[OAHTTSLF_SIZE];
  *
  ***************************************************************************/
 
-#ifdef USE_INSTRUMENT
-static unsigned int key_count[MAX_NUM_THREADS];
-#endif
-#ifdef USE_CONTENTION_INSTRUMENT
-static unsigned int retry_count[MAX_NUM_THREADS];
+struct oahttslf_s
+{
+    oahttslf_array_t *first;            /* oldest array, for freeing */
+    oahttslf_array_t *volatile current; /* oldest array still in use */
+    oahttslf_cost_fn_t cost_fn;         /* cost of a key, if a cache */
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+    shardcount_t counts;  /* per thread, indexed by OAHTTSLF_COUNT_* */
 #endif
+};
+
+
+/* one thread's part of the work of oahttslf_save() or oahttslf_compact() */
+typedef struct oahttslf_save_part_s
+{
+    oahttslf_t *table;        /* table being saved */
+    oahttslf_array_t *file;   /* array mapped from the file, or new array
+                                 to compact into (NULL to just count) */
+    unsigned int part;        /* which part of the table is ours */
+    unsigned int num_parts;   /* number of parts (one per thread) */
+    int thread_id;            /* 0,1,2,... for instrumentation */
+    oahttslf_key_pred_t pred; /* keys to leave out, or NULL for none */
+    void *pred_arg;           /* passed to pred */
+    uint64_t num_entries;     /* (OUT) number of keys we put in the file */
+    uint64_t num_removed;     /* (OUT) number of keys pred left out */
+    bool full;                /* (OUT) TRUE if a key did not fit */
+} oahttslf_save_part_t;
+
+/* one thread's part of the work of oahttslf_scan() on one array, and
+   then the totals for the whole array */
+typedef struct oahttslf_scan_part_s
+{
+    oahttslf_t *table;        /* table being scanned */
+    oahttslf_array_t *array;  /* array being scanned */
+    unsigned int start;       /* first bucket of our part */
+    unsigned int end;         /* one past last bucket of our part */
+    bool bad;                 /* (OUT) a key not found in its own slot */
+    unsigned int num_items;   /* (OUT) number of keys */
+    unsigned int num_values;  /* (OUT) number of keys with a value */
+    unsigned int num_deleted; /* (OUT) number of keys with a tombstone */
+    unsigned int hist[OAHTTSLF_MAX_PROBES + 1]; /* (OUT) keys by number
+                                                   of buckets past home */
+    unsigned int num_clusters;  /* (OUT) runs of occupied buckets inside */
+    unsigned int cluster_total; /* (OUT) buckets in those runs */
+    unsigned int max_cluster;   /* (OUT) buckets in longest of them */
+    unsigned int head;  /* (OUT) occupied buckets at start of part */
+    unsigned int tail;  /* (OUT) occupied buckets at end of part */
+} oahttslf_scan_part_t;
 
 /*****************************************************************************
  *
@@ -110,150 +447,305 @@ static unsigned int retry_count[MAX_NUM_THREADS];
  *****************************************************************************/
 
 
-#ifdef USE_GOOD_HASH
+static unsigned int hash_function(const oahttslf_array_t *a, uint64_t key) {
+  unsigned int i;
+
+  i = hashfn(OAHTTSLF_HASH, key) & (a->num_buckets - 1); /* size is 2^n */
+
+  return i;
+}
+
+
 /*
-  hash a 64 bit value into 32 bits. From:
-  (Thomas Wang, Jan 1997, Last update Mar 2007, Version 3.1)
-  http://www.concentric.net/~Ttwang/tech/inthash.htm
-  (found by reference in NIST Dictionary of Algorithms and Data Structures)
-*/
-static unsigned long hash6432shift(unsigned long long key)
+ * oahttslf_bucket_find()
+ *
+ * Find the slot for a key in one bucket: the first slot that has the key
+ * or is empty (empty slots are always after the occupied ones).
+ *
+ * Parameters:
+ *     b - bucket to search
+ *     key - key to look for
+ *     vacant - (OUT) TRUE if the slot returned is empty (only set if
+ *                    a slot is returned)
+ *
+ * Return value:
+ *     index in bucket of slot, or -1 if all slots have other keys
+ */
+static int oahttslf_bucket_find(volatile oahttslf_bucket_t *b, uint64_t key,
+                                bool *vacant)
 {
-  key = (~key) + (key << 18); /* key = (key << 18) - key - 1; */
-  key = key ^ (key >> 31);
-  key = key * 21; /* key = (key + (key << 2)) + (key << 4); */
-  key = key ^ (key >> 11);
-  key = key + (key << 6);
-  key = key ^ (key >> 22);
-  return (unsigned long) key;
-}
+#ifdef __AVX2__
+  __m256i keys;
+  int match, empty;
+  int i;
+
+  /* each aligned 8 byte lane is read atomically, though not the vector
+     as a whole; seeing an empty slot before a newly claimed one just
+     looks like we got here before the key was inserted. The load must
+     be volatile: otherwise the compiler folds it into both compares, and
+     a slot claimed between the two reads is neither empty nor our key,
+     so we would go past it and claim another slot for the same key. */
+  keys = *(volatile __m256i *)(unsigned long)b->key;
+  match = _mm256_movemask_pd(_mm256_castsi256_pd(
+            _mm256_cmpeq_epi64(keys, _mm256_set1_epi64x((long long)key))));
+  empty = _mm256_movemask_pd(_mm256_castsi256_pd(
+            _mm256_cmpeq_epi64(keys, _mm256_setzero_si256())));
+  if (!(match | empty))
+    return -1;
+  i = __builtin_ctz(match | empty);
+  *vacant = !(match & (1 << i));
+  return i;
+#else
+  int i;
+  uint64_t entkey;
 
+  for (i = 0; i < OAHTTSLF_BUCKET_SLOTS; i++)
+  {
+    entkey = b->key[i];
+    if (entkey == key || entkey == OAHTTSLF_EMPTY_KEY)
+    {
+      *vacant = (entkey == OAHTTSLF_EMPTY_KEY);
+      return i;
+    }
+  }
+  return -1;
 #endif
+}
 
 
-static unsigned int hash_function(uint64_t key) {
+/*
+ * oahttslf_setup_array()
+ *
+ * Set up the size and block generations of an array whose bucket memory
+ * is allocated (or mapped) by the caller
+ *
+ * Parameters:
+ *    a - array to set up, zeroed
+ *    size - number of slots, must be a power of 2 and at least
+ *           OAHTTSLF_BUCKET_SLOTS * OAHTTSLF_GEN_BLOCK
+ *    generation - generation of the table it is for
+ *
+ * Return value:
+ *    None. Exits with error if out of memory.
+ */
+static void oahttslf_setup_array(oahttslf_array_t *a, unsigned int size,
+                                 unsigned int generation)
+{
   unsigned int i;
-  unsigned long q;
 
-#ifdef USE_GOOD_HASH
-  q = hash6432shift(key);
-#else
-  q = key;
+  a->size = size;
+  a->num_buckets = size / OAHTTSLF_BUCKET_SLOTS;
+  a->max_probes = (a->num_buckets - 1 < OAHTTSLF_MAX_PROBES ?
+                   a->num_buckets - 1 : OAHTTSLF_MAX_PROBES);
+  a->num_blocks = a->num_buckets / OAHTTSLF_GEN_BLOCK;
+  a->gens = (unsigned int *)bpa_malloc(a->num_blocks * sizeof(unsigned int));
+  a->generation = generation;
+  for (i = 0; i < a->num_blocks; i++)
+    a->gens[i] = generation;
+#ifdef USE_BOUNDED_PROBES
+  a->reach = (uint8_t *)bpa_calloc(a->num_buckets, sizeof(uint8_t));
 #endif
+}
 
-  i = q & (OAHTTSLF_SIZE - 1); /* depends on OAHTTSLF_SIZE being 2^n */
 
-  return i;
+/*
+ * oahttslf_new_array()
+ *
+ * Allocate a new empty array of buckets
+ *
+ * Parameters:
+ *    size - number of slots, must be a power of 2 and at least
+ *           OAHTTSLF_BUCKET_SLOTS * OAHTTSLF_GEN_BLOCK
+ *    generation - generation of the table it is for
+ *
+ * Return value:
+ *    Pointer to new array. Exits with error if out of memory.
+ */
+static oahttslf_array_t *oahttslf_new_array(unsigned int size,
+                                            unsigned int generation)
+{
+  oahttslf_array_t *a;
+
+  a = (oahttslf_array_t *)bpa_calloc(1, sizeof(oahttslf_array_t));
+  oahttslf_setup_array(a, size, generation);
+  /* bigmem_alloc() gets fresh zero pages from the OS for large arrays
+     (huge pages, NUMA placement and prefaulting as set by the program)
+     One extra bucket lets us align the buckets to cache lines */
+  a->mem_size = (size_t)(a->num_buckets + 1) * sizeof(oahttslf_bucket_t);
+  a->mem = bigmem_alloc(a->mem_size);
+  a->buckets = (oahttslf_bucket_t *)
+    (((unsigned long)a->mem + OAHTTSLF_BUCKET_ALIGN - 1) &
+     ~(unsigned long)(OAHTTSLF_BUCKET_ALIGN - 1));
+  return a;
 }
 
 
-
-/*****************************************************************************
+/*
+ * oahttslf_free_array()
  *
- * external functions
+ * Free an array allocated with oahttslf_new_array() or mapped from a
+ * snapshot file
  *
- *****************************************************************************/
+ * Parameters:
+ *    a - array to free
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf_free_array(oahttslf_array_t *a)
+{
+  if (a->mapped)
+    munmap(a->mem, a->mem_size);
+  else
+    bigmem_free(a->mem, a->mem_size);
+  free((void *)(unsigned long)a->gens);
+#ifdef USE_BOUNDED_PROBES
+  free((void *)(unsigned long)a->reach);
+#endif
+  free((void *)(unsigned long)a->cost);
+  free(a);
+}
 
-volatile oahttslf_entry_t *oahttslf_getent(uint64_t key, bool *vacant);
 
 /*
- * oahttslf_insert()
+ * oahttslf_freshen()
  *
- * Insert a key/value pair into the hashtable, or update the value
- * for existing key.
+ * Make sure a block of buckets is cleared for the current generation,
+ * clearing it ourselves or waiting for another thread that is doing it.
  *
  * Parameters:
- *    key   - key to insert
- *    value - value to insert for the key
- *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
- *                 only for instrumentation
+ *     a - array the block is in
+ *     block - index of the block
  *
  * Return value:
- *    Value for the key prior to the new insertion (OAHTTSLF_EMPTY_VALUE
- *    for a new key)
+ *     None.
  */
-uint64_t oahttslf_insert(uint64_t key, uint64_t value, int thread_id)
+static void oahttslf_freshen(oahttslf_array_t *a, unsigned int block)
 {
-  static const char *funcname = "oahttslf_insert";
-  volatile oahttslf_entry_t *ent;
-  uint64_t entkey, oldvalue;
-  bool vacant;
+  unsigned int gen;
 
-  assert(key != OAHTTSLF_EMPTY_KEY);
-  assert(value != OAHTTSLF_EMPTY_VALUE);
-
-  ent = oahttslf_getent(key, &vacant);
-  if (!ent)
-  {
-    bpa_fatal_error(funcname, "hash table full\n"); /* TODO expand table */
-  }
-  oldvalue = ent->value;
-  entkey = ent->key;
-  if (vacant)
+  while ((gen = ATOMIC_LOAD_ACQUIRE(&a->gens[block])) != a->generation)
   {
-    if (CAS64(&ent->key, OAHTTSLF_EMPTY_KEY, key) != OAHTTSLF_EMPTY_KEY) {
-#ifdef USE_CONTENTION_INSTRUMENT
-      retry_count[thread_id]++;
+    if (gen != OAHTTSLF_GEN_BUSY &&
+        CAS32(&a->gens[block], gen, OAHTTSLF_GEN_BUSY) == gen)
+    {
+      memset(&a->buckets[block * OAHTTSLF_GEN_BLOCK], 0,
+             OAHTTSLF_GEN_BLOCK * sizeof(oahttslf_bucket_t));
+#ifdef USE_BOUNDED_PROBES
+      memset((void *)(unsigned long)&a->reach[block * OAHTTSLF_GEN_BLOCK], 0,
+             OAHTTSLF_GEN_BLOCK * sizeof(uint8_t));
 #endif
-      return oahttslf_insert(key, value, thread_id);  /* tail-recursive call to retry */
+      /* CAS also makes sure the clearing is seen before the generation */
+      (void)CAS32(&a->gens[block], OAHTTSLF_GEN_BUSY, a->generation);
+      return;
     }
+    /* else another thread is clearing it, wait for it to finish */
+  }
+}
 
-    /* in lookup we test for OAHHTSLF_EMPTY_VALUE so if someone looks up 
-       in anothe thread before the value is set here, we return key not found.
-       NB depends on 64-bit atomic writes */
-/*    if (ent->value != OAHTTSLF_EMPTY_VALUE)
-      bpa_error_msg(funcname, "value = %llX\n", ent->value);     
-      */
-/*  __asm__ __volatile__ ("" : : : "memory");  */
 
-    entkey = key ;
+/*
+ * oahttslf_getent()
+ *
+ * Get the slot for a key from one array of the hashtable
+ *
+ * Parameters:
+ *     a - array to search
+ *     key -  key to look up
+ *     slot - (OUT) index in returned bucket of slot for key
+ *     vacant - (OUT) TRUE if reutrn slot for key
+ *                    is not currently occupied by key
+ *     freshen - if TRUE, clear stale blocks so the slot can be
+ *               used (for insert). Else a stale block just ends the
+ *               search with the key not there (for lookup).
+ *  Return value:
+ *     pointer to bucket with slot with key, or for key (but currently
+ *     empty) in array or NULL if neither found within max_probes buckets
+ *     of the home bucket (or, for lookup with USE_BOUNDED_PROBES, within
+ *     the reach of the home bucket)
+ */
+static volatile oahttslf_bucket_t *oahttslf_getent(oahttslf_array_t *a,
+                                                   uint64_t key, int *slot,
+                                                   bool *vacant, bool freshen)
+{
+  unsigned int h;
+  volatile oahttslf_bucket_t *b;
+  unsigned int probes = 0;
+  unsigned int limit = a->max_probes;
+#ifdef USE_BOUNDED_PROBES
+  unsigned int home;
+  uint8_t reach;
+#endif
 
-#ifdef USE_INSTRUMENT
-    key_count[thread_id]++;  /* count new keys only, to get total in table */
+  h = hash_function(a, key);
+#ifdef USE_BOUNDED_PROBES
+  home = h;
+  if (!freshen &&
+      ATOMIC_LOAD_ACQUIRE(&a->gens[h / OAHTTSLF_GEN_BLOCK]) == a->generation)
+    limit = a->reach[home]; /* no key from here is further than this */
 #endif
-  }
-#ifdef DEBUG
-  /*assert(key == ent->key);*/
-  if (key != entkey)
+  for (;;)
   {
-          fprintf(stderr, "OAHTTSLF ASSERTION FAILURE: key=%llX entkey=%llX\n",  key, entkey);
-          exit(1);
-  }
-#endif
-#ifdef ALLOW_UPDATE
-  if (oldvalue == value)  /* shortcut to avoid expense of CAS instruction */
-    return oldvalue;
-  if (CAS64(&ent->value, oldvalue, value) != oldvalue)
-    return oahttslf_insert(key, value, thread_id);  /* tail-recursive call to retry */
-#else
-  ent->value = value;
+    b = &a->buckets[h];
+    if (ATOMIC_LOAD_ACQUIRE(&a->gens[h / OAHTTSLF_GEN_BLOCK]) !=
+        a->generation)
+    {
+      if (!freshen)
+      {
+        *slot = 0;
+        *vacant = TRUE;
+        return b;
+      }
+      oahttslf_freshen(a, h / OAHTTSLF_GEN_BLOCK);
+    }
+    if ((*slot = oahttslf_bucket_find(b, key, vacant)) >= 0)
+    {
+#ifdef USE_BOUNDED_PROBES
+      /* raise the reach before the caller claims the slot, so a lookup
+         can never see the key but not get as far as it */
+      if (freshen && *vacant)
+        while ((reach = a->reach[home]) < probes &&
+               CAS8(&a->reach[home], reach, (uint8_t)probes) != reach)
+          /* another thread changed it, try again */ ;
 #endif
-  return oldvalue;
+      return b;
+    }
+    if (++probes > limit)
+      return NULL;
+    h = (h + OAHTTSLF_PROBE_STEP) & (a->num_buckets - 1); /*SIZE must be 2^n*/
+  }
 }
 
 
-
 /*
- * oahttslf_lookup()
+ * oahttslf_array_lookup()
  *
- * Get the value for a key from the hashtable
+ * Get the value for a key from one array of the hashtable
  *
  * Parameters:
+ *     a - array to search
  *     key -  key to look up
  *     value - (output) value for key,ony set if TRUE returned.
- * * Return value: *      TRUE if key found, FALSE otherwise.
+ *
+ * Return value:
+ *     TRUE if key found, FALSE otherwise.
  */
-bool oahttslf_lookup(uint64_t key, uint64_t *value)
+static bool oahttslf_array_lookup(oahttslf_array_t *a, uint64_t key,
+                                  uint64_t *value)
 {
-  volatile oahttslf_entry_t *ent;
+  volatile oahttslf_bucket_t *b;
+  int slot;
   bool vacant;
   uint64_t val;
 
-  ent = oahttslf_getent(key, &vacant);
-  if (ent)
+  b = oahttslf_getent(a, key, &slot, &vacant, FALSE);
+  if (b && !vacant)
   {
-    val = ent->value;
-    if (!vacant && val != OAHTTSLF_EMPTY_VALUE)
+    /* in lookup we test for OAHHTSLF_EMPTY_VALUE so if someone looks up
+       in anothe thread before the value is set, we return key not found.
+       The acquire pairs with the CAS that set the value */
+    val = ATOMIC_LOAD_ACQUIRE(&b->value[slot]);
+    if (val != OAHTTSLF_EMPTY_VALUE && SLOT_STILL_HAS(a, b, slot, key))
     {
       *value = val;
       return TRUE;
@@ -263,184 +755,1942 @@ bool oahttslf_lookup(uint64_t key, uint64_t *value)
 }
 
 
-
-
 /*
- * oahttslf_getent()
+ * oahttslf_array_prefetch()
  *
- * Get the entry for a key from the hashtable
+ * Start the cache miss for the home bucket of a key in one array
+ * without waiting for it
  *
  * Parameters:
- *     key -  key to look up
- *     vacant - (OUT) TRUE if reutrn pointer to entry for key
- *                    is not currently occupied by key
- *  Return value:
- *     pointer to entry with key, or for key (but currently empty) in hashtable
- *     or NULL if hashtable is full
+ *     a - array the key will be looked up in
+ *     key - key that will be looked up
+ *
+ * Return value:
+ *     None.
  */
-volatile oahttslf_entry_t *oahttslf_getent(uint64_t key, bool *vacant)
+static void oahttslf_array_prefetch(oahttslf_array_t *a, uint64_t key)
 {
-  unsigned int h;
-  volatile oahttslf_entry_t *ent;
-  int probes = 0;
-  uint64_t entkey;
+  unsigned int h = hash_function(a, key);
 
-  h = hash_function(key);
-  ent = &hashtable[h];
-  entkey = ent->key;
-  while (probes < OAHTTSLF_SIZE - 1 && entkey != key && entkey != OAHTTSLF_EMPTY_KEY)
-  {
-    ++probes;
-    h = (h + OAHTTSLF_PROBE_STEP) & (OAHTTSLF_SIZE - 1); /*SIZE must be 2^n*/
-    ent = &hashtable[h];
-    entkey = ent->key;
-  }
-  if (probes >= OAHTTSLF_SIZE - 1)
-    return NULL;
-  else if (entkey == OAHTTSLF_EMPTY_KEY)
-    *vacant = TRUE;
-  else
-    *vacant = FALSE;
-  return ent;
+  OAHTTSLF_PREFETCH(&a->buckets[h]);
+#ifdef USE_BOUNDED_PROBES
+  OAHTTSLF_PREFETCH(&a->reach[h]);
+#endif
 }
 
 
-
-
 /*
- * oahttslf_validate()
+ * oahttslf_key_cost()
  *
- * Test for duplicate keys  -this should not happen
+ * The cost byte for a key in a cache, from the cost function of the table
  *
  * Parameters:
- *    None
+ *    table - cache the key is put in
+ *    key   - key to get the cost of
  *
  * Return value:
- *    0 if duplicate keys found else 1
+ *    cost of key, clamped to 0..OAHTTSLF_MAX_COST
  */
-int oahttslf_validate(void)
+static uint8_t oahttslf_key_cost(oahttslf_t *table, uint64_t key)
 {
+  unsigned int c = table->cost_fn ? table->cost_fn(key) : 0;
 
-  int i,j;
-
-  for (i = 0; i < OAHTTSLF_SIZE; i++)
-    if (hashtable[i].key != OAHTTSLF_EMPTY_KEY)
-      for (j = i + 1; j < OAHTTSLF_SIZE; j++)
-        if (hashtable[j].key == hashtable[i].key)
-          return 0;
-    
-  return 1;
+  return (uint8_t)(c > OAHTTSLF_MAX_COST ? OAHTTSLF_MAX_COST : c);
 }
 
-/* TODO function to free hash table entries */
-
 
 /*
- * oahttslf_printstats()
+ * oahttslf_evict()
  *
- *   Compute and print statistics about the hash table to stdout
+ * Evict a key from the probe window of a key that is not in a full cache
+ * array, and give its slot to the key. The victim is the slot with the
+ * lowest cost (the first one looked at of those with the lowest).
+ * The costs are only a heuristic, so they are read and written without
+ * synchronization.
  *
- *   Parameters: None
- *   Return value: None
+ * Parameters:
+ *    table - hashtable the array belongs to
+ *    a     - cache array to evict from
+ *    key   - key to claim a slot for
+ *    slot  - (OUT) index in returned bucket of slot for key
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    pointer to bucket with slot now claimed for key, or NULL if every
+ *    slot in the window is waiting for its value (or being evicted)
  */
-void oahttslf_printstats(void)
+static volatile oahttslf_bucket_t *oahttslf_evict(oahttslf_t *table,
+                                                  oahttslf_array_t *a,
+                                                  uint64_t key, int *slot,
+                                                  int thread_id)
 {
-  unsigned int num_items=0;
-  int i;
+  unsigned int h, n, i, s, victim = 0;
+  uint64_t k, victimkey;
+  uint8_t c, best;
+  bool found;
+#ifdef USE_BOUNDED_PROBES
+  unsigned int probes = 0;
+  uint8_t reach;
+#endif
 
-  for (i = 0; i < OAHTTSLF_SIZE; i++)
+  for (;;)
   {
-
-    if (hashtable[i].key != OAHTTSLF_EMPTY_KEY)
-      num_items++;
+    found = FALSE;
+    best = 0;
+    victimkey = OAHTTSLF_EMPTY_KEY;
+    h = hash_function(a, key);
+    for (n = 0; n <= a->max_probes; n++)
+    {
+      for (i = 0; i < OAHTTSLF_BUCKET_SLOTS; i++)
+      {
+        s = h * OAHTTSLF_BUCKET_SLOTS + i;
+        k = SLOT_KEY(a, s);
+        if (k == OAHTTSLF_EMPTY_KEY || k == OAHTTSLF_BUSY_KEY ||
+            SLOT_VALUE(a, s) == OAHTTSLF_EMPTY_VALUE)
+          continue; /* only a slot with a value can be evicted */
+        c = a->cost[s];
+        if (!found || c < best)
+        {
+          found = TRUE;
+          best = c;
+          victim = s;
+          victimkey = k;
+#ifdef USE_BOUNDED_PROBES
+          probes = n;
+#endif
+        }
+      }
+      h = (h + OAHTTSLF_PROBE_STEP) & (a->num_buckets - 1);
+    }
+    if (!found)
+      return NULL;
+    if (CAS64(&SLOT_KEY(a, victim), victimkey, OAHTTSLF_BUSY_KEY) ==
+        victimkey)
+      break;
+    /* another thread evicted it first, look again */
+#ifdef USE_CONTENTION_INSTRUMENT
+    SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLF_COUNT_RETRIES);
+#endif
   }
-  printf("num items       : %u (%f%% full)\n", num_items,
-         100.0*(float)num_items/OAHTTSLF_SIZE);
+
+  /* the slot is ours, and no one else writes a value that has a key */
+  SLOT_VALUE(a, victim) = OAHTTSLF_EMPTY_VALUE;
+  a->cost[victim] = oahttslf_key_cost(table, key);
+#ifdef USE_BOUNDED_PROBES
+  h = hash_function(a, key);
+  while ((reach = a->reach[h]) < probes &&
+         CAS8(&a->reach[h], reach, (uint8_t)probes) != reach)
+    /* another thread changed it, try again */ ;
+#endif
+  /* CAS also makes sure the empty value is seen before the key */
+  (void)CAS64(&SLOT_KEY(a, victim), OAHTTSLF_BUSY_KEY, key);
+#ifdef USE_INSTRUMENT
+  SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLF_COUNT_EVICTIONS);
+#endif
+  *slot = victim % OAHTTSLF_BUCKET_SLOTS;
+  return &a->buckets[victim / OAHTTSLF_BUCKET_SLOTS];
 }
 
+
 /*
- * oahttslf_reset()
- * 
- * reset all the table entries to empty
+ * oahttslf_claim()
  *
- * Parameters: None
- * Return value: None
+ * Find the slot for a key in one array of the hashtable, claiming an
+ * empty one for it if the key is not there.
+ *
+ * In a cache array, a key is evicted to make room if there is none.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to
+ *    a     - array to claim slot in
+ *    key   - key to claim slot for
+ *    slot  - (OUT) index in returned bucket of slot with key
+ *    newkey - (OUT) TRUE if we claimed a slot for a key not in the array
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
  *
+ * Return value:
+ *    pointer to bucket with slot with key, or NULL if no slot for key
+ *    within max_probes (caller must grow the table).
  */
-void oahttslf_reset(void)
+static volatile oahttslf_bucket_t *oahttslf_claim(oahttslf_t *table,
+                                                  oahttslf_array_t *a,
+                                                  uint64_t key, int *slot,
+                                                  bool *newkey, int thread_id)
 {
-#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
-  int i;
-#endif
-  assert(0 == OAHTTSLF_EMPTY_KEY);
-  assert(0 == OAHTTSLF_EMPTY_VALUE);
-  memset(hashtable, 0, sizeof(hashtable));
-#ifdef USE_INSTRUMENT
-  for (i = 0; i < MAX_NUM_THREADS; i++)
-    key_count[i] = 0;
-#endif
+  volatile oahttslf_bucket_t *b;
+  bool vacant;
+
+  *newkey = FALSE;
+  for (;;)
+  {
+    b = oahttslf_getent(a, key, slot, &vacant, TRUE);
+    if (!b)
+    {
+      if (!a->cost || !(b = oahttslf_evict(table, a, key, slot, thread_id)))
+        return NULL;
+      *newkey = TRUE;
+      break;
+    }
+    if (!vacant)
+      break;
+    if (CAS64(&b->key[*slot], OAHTTSLF_EMPTY_KEY, key) == OAHTTSLF_EMPTY_KEY)
+    {
+      if (a->cost)
+        a->cost[(unsigned int)(b - (volatile oahttslf_bucket_t *)a->buckets)
+                * OAHTTSLF_BUCKET_SLOTS + *slot] = oahttslf_key_cost(table,
+                                                                     key);
+      *newkey = TRUE;
+      break;
+    }
 #ifdef USE_CONTENTION_INSTRUMENT
-  for (i = 0; i < MAX_NUM_THREADS; i++)
-    retry_count[i] = 0;
+    SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLF_COUNT_RETRIES);
 #endif
-}
+  }
 
+#ifdef DEBUG
+  /*assert(key == ent->key);*/
+  if (!a->cost && key != b->key[*slot]) /* a cache can evict it already */
+  {
+          fprintf(stderr, "OAHTTSLF ASSERTION FAILURE: key=%llX entkey=%llX\n",  key, b->key[*slot]);
+          exit(1);
+  }
+#endif
+  return b;
+}
 
 
 /*
- * oahttslf_num_entries()
+ * oahttslf_set_value()
  *
- *   count number of keys in the hash table
- *   WARNING: may be very slow - iterates thriough whole table; we do
- *   not have a counter.
+ * Set the value of a claimed slot.
  *
- *   Parameters: None
- *   Return value: None
+ * The value is always set with CAS (even when it is empty) so that it
+ * is ordered before we check the next pointer in oahttslf_put_all().
+ * A failed weak CAS gives us the value now there to decide on again.
+ * For max/min this retries until either our value is in or one that
+ * beats it is, so concurrent contributions are never lost. A tombstone
+ * is replaced as if the slot had no value, except by the migration.
+ *
+ * Parameters:
+ *    valuep - value of the slot
+ *    value - value to set
+ *    mode  - what to do if the slot already has a value
+ *
+ * Return value:
+ *    value of the slot before (OAHTTSLF_EMPTY_VALUE if none)
  */
-unsigned int oahttslf_num_entries()
+static uint64_t oahttslf_set_value(volatile uint64_t *valuep, uint64_t value,
+                                   oahttslf_putmode_t mode)
 {
-  unsigned int num_items=0;
-  int i;
+  uint64_t oldval = ATOMIC_LOAD_ACQUIRE(valuep);
 
-  for (i = 0; i < OAHTTSLF_SIZE; i++)
+  do
   {
-
-    if (hashtable[i].key != OAHTTSLF_EMPTY_KEY)
-      num_items++;
+    if (oldval != OAHTTSLF_EMPTY_VALUE &&
+        (oldval != OAHTTSLF_DELETED_VALUE || mode == OAHTTSLF_PUT_MIGRATE) &&
+        !OAHTTSLF_REPLACES(mode, value, oldval))
+      break;  /* shortcut to avoid expense of CAS instruction */
   }
-  return num_items;
+  while (!CAS64_WEAK(valuep, &oldval, value));
+  return oldval;
 }
 
-#ifdef USE_INSTRUMENT
+
 /*
- *  add up the per-thread key counters and return total
- * Parameters: None
- * Return value: Total number of keys in the hash table
+ * oahttslf_put()
+ *
+ * Put a key/value pair into one array of the hashtable.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to (for instrumentation only)
+ *    a     - array to insert into
+ *    key   - key to insert
+ *    value - value to insert for the key
+ *    mode  - what to do if the key already has a value: leave it,
+ *            overwrite it, or keep the max or min of it and value
+ *    oldvalue - (OUT) value of key in this array before the put
+ *               (OAHTTSLF_EMPTY_VALUE if none)
+ *    newkey - (OUT) TRUE if we claimed a slot for a key not in the array
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * In a cache array, the value of a key already there is left as it is
+ * (see comments at top of file).
+ *
+ * Return value:
+ *    TRUE if done, FALSE if no slot for key within max_probes (caller
+ *    must grow the table, or for a cache, drop the key).
+ */
+static bool oahttslf_put(oahttslf_t *table, oahttslf_array_t *a,
+                         uint64_t key, uint64_t value,
+                         oahttslf_putmode_t mode, uint64_t *oldvalue, bool *newkey, int thread_id)
+{
+  volatile oahttslf_bucket_t *b;
+  int slot;
+
+  if (!(b = oahttslf_claim(table, a, key, &slot, newkey, thread_id)))
+    return FALSE;
+  if (a->cost && !*newkey)
+  {
+    *oldvalue = ATOMIC_LOAD_ACQUIRE(&b->value[slot]);
+    if (!SLOT_STILL_HAS(a, b, slot, key))
+      *oldvalue = OAHTTSLF_EMPTY_VALUE;
+    return TRUE;
+  }
+  *oldvalue = oahttslf_set_value(&b->value[slot], value, mode);
+  return TRUE;
+}
+
+
+/*
+ * oahttslf_grow()
+ *
+ * Make sure array a has a successor, allocating it if necessary. If
+ * several threads do this at once, only one array is installed and the
+ * others are freed.
+ *
+ * Parameters:
+ *    a - array that has no room for a key
+ *
+ * Return value:
+ *    The array following a.
+ */
+static oahttslf_array_t *oahttslf_grow(oahttslf_array_t *a)
+{
+  static const char *funcname = "oahttslf_grow";
+  oahttslf_array_t *newa;
+
+  if (!a->next)
+  {
+    if (a->size >= OAHTTSLF_GROW_LIMIT)
+      bpa_fatal_error(funcname, "hash table full\n");
+    newa = oahttslf_new_array(a->size * 2, a->generation);
+    if (CASPTR(&a->next, (oahttslf_array_t *)NULL, newa) != NULL)
+      oahttslf_free_array(newa); /* another thread beat us to it */
+  }
+  return a->next;
+}
+
+
+/*
+ * oahttslf_copy_slot()
+ *
+ * Copy one slot of an array being migrated into the newer arrays, unless
+ * the key is already there (even deleted), or is deleted in this one.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to
+ *    a     - array being migrated
+ *    i     - index of slot in a to copy
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf_copy_slot(oahttslf_t *table, oahttslf_array_t *a,
+                               unsigned int i, int thread_id)
+{
+  oahttslf_array_t *b;
+  uint64_t key, value, oldvalue;
+  bool newkey;
+
+  if (!SLOT_FRESH(a, i))
+    return; /* stale, or being cleared so nothing put there yet */
+  key = SLOT_KEY(a, i);
+  if (key == OAHTTSLF_EMPTY_KEY)
+    return;
+  value = ATOMIC_LOAD_SEQ_CST(&SLOT_VALUE(a, i));
+  if (value == OAHTTSLF_EMPTY_VALUE)
+    return; /* insert in progress: the inserter will see a->next and copy */
+  if (value == OAHTTSLF_DELETED_VALUE)
+    return; /* the tombstone is compacted away. Any older value of the key
+               was already migrated into this array, under it */
+
+  b = a->next;
+  for (;;)
+  {
+    if (!oahttslf_put(table, b, key, value, OAHTTSLF_PUT_MIGRATE,
+                      &oldvalue, &newkey, thread_id))
+    {
+      b = oahttslf_grow(b);
+      continue;
+    }
+    /* if the key was already in b, whoever put it there is responsible
+       for it reaching any newer array */
+    if (oldvalue != OAHTTSLF_EMPTY_VALUE || !b->next)
+      break;
+    b = b->next;
+  }
+}
+
+
+/*
+ * oahttslf_help_migrate()
+ *
+ * If the oldest array is being migrated, claim a chunk of it and copy
+ * it. The thread that finishes the last chunk moves the current pointer
+ * on so that lookups no longer need to look there.
+ *
+ * Parameters:
+ *    table - hashtable to help migrate
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf_help_migrate(oahttslf_t *table, int thread_id)
+{
+  oahttslf_array_t *a = CURRENT_ARRAY(table);
+  unsigned int start, end, i;
+
+  if (!NEXT_ARRAY(a) || a->copy_idx >= a->size)
+    return;
+  start = ATOMIC_ADD_32_NV_RELAXED(&a->copy_idx, OAHTTSLF_COPY_CHUNK)
+          - OAHTTSLF_COPY_CHUNK;
+  if (start >= a->size)
+    return;
+  end = (a->size - start < OAHTTSLF_COPY_CHUNK ? a->size :
+         start + OAHTTSLF_COPY_CHUNK);
+  for (i = start; i < end; i++)
+    oahttslf_copy_slot(table, a, i, thread_id);
+
+  if (ATOMIC_ADD_32_NV(&a->copy_done, end - start) == a->size)
+  {
+    while ((a = table->current)->next && a->copy_done == a->size)
+      (void)CASPTR(&table->current, a, a->next);
+  }
+}
+
+
+
+/*
+ * oahttslf_put_all()
+ *
+ * Put a key/value pair into the hashtable: into the newest array, and
+ * again into any newer array that appears while we are doing it.
+ *
+ * For max/min, what is repeated in a newer array is the value our put
+ * left in the slot, not our own value, since the key may already be in
+ * the newer array (so the copy would skip it) with a worse value than a
+ * thread before us left in the older one. And if the key was only in
+ * an older array not yet migrated, its value there is combined in too.
+ * A tombstone counts as no value, for the old value as for max/min.
+ *
+ * Parameters:
+ *    table - hashtable to insert into
+ *    key   - key to insert
+ *    value - value to insert for the key
+ *    mode  - what to do if the key already has a value
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    Value for the key prior to the new insertion (OAHTTSLF_EMPTY_VALUE
+ *    for a new or deleted key)
+ */
+static uint64_t oahttslf_put_all(oahttslf_t *table, uint64_t key,
+                                 uint64_t value, oahttslf_putmode_t mode,
+                                 int thread_id)
+{
+  const bool combining = (mode == OAHTTSLF_PUT_MAX || mode == OAHTTSLF_PUT_MIN);
+  oahttslf_array_t *start, *a, *b;
+  uint64_t oldvalue = OAHTTSLF_EMPTY_VALUE, prevvalue;
+  bool newkey, first = TRUE;
+
+  assert(key != OAHTTSLF_EMPTY_KEY);
+  assert(value != OAHTTSLF_EMPTY_VALUE);
+  assert(key != OAHTTSLF_BUSY_KEY || !table->current->cost);
+
+  oahttslf_help_migrate(table, thread_id);
+
+  start = CURRENT_ARRAY(table);
+  for (a = start; NEXT_ARRAY(a); a = a->next)
+    /* new keys always go in the newest array */ ;
+
+  for (;;)
+  {
+    if (!oahttslf_put(table, a, key, value, mode, &prevvalue, &newkey,
+                      thread_id))
+    {
+      if (a->cost)
+        break; /* a cache never grows: nothing to evict, so drop it */
+      a = oahttslf_grow(a);
+      continue;
+    }
+    if (combining && OAHTTSLF_IS_VALUE(prevvalue) &&
+        !OAHTTSLF_REPLACES(mode, value, prevvalue))
+      value = prevvalue; /* what is in the slot now */
+    if (first)
+    {
+      first = FALSE;
+      oldvalue = prevvalue;
+      if (oldvalue == OAHTTSLF_EMPTY_VALUE)
+      {
+        /* key may still be in an older array that is not migrated yet */
+        for (b = start; b != a; b = b->next)
+          if (oahttslf_array_lookup(b, key, &prevvalue))
+            oldvalue = prevvalue;
+      }
+#ifdef USE_INSTRUMENT
+      /* count new keys only, to get total in table. This can overcount
+         if the same key is inserted by two threads during migration */
+      if (newkey && oldvalue == OAHTTSLF_EMPTY_VALUE)
+        SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLF_COUNT_KEYS);
+#endif
+      if (combining && OAHTTSLF_IS_VALUE(oldvalue) &&
+          !OAHTTSLF_REPLACES(mode, value, oldvalue))
+      {
+        /* the migration will not copy the older value over ours */
+        value = oldvalue;
+        continue;
+      }
+    }
+    /* if a newer array appeared while we were writing, the migration
+       may already have passed our slot, so repeat the write there */
+    if (!ATOMIC_LOAD_SEQ_CST(&a->next))
+      break;
+    a = a->next;
+  }
+  return OAHTTSLF_IS_VALUE(oldvalue) ? oldvalue : OAHTTSLF_EMPTY_VALUE;
+}
+
+
+
+/*
+ * oahttslf_save_entry()
+ *
+ * Put one entry of the table being saved into the file (or compacted
+ * into a new array), unless the predicate picks it to leave out, as the
+ * callback for oahttslf_foreach_part()
+ *
+ * Parameters:
+ *    key   - key of entry
+ *    value - value of entry
+ *    arg   - pointer to oahttslf_save_part_t of this thread
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf_save_entry(uint64_t key, uint64_t value, void *arg)
+{
+  oahttslf_save_part_t *part = (oahttslf_save_part_t *)arg;
+  uint64_t oldvalue;
+  bool newkey;
+
+  if (part->full)
+    return; /* starting again with a bigger file anyway */
+  if (part->pred && part->pred(key, value, part->pred_arg))
+  {
+    part->num_removed++;
+    return;
+  }
+  if (!part->file)
+    part->num_entries++; /* just counting */
+  else if (!oahttslf_put(part->table, part->file, key, value,
+                    OAHTTSLF_PUT_IFABSENT, &oldvalue, &newkey,
+                    part->thread_id))
+    part->full = TRUE;
+  else if (newkey)
+    part->num_entries++;
+}
+
+
+/*
+ * oahttslf_save_thread()
+ *
+ * Thread to put one part of the table being saved into the file
+ *
+ * Parameters:
+ *    threadarg - pointer to oahttslf_save_part_t for the part
+ *
+ * Return value:
+ *    NULL
+ */
+static void *oahttslf_save_thread(void *threadarg)
+{
+  oahttslf_save_part_t *part = (oahttslf_save_part_t *)threadarg;
+
+  (void)oahttslf_foreach_part(part->table, part->part, part->num_parts,
+                              oahttslf_save_entry, part);
+  return NULL;
+}
+
+
+/*
+ * oahttslf_save_parts()
+ *
+ * Put all the entries of the table into one array (a snapshot file or
+ * a new array to compact into), with num_threads threads each doing a
+ * part of the table
+ *
+ * Parameters:
+ *    table - hashtable to save
+ *    file  - array to put the entries in, or NULL just to count them
+ *    pred  - keys to leave out, or NULL for none
+ *    pred_arg - passed to pred
+ *    num_threads - number of threads to use (1..MAX_NUM_THREADS)
+ *    num_entries - (OUT) number of keys put in file
+ *    num_removed - (OUT) number of keys pred left out
+ *
+ * Return value:
+ *    TRUE if a key did not fit in file (so it must be done again bigger)
+ */
+static bool oahttslf_save_parts(oahttslf_t *table, oahttslf_array_t *file,
+                                oahttslf_key_pred_t pred, void *pred_arg,
+                                int num_threads, uint64_t *num_entries,
+                                uint64_t *num_removed)
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  oahttslf_save_part_t parts[MAX_NUM_THREADS];
+  bool started[MAX_NUM_THREADS];
+  bool full = FALSE;
+  int t;
+
+  if (num_threads < 1)
+    num_threads = 1;
+  else if (num_threads > MAX_NUM_THREADS)
+    num_threads = MAX_NUM_THREADS;
+
+  for (t = 0; t < num_threads; t++)
+  {
+    parts[t].table = table;
+    parts[t].file = file;
+    parts[t].part = t;
+    parts[t].num_parts = num_threads;
+    parts[t].thread_id = t;
+    parts[t].pred = pred;
+    parts[t].pred_arg = pred_arg;
+    parts[t].num_entries = 0;
+    parts[t].num_removed = 0;
+    parts[t].full = FALSE;
+    started[t] = (num_threads > 1 &&
+                  pthread_create(&threads[t], NULL, oahttslf_save_thread,
+                                 &parts[t]) == 0);
+    if (!started[t])
+      oahttslf_save_thread(&parts[t]); /* do it ourselves then */
+  }
+  *num_entries = 0;
+  *num_removed = 0;
+  for (t = 0; t < num_threads; t++)
+  {
+    if (started[t])
+      pthread_join(threads[t], NULL);
+    full = full || parts[t].full;
+    *num_entries += parts[t].num_entries;
+    *num_removed += parts[t].num_removed;
+  }
+  return full;
+}
+
+
+/*
+ * oahttslf_add_cluster()
+ *
+ * Count a run of occupied buckets in the cluster statistics
+ *
+ * Parameters:
+ *    part - statistics to add it to
+ *    len  - number of buckets in the run (nothing is counted if 0)
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf_add_cluster(oahttslf_scan_part_t *part, unsigned int len)
+{
+  if (len == 0)
+    return;
+  part->num_clusters++;
+  part->cluster_total += len;
+  if (len > part->max_cluster)
+    part->max_cluster = len;
+}
+
+
+/*
+ * oahttslf_scan_thread()
+ *
+ * Thread to check and count the keys in one part of an array. Each key
+ * must be the one a lookup finds, starting from its home bucket: if
+ * it is not, there is a duplicate of it nearer home, an empty slot
+ * before it or it is too far from home. This only looks at the few
+ * buckets between the home bucket and the key, so it is linear in the
+ * size of the array, and mostly reads memory that is already in cache.
+ * A cache can legitimately have a key twice (see comments at top of
+ * file), so there only the first one has to be found.
+ *
+ * Parameters:
+ *    threadarg - pointer to oahttslf_scan_part_t for the part
+ *
+ * Return value:
+ *    NULL
+ */
+static void *oahttslf_scan_thread(void *threadarg)
+{
+  oahttslf_scan_part_t *part = (oahttslf_scan_part_t *)threadarg;
+  oahttslf_array_t *a = part->array;
+  volatile oahttslf_bucket_t *b, *found;
+  unsigned int h, dist, run = 0;
+  bool gap = FALSE, vacant;
+  uint64_t key;
+  int s, slot;
+
+  for (h = part->start; h < part->end; h++)
+  {
+    b = &a->buckets[h];
+    if (a->gens[h / OAHTTSLF_GEN_BLOCK] != a->generation ||
+        b->key[0] == OAHTTSLF_EMPTY_KEY)
+    {
+      if (gap)
+        oahttslf_add_cluster(part, run);
+      else
+        part->head = run; /* continues the run at the end of the last part */
+      gap = TRUE;
+      run = 0;
+      continue;
+    }
+    run++;
+    for (s = 0; s < OAHTTSLF_BUCKET_SLOTS &&
+           (key = b->key[s]) != OAHTTSLF_EMPTY_KEY; s++)
+    {
+      part->num_items++;
+      if (b->value[s] == OAHTTSLF_DELETED_VALUE)
+        part->num_deleted++;
+      else if (b->value[s] != OAHTTSLF_EMPTY_VALUE)
+        part->num_values++;
+      dist = (h - hash_function(a, key)) & (a->num_buckets - 1);
+      part->hist[dist > OAHTTSLF_MAX_PROBES ? OAHTTSLF_MAX_PROBES : dist]++;
+      found = oahttslf_getent(a, key, &slot, &vacant, FALSE);
+      if (!found || vacant || (!a->cost && (found != b || slot != s)))
+        part->bad = TRUE;
+    }
+    for (; s < OAHTTSLF_BUCKET_SLOTS; s++)
+      if (b->key[s] != OAHTTSLF_EMPTY_KEY)
+        part->bad = TRUE; /* a key after an empty slot is never found */
+  }
+  if (!gap)
+    part->head = run;
+  part->tail = run;
+  return NULL;
+}
+
+
+/*
+ * oahttslf_scan()
+ *
+ * Check and count the keys in one array of a table, with num_threads
+ * threads each doing an equal part of it. The table should not be
+ * changed while this is running.
+ *
+ * Parameters:
+ *    table - table the array is in
+ *    a     - array to scan
+ *    num_threads - number of threads to use (1..MAX_NUM_THREADS)
+ *    total - (OUT) statistics of the whole array
+ *
+ * Return value:
+ *    TRUE if every key is found in its own slot else FALSE
+ */
+static bool oahttslf_scan(oahttslf_t *table, oahttslf_array_t *a,
+                          int num_threads, oahttslf_scan_part_t *total)
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  bool started[MAX_NUM_THREADS];
+  oahttslf_scan_part_t *parts, *part;
+  unsigned int carry = 0, first_head = 0, dist;
+  bool first = TRUE;
+  int t;
+
+  if (num_threads < 1)
+    num_threads = 1;
+  else if (num_threads > MAX_NUM_THREADS)
+    num_threads = MAX_NUM_THREADS;
+
+  parts = (oahttslf_scan_part_t *)bpa_calloc(num_threads,
+                                             sizeof(oahttslf_scan_part_t));
+  for (t = 0; t < num_threads; t++)
+  {
+    parts[t].table = table;
+    parts[t].array = a;
+    parts[t].start = (unsigned int)((uint64_t)a->num_buckets * t /
+                                    num_threads);
+    parts[t].end = (unsigned int)((uint64_t)a->num_buckets * (t + 1) /
+                                  num_threads);
+    started[t] = (num_threads > 1 &&
+                  pthread_create(&threads[t], NULL, oahttslf_scan_thread,
+                                 &parts[t]) == 0);
+    if (!started[t])
+      oahttslf_scan_thread(&parts[t]); /* do it ourselves then */
+  }
+
+  /* add up the parts in order, joining the runs of occupied buckets
+     that cross from one part into the next, and from the end of the
+     array round to the start */
+  memset(total, 0, sizeof(oahttslf_scan_part_t));
+  total->table = table;
+  total->array = a;
+  total->end = a->num_buckets;
+  for (t = 0; t < num_threads; t++)
+  {
+    if (started[t])
+      pthread_join(threads[t], NULL);
+    part = &parts[t];
+    total->bad = total->bad || part->bad;
+    total->num_items += part->num_items;
+    total->num_values += part->num_values;
+    total->num_deleted += part->num_deleted;
+    for (dist = 0; dist <= OAHTTSLF_MAX_PROBES; dist++)
+      total->hist[dist] += part->hist[dist];
+    if (part->head == part->end - part->start)
+    {
+      carry += part->head; /* whole part occupied */
+      continue;
+    }
+    if (first)
+      first_head = carry + part->head; /* joins the run at the end */
+    else
+      oahttslf_add_cluster(total, carry + part->head);
+    first = FALSE;
+    total->num_clusters += part->num_clusters;
+    total->cluster_total += part->cluster_total;
+    if (part->max_cluster > total->max_cluster)
+      total->max_cluster = part->max_cluster;
+    carry = part->tail;
+  }
+  oahttslf_add_cluster(total, carry + first_head);
+  free(parts);
+  return !total->bad;
+}
+
+
+
+/*****************************************************************************
+ *
+ * external functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * oahttslf_create()
+ *
+ * Allocate a new empty hashtable. The initial size is the smallest power
+ * of 2 that keeps the table at most half full with max_keys keys in it,
+ * clamped to [OAHTTSLF_MIN_SIZE, OAHTTSLF_MAX_SIZE]. Since the caller
+ * usually only has an upper bound on the number of keys (e.g. the size
+ * of the d.p. matrix) the upper limit stops us allocating huge tables
+ * that would never be filled; the table grows if it does fill up.
+ *
+ * Parameters:
+ *    max_keys - (estimate of) the maximum number of keys to be inserted
+ *
+ * Return value:
+ *    Pointer to new hashtable. Exits with error if out of memory.
+ */
+oahttslf_t *oahttslf_create(uint64_t max_keys)
+{
+  oahttslf_t *table;
+  uint64_t size = OAHTTSLF_MIN_SIZE;
+
+  while (size < OAHTTSLF_MAX_SIZE && size < 2 * max_keys)
+    size <<= 1;
+  table = (oahttslf_t *)bpa_calloc(1, sizeof(oahttslf_t));
+  table->first = table->current = oahttslf_new_array((unsigned int)size, 1);
+  return table;
+}
+
+
+/*
+ * oahttslf_cache_slots()
+ *
+ * The number of keys a cache made by oahttslf_create_cache() in
+ * max_bytes bytes can hold: the biggest power of 2 slots that fit (each
+ * slot is 16 bytes and a cost byte), but at least OAHTTSLF_MIN_SIZE.
+ *
+ * Parameters:
+ *    max_bytes - memory to use for the table
+ *
+ * Return value:
+ *    number of slots in the cache
+ */
+uint64_t oahttslf_cache_slots(uint64_t max_bytes)
+{
+  const uint64_t slot_bytes = sizeof(uint64_t) * 2 + sizeof(uint8_t);
+  uint64_t size = OAHTTSLF_MIN_SIZE;
+
+  while (size < OAHTTSLF_GROW_LIMIT && 2 * size * slot_bytes <= max_bytes)
+    size <<= 1;
+  return size;
+}
+
+
+/*
+ * oahttslf_create_cache()
+ *
+ * Allocate a new empty hashtable that is a lossy memo cache in at most
+ * max_bytes bytes (see comments at top of file). It has
+ * oahttslf_cache_slots(max_bytes) slots and never grows: when it is
+ * full, putting a new key evicts one.
+ *
+ * Parameters:
+ *    max_bytes - memory to use for the table
+ *    cost_fn - cost of computing the value of a key again, higher
+ *              is kept longer. If NULL all keys cost the same.
+ *
+ * Return value:
+ *    Pointer to new hashtable. Exits with error if out of memory.
+ */
+oahttslf_t *oahttslf_create_cache(uint64_t max_bytes,
+                                  oahttslf_cost_fn_t cost_fn)
+{
+  oahttslf_t *table;
+  oahttslf_array_t *a;
+  uint64_t size = oahttslf_cache_slots(max_bytes);
+
+  table = (oahttslf_t *)bpa_calloc(1, sizeof(oahttslf_t));
+  table->cost_fn = cost_fn;
+  a = oahttslf_new_array((unsigned int)size, 1);
+  a->cost = (uint8_t *)bpa_calloc(a->size, sizeof(uint8_t));
+  if (a->max_probes > OAHTTSLF_CACHE_PROBES)
+    a->max_probes = OAHTTSLF_CACHE_PROBES;
+  table->first = table->current = a;
+  return table;
+}
+
+
+/*
+ * oahttslf_destroy()
+ *
+ * Free all memory used by a hashtable created with oahttslf_create()
+ *
+ * Parameters:
+ *    table - hashtable to free
+ *
+ * Return value:
+ *    None.
+ */
+void oahttslf_destroy(oahttslf_t *table)
+{
+  oahttslf_array_t *a, *next;
+
+  for (a = table->first; a; a = next)
+  {
+    next = a->next;
+    oahttslf_free_array(a);
+  }
+  free(table);
+}
+
+
+/*
+ * oahttslf_insert()
+ *
+ * Insert a key/value pair into the hashtable, or update the value
+ * for existing key.
+ *
+ * Parameters:
+ *    table - hashtable to insert into
+ *    key   - key to insert
+ *    value - value to insert for the key
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    Value for the key prior to the new insertion (OAHTTSLF_EMPTY_VALUE
+ *    for a new key)
+ */
+uint64_t oahttslf_insert(oahttslf_t *table, uint64_t key, uint64_t value,
+                         int thread_id)
+{
+#ifdef ALLOW_UPDATE
+  return oahttslf_put_all(table, key, value, OAHTTSLF_PUT_OVERWRITE,
+                          thread_id);
+#else
+  return oahttslf_put_all(table, key, value, OAHTTSLF_PUT_IFABSENT,
+                          thread_id);
+#endif
+}
+
+
+/*
+ * oahttslf_insert_max()
+ *
+ * Insert a key/value pair into the hashtable, or if the key is already
+ * there, set its value to the greater of the old and new values. Values
+ * are compared as signed 64 bit integers. Any number of threads may do
+ * this for the same key at once (e.g. each contributing a partial
+ * maximum) and the table ends up with the maximum of all of them.
+ *
+ * Parameters:
+ *    table - hashtable to insert into
+ *    key   - key to insert
+ *    value - value to combine into the value for the key
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    Value for the key prior to the new insertion (OAHTTSLF_EMPTY_VALUE
+ *    for a new key)
+ */
+uint64_t oahttslf_insert_max(oahttslf_t *table, uint64_t key, uint64_t value,
+                             int thread_id)
+{
+  return oahttslf_put_all(table, key, value, OAHTTSLF_PUT_MAX, thread_id);
+}
+
+
+/*
+ * oahttslf_insert_min()
+ *
+ * Insert a key/value pair into the hashtable, or if the key is already
+ * there, set its value to the lesser of the old and new values. Values
+ * are compared as signed 64 bit integers. As for oahttslf_insert_max().
+ *
+ * Parameters:
+ *    table - hashtable to insert into
+ *    key   - key to insert
+ *    value - value to combine into the value for the key
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    Value for the key prior to the new insertion (OAHTTSLF_EMPTY_VALUE
+ *    for a new key)
+ */
+uint64_t oahttslf_insert_min(oahttslf_t *table, uint64_t key, uint64_t value,
+                             int thread_id)
+{
+  return oahttslf_put_all(table, key, value, OAHTTSLF_PUT_MIN, thread_id);
+}
+
+
+/*
+ * oahttslf_delete()
+ *
+ * Remove a key from the hashtable, by giving it a tombstone (see
+ * comments at top of file). Its slot is only reclaimed when the table
+ * grows or is compacted. Not for a cache.
+ *
+ * Parameters:
+ *    table - hashtable to delete from
+ *    key   - key to delete
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    TRUE if the key had a value, FALSE if it was not there (or deleted)
+ */
+bool oahttslf_delete(oahttslf_t *table, uint64_t key, int thread_id)
+{
+  uint64_t value;
+
+  assert(!table->current->cost);
+  if (!oahttslf_lookup(table, key, &value))
+    return FALSE; /* no need to put a tombstone for it */
+  return oahttslf_put_all(table, key, OAHTTSLF_DELETED_VALUE,
+                          OAHTTSLF_PUT_OVERWRITE, thread_id) !=
+         OAHTTSLF_EMPTY_VALUE;
+}
+
+
+
+/*
+ * oahttslf_find_or_claim()
+ *
+ * Get the value for a key from the hashtable, or if it has none, claim
+ * a slot for it in the newest array and return a handle to the slot.
+ * The value is then given with oahttslf_publish(), which need not probe
+ * for the key again. Until then lookups of the key do not find it, but
+ * oahttslf_lookup_state() and this function report it as pending, so
+ * other threads can do something else while it is computed. A thread
+ * that finds the key pending also gets a handle to the slot, so it can
+ * compute and publish the value itself rather than wait.
+ *
+ * A claim is not copied when the table grows, so a key claimed in an
+ * array that is then migrated can be claimed again in the new one.
+ * A deleted key is claimed again, but other threads see it as absent,
+ * not pending, until it is published.
+ * In a cache, only the thread that claimed the key can publish it: the
+ * handle of a pending key has no slot, nor does the handle of a key that
+ * found no slot to evict, and publishing a handle with no slot does
+ * nothing.
+ *
+ * Parameters:
+ *     table - hashtable to search
+ *     key -  key to look up
+ *     value - (output) value for key, only set if OAHTTSLF_FOUND returned.
+ *     handle - (output) slot for key, set unless OAHTTSLF_FOUND returned.
+ *              Only valid until the table is reset.
+ *     thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *     OAHTTSLF_FOUND if key has a value, else OAHTTSLF_CLAIMED if we
+ *     claimed it or OAHTTSLF_PENDING if another thread already had.
+ */
+oahttslf_state_t oahttslf_find_or_claim(oahttslf_t *table, uint64_t key,
+                                        uint64_t *value,
+                                        oahttslf_handle_t *handle,
+                                        int thread_id)
+{
+  oahttslf_array_t *a;
+  volatile oahttslf_bucket_t *b;
+  uint64_t val = OAHTTSLF_EMPTY_VALUE;
+  int slot;
+  bool newkey;
+
+  assert(key != OAHTTSLF_EMPTY_KEY);
+  assert(key != OAHTTSLF_BUSY_KEY || !table->current->cost);
+
+  oahttslf_help_migrate(table, thread_id);
+
+  /* the newest array that has the key has the latest value */
+  for (a = CURRENT_ARRAY(table); NEXT_ARRAY(a); a = a->next)
+    (void)oahttslf_array_lookup(a, key, &val);
+  if (val != OAHTTSLF_EMPTY_VALUE)
+  {
+    (void)oahttslf_array_lookup(a, key, &val);
+    if (val != OAHTTSLF_DELETED_VALUE)
+    {
+      *value = val;
+      return OAHTTSLF_FOUND;
+    }
+  }
+
+  /* in the newest array, the probe that finds the key is the one that
+     claims a slot for it if it is not there */
+  handle->array = a;
+  handle->value = NULL;
+  handle->key = key;
+  while (!(b = oahttslf_claim(table, a, key, &slot, &newkey, thread_id)))
+  {
+    if (a->cost)
+      return OAHTTSLF_CLAIMED; /* full cache: compute it but do not keep it */
+    a = oahttslf_grow(a);
+  }
+  if (!newkey &&
+      (val = ATOMIC_LOAD_ACQUIRE(&b->value[slot])) != OAHTTSLF_EMPTY_VALUE)
+  {
+    if (!SLOT_STILL_HAS(a, b, slot, key))
+      return OAHTTSLF_CLAIMED; /* just evicted, as for a full cache */
+    if (val != OAHTTSLF_DELETED_VALUE)
+    {
+      *value = val;
+      return OAHTTSLF_FOUND;
+    }
+    /* deleted: the publish replaces the tombstone */
+    handle->array = a;
+    handle->value = &b->value[slot];
+    return OAHTTSLF_CLAIMED;
+  }
+#ifdef USE_INSTRUMENT
+  if (newkey)
+    SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLF_COUNT_KEYS);
+#endif
+  handle->array = a;
+  if (newkey || !a->cost)
+    handle->value = &b->value[slot];
+  return newkey ? OAHTTSLF_CLAIMED : OAHTTSLF_PENDING;
+}
+
+
+/*
+ * oahttslf_find_or_reserve()
+ *
+ * Get the value for a key from the hashtable, or if it has none, reserve
+ * a slot for it to be given its value by oahttslf_publish(). This is
+ * oahttslf_find_or_claim() for callers that compute the value the same
+ * way whether or not another thread has claimed the key.
+ *
+ * Parameters:
+ *     table - hashtable to search
+ *     key -  key to look up
+ *     value - (output) value for key, only set if TRUE returned.
+ *     handle - (output) slot reserved for key, only set if FALSE
+ *              returned. Only valid until the table is reset.
+ *     thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *     TRUE if key found, FALSE if reserved.
+ */
+bool oahttslf_find_or_reserve(oahttslf_t *table, uint64_t key,
+                              uint64_t *value, oahttslf_handle_t *handle,
+                              int thread_id)
+{
+  return oahttslf_find_or_claim(table, key, value, handle, thread_id) ==
+         OAHTTSLF_FOUND;
+}
+
+
+/*
+ * oahttslf_publish()
+ *
+ * Give the key reserved by oahttslf_find_or_reserve() or
+ * oahttslf_find_or_claim() its value, as oahttslf_insert() would but
+ * without probing for the key.
+ *
+ * Parameters:
+ *    table - hashtable the key was reserved in
+ *    handle - slot reserved for the key
+ *    value - value for the key
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    Value for the key prior to publishing (OAHTTSLF_EMPTY_VALUE unless
+ *    another thread that reserved the key published first and it was
+ *    not deleted since, or the handle has no slot)
+ */
+uint64_t oahttslf_publish(oahttslf_t *table, const oahttslf_handle_t *handle,
+                          uint64_t value, int thread_id)
+{
+#ifdef ALLOW_UPDATE
+  const oahttslf_putmode_t mode = OAHTTSLF_PUT_OVERWRITE;
+#else
+  const oahttslf_putmode_t mode = OAHTTSLF_PUT_IFABSENT;
+#endif
+  oahttslf_array_t *a = (oahttslf_array_t *)handle->array;
+  uint64_t oldvalue, prevvalue;
+  bool newkey;
+
+  assert(value != OAHTTSLF_EMPTY_VALUE);
+
+  if (!handle->value)
+    return OAHTTSLF_EMPTY_VALUE; /* a cache had no room to keep it */
+  oldvalue = oahttslf_set_value(handle->value, value, mode);
+
+  /* as in oahttslf_put_all(): the migration skips a slot with no value,
+     so if a newer array appeared while the key was reserved, repeat
+     the write there */
+  while (ATOMIC_LOAD_SEQ_CST(&a->next))
+  {
+    a = a->next;
+    while (!oahttslf_put(table, a, handle->key, value, mode, &prevvalue,
+                         &newkey, thread_id))
+      a = oahttslf_grow(a);
+  }
+  return OAHTTSLF_IS_VALUE(oldvalue) ? oldvalue : OAHTTSLF_EMPTY_VALUE;
+}
+
+
+/*
+ * oahttslf_lookup()
+ *
+ * Get the value for a key from the hashtable
+ *
+ * Parameters:
+ *     table - hashtable to search
+ *     key -  key to look up
+ *     value - (output) value for key,ony set if TRUE returned.
+ * * Return value: *      TRUE if key found, FALSE otherwise.
+ */
+bool oahttslf_lookup(oahttslf_t *table, uint64_t key, uint64_t *value)
+{
+  oahttslf_array_t *a;
+  uint64_t val = OAHTTSLF_EMPTY_VALUE;
+
+  /* the newest array that has the key has the latest value */
+  for (a = CURRENT_ARRAY(table); a; a = NEXT_ARRAY(a))
+    (void)oahttslf_array_lookup(a, key, &val);
+  if (!OAHTTSLF_IS_VALUE(val))
+    return FALSE; /* not there, or deleted */
+  *value = val;
+  return TRUE;
+}
+
+
+
+/*
+ * oahttslf_lookup_state()
+ *
+ * Get the value for a key from the hashtable, or whether another thread
+ * has claimed it with oahttslf_find_or_claim() and not yet published it.
+ *
+ * Parameters:
+ *     table - hashtable to search
+ *     key -  key to look up
+ *     value - (output) value for key, only set if OAHTTSLF_FOUND returned.
+ *
+ * Return value:
+ *     OAHTTSLF_FOUND if key has a value, OAHTTSLF_PENDING if it is
+ *     claimed with no value yet, else OAHTTSLF_ABSENT.
+ */
+oahttslf_state_t oahttslf_lookup_state(oahttslf_t *table, uint64_t key,
+                                       uint64_t *value)
+{
+  oahttslf_array_t *a;
+  volatile oahttslf_bucket_t *b;
+  uint64_t val;
+  int slot;
+  bool vacant;
+  oahttslf_state_t state = OAHTTSLF_ABSENT;
+
+  /* the newest array that has the key has the latest value */
+  for (a = CURRENT_ARRAY(table); a; a = NEXT_ARRAY(a))
+  {
+    b = oahttslf_getent(a, key, &slot, &vacant, FALSE);
+    if (b && !vacant)
+    {
+      val = ATOMIC_LOAD_ACQUIRE(&b->value[slot]);
+      if (!SLOT_STILL_HAS(a, b, slot, key))
+        continue; /* evicted from a cache */
+      if (val == OAHTTSLF_DELETED_VALUE)
+        state = OAHTTSLF_ABSENT;
+      else if (val != OAHTTSLF_EMPTY_VALUE)
+      {
+        *value = val;
+        state = OAHTTSLF_FOUND;
+      }
+      else if (state == OAHTTSLF_ABSENT)
+        state = OAHTTSLF_PENDING;
+    }
+  }
+  return state;
+}
+
+
+/*
+ * oahttslf_lookup_batch()
+ *
+ * Get the values for several keys from the hashtable. The home buckets
+ * of all the keys are prefetched before any of them is looked up, so
+ * the cache misses overlap instead of each waiting for the last.
+ * Each key gets the same result oahttslf_lookup() would give it.
+ *
+ * Parameters:
+ *     table - hashtable to search
+ *     keys - keys to look up
+ *     n - number of keys
+ *     values - (output) values[i] is value for keys[i], only set if
+ *              found[i] is TRUE
+ *     found - (output) found[i] is TRUE if keys[i] found, FALSE otherwise
+ *
+ * Return value:
+ *     number of keys found
  */
-unsigned int oahttslf_total_key_count()
+unsigned int oahttslf_lookup_batch(oahttslf_t *table, const uint64_t keys[],
+                                   unsigned int n, uint64_t values[],
+                                   bool found[])
 {
-  unsigned int num_items = 0;
-  int i;
-  for (i = 0; i < MAX_NUM_THREADS; i++)
-    num_items += key_count[i];
+  oahttslf_array_t *a;
+  uint64_t val;
+  unsigned int i, num_found = 0;
+
+  for (i = 0; i < n; i++)
+    found[i] = FALSE;
+
+  /* the newest array that has the key has the latest value. The hash
+     is cheap enough to compute again rather than keep */
+  for (a = CURRENT_ARRAY(table); a; a = NEXT_ARRAY(a))
+  {
+    for (i = 0; i < n; i++)
+      oahttslf_array_prefetch(a, keys[i]);
+    for (i = 0; i < n; i++)
+    {
+      if (oahttslf_array_lookup(a, keys[i], &val))
+      {
+        if ((found[i] = (val != OAHTTSLF_DELETED_VALUE)))
+          values[i] = val;
+      }
+    }
+  }
+
+  for (i = 0; i < n; i++)
+    if (found[i])
+      num_found++;
+  return num_found;
+}
+
+
+/*
+ * oahttslf_prefetch()
+ *
+ * Start the cache misses for the home buckets of several keys without
+ * waiting for them, so that the oahttslf_find_or_claim() (or other
+ * call) for each of them that follows finds its bucket in the cache or
+ * on the way. Unlike oahttslf_lookup_batch() this does not look at the
+ * buckets, so a key that is then claimed is still probed for only once.
+ *
+ * Parameters:
+ *     table - hashtable the keys will be looked up in
+ *     keys - keys that will be looked up
+ *     n - number of keys
+ *
+ * Return value:
+ *     None.
+ */
+void oahttslf_prefetch(oahttslf_t *table, const uint64_t keys[],
+                       unsigned int n)
+{
+  oahttslf_array_t *a;
+  unsigned int i;
+
+  for (a = CURRENT_ARRAY(table); a; a = NEXT_ARRAY(a))
+    for (i = 0; i < n; i++)
+      oahttslf_array_prefetch(a, keys[i]);
+}
+
+
+/*
+ * oahttslf_validate()
+ *
+ * Check that every key is found where it is: that there is no duplicate
+ * of it within one array (but a key can be in more than one array while
+ * migrating), and that it is not past an empty slot or too far from
+ * home. The table should not be changed while this is running.
+ * See oahttslf_validate_par().
+ *
+ * Parameters:
+ *    table - hashtable to check
+ *
+ * Return value:
+ *    0 if duplicate or unreachable keys found else 1
+ */
+int oahttslf_validate(oahttslf_t *table)
+{
+  return oahttslf_validate_par(table, 1);
+}
+
+/*
+ * oahttslf_validate_par()
+ *
+ * oahttslf_validate() with num_threads threads each checking an equal
+ * part of each array. It takes time linear in the size of the table, so
+ * even a table of billions of slots can be checked after a run.
+ *
+ * Parameters:
+ *    table - hashtable to check
+ *    num_threads - number of threads to use (1..MAX_NUM_THREADS)
+ *
+ * Return value:
+ *    0 if duplicate or unreachable keys found else 1
+ */
+int oahttslf_validate_par(oahttslf_t *table, int num_threads)
+{
+  oahttslf_array_t *a;
+  oahttslf_scan_part_t total;
+
+  for (a = table->first; a; a = a->next)
+    if (!oahttslf_scan(table, a, num_threads, &total))
+      return 0;
+
+  return 1;
+}
+
+/*
+ * oahttslf_printstats()
+ *
+ *   Compute and print statistics about the hash table to stdout
+ *   See oahttslf_printstats_par().
+ *
+ *   Parameters:
+ *      table - hashtable to compute stats for
+ *   Return value: None
+ */
+void oahttslf_printstats(oahttslf_t *table)
+{
+  oahttslf_printstats_par(table, 1);
+}
+
+/*
+ * oahttslf_printstats_par()
+ *
+ *   Compute and print statistics about the hash table to stdout, with
+ *   num_threads threads each scanning an equal part of each array:
+ *   occupancy, probe lengths (buckets each key is past its home bucket),
+ *   clusters (runs of buckets with keys in them, which a probe can only
+ *   end after) and whether it is valid as for oahttslf_validate().
+ *   The table should not be changed while this is running.
+ *
+ *   Parameters:
+ *      table - hashtable to compute stats for
+ *      num_threads - number of threads to use (1..MAX_NUM_THREADS)
+ *   Return value: None
+ */
+void oahttslf_printstats_par(oahttslf_t *table, int num_threads)
+{
+  oahttslf_array_t *a;
+  oahttslf_scan_part_t st;
+  unsigned int num_arrays = 0;
+  unsigned int dist, max_dist;
+  double total_dist;
+  bool valid;
+
+  for (a = table->first; a; a = a->next)
+  {
+    valid = oahttslf_scan(table, a, num_threads, &st);
+    max_dist = 0;
+    total_dist = 0;
+    for (dist = 0; dist <= OAHTTSLF_MAX_PROBES; dist++)
+    {
+      total_dist += (double)dist * st.hist[dist];
+      if (st.hist[dist] > 0)
+        max_dist = dist;
+    }
+    printf("array %u size    : %u%s\n", num_arrays, a->size,
+           a == table->current ? " (current)" : "");
+    printf("num items       : %u (%f%% full)\n", st.num_items,
+           100.0*(float)st.num_items/a->size);
+    printf("num values      : %u\n", st.num_values);
+    printf("num tombstones  : %u\n", st.num_deleted);
+    printf("valid           : %s\n", valid ? "yes" : "NO");
+    if (st.num_items > 0)
+    {
+      printf("mean probe len  : %f buckets past home\n",
+             total_dist / st.num_items);
+      printf("probe len histogram (buckets past home: keys)\n");
+      for (dist = 0; dist <= max_dist; dist++)
+        printf("  %2u: %u\n", dist, st.hist[dist]);
+      printf("num clusters    : %u\n", st.num_clusters);
+      printf("mean cluster len: %f buckets\n",
+             (double)st.cluster_total / st.num_clusters);
+      printf("max cluster len : %u buckets\n", st.max_cluster);
+    }
+    num_arrays++;
+  }
+  printf("num arrays      : %u\n", num_arrays);
+}
+
+/*
+ * oahttslf_reset()
+ *
+ * reset all the table entries to empty. The newest (largest) array is
+ * kept and all the older ones freed. Must not be called while other
+ * threads are using the table.
+ * The array is not cleared, we just start a new generation so all of it
+ * is stale (see comments at top of file). Only if the generation number
+ * wraps around do we really have to clear it.
+ *
+ * Parameters:
+ *    table - hashtable to reset
+ * Return value: None
+ *
+ */
+void oahttslf_reset(oahttslf_t *table)
+{
+  oahttslf_array_t *a, *next;
+  unsigned int b;
+  assert(0 == OAHTTSLF_EMPTY_KEY);
+  assert(0 == OAHTTSLF_EMPTY_VALUE);
+  for (a = table->first; a->next; a = next)
+  {
+    next = a->next;
+    oahttslf_free_array(a);
+  }
+  if (++a->generation == OAHTTSLF_GEN_BUSY)
+  {
+    if (a->mapped) /* dropping its pages would bring back the snapshot */
+      memset(a->buckets, 0, a->num_buckets * sizeof(oahttslf_bucket_t));
+    else
+      bigmem_zero(a->mem, a->mem_size);
+#ifdef USE_BOUNDED_PROBES
+    memset((void *)(unsigned long)a->reach, 0, a->num_buckets);
+#endif
+    a->generation = 1;
+    for (b = 0; b < a->num_blocks; b++)
+      a->gens[b] = a->generation;
+  }
+  a->copy_idx = a->copy_done = 0;
+  table->first = table->current = a;
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+  shardcount_reset(&table->counts);
+#endif
+}
+
+
+/*
+ * oahttslf_compact()
+ *
+ * Rebuild the hashtable into a single new array, leaving out deleted
+ * keys and the keys for which pred is TRUE, and free all the old
+ * arrays. The new array is the smallest that is at most half full with
+ * the keys left (as oahttslf_create() would make it), but no bigger
+ * than the newest array. num_threads threads each put a part of the
+ * table into it, as for oahttslf_save(). Must not be called while other
+ * threads are using the table. Not for a cache.
+ *
+ * Parameters:
+ *    table - hashtable to compact
+ *    pred  - function that returns TRUE for a key to remove, or NULL
+ *            just to drop the deleted keys
+ *    arg   - passed to pred
+ *    num_threads - number of threads to use (1..MAX_NUM_THREADS)
+ *
+ * Return value:
+ *    Number of keys removed because pred was TRUE for them
+ */
+uint64_t oahttslf_compact(oahttslf_t *table, oahttslf_key_pred_t pred,
+                          void *arg, int num_threads)
+{
+  static const char *funcname = "oahttslf_compact";
+  oahttslf_array_t *a, *next, *newa;
+  uint64_t num_entries, num_removed;
+  unsigned int size;
+
+  assert(!table->current->cost);
+
+  /* count the keys that will be left, to size the new array for them */
+  (void)oahttslf_save_parts(table, NULL, pred, arg, num_threads,
+                            &num_entries, &num_removed);
+  for (a = table->current; a->next; a = a->next)
+    /* the newest array has room for all the keys */ ;
+  size = OAHTTSLF_MIN_SIZE;
+  while (size < a->size && (uint64_t)size < 2 * num_entries)
+    size *= 2;
+  for (;;)
+  {
+    newa = oahttslf_new_array(size, 1);
+    if (!oahttslf_save_parts(table, newa, pred, arg, num_threads,
+                             &num_entries, &num_removed))
+      break;
+    /* keys from older arrays did not all fit, start again bigger */
+    oahttslf_free_array(newa);
+    if (size >= OAHTTSLF_GROW_LIMIT)
+      bpa_fatal_error(funcname, "hash table full\n");
+    size *= 2;
+  }
+
+  for (a = table->first; a; a = next)
+  {
+    next = a->next;
+    oahttslf_free_array(a);
+  }
+  table->first = table->current = newa;
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+  shardcount_reset(&table->counts);
+#endif
+#ifdef USE_INSTRUMENT
+  SHARDCOUNT_ADD(&table->counts, 0, OAHTTSLF_COUNT_KEYS, num_entries);
+#endif
+  return num_removed;
+}
+
+
+
+/*
+ * oahttslf_num_entries()
+ *
+ *   count number of keys in the hash table
+ *   WARNING: may be very slow - iterates thriough whole table; we do
+ *   not have a counter.
+ *
+ *   Parameters:
+ *      table - hashtable to count entries in
+ *   Return value: Number of keys in the hash table
+ */
+unsigned int oahttslf_num_entries(oahttslf_t *table)
+{
+  oahttslf_array_t *a, *b;
+  unsigned int num_items=0;
+  unsigned int i;
+  uint64_t key, value;
+  bool newer;
+
+  for (a = table->current; a; a = a->next)
+  {
+    for (i = 0; i < a->size; i++)
+    {
+      key = SLOT_FRESH(a, i) ? SLOT_KEY(a, i) : OAHTTSLF_EMPTY_KEY;
+      if (key != OAHTTSLF_EMPTY_KEY &&
+          SLOT_VALUE(a, i) != OAHTTSLF_DELETED_VALUE)
+      {
+        /* keys already copied to a newer array are counted there */
+        newer = FALSE;
+        for (b = a->next; b && !newer; b = b->next)
+          newer = oahttslf_array_lookup(b, key, &value);
+        if (!newer)
+          num_items++;
+      }
+    }
+  }
   return num_items;
 }
+
+/*
+ * oahttslf_foreach_part()
+ *
+ * Call a function for each key in one part of the table that has a
+ * value. Each of the num_parts parts is the same fraction of every
+ * array, so num_parts threads can each do one part to go through the
+ * whole table in parallel. A key in more than one array (while
+ * migrating) is only visited in the newest, with its value there.
+ * It can be called while other threads are inserting, but then
+ * whether keys inserted meanwhile are visited is a matter of timing.
+ *
+ * Parameters:
+ *    table - hashtable to go through
+ *    part  - which part to do, 0..num_parts-1
+ *    num_parts - number of parts the table is divided into
+ *    fn    - function to call with each key and its value
+ *    arg   - passed to fn
+ *
+ * Return value:
+ *    Number of keys visited
+ */
+unsigned int oahttslf_foreach_part(oahttslf_t *table, unsigned int part,
+                                   unsigned int num_parts,
+                                   oahttslf_entry_fn_t fn, void *arg)
+{
+  oahttslf_array_t *a, *b;
+  unsigned int i, start, end, num_visited = 0;
+  uint64_t key, value, newvalue;
+  bool newer;
+
+  assert(part < num_parts);
+  for (a = table->current; a; a = a->next)
+  {
+    start = (unsigned int)((uint64_t)a->size * part / num_parts);
+    end = (unsigned int)((uint64_t)a->size * (part + 1) / num_parts);
+    for (i = start; i < end; i++)
+    {
+      key = SLOT_FRESH(a, i) ? SLOT_KEY(a, i) : OAHTTSLF_EMPTY_KEY;
+      if (key == OAHTTSLF_EMPTY_KEY)
+        continue;
+      if ((value = SLOT_VALUE(a, i)) == OAHTTSLF_EMPTY_VALUE)
+        continue; /* claimed but no value yet */
+      if (value == OAHTTSLF_DELETED_VALUE)
+        continue;
+      /* keys already copied to a newer array are visited there */
+      newer = FALSE;
+      for (b = a->next; b && !newer; b = b->next)
+        newer = oahttslf_array_lookup(b, key, &newvalue);
+      if (newer)
+        continue;
+      fn(key, value, arg);
+      num_visited++;
+    }
+  }
+  return num_visited;
+}
+
+
+/*
+ * oahttslf_save()
+ *
+ * Write a snapshot of the table to a file that oahttslf_load() can map.
+ * The table should not be changed while this is running.
+ * The file has one array, the size of the newest array of the table
+ * (or bigger if the table was part way through growing and the keys do
+ * not all fit), which num_threads threads fill in parallel.
+ *
+ * Parameters:
+ *    table - hashtable to save
+ *    filename - file to write (replaced if it exists)
+ *    problem_id - id of the problem the values are for (e.g. a hash of
+ *                 its input, see hashfn_bytes()), recorded in the header
+ *    num_threads - number of threads to use (1..MAX_NUM_THREADS)
+ *
+ * Return value:
+ *    0 if OK, -1 on error (with message on stderr)
+ */
+int oahttslf_save(oahttslf_t *table, const char *filename,
+                  uint64_t problem_id, int num_threads)
+{
+  static const char *funcname = "oahttslf_save";
+  oahttslf_file_header_t header;
+  oahttslf_array_t *a, *file;
+  uint64_t num_entries, num_removed;
+  unsigned int size;
+  size_t len;
+  void *mem;
+  int fd, rc = 0;
+
+  for (a = table->current; a->next; a = a->next)
+    /* the newest array has room for all the keys */ ;
+  size = a->size;
+  for (;;)
+  {
+    len = OAHTTSLF_FILE_HEADER_SIZE +
+      (size_t)(size / OAHTTSLF_BUCKET_SLOTS) * sizeof(oahttslf_bucket_t);
+    if ((fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666)) < 0)
+    {
+      bpa_error_msg(funcname, "cannot create %s\n", filename);
+      return -1;
+    }
+    /* the file is sparse, so empty buckets take no disk space */
+    if (ftruncate(fd, (off_t)len) != 0 ||
+        (mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0)) == MAP_FAILED)
+    {
+      bpa_error_msg(funcname, "cannot map %lu bytes of %s\n",
+                    (unsigned long)len, filename);
+      close(fd);
+      return -1;
+    }
+    close(fd);
+    file = (oahttslf_array_t *)bpa_calloc(1, sizeof(oahttslf_array_t));
+    oahttslf_setup_array(file, size, 1);
+    file->mem = mem;
+    file->mem_size = len;
+    file->mapped = TRUE;
+    file->buckets = (oahttslf_bucket_t *)
+      ((char *)mem + OAHTTSLF_FILE_HEADER_SIZE);
+
+    if (!oahttslf_save_parts(table, file, NULL, NULL, num_threads,
+                             &num_entries, &num_removed))
+      break;
+
+    /* keys from older arrays did not all fit, start again bigger */
+    oahttslf_free_array(file);
+    if (size >= OAHTTSLF_GROW_LIMIT)
+    {
+      bpa_error_msg(funcname, "hash table too big to save\n");
+      return -1;
+    }
+    size *= 2;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, OAHTTSLF_FILE_MAGIC, sizeof(header.magic));
+  header.version = OAHTTSLF_FILE_VERSION;
+  header.bucket_slots = OAHTTSLF_BUCKET_SLOTS;
+  header.hash = OAHTTSLF_FILE_HASH;
+  header.size = size;
+  header.num_entries = num_entries;
+  header.problem_id = problem_id;
+  memcpy(mem, &header, sizeof(header));
+  if (msync(mem, len, MS_SYNC) != 0)
+  {
+    bpa_error_msg(funcname, "cannot write %s\n", filename);
+    rc = -1;
+  }
+  oahttslf_free_array(file);
+  return rc;
+}
+
+
+/*
+ * oahttslf_load()
+ *
+ * Make a new hashtable from a snapshot file written by oahttslf_save().
+ * The file is mapped copy-on-write, not read, so this takes no time
+ * however big it is; pages are read as they are looked up, and changes
+ * to the table are never written back to the file. A snapshot saved
+ * for a different problem is refused, since its values would be wrong.
+ *
+ * Parameters:
+ *    filename - snapshot file
+ *    problem_id - id of the problem, as given to oahttslf_save()
+ *
+ * Return value:
+ *    Pointer to new hashtable, or NULL on error (with message on stderr)
+ */
+oahttslf_t *oahttslf_load(const char *filename, uint64_t problem_id)
+{
+  static const char *funcname = "oahttslf_load";
+  oahttslf_file_header_t header;
+  oahttslf_array_t *a;
+  oahttslf_t *table;
+  struct stat st;
+  size_t len;
+  void *mem;
+  int fd;
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+  {
+    bpa_error_msg(funcname, "cannot open %s\n", filename);
+    return NULL;
+  }
+  if (read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+      memcmp(header.magic, OAHTTSLF_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != OAHTTSLF_FILE_VERSION ||
+      header.bucket_slots != OAHTTSLF_BUCKET_SLOTS ||
+      header.hash != OAHTTSLF_FILE_HASH ||
+      header.size < OAHTTSLF_BUCKET_SLOTS * OAHTTSLF_GEN_BLOCK ||
+      (header.size & (header.size - 1)) != 0)
+  {
+    bpa_error_msg(funcname, "%s is not a snapshot of this hash table\n",
+                  filename);
+    close(fd);
+    return NULL;
+  }
+  if (header.problem_id != problem_id)
+  {
+    bpa_error_msg(funcname, "%s is a snapshot of a different problem\n",
+                  filename);
+    close(fd);
+    return NULL;
+  }
+  len = OAHTTSLF_FILE_HEADER_SIZE +
+    (size_t)(header.size / OAHTTSLF_BUCKET_SLOTS) * sizeof(oahttslf_bucket_t);
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size != len)
+  {
+    bpa_error_msg(funcname, "%s is the wrong size\n", filename);
+    close(fd);
+    return NULL;
+  }
+  mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED)
+  {
+    bpa_error_msg(funcname, "cannot map %s\n", filename);
+    return NULL;
+  }
+
+  a = (oahttslf_array_t *)bpa_calloc(1, sizeof(oahttslf_array_t));
+  oahttslf_setup_array(a, header.size, 1);
+  a->mem = mem;
+  a->mem_size = len;
+  a->mapped = TRUE;
+  a->buckets = (oahttslf_bucket_t *)((char *)mem + OAHTTSLF_FILE_HEADER_SIZE);
+#ifdef USE_BOUNDED_PROBES
+  /* reaches are not saved, so a lookup may have to go as far as any key */
+  memset((void *)(unsigned long)a->reach, (int)a->max_probes, a->num_buckets);
+#endif
+
+  table = (oahttslf_t *)bpa_calloc(1, sizeof(oahttslf_t));
+  table->first = table->current = a;
+#ifdef USE_INSTRUMENT
+  /* so the total key count includes the keys we started with */
+  SHARDCOUNT_ADD(&table->counts, 0, OAHTTSLF_COUNT_KEYS, header.num_entries);
+#endif
+  return table;
+}
+
+
+#ifdef USE_INSTRUMENT
+/*
+ *  add up the per-thread key counters and return total
+ * Parameters:
+ *    table - hashtable to count keys in
+ * Return value: Total number of keys in the hash table
+ */
+unsigned int oahttslf_total_key_count(oahttslf_t *table)
+{
+  return (unsigned int)shardcount_total(&table->counts, OAHTTSLF_COUNT_KEYS);
+}
+#endif
+
+
+#ifdef USE_INSTRUMENT
+/*
+ *  add up the per-thread eviction counters and return total
+ * Parameters:
+ *    table - hashtable to count evictions in
+ * Return value: Total number of keys evicted (0 unless a cache)
+ */
+unsigned int oahttslf_total_eviction_count(oahttslf_t *table)
+{
+  return (unsigned int)shardcount_total(&table->counts,
+                                        OAHTTSLF_COUNT_EVICTIONS);
+}
 #endif
 
 
 #ifdef USE_CONTENTION_INSTRUMENT
 /*
  *  add up the per-thread retry counters and return total
- * Parameters: None
+ * Parameters:
+ *    table - hashtable to count retries for
  * Return value: Total number of times an insertion had to be retried
  */
-unsigned int oahttslf_total_retry_count()
+unsigned int oahttslf_total_retry_count(oahttslf_t *table)
 {
-  unsigned int total_retries = 0;
-  int i;
-  for (i = 0; i < MAX_NUM_THREADS; i++)
-    total_retries += retry_count[i];
-  return total_retries;
+  return (unsigned int)shardcount_total(&table->counts, OAHTTSLF_COUNT_RETRIES);
 }
 #endif
 
@@ -451,6 +2701,7 @@ unsigned int oahttslf_total_retry_count()
  * for existing key.
  *
  * Parameters:
+ *    table - hashtable to insert into
  *    key   - key to insert
  *    value - value to insert for the key
  *    thread_id - id (0,...n, not pthread id) of this thread
@@ -459,57 +2710,14 @@ unsigned int oahttslf_total_retry_count()
  *    Value for the key prior to the new insertion (OAHTTSLF_EMPTY_VALUE
  *    for a new key)
  */
-double oahttslf_insert_double(uint64_t key, double value, int thread_id)
+double oahttslf_insert_double(oahttslf_t *table, uint64_t key, double value,
+                              int thread_id)
 {
-  static const char *funcname = "oahttslf_insert_double";
-  volatile oahttslf_entry_t *ent;
-  uint64_t entkey, oldvalue;
-  bool vacant;
-  uint64_t newvalue;
+  uint64_t newvalue, oldvalue;
   double d_oldvalue;
 
-  assert(key != OAHTTSLF_EMPTY_KEY);
-  assert(value != OAHTTSLF_EMPTY_VALUE);
-
-  ent = oahttslf_getent(key, &vacant);
-  if (!ent)
-  {
-    bpa_fatal_error(funcname, "hash table full\n"); /* TODO expand table */
-  }
-  oldvalue = ent->value;
-  entkey = ent->key;
-  if (vacant)
-  {
-    if (CAS64(&ent->key, OAHTTSLF_EMPTY_KEY, key) != OAHTTSLF_EMPTY_KEY)
-      return oahttslf_insert_double(key, value, thread_id);  /* tail-recursive call to retry */
-
-    /* in lookup we test for OAHHTSLF_EMPTY_VALUE so if someone looks up 
-       in anothe thread before the value is set here, we return key not found.
-       NB depends on 64-bit atomic writes */
-/*    if (ent->value != OAHTTSLF_EMPTY_VALUE)
-      bpa_error_msg(funcname, "value = %llX\n", ent->value);     
-      */
-/*  __asm__ __volatile__ ("" : : : "memory");  */
-
-    entkey = key ;
-  }
-#ifdef DEBUG
-  /*assert(key == ent->key);*/
-  if (key != entkey)
-  {
-          fprintf(stderr, "OAHTTSLF ASSERTION FAILURE: key=%llX entkey=%llX\n",  key, entkey);
-          exit(1);
-  }
-#endif
   memcpy(&newvalue, &value, sizeof(double));
-#ifdef ALLOW_UPDATE
-  if (oldvalue == newvalue)  /* shortcut to avoid expense of CAS instruction */
-    return newvalue;
-  if (CAS64(&ent->value, oldvalue, newvalue) != oldvalue)
-    return oahttslf_insert_double(key, value, thread_id);  /* tail-recursive call to retry */
-#else
-  ent->value = newvalue;
-#endif
+  oldvalue = oahttslf_insert(table, key, newvalue, thread_id);
   memcpy(&d_oldvalue, &oldvalue, sizeof(double));
   return d_oldvalue;
 }
@@ -522,29 +2730,19 @@ double oahttslf_insert_double(uint64_t key, double value, int thread_id)
  * Get the value for a key from the hashtable
  *
  * Parameters:
+ *     table - hashtable to search
  *     key -  key to look up
  *     value - (output) value for key,ony set if TRUE returned.
  * * Return value: *      TRUE if key found, FALSE otherwise.
  */
-bool oahttslf_lookup_double(uint64_t key, double *value)
+bool oahttslf_lookup_double(oahttslf_t *table, uint64_t key, double *value)
 {
-  volatile oahttslf_entry_t *ent;
-  bool vacant;
-  double val;
+  uint64_t val;
 
-  ent = oahttslf_getent(key, &vacant);
-  if (ent)
+  if (oahttslf_lookup(table, key, &val))
   {
-    if (!vacant && ent->value != OAHTTSLF_EMPTY_VALUE)
-    {
-      memcpy(&val, &ent->value, sizeof(double));
-      *value = val;
-      return TRUE;
-    }
+    memcpy(value, &val, sizeof(double));
+    return TRUE;
   }
   return FALSE;
 }
-
-
-
-
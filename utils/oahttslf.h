@@ -15,10 +15,16 @@
 
 #include "bpautils.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
-/* size of the hash table (must be a power of 2)*/
-/*#define OAHTTSLF_SIZE  134217728 */   /* 2^27 */ /* too large */
-#define OAHTTSLF_SIZE  67108864   /* 2^26 */
+/* the initial table size is chosen at run time by oahttslf_create() and
+   is always a power of 2 between these limits. The table grows as needed */
+#define OAHTTSLF_MIN_SIZE  1024       /* 2^10 */
+/*#define OAHTTSLF_MAX_SIZE  134217728 */   /* 2^27 */ /* too large */
+#define OAHTTSLF_MAX_SIZE  67108864   /* 2^26 */
 
 /* marks unused slot (a key cannot have this value) */
 #define OAHTTSLF_EMPTY_KEY 0
@@ -27,47 +33,182 @@
 #define OAHTTSLF_EMPTY_VALUE 0
 
 /* note we depend on the above two empty key/value being 0 since table
-   is decalred static so initially zero */
+   is allocated with calloc() so initially zero */
+
+/* marks a deleted key, a tombstone (a value cannot have this value) */
+#define OAHTTSLF_DELETED_VALUE 0xde1e7edde1e7eddeULL
+
+/* marks a slot being evicted from a cache made by oahttslf_create_cache()
+   (a key in a cache cannot have this value) */
+#define OAHTTSLF_BUSY_KEY 0x8000000000000000ULL
+
+/* costs given by a cache's cost function are clamped to this */
+#define OAHTTSLF_MAX_COST 255
+
+
+/* handle for a hash table; contents are private to oahttslf.c */
+typedef struct oahttslf_s oahttslf_t;
+
+/* a slot reserved for a key by oahttslf_find_or_reserve() or
+   oahttslf_find_or_claim(), to be given its value by oahttslf_publish().
+   Fields are private to oahttslf.c */
+typedef struct oahttslf_handle_s
+{
+    void *array;              /* array the slot is in */
+    volatile uint64_t *value; /* value of the slot */
+    uint64_t key;             /* key the slot is reserved for */
+} oahttslf_handle_t;
+
+/* what oahttslf_find_or_claim() and oahttslf_lookup_state() found */
+typedef enum oahttslf_state_e
+{
+  OAHTTSLF_ABSENT,  /* key not in table */
+  OAHTTSLF_CLAIMED, /* key was not in table, now claimed by caller */
+  OAHTTSLF_PENDING, /* key claimed by a thread, value not published yet */
+  OAHTTSLF_FOUND    /* key has a value */
+} oahttslf_state_t;
+
+
+/* called by oahttslf_foreach_part() for each key with a value */
+typedef void (*oahttslf_entry_fn_t)(uint64_t key, uint64_t value, void *arg);
+
+
+/* called by oahttslf_compact() for each key with a value: TRUE to remove
+   the key */
+typedef bool (*oahttslf_key_pred_t)(uint64_t key, uint64_t value, void *arg);
+
 
+/* cost of computing the value of a key again, 0..OAHTTSLF_MAX_COST,
+   for choosing which key a cache evicts */
+typedef unsigned int (*oahttslf_cost_fn_t)(uint64_t key);
 
-typedef unsigned long long uint64_t;
-typedef unsigned int       uint32_t;
-typedef unsigned short     uint16_t;
-typedef unsigned char      uint8_t;
 
+/* create a new empty hashtable sized to hold max_keys keys */
+oahttslf_t *oahttslf_create(uint64_t max_keys);
+
+/* number of keys a cache made with oahttslf_create_cache() can hold */
+uint64_t oahttslf_cache_slots(uint64_t max_bytes);
+
+/* create a new empty hashtable that evicts keys to stay in max_bytes */
+oahttslf_t *oahttslf_create_cache(uint64_t max_bytes,
+                                  oahttslf_cost_fn_t cost_fn);
+
+/* free all memory used by a hashtable */
+void oahttslf_destroy(oahttslf_t *table);
 
 /* insert into hashtable. Returns old value. */
-uint64_t oahttslf_insert(uint64_t key, uint64_t value, int thread_id);
+uint64_t oahttslf_insert(oahttslf_t *table, uint64_t key, uint64_t value,
+                         int thread_id);
+
+/* insert into hashtable keeping max (signed) of old and new value.
+   Returns old value. */
+uint64_t oahttslf_insert_max(oahttslf_t *table, uint64_t key, uint64_t value,
+                             int thread_id);
+
+/* insert into hashtable keeping min (signed) of old and new value.
+   Returns old value. */
+uint64_t oahttslf_insert_min(oahttslf_t *table, uint64_t key, uint64_t value,
+                             int thread_id);
 
 /* lookup in hashtable */
-bool oahttslf_lookup(uint64_t key, uint64_t *value);
+bool oahttslf_lookup(oahttslf_t *table, uint64_t key, uint64_t *value);
+
+/* lookup in hashtable, reserving a slot for the key if not found.
+   Returns TRUE if found. */
+bool oahttslf_find_or_reserve(oahttslf_t *table, uint64_t key,
+                              uint64_t *value, oahttslf_handle_t *handle,
+                              int thread_id);
+
+/* lookup in hashtable, claiming the key if not found so other threads
+   see it is being computed. Returns OAHTTSLF_FOUND, _CLAIMED or _PENDING */
+oahttslf_state_t oahttslf_find_or_claim(oahttslf_t *table, uint64_t key,
+                                        uint64_t *value,
+                                        oahttslf_handle_t *handle,
+                                        int thread_id);
+
+/* lookup in hashtable, also telling if key is claimed but has no value.
+   Returns OAHTTSLF_FOUND, _PENDING or _ABSENT */
+oahttslf_state_t oahttslf_lookup_state(oahttslf_t *table, uint64_t key,
+                                       uint64_t *value);
+
+/* set the value of a key reserved by oahttslf_find_or_reserve() or
+   oahttslf_find_or_claim(). Returns old value. */
+uint64_t oahttslf_publish(oahttslf_t *table, const oahttslf_handle_t *handle,
+                          uint64_t value, int thread_id);
+
+/* lookup n keys in hashtable with their cache misses overlapped.
+   Returns number of keys found. */
+unsigned int oahttslf_lookup_batch(oahttslf_t *table, const uint64_t keys[],
+                                   unsigned int n, uint64_t values[],
+                                   bool found[]);
+
+/* start the cache misses for n keys about to be looked up */
+void oahttslf_prefetch(oahttslf_t *table, const uint64_t keys[],
+                       unsigned int n);
+
+/* delete key from hashtable. Returns TRUE if it had a value */
+bool oahttslf_delete(oahttslf_t *table, uint64_t key, int thread_id);
+
+/* rebuild hashtable without deleted keys or keys for which pred is TRUE,
+   with num_threads threads. Returns number of keys removed by pred */
+uint64_t oahttslf_compact(oahttslf_t *table, oahttslf_key_pred_t pred,
+                          void *arg, int num_threads);
 
 /* test for invalid structure */
-int oahttslf_validate(void);
+int oahttslf_validate(oahttslf_t *table);
+
+/* test for invalid structure with num_threads threads */
+int oahttslf_validate_par(oahttslf_t *table, int num_threads);
 
 /* compute and print stats about hash table */
-void oahttslf_printstats(void);
+void oahttslf_printstats(oahttslf_t *table);
+
+/* compute and print stats about hash table with num_threads threads */
+void oahttslf_printstats_par(oahttslf_t *table, int num_threads);
 
 /* reset all table entries to empty */
-void oahttslf_reset(void);
+void oahttslf_reset(oahttslf_t *table);
 
 /* return number of keys in table */
-unsigned int oahttslf_num_entries();
+unsigned int oahttslf_num_entries(oahttslf_t *table);
+
+/* call fn for each key with a value in part (of num_parts) of table.
+   Returns number of keys visited */
+unsigned int oahttslf_foreach_part(oahttslf_t *table, unsigned int part,
+                                   unsigned int num_parts,
+                                   oahttslf_entry_fn_t fn, void *arg);
+
+/* write snapshot of table, for the problem problem_id, to file with
+   num_threads threads. Returns 0 if OK, -1 on error */
+int oahttslf_save(oahttslf_t *table, const char *filename,
+                  uint64_t problem_id, int num_threads);
+
+/* make a new hashtable by mapping a snapshot file, which must be for
+   the problem problem_id. NULL on error */
+oahttslf_t *oahttslf_load(const char *filename, uint64_t problem_id);
 
 #ifdef USE_INSTRUMENT
 /* add up per-thread counters and return total */
-unsigned int oahttslf_total_key_count();
+unsigned int oahttslf_total_key_count(oahttslf_t *table);
+
+/* add up per-thread eviction counters and return total */
+unsigned int oahttslf_total_eviction_count(oahttslf_t *table);
 #endif
 
 #ifdef USE_CONTENTION_INSTRUMENT
 /* add up per-thread retry counters and return total */
-unsigned int oahttslf_total_retry_count();
+unsigned int oahttslf_total_retry_count(oahttslf_t *table);
 #endif
 
 /* insert into hashtable. Returns old value. */
-double oahttslf_insert_double(uint64_t key, double value, int thread_id);
+double oahttslf_insert_double(oahttslf_t *table, uint64_t key, double value,
+                              int thread_id);
 
 /* lookup in hashtable */
-bool oahttslf_lookup_double(uint64_t key, double *value);
+bool oahttslf_lookup_double(oahttslf_t *table, uint64_t key, double *value);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* OAHTTSLF_H */
@@ -0,0 +1,847 @@
+/*****************************************************************************
+ *
+ * File:    oahttslf128.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Open addressing (closed hashing) thread-safe lock-free hash table
+ * with 128 bit keys and 128 bit values. Uses linear probing.
+ *
+ * This is the same as oahttslf.c (including growing online by migrating
+ * to a chain of larger arrays, see comments there) except that keys
+ * and values are written with a double-width CAS (x86-64 cmpxchg16b).
+ * So we can have e.g. a SET of up to 128 elements as the key, or a
+ * score and a backpointer as the value, without having to pack them
+ * (lossily) into 64 bits.
+ *
+ * Reading a 128 bit word with two ordinary 64 bit loads could give us
+ * half of an old and half of a new value. For keys this does not
+ * matter as long as we re-read the low word: a key only ever changes
+ * once (from empty to the key) so if the low word is unchanged after
+ * reading the high word we have a consistent snapshot. Values can
+ * change more than once (ALLOW_UPDATE) so they are read with the CAS
+ * itself (comparing with and swapping in the empty value, which
+ * either fails or changes nothing).
+ *
+ * gcc version 4.1.0 or greater is required, in order to use the
+ * __sync_val_compare_and_swap() builtin, compiled with -mcx16.
+ * Since SPARC has no double-width CAS, there is no Solaris version.
+ *
+ *
+ * Preprocessor symbols:
+ *
+ *
+ * USE_GOOD_HASH  - use mixing hash function rather than trivial one
+ * DEBUG          - include extra assertion checks etc.
+ * ALLOW_UPDATE  - allow insert to update value of existing key
+ * USE_INSTRUMENT - compile in (per-thread) instrumentation counts.
+ * USE_CONTENTION_INSTRUMENT - per-thread contention counts (only).
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "bpautils.h"
+#include "oahttslf128.h"
+#include "atomicdefs.h"
+#include "shardcount.h"
+
+#ifndef CAS128
+#error "oahttslf128 needs a double-width CAS (CAS128 in atomicdefs.h)"
+#endif
+
+#define USE_GOOD_HASH
+#define ALLOW_UPDATE
+
+/* linear probing step size */
+#define OAHTTSLF128_PROBE_STEP 1
+
+/* maximum number of probes past the home slot before an insert gives up
+   on an array and grows into a new one. So lookups can stop here too. */
+#define OAHTTSLF128_MAX_PROBES 128
+
+/* number of slots a thread claims at a time when helping to migrate */
+#define OAHTTSLF128_COPY_CHUNK 1024
+
+/* largest array we can grow to (slot indices are unsigned int) */
+#define OAHTTSLF128_GROW_LIMIT 0x80000000U  /* 2^31 */
+
+/* per-thread instrumentation counters in table->counts */
+enum
+{
+  OAHTTSLF128_COUNT_KEYS,    /* new keys inserted */
+  OAHTTSLF128_COUNT_RETRIES  /* CAS failures claiming a slot */
+};
+
+
+/*****************************************************************************
+ *
+ * types
+ *
+ *****************************************************************************/
+
+typedef unsigned __int128 uint128_t;
+
+typedef struct oahttslf128_entry_s
+{
+    uint128_t key;
+    uint128_t value;
+} oahttslf128_entry_t;
+
+
+/* One array of entries. Each new array in the chain is twice as big */
+typedef struct oahttslf128_array_s
+{
+    /* Note we depend on the empty key/value being 0 since this is */
+    /* allocated with calloc() and therefore initilized to zero */
+    oahttslf128_entry_t *entries;
+    unsigned int size;        /* number of entries (power of 2) */
+    unsigned int max_probes;  /* probes past home slot before giving up */
+    struct oahttslf128_array_s *volatile next; /* newer array, or NULL */
+    volatile unsigned int copy_idx;  /* next slot to claim for migration */
+    volatile unsigned int copy_done; /* number of slots migrated so far */
+} oahttslf128_array_t;
+
+
+/*
+ * The hash table itself. Callers only ever see a pointer to this.
+ * Instrumentation is per thread as in oahttslf.c (see comments there).
+ */
+struct oahttslf128_s
+{
+    oahttslf128_array_t *first;            /* oldest array, for freeing */
+    oahttslf128_array_t *volatile current; /* oldest array still in use */
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+    shardcount_t counts;  /* per thread, indexed by OAHTTSLF128_COUNT_* */
+#endif
+};
+
+/*****************************************************************************
+ *
+ * static functions
+ *
+ *****************************************************************************/
+
+
+static uint128_t word_to_u128(oahttslf128_word_t w)
+{
+  return ((uint128_t)w.high << 64) | w.low;
+}
+
+static oahttslf128_word_t u128_to_word(uint128_t u)
+{
+  oahttslf128_word_t w;
+  w.low = (uint64_t)u;
+  w.high = (uint64_t)(u >> 64);
+  return w;
+}
+
+
+#ifdef USE_GOOD_HASH
+/*
+  hash a 64 bit value into 32 bits. From:
+  (Thomas Wang, Jan 1997, Last update Mar 2007, Version 3.1)
+  http://www.concentric.net/~Ttwang/tech/inthash.htm
+  (found by reference in NIST Dictionary of Algorithms and Data Structures)
+*/
+static unsigned long hash6432shift(unsigned long long key)
+{
+  key = (~key) + (key << 18); /* key = (key << 18) - key - 1; */
+  key = key ^ (key >> 31);
+  key = key * 21; /* key = (key + (key << 2)) + (key << 4); */
+  key = key ^ (key >> 11);
+  key = key + (key << 6);
+  key = key ^ (key >> 22);
+  return (unsigned long) key;
+}
+
+#endif
+
+
+static unsigned int hash_function(const oahttslf128_array_t *a, uint128_t key)
+{
+  unsigned int i;
+  unsigned long q;
+
+#ifdef USE_GOOD_HASH
+  q = hash6432shift((uint64_t)key ^ hash6432shift((uint64_t)(key >> 64)));
+#else
+  q = (uint64_t)key ^ (uint64_t)(key >> 64);
+#endif
+
+  i = q & (a->size - 1); /* depends on array size being 2^n */
+
+  return i;
+}
+
+
+/*
+ * read_key()
+ *
+ * Read the key in an entry without tearing it (see comments at top)
+ *
+ * Parameters:
+ *     ent - entry to read key of
+ *
+ * Return value:
+ *     the key
+ */
+static uint128_t read_key(volatile oahttslf128_entry_t *ent)
+{
+  volatile uint64_t *k = (volatile uint64_t *)&ent->key;
+  uint64_t low, high;
+
+  do
+  {
+    low = k[0];
+    high = k[1];
+  }
+  while (k[0] != low);
+  return ((uint128_t)high << 64) | low;
+}
+
+
+/*
+ * read_value()
+ *
+ * Read the value in an entry atomically
+ *
+ * Parameters:
+ *     ent - entry to read value of
+ *
+ * Return value:
+ *     the value
+ */
+static uint128_t read_value(volatile oahttslf128_entry_t *ent)
+{
+  return CAS128(&ent->value, (uint128_t)0, (uint128_t)0);
+}
+
+
+/*
+ * oahttslf128_new_array()
+ *
+ * Allocate a new empty array of entries
+ *
+ * Parameters:
+ *    size - number of entries, must be a power of 2
+ *
+ * Return value:
+ *    Pointer to new array. Exits with error if out of memory.
+ */
+static oahttslf128_array_t *oahttslf128_new_array(unsigned int size)
+{
+  oahttslf128_array_t *a;
+
+  a = (oahttslf128_array_t *)bpa_calloc(1, sizeof(oahttslf128_array_t));
+  a->size = size;
+  a->max_probes = (size - 1 < OAHTTSLF128_MAX_PROBES ? size - 1 :
+                   OAHTTSLF128_MAX_PROBES);
+  /* malloc() alignment on x86-64 is 16 bytes, enough for cmpxchg16b */
+  a->entries = (oahttslf128_entry_t *)bpa_calloc(size,
+                                                 sizeof(oahttslf128_entry_t));
+  assert(((unsigned long)a->entries & 15) == 0);
+  return a;
+}
+
+
+/*
+ * oahttslf128_free_array()
+ *
+ * Free an array allocated with oahttslf128_new_array()
+ *
+ * Parameters:
+ *    a - array to free
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf128_free_array(oahttslf128_array_t *a)
+{
+  free(a->entries);
+  free(a);
+}
+
+
+/*
+ * oahttslf128_getent()
+ *
+ * Get the entry for a key from one array of the hashtable
+ *
+ * Parameters:
+ *     a - array to search
+ *     key -  key to look up
+ *     vacant - (OUT) TRUE if reutrn pointer to entry for key
+ *                    is not currently occupied by key
+ *  Return value:
+ *     pointer to entry with key, or for key (but currently empty) in array
+ *     or NULL if neither found within max_probes of the home slot
+ */
+static volatile oahttslf128_entry_t *oahttslf128_getent(oahttslf128_array_t *a,
+                                                        uint128_t key,
+                                                        bool *vacant)
+{
+  unsigned int h;
+  volatile oahttslf128_entry_t *ent;
+  unsigned int probes = 0;
+  uint128_t entkey;
+
+  h = hash_function(a, key);
+  ent = &a->entries[h];
+  entkey = read_key(ent);
+  while (entkey != key && entkey != 0)
+  {
+    if (++probes > a->max_probes)
+      return NULL;
+    h = (h + OAHTTSLF128_PROBE_STEP) & (a->size - 1); /*SIZE must be 2^n*/
+    ent = &a->entries[h];
+    entkey = read_key(ent);
+  }
+  *vacant = (entkey == 0);
+  return ent;
+}
+
+
+/*
+ * oahttslf128_array_lookup()
+ *
+ * Get the value for a key from one array of the hashtable
+ *
+ * Parameters:
+ *     a - array to search
+ *     key -  key to look up
+ *     value - (output) value for key,ony set if TRUE returned.
+ *
+ * Return value:
+ *     TRUE if key found, FALSE otherwise.
+ */
+static bool oahttslf128_array_lookup(oahttslf128_array_t *a, uint128_t key,
+                                     uint128_t *value)
+{
+  volatile oahttslf128_entry_t *ent;
+  bool vacant;
+  uint128_t val;
+
+  ent = oahttslf128_getent(a, key, &vacant);
+  if (ent && !vacant)
+  {
+    val = read_value(ent);
+    if (val != 0)
+    {
+      *value = val;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+
+/*
+ * oahttslf128_put()
+ *
+ * Put a key/value pair into one array of the hashtable.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to (for instrumentation only)
+ *    a     - array to insert into
+ *    key   - key to insert
+ *    value - value to insert for the key
+ *    overwrite - if TRUE, replace value of existing key, else leave it
+ *    oldvalue - (OUT) value of key in this array before the put
+ *               (0 if none)
+ *    newkey - (OUT) TRUE if we claimed a slot for a key not in the array
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    TRUE if done, FALSE if no slot for key within max_probes (caller
+ *    must grow the table).
+ */
+static bool oahttslf128_put(oahttslf128_t *table, oahttslf128_array_t *a,
+                            uint128_t key, uint128_t value, bool overwrite,
+                            uint128_t *oldvalue, bool *newkey, int thread_id)
+{
+  volatile oahttslf128_entry_t *ent;
+  uint128_t oldval, seen;
+  bool vacant;
+
+  (void)table;     /* only for instrumentation */
+  (void)thread_id;
+  *newkey = FALSE;
+  for (;;)
+  {
+    ent = oahttslf128_getent(a, key, &vacant);
+    if (!ent)
+      return FALSE;
+    if (!vacant)
+      break;
+    if (CAS128(&ent->key, (uint128_t)0, key) == 0)
+    {
+      *newkey = TRUE;
+      break;
+    }
+#ifdef USE_CONTENTION_INSTRUMENT
+    SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLF128_COUNT_RETRIES);
+#endif
+  }
+
+  /* the CAS returns the current value when it fails, so we never need
+     to read the value separately */
+  oldval = 0;
+  while ((seen = CAS128(&ent->value, oldval, value)) != oldval)
+  {
+    oldval = seen;
+    if (!overwrite || oldval == value)
+      break;
+  }
+
+  *oldvalue = oldval;
+  return TRUE;
+}
+
+
+/*
+ * oahttslf128_grow()
+ *
+ * Make sure array a has a successor, allocating it if necessary. If
+ * several threads do this at once, only one array is installed and the
+ * others are freed.
+ *
+ * Parameters:
+ *    a - array that has no room for a key
+ *
+ * Return value:
+ *    The array following a.
+ */
+static oahttslf128_array_t *oahttslf128_grow(oahttslf128_array_t *a)
+{
+  static const char *funcname = "oahttslf128_grow";
+  oahttslf128_array_t *newa;
+
+  if (!a->next)
+  {
+    if (a->size >= OAHTTSLF128_GROW_LIMIT)
+      bpa_fatal_error(funcname, "hash table full\n");
+    newa = oahttslf128_new_array(a->size * 2);
+    if (CASPTR(&a->next, (oahttslf128_array_t *)NULL, newa) != NULL)
+      oahttslf128_free_array(newa); /* another thread beat us to it */
+  }
+  return a->next;
+}
+
+
+/*
+ * oahttslf128_copy_slot()
+ *
+ * Copy one slot of an array being migrated into the newer arrays, unless
+ * the key is already there.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to
+ *    a     - array being migrated
+ *    i     - index of slot in a to copy
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf128_copy_slot(oahttslf128_t *table,
+                                  oahttslf128_array_t *a,
+                                  unsigned int i, int thread_id)
+{
+  oahttslf128_array_t *b;
+  uint128_t key, value, oldvalue;
+  bool newkey;
+
+  key = read_key(&a->entries[i]);
+  if (key == 0)
+    return;
+  value = read_value(&a->entries[i]);
+  if (value == 0)
+    return; /* insert in progress: the inserter will see a->next and copy */
+
+  b = a->next;
+  for (;;)
+  {
+    if (!oahttslf128_put(table, b, key, value, FALSE, &oldvalue, &newkey,
+                         thread_id))
+    {
+      b = oahttslf128_grow(b);
+      continue;
+    }
+    /* if the key was already in b, whoever put it there is responsible
+       for it reaching any newer array */
+    if (oldvalue != 0 || !b->next)
+      break;
+    b = b->next;
+  }
+}
+
+
+/*
+ * oahttslf128_help_migrate()
+ *
+ * If the oldest array is being migrated, claim a chunk of it and copy
+ * it. The thread that finishes the last chunk moves the current pointer
+ * on so that lookups no longer need to look there.
+ *
+ * Parameters:
+ *    table - hashtable to help migrate
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslf128_help_migrate(oahttslf128_t *table, int thread_id)
+{
+  oahttslf128_array_t *a = table->current;
+  unsigned int start, end, i;
+
+  if (!a->next || a->copy_idx >= a->size)
+    return;
+  start = ATOMIC_ADD_32_NV(&a->copy_idx, OAHTTSLF128_COPY_CHUNK)
+          - OAHTTSLF128_COPY_CHUNK;
+  if (start >= a->size)
+    return;
+  end = (a->size - start < OAHTTSLF128_COPY_CHUNK ? a->size :
+         start + OAHTTSLF128_COPY_CHUNK);
+  for (i = start; i < end; i++)
+    oahttslf128_copy_slot(table, a, i, thread_id);
+
+  if (ATOMIC_ADD_32_NV(&a->copy_done, end - start) == a->size)
+  {
+    while ((a = table->current)->next && a->copy_done == a->size)
+      (void)CASPTR(&table->current, a, a->next);
+  }
+}
+
+
+
+/*****************************************************************************
+ *
+ * external functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * oahttslf128_create()
+ *
+ * Allocate a new empty hashtable. The initial size is chosen as for
+ * oahttslf_create().
+ *
+ * Parameters:
+ *    max_keys - (estimate of) the maximum number of keys to be inserted
+ *
+ * Return value:
+ *    Pointer to new hashtable. Exits with error if out of memory.
+ */
+oahttslf128_t *oahttslf128_create(uint64_t max_keys)
+{
+  oahttslf128_t *table;
+  uint64_t size = OAHTTSLF_MIN_SIZE;
+
+  while (size < OAHTTSLF_MAX_SIZE && size < 2 * max_keys)
+    size <<= 1;
+  table = (oahttslf128_t *)bpa_calloc(1, sizeof(oahttslf128_t));
+  table->first = table->current = oahttslf128_new_array((unsigned int)size);
+  return table;
+}
+
+
+/*
+ * oahttslf128_destroy()
+ *
+ * Free all memory used by a hashtable created with oahttslf128_create()
+ *
+ * Parameters:
+ *    table - hashtable to free
+ *
+ * Return value:
+ *    None.
+ */
+void oahttslf128_destroy(oahttslf128_t *table)
+{
+  oahttslf128_array_t *a, *next;
+
+  for (a = table->first; a; a = next)
+  {
+    next = a->next;
+    oahttslf128_free_array(a);
+  }
+  free(table);
+}
+
+
+/*
+ * oahttslf128_insert()
+ *
+ * Insert a key/value pair into the hashtable, or update the value
+ * for existing key.
+ *
+ * Parameters:
+ *    table - hashtable to insert into
+ *    key   - key to insert (not both words 0)
+ *    value - value to insert for the key (not both words 0)
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    Value for the key prior to the new insertion (both words 0
+ *    for a new key)
+ */
+oahttslf128_word_t oahttslf128_insert(oahttslf128_t *table,
+                                      oahttslf128_word_t key,
+                                      oahttslf128_word_t value,
+                                      int thread_id)
+{
+#ifdef ALLOW_UPDATE
+  const bool overwrite = TRUE;
+#else
+  const bool overwrite = FALSE;
+#endif
+  oahttslf128_array_t *start, *a, *b;
+  uint128_t k = word_to_u128(key), v = word_to_u128(value);
+  uint128_t oldvalue = 0, prevvalue;
+  bool newkey, first = TRUE;
+
+  assert(k != 0);
+  assert(v != 0);
+
+  oahttslf128_help_migrate(table, thread_id);
+
+  start = table->current;
+  for (a = start; a->next; a = a->next)
+    /* new keys always go in the newest array */ ;
+
+  for (;;)
+  {
+    if (!oahttslf128_put(table, a, k, v, overwrite, &prevvalue, &newkey,
+                         thread_id))
+    {
+      a = oahttslf128_grow(a);
+      continue;
+    }
+    if (first)
+    {
+      first = FALSE;
+      oldvalue = prevvalue;
+      if (oldvalue == 0)
+      {
+        /* key may still be in an older array that is not migrated yet */
+        for (b = start; b != a; b = b->next)
+          if (oahttslf128_array_lookup(b, k, &prevvalue))
+            oldvalue = prevvalue;
+      }
+#ifdef USE_INSTRUMENT
+      if (newkey && oldvalue == 0)
+        SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLF128_COUNT_KEYS);
+#endif
+    }
+    /* if a newer array appeared while we were writing, the migration
+       may already have passed our slot, so repeat the write there */
+    if (!a->next)
+      break;
+    a = a->next;
+  }
+  return u128_to_word(oldvalue);
+}
+
+
+
+/*
+ * oahttslf128_lookup()
+ *
+ * Get the value for a key from the hashtable
+ *
+ * Parameters:
+ *     table - hashtable to search
+ *     key -  key to look up
+ *     value - (output) value for key,ony set if TRUE returned.
+ *
+ * Return value:
+ *     TRUE if key found, FALSE otherwise.
+ */
+bool oahttslf128_lookup(oahttslf128_t *table, oahttslf128_word_t key,
+                        oahttslf128_word_t *value)
+{
+  oahttslf128_array_t *a;
+  uint128_t k = word_to_u128(key), val;
+  bool found = FALSE;
+
+  /* the newest array that has the key has the latest value */
+  for (a = table->current; a; a = a->next)
+  {
+    if (oahttslf128_array_lookup(a, k, &val))
+    {
+      *value = u128_to_word(val);
+      found = TRUE;
+    }
+  }
+  return found;
+}
+
+
+
+/*
+ * oahttslf128_validate()
+ *
+ * Test for duplicate keys  -this should not happen within one array
+ * (but a key can be in more than one array while migrating) - and that
+ * every key is found where it is
+ *
+ * Parameters:
+ *    table - hashtable to check
+ *
+ * Return value:
+ *    0 if duplicate or unreachable keys found else 1
+ */
+int oahttslf128_validate(oahttslf128_t *table)
+{
+  oahttslf128_array_t *a;
+  unsigned int i;
+  uint128_t key;
+  bool vacant;
+
+  /* a lookup finds the first slot with the key, so a duplicate would be
+     a slot that is not found (and this is linear, not quadratic) */
+  for (a = table->first; a; a = a->next)
+    for (i = 0; i < a->size; i++)
+      if ((key = read_key(&a->entries[i])) != 0 &&
+          oahttslf128_getent(a, key, &vacant) != &a->entries[i])
+        return 0;
+
+  return 1;
+}
+
+/*
+ * oahttslf128_printstats()
+ *
+ *   Compute and print statistics about the hash table to stdout
+ *
+ *   Parameters:
+ *      table - hashtable to compute stats for
+ *   Return value: None
+ */
+void oahttslf128_printstats(oahttslf128_t *table)
+{
+  oahttslf128_array_t *a;
+  unsigned int num_items, num_arrays = 0;
+  unsigned int i;
+
+  for (a = table->first; a; a = a->next)
+  {
+    num_items = 0;
+    for (i = 0; i < a->size; i++)
+    {
+      if (a->entries[i].key != 0)
+        num_items++;
+    }
+    printf("array %u size    : %u%s\n", num_arrays, a->size,
+           a == table->current ? " (current)" : "");
+    printf("num items       : %u (%f%% full)\n", num_items,
+           100.0*(float)num_items/a->size);
+    num_arrays++;
+  }
+  printf("num arrays      : %u\n", num_arrays);
+}
+
+/*
+ * oahttslf128_reset()
+ *
+ * reset all the table entries to empty. The newest (largest) array is
+ * kept and all the older ones freed. Must not be called while other
+ * threads are using the table.
+ *
+ * Parameters:
+ *    table - hashtable to reset
+ * Return value: None
+ *
+ */
+void oahttslf128_reset(oahttslf128_t *table)
+{
+  oahttslf128_array_t *a, *next;
+  for (a = table->first; a->next; a = next)
+  {
+    next = a->next;
+    oahttslf128_free_array(a);
+  }
+  memset(a->entries, 0, a->size * sizeof(oahttslf128_entry_t));
+  a->copy_idx = a->copy_done = 0;
+  table->first = table->current = a;
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+  shardcount_reset(&table->counts);
+#endif
+}
+
+
+
+/*
+ * oahttslf128_num_entries()
+ *
+ *   count number of keys in the hash table
+ *   WARNING: may be very slow - iterates thriough whole table; we do
+ *   not have a counter.
+ *
+ *   Parameters:
+ *      table - hashtable to count entries in
+ *   Return value: Number of keys in the hash table
+ */
+unsigned int oahttslf128_num_entries(oahttslf128_t *table)
+{
+  oahttslf128_array_t *a, *b;
+  unsigned int num_items=0;
+  unsigned int i;
+  uint128_t key, value;
+  bool newer;
+
+  for (a = table->current; a; a = a->next)
+  {
+    for (i = 0; i < a->size; i++)
+    {
+      key = a->entries[i].key;
+      if (key != 0)
+      {
+        /* keys already copied to a newer array are counted there */
+        newer = FALSE;
+        for (b = a->next; b && !newer; b = b->next)
+          newer = oahttslf128_array_lookup(b, key, &value);
+        if (!newer)
+          num_items++;
+      }
+    }
+  }
+  return num_items;
+}
+
+#ifdef USE_INSTRUMENT
+/*
+ *  add up the per-thread key counters and return total
+ * Parameters:
+ *    table - hashtable to count keys in
+ * Return value: Total number of keys in the hash table
+ */
+unsigned int oahttslf128_total_key_count(oahttslf128_t *table)
+{
+  return (unsigned int)shardcount_total(&table->counts, OAHTTSLF128_COUNT_KEYS);
+}
+#endif
+
+
+#ifdef USE_CONTENTION_INSTRUMENT
+/*
+ *  add up the per-thread retry counters and return total
+ * Parameters:
+ *    table - hashtable to count retries for
+ * Return value: Total number of times an insertion had to be retried
+ */
+unsigned int oahttslf128_total_retry_count(oahttslf128_t *table)
+{
+  return (unsigned int)shardcount_total(&table->counts, OAHTTSLF128_COUNT_RETRIES);
+}
+#endif
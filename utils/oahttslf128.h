@@ -0,0 +1,76 @@
+#ifndef OAHTTSLF128_H
+#define OAHTTSLF128_H
+/*****************************************************************************
+ *
+ * File:    oahttslf128.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Declarations for open addressing thread-safe lock-free hash table
+ * with 128 bit keys and values.
+ *
+ *
+ *****************************************************************************/
+
+#include "bpautils.h"
+#include "oahttslf.h"   /* for uint64_t etc. and OAHTTSLF_MIN/MAX_SIZE */
+
+
+/* a 128 bit key or value, e.g. a SET of up to 128 elements as in
+   the test harnesses. Must be 16 byte aligned for the double-width CAS,
+   and low word first so it has the same layout as an x86-64 __int128 */
+typedef struct oahttslf128_word_s
+{
+    uint64_t low;
+    uint64_t high;
+} __attribute__((aligned(16))) oahttslf128_word_t;
+
+/* marks unused slot (a key cannot have this value, i.e. both words 0) */
+/* marks unset value (a value cannot have this value, i.e. both words 0) */
+/* as for oahttslf we depend on these being 0 since arrays are calloc()ed */
+#define OAHTTSLF128_IS_EMPTY(w) ((w).low == 0 && (w).high == 0)
+#define OAHTTSLF128_EQUAL(w1,w2) ((w1).low == (w2).low && (w1).high == (w2).high)
+
+/* handle for a hash table; contents are private to oahttslf128.c */
+typedef struct oahttslf128_s oahttslf128_t;
+
+
+/* create a new empty hashtable sized to hold max_keys keys */
+oahttslf128_t *oahttslf128_create(uint64_t max_keys);
+
+/* free all memory used by a hashtable */
+void oahttslf128_destroy(oahttslf128_t *table);
+
+/* insert into hashtable. Returns old value. */
+oahttslf128_word_t oahttslf128_insert(oahttslf128_t *table,
+                                      oahttslf128_word_t key,
+                                      oahttslf128_word_t value,
+                                      int thread_id);
+
+/* lookup in hashtable */
+bool oahttslf128_lookup(oahttslf128_t *table, oahttslf128_word_t key,
+                        oahttslf128_word_t *value);
+
+/* test for invalid structure */
+int oahttslf128_validate(oahttslf128_t *table);
+
+/* compute and print stats about hash table */
+void oahttslf128_printstats(oahttslf128_t *table);
+
+/* reset all table entries to empty */
+void oahttslf128_reset(oahttslf128_t *table);
+
+/* return number of keys in table */
+unsigned int oahttslf128_num_entries(oahttslf128_t *table);
+
+#ifdef USE_INSTRUMENT
+/* add up per-thread counters and return total */
+unsigned int oahttslf128_total_key_count(oahttslf128_t *table);
+#endif
+
+#ifdef USE_CONTENTION_INSTRUMENT
+/* add up per-thread retry counters and return total */
+unsigned int oahttslf128_total_retry_count(oahttslf128_t *table);
+#endif
+
+#endif /* OAHTTSLF128_H */
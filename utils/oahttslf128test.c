@@ -0,0 +1,220 @@
+/*****************************************************************************
+ *
+ * File:    oahttslf128test.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Test harness for open addressing thread-safe lock-free hash table
+ * with 128 bit keys and values. Unlike oahttslftest this uses both
+ * words of the SET as the key, and keys that differ only in the high
+ * word, so it would fail if the high word were not stored.
+ *
+ * Usage:
+ *    oahttslf128test [numthreads]
+ *
+ *
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L  /* for rand_r() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "oahttslf128.h"
+
+#define NUM_INSERTIONS  4000000
+
+/* keys are (high,low) with low in [1,NUM_LOW_KEYS] and high in
+   [0,NUM_HIGH_KEYS) so there are lots of repeated keys */
+#define NUM_LOW_KEYS    250000
+#define NUM_HIGH_KEYS   4
+
+
+typedef struct twothings {
+  uint64_t high, low;
+} SET;
+
+
+/***************************************************************************
+ *
+ * thread data
+ *
+ ***************************************************************************/
+
+
+typedef struct thread_data_s
+{
+    int thread_id;
+    int num_insertions;
+} thread_data_t;
+
+
+static thread_data_t thread_data[MAX_NUM_THREADS];
+
+static oahttslf128_t *hashtable;  /* the table shared by all threads */
+
+
+/***************************************************************************
+ *
+ * test functions
+ *
+ ***************************************************************************/
+
+/* the value we store for a key, with both words non-zero */
+static oahttslf128_word_t value_for_key(SET s)
+{
+  oahttslf128_word_t v;
+  v.low = ~s.high;
+  v.high = s.low;
+  return v;
+}
+
+static oahttslf128_word_t set_to_word(SET s)
+{
+  oahttslf128_word_t w;
+  w.low = s.low;
+  w.high = s.high;
+  return w;
+}
+
+static void *insert_random(void *threadarg)
+{
+  SET s;
+  thread_data_t *mydata = (thread_data_t *)threadarg;
+  unsigned int seed = mydata->thread_id * time(NULL);
+  oahttslf128_word_t key, value, expected;
+  int q;
+
+  for (q = 0; q < mydata->num_insertions; q++)
+  {
+    s.low = rand_r(&seed) % NUM_LOW_KEYS + 1;
+    s.high = rand_r(&seed) % NUM_HIGH_KEYS;
+    key = set_to_word(s);
+    expected = value_for_key(s);
+    if (!oahttslf128_lookup(hashtable, key, &value))
+    {
+      oahttslf128_insert(hashtable, key, expected, mydata->thread_id);
+    }
+    else if (!OAHTTSLF128_EQUAL(value, expected))
+    {
+      fprintf(stderr, "ASSERTION FAILURE: thread %d: key=%llX:%llX value=%llX:%llX\n",
+              mydata->thread_id, s.high, s.low, value.high, value.low);
+      exit(101);
+    }
+  }
+  return NULL;
+}
+
+
+/***************************************************************************
+ *
+ * main
+ *
+ ***************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  int t;
+  int num_threads;
+  int rc;
+  pthread_t threads[MAX_NUM_THREADS];
+  struct timeval start_timeval,end_timeval,elapsed_timeval;
+  int etime;
+  SET s;
+  oahttslf128_word_t value, expected;
+  unsigned int num_found = 0;
+
+  if (argc == 1)
+    num_threads = 2;
+  else if (argc == 2)
+    num_threads = atoi(argv[1]);
+  else
+  {
+    fprintf(stderr, "usage: %s [numthreads]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_threads < 1 || num_threads >  MAX_NUM_THREADS)
+  {
+    fprintf(stderr, "number of threads must be 1..%d\n", MAX_NUM_THREADS);
+    exit(1);
+  }
+
+  hashtable = oahttslf128_create(0); /* start small so the test also grows it */
+
+  gettimeofday(&start_timeval, NULL);
+
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    thread_data[t].num_insertions = NUM_INSERTIONS / num_threads;
+
+    if ((rc = pthread_create(&threads[t], NULL, insert_random,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* wait for threads */
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+  printf("elapsed time %d ms\n", etime);
+
+  /* every key that is in the table must have the right value */
+  for (s.high = 0; s.high < NUM_HIGH_KEYS; s.high++)
+  {
+    for (s.low = 1; s.low <= NUM_LOW_KEYS; s.low++)
+    {
+      expected = value_for_key(s);
+      if (oahttslf128_lookup(hashtable, set_to_word(s), &value))
+      {
+        if (!OAHTTSLF128_EQUAL(value, expected))
+        {
+          fprintf(stderr, "bad value for key %llX:%llX\n", s.high, s.low);
+          exit(EXIT_FAILURE);
+        }
+        num_found++;
+      }
+    }
+  }
+  if (num_found != oahttslf128_num_entries(hashtable))
+  {
+    fprintf(stderr, "found %u keys but table has %u\n", num_found,
+            oahttslf128_num_entries(hashtable));
+    exit(EXIT_FAILURE);
+  }
+  printf("%u keys\n", num_found);
+
+#ifdef DEBUG
+  if (!oahttslf128_validate(hashtable))
+  {
+      fprintf(stderr, "hash table validation failed\n");
+      exit(EXIT_FAILURE);
+  }
+
+  oahttslf128_printstats(hashtable);
+#endif
+
+#ifdef USE_CONTENTION_INSTRUMENT
+  printf("total retry count = %u\n", oahttslf128_total_retry_count(hashtable));
+#endif
+
+  oahttslf128_destroy(hashtable);
+  exit(0);
+}
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ *
+ * File:    oahttslf6432.cpp
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * C callable interface to the oahttslft template (oahttslft.h)
+ * instantiated with 64 bit keys and 32 bit values.
+ *
+ * The table is allocated with bpa_malloc() and constructed in place,
+ * rather than with new, and this is compiled with -fno-exceptions, so
+ * C programs can link it with gcc and without the C++ library.
+ *
+ *
+ *****************************************************************************/
+
+#include <new>
+#include "oahttslft.h"
+#include "oahttslf6432.h"
+
+typedef oahttslft<uint64_t, uint32_t,
+                  OAHTTSLF6432_EMPTY_KEY, OAHTTSLF6432_EMPTY_VALUE> table6432_t;
+
+/* the C handle is just the C++ object */
+struct oahttslf6432_s : public table6432_t
+{
+  oahttslf6432_s(uint64_t max_keys) : table6432_t(max_keys) {}
+};
+
+
+oahttslf6432_t *oahttslf6432_create(uint64_t max_keys)
+{
+  return new (bpa_malloc(sizeof(oahttslf6432_t))) oahttslf6432_t(max_keys);
+}
+
+void oahttslf6432_destroy(oahttslf6432_t *table)
+{
+  table->~oahttslf6432_t();
+  free(table);
+}
+
+uint32_t oahttslf6432_insert(oahttslf6432_t *table, uint64_t key,
+                             uint32_t value, int thread_id)
+{
+  return table->insert(key, value, thread_id);
+}
+
+bool oahttslf6432_lookup(oahttslf6432_t *table, uint64_t key,
+                         uint32_t *value)
+{
+  return table->lookup(key, value);
+}
+
+void oahttslf6432_reset(oahttslf6432_t *table)
+{
+  table->reset();
+}
+
+unsigned int oahttslf6432_slot_bytes(void)
+{
+  return (unsigned int)table6432_t::slot_bytes();
+}
+
+#ifdef USE_INSTRUMENT
+unsigned int oahttslf6432_total_key_count(oahttslf6432_t *table)
+{
+  return table->total_key_count();
+}
+#endif
+
+#ifdef USE_CONTENTION_INSTRUMENT
+unsigned int oahttslf6432_total_retry_count(oahttslf6432_t *table)
+{
+  return table->total_retry_count();
+}
+#endif
@@ -0,0 +1,69 @@
+#ifndef OAHTTSLF6432_H
+#define OAHTTSLF6432_H
+/*****************************************************************************
+ *
+ * File:    oahttslf6432.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * C callable interface to the oahttslft template (oahttslft.h)
+ * instantiated with 64 bit keys and 32 bit values, so that each slot
+ * takes 12.8 bytes rather than the 16 bytes of oahttslf.
+ *
+ *
+ *****************************************************************************/
+
+#include "bpautils.h"
+#include "oahttslf.h"   /* for uint64_t etc. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* marks unused slot (a key cannot have this value) */
+#define OAHTTSLF6432_EMPTY_KEY 0xffffffffffffffffULL
+
+/* marks unset value (a value cannot have this value) */
+#define OAHTTSLF6432_EMPTY_VALUE 0xffffffffU
+
+/* unlike oahttslf, 0 is a valid key and value */
+
+/* handle for a hash table; contents are private to oahttslf6432.cpp */
+typedef struct oahttslf6432_s oahttslf6432_t;
+
+
+/* create a new empty hashtable sized to hold max_keys keys */
+oahttslf6432_t *oahttslf6432_create(uint64_t max_keys);
+
+/* free all memory used by a hashtable */
+void oahttslf6432_destroy(oahttslf6432_t *table);
+
+/* insert into hashtable. Returns old value. */
+uint32_t oahttslf6432_insert(oahttslf6432_t *table, uint64_t key,
+                             uint32_t value, int thread_id);
+
+/* lookup in hashtable */
+bool oahttslf6432_lookup(oahttslf6432_t *table, uint64_t key,
+                         uint32_t *value);
+
+/* reset all table entries to empty */
+void oahttslf6432_reset(oahttslf6432_t *table);
+
+/* number of bytes each slot takes */
+unsigned int oahttslf6432_slot_bytes(void);
+
+#ifdef USE_INSTRUMENT
+/* add up per-thread counters and return total */
+unsigned int oahttslf6432_total_key_count(oahttslf6432_t *table);
+#endif
+
+#ifdef USE_CONTENTION_INSTRUMENT
+/* add up per-thread retry counters and return total */
+unsigned int oahttslf6432_total_retry_count(oahttslf6432_t *table);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OAHTTSLF6432_H */
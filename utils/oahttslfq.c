@@ -0,0 +1,896 @@
+/*****************************************************************************
+ *
+ * File:    oahttslfq.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Quotiented open addressing (closed hashing) thread-safe lock-free hash
+ * table. Uses linear probing.
+ *
+ * This is the same as oahttslf.c (including growing online by migrating
+ * to a chain of larger arrays, see comments there) except for what is
+ * stored in a slot. Keys are hashed with a bijection on key_bits bits,
+ * so the hash determines the key. The low log2(size) bits of the hash
+ * are the home slot and so do not need to be stored: a slot only holds
+ * the rest of the hash (the quotient, or remainder as it is usually
+ * called for quotient filters), how far the slot is past the home slot,
+ * and the value, all in one 64 bit word:
+ *
+ *    | probes+1 (6 bits) | remainder (key_bits-log2(size)) | value |
+ *
+ * That is 8 bytes a slot instead of the 16 of oahttslf, and since the
+ * key and value are one word they are published by a single CAS, so
+ * there is no window where a key is there with an empty value (and
+ * there is no empty key or value: a slot is empty if the whole word is
+ * 0, and probes+1 is never 0). Updating a value is a CAS of the word
+ * with the same key part.
+ *
+ * The price is that keys and values must fit: key_bits - log2(size) +
+ * value_bits + 6 <= 64. E.g. the knapsack has at most (n+1)(W+1) keys
+ * i*(W+1)+w, and the table has about twice as many slots as that, so the
+ * remainder is 1 or 2 bits and the 32 bit profit easily fits. Each
+ * larger array stores one bit less of remainder. oahttslfq_create()
+ * makes the initial array big enough for the word to fit.
+ *
+ * hash6432shift() (oahttslf.c) is in fact a bijection on 64 bits, but
+ * its shifts are fixed for 64 bit words, and masked to fewer bits its
+ * low bits (the home slot) no longer depend on the high bits of the key.
+ * So instead we use the finaliser of MurmurHash3 (fmix64) with its
+ * shifts scaled to key_bits: xorshifts by half the width or more are
+ * their own inverse, and the odd multipliers have inverses mod 2^64.
+ *
+ * Preprocessor symbols:
+ *
+ *
+ * DEBUG          - include extra assertion checks etc.
+ * ALLOW_UPDATE  - allow insert to update value of existing key
+ * USE_INSTRUMENT - compile in (per-thread) instrumentation counts.
+ * USE_CONTENTION_INSTRUMENT - per-thread contention counts (only).
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "bpautils.h"
+#include "oahttslfq.h"
+#include "atomicdefs.h"
+#include "shardcount.h"
+#include "bigmem.h"
+
+#define ALLOW_UPDATE
+
+/* linear probing step size */
+#define OAHTTSLFQ_PROBE_STEP 1
+
+/* bits at the top of a slot for the number of probes past home + 1 */
+#define OAHTTSLFQ_PROBE_BITS 6
+
+/* maximum number of probes past the home slot before an insert gives up
+   on an array and grows into a new one. So lookups can stop here too.
+   Must fit (plus one) in OAHTTSLFQ_PROBE_BITS. 62 slots is 8 cache lines */
+#define OAHTTSLFQ_MAX_PROBES 62
+
+/* number of slots a thread claims at a time when helping to migrate */
+#define OAHTTSLFQ_COPY_CHUNK 1024
+
+/* largest array we can grow to (slot indices are unsigned int) */
+#define OAHTTSLFQ_GROW_LIMIT 0x80000000U  /* 2^31 */
+
+/* multipliers from the MurmurHash3 fmix64 finaliser (both odd) */
+#define OAHTTSLFQ_MUL1 0xff51afd7ed558ccdULL
+#define OAHTTSLFQ_MUL2 0xc4ceb9fe1a85ec53ULL
+
+/* per-thread instrumentation counters in table->counts */
+enum
+{
+  OAHTTSLFQ_COUNT_KEYS,    /* new keys inserted */
+  OAHTTSLFQ_COUNT_RETRIES  /* CAS failures claiming a slot */
+};
+
+/* fields of slot word w in array a */
+#define SLOT_PROBES1(w) ((unsigned int)((w) >> (64 - OAHTTSLFQ_PROBE_BITS)))
+#define SLOT_REM(a, w) \
+  (((w) >> (a)->value_bits) & (((uint64_t)1 << (a)->rem_bits) - 1))
+#define SLOT_VALUE(a, w) ((w) & (a)->value_mask)
+
+
+/*****************************************************************************
+ *
+ * types
+ *
+ *****************************************************************************/
+
+
+/* One array of slots. Each new array in the chain is twice as big */
+typedef struct oahttslfq_array_s
+{
+    /* Note we depend on an empty slot being 0 since this is */
+    /* allocated with bigmem_alloc() and therefore initilized to zero */
+    volatile uint64_t *slots;
+    size_t mem_size;          /* bytes allocated at slots */
+    unsigned int size;        /* number of slots (power of 2) */
+    unsigned int log2size;    /* number of hash bits implied by the slot */
+    unsigned int rem_bits;    /* number of hash bits stored in the slot */
+    unsigned int value_bits;  /* (same for all arrays in a table) */
+    uint64_t value_mask;      /* (same for all arrays in a table) */
+    unsigned int max_probes;  /* probes past home slot before giving up */
+    struct oahttslfq_array_s *volatile next; /* newer array, or NULL */
+    volatile unsigned int copy_idx;  /* next slot to claim for migration */
+    volatile unsigned int copy_done; /* number of slots migrated so far */
+} oahttslfq_array_t;
+
+
+/*
+ * The hash table itself. Callers only ever see a pointer to this.
+ * Instrumentation is per thread as in oahttslf.c (see comments there).
+ */
+struct oahttslfq_s
+{
+    oahttslfq_array_t *first;            /* oldest array, for freeing */
+    oahttslfq_array_t *volatile current; /* oldest array still in use */
+    unsigned int key_bits;    /* keys are in [0, 2^key_bits) */
+    unsigned int value_bits;  /* values are in [0, 2^value_bits) */
+    uint64_t key_mask;        /* 2^key_bits - 1 */
+    uint64_t value_mask;      /* 2^value_bits - 1 */
+    unsigned int shift;       /* xorshift for hash, at least key_bits/2 */
+    uint64_t mul1_inv;        /* inverse of OAHTTSLFQ_MUL1 mod 2^64 */
+    uint64_t mul2_inv;        /* inverse of OAHTTSLFQ_MUL2 mod 2^64 */
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+    shardcount_t counts;  /* per thread, indexed by OAHTTSLFQ_COUNT_* */
+#endif
+};
+
+/*****************************************************************************
+ *
+ * static functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * mod_inverse()
+ *
+ * Inverse of an odd number mod 2^64, by Newton's method (each step
+ * doubles the number of correct low bits, and a itself is right to 3)
+ *
+ * Parameters:
+ *    a - odd number to invert
+ *
+ * Return value:
+ *    x such that a * x = 1 mod 2^64
+ */
+static uint64_t mod_inverse(uint64_t a)
+{
+  uint64_t x = a;
+  int i;
+
+  for (i = 0; i < 5; i++)
+    x *= 2 - a * x;
+  return x;
+}
+
+
+/*
+ * hash_key()
+ *
+ * Hash a key of key_bits bits into key_bits bits, bijectively
+ * (MurmurHash3 fmix64 with the shifts scaled to key_bits)
+ *
+ * Parameters:
+ *    table - table the key is for
+ *    key   - key to hash, < 2^key_bits
+ *
+ * Return value:
+ *    hash of key, < 2^key_bits
+ */
+static uint64_t hash_key(const oahttslfq_t *table, uint64_t key)
+{
+  key ^= key >> table->shift;
+  key = (key * OAHTTSLFQ_MUL1) & table->key_mask;
+  key ^= key >> table->shift;
+  key = (key * OAHTTSLFQ_MUL2) & table->key_mask;
+  key ^= key >> table->shift;
+  return key;
+}
+
+
+/*
+ * unhash_key()
+ *
+ * Inverse of hash_key()
+ *
+ * Parameters:
+ *    table - table the key is for
+ *    h     - hash of a key
+ *
+ * Return value:
+ *    the key that hashes to h
+ */
+static uint64_t unhash_key(const oahttslfq_t *table, uint64_t h)
+{
+  h ^= h >> table->shift;
+  h = (h * table->mul2_inv) & table->key_mask;
+  h ^= h >> table->shift;
+  h = (h * table->mul1_inv) & table->key_mask;
+  h ^= h >> table->shift;
+  return h;
+}
+
+
+/*
+ * slot_key()
+ *
+ * Get the key stored in a (non-empty) slot back from its remainder and
+ * the home slot, which is how far it is before the slot
+ *
+ * Parameters:
+ *    table - table the array belongs to
+ *    a     - array the slot is in
+ *    i     - index of the slot
+ *    w     - contents of the slot
+ *
+ * Return value:
+ *    the key in the slot
+ */
+static uint64_t slot_key(const oahttslfq_t *table, const oahttslfq_array_t *a,
+                         unsigned int i, uint64_t w)
+{
+  unsigned int home;
+
+  home = (i - (SLOT_PROBES1(w) - 1) * OAHTTSLFQ_PROBE_STEP) & (a->size - 1);
+  return unhash_key(table, (SLOT_REM(a, w) << a->log2size) | home);
+}
+
+
+/*
+ * oahttslfq_new_array()
+ *
+ * Allocate a new empty array of slots
+ *
+ * Parameters:
+ *    table - table it is for (for key and value sizes)
+ *    log2size - log2 of number of slots
+ *
+ * Return value:
+ *    Pointer to new array. Exits with error if out of memory.
+ */
+static oahttslfq_array_t *oahttslfq_new_array(const oahttslfq_t *table,
+                                              unsigned int log2size)
+{
+  oahttslfq_array_t *a;
+
+  a = (oahttslfq_array_t *)bpa_calloc(1, sizeof(oahttslfq_array_t));
+  a->log2size = log2size;
+  a->size = 1U << log2size;
+  a->rem_bits = (log2size < table->key_bits ? table->key_bits - log2size : 0);
+  a->value_bits = table->value_bits;
+  a->value_mask = table->value_mask;
+  assert(OAHTTSLFQ_PROBE_BITS + a->rem_bits + a->value_bits <= 64);
+  a->max_probes = (a->size - 1 < OAHTTSLFQ_MAX_PROBES ? a->size - 1 :
+                   OAHTTSLFQ_MAX_PROBES);
+  a->mem_size = (size_t)a->size * sizeof(uint64_t);
+  a->slots = (volatile uint64_t *)bigmem_alloc(a->mem_size);
+  return a;
+}
+
+
+/*
+ * oahttslfq_free_array()
+ *
+ * Free an array allocated with oahttslfq_new_array()
+ *
+ * Parameters:
+ *    a - array to free
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslfq_free_array(oahttslfq_array_t *a)
+{
+  bigmem_free((void *)(unsigned long)a->slots, a->mem_size);
+  free(a);
+}
+
+
+/*
+ * oahttslfq_getent()
+ *
+ * Get the slot for a key from one array of the hashtable: the slot
+ * with the key in it, or the first empty slot
+ *
+ * Parameters:
+ *     table - table the array belongs to
+ *     a - array to search
+ *     key -  key to look up
+ *     probes - (OUT) number of probes past the home slot to the slot
+ *     rem - (OUT) remainder of key in this array
+ *     w - (OUT) contents of the slot (0 if empty)
+ *  Return value:
+ *     pointer to slot with key, or for key (but currently empty) in array
+ *     or NULL if neither found within max_probes of the home slot
+ */
+static volatile uint64_t *oahttslfq_getent(const oahttslfq_t *table,
+                                           oahttslfq_array_t *a,
+                                           uint64_t key,
+                                           unsigned int *probes,
+                                           uint64_t *rem, uint64_t *w)
+{
+  unsigned int h;
+  uint64_t hash, entw;
+
+  hash = hash_key(table, key);
+  h = (unsigned int)hash & (a->size - 1);
+  *rem = (a->rem_bits ? hash >> a->log2size : 0);
+  for (*probes = 0; *probes <= a->max_probes; (*probes)++)
+  {
+    entw = a->slots[h];
+    /* the slot has our key if it has our remainder and our home slot */
+    if (entw == 0 ||
+        (SLOT_PROBES1(entw) == *probes + 1 && SLOT_REM(a, entw) == *rem))
+    {
+      *w = entw;
+      return &a->slots[h];
+    }
+    h = (h + OAHTTSLFQ_PROBE_STEP) & (a->size - 1); /*SIZE must be 2^n*/
+  }
+  return NULL;
+}
+
+
+/*
+ * oahttslfq_array_lookup()
+ *
+ * Get the value for a key from one array of the hashtable
+ *
+ * Parameters:
+ *     table - table the array belongs to
+ *     a - array to search
+ *     key -  key to look up
+ *     value - (output) value for key,ony set if TRUE returned.
+ *
+ * Return value:
+ *     TRUE if key found, FALSE otherwise.
+ */
+static bool oahttslfq_array_lookup(const oahttslfq_t *table,
+                                   oahttslfq_array_t *a, uint64_t key,
+                                   uint64_t *value)
+{
+  unsigned int probes;
+  uint64_t rem, w;
+
+  if (oahttslfq_getent(table, a, key, &probes, &rem, &w) && w != 0)
+  {
+    *value = SLOT_VALUE(a, w);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+
+/*
+ * oahttslfq_put()
+ *
+ * Put a key/value pair into one array of the hashtable.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to
+ *    a     - array to insert into
+ *    key   - key to insert
+ *    value - value to insert for the key
+ *    overwrite - if TRUE, replace value of existing key, else leave it
+ *    found - (OUT) TRUE if the key was already in this array
+ *    oldvalue - (OUT) value of key in this array before the put
+ *               (only set if found)
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    TRUE if done, FALSE if no slot for key within max_probes (caller
+ *    must grow the table).
+ */
+static bool oahttslfq_put(oahttslfq_t *table, oahttslfq_array_t *a,
+                          uint64_t key, uint64_t value, bool overwrite,
+                          bool *found, uint64_t *oldvalue, int thread_id)
+{
+  volatile uint64_t *ent;
+  unsigned int probes;
+  uint64_t rem, w, seen;
+
+  (void)thread_id; /* only for instrumentation */
+  for (;;)
+  {
+    ent = oahttslfq_getent(table, a, key, &probes, &rem, &w);
+    if (!ent)
+      return FALSE;
+    if (w != 0)
+      break;
+    /* key and value go in together */
+    w = ((uint64_t)(probes + 1) << (64 - OAHTTSLFQ_PROBE_BITS)) |
+        (rem << a->value_bits) | value;
+    if (CAS64(ent, (uint64_t)0, w) == 0)
+    {
+      *found = FALSE;
+      return TRUE;
+    }
+#ifdef USE_CONTENTION_INSTRUMENT
+    SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLFQ_COUNT_RETRIES);
+#endif
+  }
+
+  /* the key part of the word never changes once set, so the CAS can
+     only fail because another thread changed the value */
+  *found = TRUE;
+  *oldvalue = SLOT_VALUE(a, w);
+  while (overwrite && SLOT_VALUE(a, w) != value &&
+         (seen = CAS64(ent, w, (w & ~a->value_mask) | value)) != w)
+    w = seen;
+  return TRUE;
+}
+
+
+/*
+ * oahttslfq_grow()
+ *
+ * Make sure array a has a successor, allocating it if necessary. If
+ * several threads do this at once, only one array is installed and the
+ * others are freed.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to
+ *    a - array that has no room for a key
+ *
+ * Return value:
+ *    The array following a.
+ */
+static oahttslfq_array_t *oahttslfq_grow(const oahttslfq_t *table,
+                                         oahttslfq_array_t *a)
+{
+  static const char *funcname = "oahttslfq_grow";
+  oahttslfq_array_t *newa;
+
+  if (!a->next)
+  {
+    if (a->size >= OAHTTSLFQ_GROW_LIMIT)
+      bpa_fatal_error(funcname, "hash table full\n");
+    newa = oahttslfq_new_array(table, a->log2size + 1);
+    if (CASPTR(&a->next, (oahttslfq_array_t *)NULL, newa) != NULL)
+      oahttslfq_free_array(newa); /* another thread beat us to it */
+  }
+  return a->next;
+}
+
+
+/*
+ * oahttslfq_copy_slot()
+ *
+ * Copy one slot of an array being migrated into the newer arrays, unless
+ * the key is already there.
+ *
+ * Parameters:
+ *    table - hashtable the array belongs to
+ *    a     - array being migrated
+ *    i     - index of slot in a to copy
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslfq_copy_slot(oahttslfq_t *table, oahttslfq_array_t *a,
+                                unsigned int i, int thread_id)
+{
+  oahttslfq_array_t *b;
+  uint64_t w, key, oldvalue;
+  bool found;
+
+  /* unlike oahttslf, a key is never there without its value */
+  w = a->slots[i];
+  if (w == 0)
+    return;
+  key = slot_key(table, a, i, w);
+
+  b = a->next;
+  for (;;)
+  {
+    if (!oahttslfq_put(table, b, key, SLOT_VALUE(a, w), FALSE, &found,
+                       &oldvalue, thread_id))
+    {
+      b = oahttslfq_grow(table, b);
+      continue;
+    }
+    /* if the key was already in b, whoever put it there is responsible
+       for it reaching any newer array */
+    if (found || !b->next)
+      break;
+    b = b->next;
+  }
+}
+
+
+/*
+ * oahttslfq_help_migrate()
+ *
+ * If the oldest array is being migrated, claim a chunk of it and copy
+ * it. The thread that finishes the last chunk moves the current pointer
+ * on so that lookups no longer need to look there.
+ *
+ * Parameters:
+ *    table - hashtable to help migrate
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    None.
+ */
+static void oahttslfq_help_migrate(oahttslfq_t *table, int thread_id)
+{
+  oahttslfq_array_t *a = table->current;
+  unsigned int start, end, i;
+
+  if (!a->next || a->copy_idx >= a->size)
+    return;
+  start = ATOMIC_ADD_32_NV(&a->copy_idx, OAHTTSLFQ_COPY_CHUNK)
+          - OAHTTSLFQ_COPY_CHUNK;
+  if (start >= a->size)
+    return;
+  end = (a->size - start < OAHTTSLFQ_COPY_CHUNK ? a->size :
+         start + OAHTTSLFQ_COPY_CHUNK);
+  for (i = start; i < end; i++)
+    oahttslfq_copy_slot(table, a, i, thread_id);
+
+  if (ATOMIC_ADD_32_NV(&a->copy_done, end - start) == a->size)
+  {
+    while ((a = table->current)->next && a->copy_done == a->size)
+      (void)CASPTR(&table->current, a, a->next);
+  }
+}
+
+
+
+/*****************************************************************************
+ *
+ * external functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * oahttslfq_create()
+ *
+ * Allocate a new empty hashtable. The initial size is chosen as for
+ * oahttslf_create(), but made larger if need be so that the remainder
+ * of a key and a value fit in a slot.
+ *
+ * Parameters:
+ *    max_keys - (estimate of) the maximum number of keys to be inserted
+ *    key_bits - number of bits in a key (1..64)
+ *    value_bits - number of bits in a value
+ *
+ * Return value:
+ *    Pointer to new hashtable. Exits with error if out of memory, or
+ *    if keys and values are too big to ever fit.
+ */
+oahttslfq_t *oahttslfq_create(uint64_t max_keys, unsigned int key_bits,
+                              unsigned int value_bits)
+{
+  static const char *funcname = "oahttslfq_create";
+  oahttslfq_t *table;
+  unsigned int log2size = 0;
+
+  if (key_bits < 1 || key_bits > 64)
+    bpa_fatal_error(funcname, "key_bits %u not in 1..64\n", key_bits);
+  if (OAHTTSLFQ_PROBE_BITS + value_bits > 64)
+    bpa_fatal_error(funcname, "value_bits %u > %d\n", value_bits,
+                    64 - OAHTTSLFQ_PROBE_BITS);
+  while ((1ULL << log2size) < OAHTTSLF_MIN_SIZE ||
+         ((1ULL << log2size) < OAHTTSLF_MAX_SIZE &&
+          (1ULL << log2size) < 2 * max_keys))
+    log2size++;
+  while ((int)(OAHTTSLFQ_PROBE_BITS + key_bits + value_bits - log2size) > 64)
+    log2size++;
+  if ((1ULL << log2size) > OAHTTSLFQ_GROW_LIMIT)
+    bpa_fatal_error(funcname, "%u bit keys with %u bit values do not fit\n",
+                    key_bits, value_bits);
+
+  table = (oahttslfq_t *)bpa_calloc(1, sizeof(oahttslfq_t));
+  table->key_bits = key_bits;
+  table->value_bits = value_bits;
+  table->key_mask = (key_bits == 64 ? ~0ULL : (1ULL << key_bits) - 1);
+  table->value_mask = (1ULL << value_bits) - 1;
+  table->shift = (key_bits + 1) / 2;
+  table->mul1_inv = mod_inverse(OAHTTSLFQ_MUL1);
+  table->mul2_inv = mod_inverse(OAHTTSLFQ_MUL2);
+  table->first = table->current = oahttslfq_new_array(table, log2size);
+  return table;
+}
+
+
+/*
+ * oahttslfq_destroy()
+ *
+ * Free all memory used by a hashtable created with oahttslfq_create()
+ *
+ * Parameters:
+ *    table - hashtable to free
+ *
+ * Return value:
+ *    None.
+ */
+void oahttslfq_destroy(oahttslfq_t *table)
+{
+  oahttslfq_array_t *a, *next;
+
+  for (a = table->first; a; a = next)
+  {
+    next = a->next;
+    oahttslfq_free_array(a);
+  }
+  free(table);
+}
+
+
+/*
+ * oahttslfq_insert()
+ *
+ * Insert a key/value pair into the hashtable, or update the value
+ * for existing key.
+ *
+ * Parameters:
+ *    table - hashtable to insert into
+ *    key   - key to insert (< 2^key_bits)
+ *    value - value to insert for the key (< 2^value_bits)
+ *    thread_id - our thread identifer (0,1,2,.. NOT pthread_t) used
+ *                 only for instrumentation
+ *
+ * Return value:
+ *    TRUE if the key was already in the table, FALSE if it is new.
+ */
+bool oahttslfq_insert(oahttslfq_t *table, uint64_t key, uint64_t value,
+                      int thread_id)
+{
+#ifdef ALLOW_UPDATE
+  const bool overwrite = TRUE;
+#else
+  const bool overwrite = FALSE;
+#endif
+  oahttslfq_array_t *start, *a, *b;
+  uint64_t oldvalue;
+  bool found, was_there = FALSE, first = TRUE;
+
+  assert((key & ~table->key_mask) == 0);
+  assert((value & ~table->value_mask) == 0);
+
+  oahttslfq_help_migrate(table, thread_id);
+
+  start = table->current;
+  for (a = start; a->next; a = a->next)
+    /* new keys always go in the newest array */ ;
+
+  for (;;)
+  {
+    if (!oahttslfq_put(table, a, key, value, overwrite, &found, &oldvalue,
+                       thread_id))
+    {
+      a = oahttslfq_grow(table, a);
+      continue;
+    }
+    if (first)
+    {
+      first = FALSE;
+      was_there = found;
+      /* key may still be in an older array that is not migrated yet */
+      for (b = start; b != a && !was_there; b = b->next)
+        was_there = oahttslfq_array_lookup(table, b, key, &oldvalue);
+#ifdef USE_INSTRUMENT
+      if (!was_there)
+        SHARDCOUNT_INC(&table->counts, thread_id, OAHTTSLFQ_COUNT_KEYS);
+#endif
+    }
+    /* if a newer array appeared while we were writing, the migration
+       may already have passed our slot, so repeat the write there */
+    if (!a->next)
+      break;
+    a = a->next;
+  }
+  return was_there;
+}
+
+
+
+/*
+ * oahttslfq_lookup()
+ *
+ * Get the value for a key from the hashtable
+ *
+ * Parameters:
+ *     table - hashtable to search
+ *     key -  key to look up
+ *     value - (output) value for key,ony set if TRUE returned.
+ *
+ * Return value:
+ *     TRUE if key found, FALSE otherwise.
+ */
+bool oahttslfq_lookup(oahttslfq_t *table, uint64_t key, uint64_t *value)
+{
+  oahttslfq_array_t *a;
+  uint64_t val;
+  bool found = FALSE;
+
+  /* the newest array that has the key has the latest value */
+  for (a = table->current; a; a = a->next)
+  {
+    if (oahttslfq_array_lookup(table, a, key, &val))
+    {
+      *value = val;
+      found = TRUE;
+    }
+  }
+  return found;
+}
+
+
+
+/*
+ * oahttslfq_validate()
+ *
+ * Test for duplicate keys  -this should not happen within one array
+ * (but a key can be in more than one array while migrating) - and that
+ * every key is found where it is
+ *
+ * Parameters:
+ *    table - hashtable to check
+ *
+ * Return value:
+ *    0 if duplicate or unreachable keys found else 1
+ */
+int oahttslfq_validate(oahttslfq_t *table)
+{
+  oahttslfq_array_t *a;
+  unsigned int i, probes;
+  uint64_t rem, w;
+
+  /* since a slot is found from the key, each key can only be found in
+     one slot; so a duplicate would be a slot that is not found */
+  for (a = table->first; a; a = a->next)
+    for (i = 0; i < a->size; i++)
+      if (a->slots[i] != 0 &&
+          oahttslfq_getent(table, a, slot_key(table, a, i, a->slots[i]),
+                           &probes, &rem, &w) != &a->slots[i])
+        return 0;
+
+  return 1;
+}
+
+/*
+ * oahttslfq_printstats()
+ *
+ *   Compute and print statistics about the hash table to stdout
+ *
+ *   Parameters:
+ *      table - hashtable to compute stats for
+ *   Return value: None
+ */
+void oahttslfq_printstats(oahttslfq_t *table)
+{
+  oahttslfq_array_t *a;
+  unsigned int num_items, num_arrays = 0;
+  unsigned int i;
+
+  printf("key bits        : %u\n", table->key_bits);
+  printf("value bits      : %u\n", table->value_bits);
+  for (a = table->first; a; a = a->next)
+  {
+    num_items = 0;
+    for (i = 0; i < a->size; i++)
+    {
+      if (a->slots[i] != 0)
+        num_items++;
+    }
+    printf("array %u size    : %u%s\n", num_arrays, a->size,
+           a == table->current ? " (current)" : "");
+    printf("remainder bits  : %u\n", a->rem_bits);
+    printf("num items       : %u (%f%% full)\n", num_items,
+           100.0*(float)num_items/a->size);
+    num_arrays++;
+  }
+  printf("num arrays      : %u\n", num_arrays);
+}
+
+/*
+ * oahttslfq_reset()
+ *
+ * reset all the table entries to empty. The newest (largest) array is
+ * kept and all the older ones freed. Must not be called while other
+ * threads are using the table.
+ *
+ * Parameters:
+ *    table - hashtable to reset
+ * Return value: None
+ *
+ */
+void oahttslfq_reset(oahttslfq_t *table)
+{
+  oahttslfq_array_t *a, *next;
+  for (a = table->first; a->next; a = next)
+  {
+    next = a->next;
+    oahttslfq_free_array(a);
+  }
+  bigmem_zero((void *)(unsigned long)a->slots, a->mem_size);
+  a->copy_idx = a->copy_done = 0;
+  table->first = table->current = a;
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+  shardcount_reset(&table->counts);
+#endif
+}
+
+
+
+/*
+ * oahttslfq_num_entries()
+ *
+ *   count number of keys in the hash table
+ *   WARNING: may be very slow - iterates thriough whole table; we do
+ *   not have a counter.
+ *
+ *   Parameters:
+ *      table - hashtable to count entries in
+ *   Return value: Number of keys in the hash table
+ */
+unsigned int oahttslfq_num_entries(oahttslfq_t *table)
+{
+  oahttslfq_array_t *a, *b;
+  unsigned int num_items=0;
+  unsigned int i;
+  uint64_t w, key, value;
+  bool newer;
+
+  for (a = table->current; a; a = a->next)
+  {
+    for (i = 0; i < a->size; i++)
+    {
+      w = a->slots[i];
+      if (w != 0)
+      {
+        /* keys already copied to a newer array are counted there */
+        key = slot_key(table, a, i, w);
+        newer = FALSE;
+        for (b = a->next; b && !newer; b = b->next)
+          newer = oahttslfq_array_lookup(table, b, key, &value);
+        if (!newer)
+          num_items++;
+      }
+    }
+  }
+  return num_items;
+}
+
+#ifdef USE_INSTRUMENT
+/*
+ *  add up the per-thread key counters and return total
+ * Parameters:
+ *    table - hashtable to count keys in
+ * Return value: Total number of keys in the hash table
+ */
+unsigned int oahttslfq_total_key_count(oahttslfq_t *table)
+{
+  return (unsigned int)shardcount_total(&table->counts, OAHTTSLFQ_COUNT_KEYS);
+}
+#endif
+
+
+#ifdef USE_CONTENTION_INSTRUMENT
+/*
+ *  add up the per-thread retry counters and return total
+ * Parameters:
+ *    table - hashtable to count retries for
+ * Return value: Total number of times an insertion had to be retried
+ */
+unsigned int oahttslfq_total_retry_count(oahttslfq_t *table)
+{
+  return (unsigned int)shardcount_total(&table->counts, OAHTTSLFQ_COUNT_RETRIES);
+}
+#endif
@@ -0,0 +1,71 @@
+#ifndef OAHTTSLFQ_H
+#define OAHTTSLFQ_H
+/*****************************************************************************
+ *
+ * File:    oahttslfq.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Declarations for quotiented open addressing thread-safe lock-free hash
+ * table, with keys of up to key_bits bits and values of up to value_bits
+ * bits sharing one 64 bit word per slot.
+ *
+ *
+ *****************************************************************************/
+
+#include "bpautils.h"
+#include "oahttslf.h"   /* for uint64_t etc. and OAHTTSLF_MIN/MAX_SIZE */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* there is no empty key or value: any key in [0, 2^key_bits) and any
+   value in [0, 2^value_bits) can be stored */
+
+/* handle for a hash table; contents are private to oahttslfq.c */
+typedef struct oahttslfq_s oahttslfq_t;
+
+
+/* create a new empty hashtable sized to hold max_keys keys of key_bits
+   bits with values of value_bits bits */
+oahttslfq_t *oahttslfq_create(uint64_t max_keys, unsigned int key_bits,
+                              unsigned int value_bits);
+
+/* free all memory used by a hashtable */
+void oahttslfq_destroy(oahttslfq_t *table);
+
+/* insert into hashtable. Returns TRUE if key was already there */
+bool oahttslfq_insert(oahttslfq_t *table, uint64_t key, uint64_t value,
+                      int thread_id);
+
+/* lookup in hashtable */
+bool oahttslfq_lookup(oahttslfq_t *table, uint64_t key, uint64_t *value);
+
+/* test for invalid structure */
+int oahttslfq_validate(oahttslfq_t *table);
+
+/* compute and print stats about hash table */
+void oahttslfq_printstats(oahttslfq_t *table);
+
+/* reset all table entries to empty */
+void oahttslfq_reset(oahttslfq_t *table);
+
+/* return number of keys in table */
+unsigned int oahttslfq_num_entries(oahttslfq_t *table);
+
+#ifdef USE_INSTRUMENT
+/* add up per-thread counters and return total */
+unsigned int oahttslfq_total_key_count(oahttslfq_t *table);
+#endif
+
+#ifdef USE_CONTENTION_INSTRUMENT
+/* add up per-thread retry counters and return total */
+unsigned int oahttslfq_total_retry_count(oahttslfq_t *table);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OAHTTSLFQ_H */
@@ -0,0 +1,246 @@
+/*****************************************************************************
+ *
+ * File:    oahttslfqtest.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Test harness for quotiented open addressing thread-safe lock-free hash
+ * table. Runs concurrent inserts and lookups with narrow keys (as the
+ * knapsack would use) and with full 64 bit keys and small values,
+ * starting small so the tables also grow. Key 0 and value 0 are used
+ * too since oahttslfq has no empty key or value.
+ *
+ * Usage:
+ *    oahttslfqtest [numthreads]
+ *
+ *
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L  /* for rand_r() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "oahttslfq.h"
+
+#define NUM_INSERTIONS  4000000
+
+/* keys are chosen from NUM_KEYS different ones so there are lots of
+   repeated keys */
+#define NUM_KEYS        200000
+
+
+/* a test: keys and values of these sizes, with key n being
+   (n * key_mul) mod 2^key_bits so keys are spread over all the bits */
+typedef struct test_s
+{
+    const char *name;
+    unsigned int key_bits;
+    unsigned int value_bits;
+    uint64_t key_mul;
+} test_t;
+
+static const test_t tests[] =
+{
+  { "narrow keys", 20, 32, 5 },
+  { "64 bit keys", 64, 8, 0x9e3779b97f4a7c15ULL }
+};
+
+
+/***************************************************************************
+ *
+ * thread data
+ *
+ ***************************************************************************/
+
+
+typedef struct thread_data_s
+{
+    int thread_id;
+    int num_insertions;
+    const test_t *test;
+} thread_data_t;
+
+
+static thread_data_t thread_data[MAX_NUM_THREADS];
+
+static oahttslfq_t *hashtable;  /* the table shared by all threads */
+
+
+/***************************************************************************
+ *
+ * test functions
+ *
+ ***************************************************************************/
+
+static uint64_t key_for(const test_t *test, unsigned int n)
+{
+  uint64_t k = n * test->key_mul;
+  return test->key_bits == 64 ? k : k & ((1ULL << test->key_bits) - 1);
+}
+
+/* the value we store for key n; not unique, but different for adjacent
+   keys and 0 for key 0 */
+static uint64_t value_for(const test_t *test, unsigned int n)
+{
+  return (n * 3ULL) & ((1ULL << test->value_bits) - 1);
+}
+
+static void *insert_random(void *threadarg)
+{
+  thread_data_t *mydata = (thread_data_t *)threadarg;
+  const test_t *test = mydata->test;
+  unsigned int seed = mydata->thread_id * time(NULL);
+  unsigned int n;
+  uint64_t value;
+  int q;
+
+  for (q = 0; q < mydata->num_insertions; q++)
+  {
+    n = rand_r(&seed) % NUM_KEYS;
+    if (!oahttslfq_lookup(hashtable, key_for(test, n), &value))
+    {
+      oahttslfq_insert(hashtable, key_for(test, n), value_for(test, n),
+                       mydata->thread_id);
+    }
+    else if (value != value_for(test, n))
+    {
+      fprintf(stderr, "ASSERTION FAILURE: thread %d: n=%u value=%llX\n",
+              mydata->thread_id, n, value);
+      exit(101);
+    }
+  }
+  return NULL;
+}
+
+
+/*
+ * run_test()
+ *
+ * Run the insert test in num_threads threads on a new table, then check
+ * that every key in it has the right value, and that reset() empties it.
+ */
+static void run_test(const test_t *test, int num_threads)
+{
+  int t;
+  int rc;
+  pthread_t threads[MAX_NUM_THREADS];
+  struct timeval start_timeval,end_timeval,elapsed_timeval;
+  int etime;
+  unsigned int n, num_found = 0;
+  uint64_t value;
+
+  /* start small so the test also grows it */
+  hashtable = oahttslfq_create(0, test->key_bits, test->value_bits);
+
+  gettimeofday(&start_timeval, NULL);
+
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    thread_data[t].num_insertions = NUM_INSERTIONS / num_threads;
+    thread_data[t].test = test;
+
+    if ((rc = pthread_create(&threads[t], NULL, insert_random,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* wait for threads */
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+
+  /* every key that is in the table must have the right value */
+  for (n = 0; n < NUM_KEYS; n++)
+  {
+    if (oahttslfq_lookup(hashtable, key_for(test, n), &value))
+    {
+      if (value != value_for(test, n))
+      {
+        fprintf(stderr, "%s: bad value for key %u\n", test->name, n);
+        exit(EXIT_FAILURE);
+      }
+      num_found++;
+    }
+  }
+  if (num_found != oahttslfq_num_entries(hashtable))
+  {
+    fprintf(stderr, "%s: found %u keys but table has %u\n", test->name,
+            num_found, oahttslfq_num_entries(hashtable));
+    exit(EXIT_FAILURE);
+  }
+  if (!oahttslfq_validate(hashtable))
+  {
+    fprintf(stderr, "%s: hash table validation failed\n", test->name);
+    exit(EXIT_FAILURE);
+  }
+  printf("%s: %u keys, elapsed time %d ms\n", test->name, num_found, etime);
+
+#ifdef DEBUG
+  oahttslfq_printstats(hashtable);
+#endif
+
+#ifdef USE_CONTENTION_INSTRUMENT
+  printf("total retry count = %u\n", oahttslfq_total_retry_count(hashtable));
+#endif
+
+  oahttslfq_reset(hashtable);
+  if (oahttslfq_num_entries(hashtable) != 0 ||
+      oahttslfq_lookup(hashtable, key_for(test, 0), &value))
+  {
+    fprintf(stderr, "%s: table not empty after reset\n", test->name);
+    exit(EXIT_FAILURE);
+  }
+  oahttslfq_destroy(hashtable);
+}
+
+
+/***************************************************************************
+ *
+ * main
+ *
+ ***************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  int num_threads;
+  unsigned int i;
+
+  if (argc == 1)
+    num_threads = 2;
+  else if (argc == 2)
+    num_threads = atoi(argv[1]);
+  else
+  {
+    fprintf(stderr, "usage: %s [numthreads]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_threads < 1 || num_threads >  MAX_NUM_THREADS)
+  {
+    fprintf(stderr, "number of threads must be 1..%d\n", MAX_NUM_THREADS);
+    exit(1);
+  }
+
+  for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    run_test(&tests[i], num_threads);
+
+  exit(0);
+}
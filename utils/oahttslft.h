@@ -0,0 +1,692 @@
+#ifndef OAHTTSLFT_H
+#define OAHTTSLFT_H
+/*****************************************************************************
+ *
+ * File:    oahttslft.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Open addressing (closed hashing) thread-safe lock-free hash table as
+ * a C++ template, with the key and value types and their empty
+ * sentinels fixed at compile time. Header only.
+ *
+ * This is the same algorithm as oahttslf.c (see there for the details):
+ * linear probing over cache line buckets, a key claimed with CAS and
+ * then its value set with CAS, and online growth into a chain of
+ * arrays each twice the size of the one before, migrated a chunk at a
+ * time by the inserting threads. What it does not have is the
+ * generation-tagged O(1) reset, bounded probes and max/min combining.
+ *
+ * oahttslf always uses a 64 bit key and a 64 bit value, so every entry
+ * is 16 bytes even when (as in the knapsack) the value is a 32 bit
+ * profit. Here K and V can each be uint32_t or uint64_t, and a bucket
+ * (one 64 byte cache line, keys followed by values) holds as many slots
+ * as fit: 4 slots for 64/64 bits, 5 for 64/32 or 32/64 bits (12.8 bytes
+ * a slot) and 8 for 32/32 bits. So the same number of states takes
+ * correspondingly less memory and bandwidth.
+ *
+ * The empty key and value do not have to be 0, so a caller whose keys
+ * or values can be 0 does not have to remap them (the MAGIC_ZERO of the
+ * knapsack). But if either is not 0 every new array has to be filled
+ * with them, which touches all its pages up front instead of getting
+ * zero pages from the OS lazily.
+ *
+ * Usage:
+ *    typedef oahttslft<uint64_t, uint32_t, 0, 0xffffffff> table_t;
+ *    table_t *t = new table_t(max_keys);
+ *    t->insert(key, value, thread_id);
+ *    if (t->lookup(key, &value)) ...
+ *
+ * oahttslf6432.h is a C callable instantiation of this for C programs.
+ *
+ * Preprocessor symbols:
+ *
+ * USE_GOOD_HASH  - use mixing hash function rather than trivial one
+ * OAHTTSLFT_HASH - hash function family (hashfn.h), overriding USE_GOOD_HASH
+ * ALLOW_UPDATE   - allow insert to update value of existing key
+ * USE_INSTRUMENT - compile in (per-thread) instrumentation counts.
+ * USE_CONTENTION_INSTRUMENT - per-thread contention counts (only).
+ *
+ *****************************************************************************/
+
+#include <string.h>
+#include <assert.h>
+
+#include "bpautils.h"
+#include "oahttslf.h"   /* for uint64_t etc. and OAHTTSLF_MIN/MAX_SIZE */
+#include "atomicdefs.h"
+#include "shardcount.h"
+#include "bigmem.h"
+#include "hashfn.h"
+
+#define USE_GOOD_HASH
+#define ALLOW_UPDATE
+
+/* hash function family (hashfn.h) */
+#ifndef OAHTTSLFT_HASH
+#ifdef USE_GOOD_HASH
+#define OAHTTSLFT_HASH HASHFN_WANG
+#else
+#define OAHTTSLFT_HASH HASHFN_IDENTITY
+#endif
+#endif
+
+/* a bucket is one cache line */
+#define OAHTTSLFT_BUCKET_BYTES 64
+
+/* maximum number of buckets probed past the home bucket, as in oahttslf */
+#define OAHTTSLFT_MAX_PROBES 32
+
+/* number of slots a thread claims at a time when helping to migrate */
+#define OAHTTSLFT_COPY_CHUNK 1024
+
+/* largest array we can grow to (slot indices are unsigned int) */
+#define OAHTTSLFT_GROW_LIMIT 0x80000000U  /* 2^31 */
+
+
+/* CAS on a key or value of either width */
+static inline uint32_t oahttslft_cas(volatile uint32_t *ptr, uint32_t oldval,
+                                     uint32_t newval)
+{
+  return CAS32(ptr, oldval, newval);
+}
+
+static inline uint64_t oahttslft_cas(volatile uint64_t *ptr, uint64_t oldval,
+                                     uint64_t newval)
+{
+  return CAS64(ptr, oldval, newval);
+}
+
+
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+class oahttslft
+{
+public:
+  /* slots in one bucket: as many keys and values as fit in a cache line */
+  enum { BUCKET_SLOTS = OAHTTSLFT_BUCKET_BYTES / (sizeof(K) + sizeof(V)) };
+
+  oahttslft(uint64_t max_keys);
+  ~oahttslft();
+
+  /* insert into hashtable. Returns old value (EMPTY_VALUE if new key) */
+  V insert(K key, V value, int thread_id);
+
+  /* lookup in hashtable, value only set if TRUE returned */
+  bool lookup(K key, V *value);
+
+  /* reset all table entries to empty (no other thread may be using it) */
+  void reset();
+
+  /* number of keys inserted (needs USE_INSTRUMENT) */
+  unsigned int total_key_count();
+
+  /* number of CAS retries claiming a slot (needs USE_CONTENTION_INSTRUMENT) */
+  unsigned int total_retry_count();
+
+  /* number of bytes each slot takes, for reporting */
+  static size_t slot_bytes() { return sizeof(bucket_t) / BUCKET_SLOTS; }
+
+private:
+  /* per-thread instrumentation counters in counts */
+  enum
+  {
+    COUNT_KEYS,    /* new keys inserted */
+    COUNT_RETRIES  /* CAS failures claiming a slot */
+  };
+
+  /* a bucket of slots: slot i is key[i] with value value[i] */
+  typedef struct bucket_s
+  {
+    K key[BUCKET_SLOTS];
+    V value[BUCKET_SLOTS];
+  } __attribute__((aligned(OAHTTSLFT_BUCKET_BYTES))) bucket_t;
+
+  /* one array of buckets. Each new array in the chain is twice as big */
+  typedef struct array_s
+  {
+    bucket_t *buckets;        /* cache line aligned, within mem */
+    void *mem;                /* as allocated, for bigmem_free() */
+    size_t mem_size;          /* bytes allocated at mem */
+    unsigned int size;        /* number of slots (power of 2 buckets) */
+    unsigned int num_buckets; /* power of 2 */
+    unsigned int max_probes;  /* buckets past home bucket before giving up */
+    struct array_s *volatile next;   /* newer array, or NULL */
+    volatile unsigned int copy_idx;  /* next slot to claim for migration */
+    volatile unsigned int copy_done; /* number of slots migrated so far */
+  } array_t;
+
+  array_t *first;            /* oldest array, for freeing */
+  array_t *volatile current; /* oldest array still in use */
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+  shardcount_t counts;       /* per thread, indexed by COUNT_* */
+#endif
+
+  static unsigned int hash_function(const array_t *a, K key);
+  static void clear_array(array_t *a);
+  static array_t *new_array(unsigned int num_buckets);
+  static void free_array(array_t *a);
+  static int bucket_find(volatile bucket_t *b, K key, bool *vacant);
+  static volatile bucket_t *getent(array_t *a, K key, int *slot,
+                                   bool *vacant);
+  static bool array_lookup(array_t *a, K key, V *value);
+  static array_t *grow(array_t *a);
+  bool put(array_t *a, K key, V value, bool overwrite, V *oldvalue,
+           bool *newkey, int thread_id);
+  void copy_slot(array_t *a, unsigned int i, int thread_id);
+  void help_migrate(int thread_id);
+};
+
+
+/*****************************************************************************
+ *
+ * private member functions
+ *
+ *****************************************************************************/
+
+
+/* home bucket of a key, hashed as in oahttslf (see hashfn.h) */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+unsigned int oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::hash_function(
+  const array_t *a, K k)
+{
+  return hashfn(OAHTTSLFT_HASH, (uint64_t)k) &
+    (a->num_buckets - 1); /* size must be 2^n */
+}
+
+
+/*
+ * clear_array()
+ *
+ * Set every slot of an array to the empty key and value. If they are
+ * both 0 this can use bigmem_zero(), which gives back the pages of a
+ * big array rather than writing to them.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+void oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::clear_array(array_t *a)
+{
+  unsigned int i;
+  int j;
+
+  if (EMPTY_KEY == 0 && EMPTY_VALUE == 0)
+  {
+    bigmem_zero(a->mem, a->mem_size);
+    return;
+  }
+  for (i = 0; i < a->num_buckets; i++)
+  {
+    for (j = 0; j < BUCKET_SLOTS; j++)
+    {
+      a->buckets[i].key[j] = EMPTY_KEY;
+      a->buckets[i].value[j] = EMPTY_VALUE;
+    }
+  }
+}
+
+
+/*
+ * new_array()
+ *
+ * Allocate a new empty array of num_buckets (a power of 2) buckets.
+ * Exits with error if out of memory.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+typename oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::array_t *
+oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::new_array(unsigned int num_buckets)
+{
+  array_t *a;
+
+  a = (array_t *)bpa_calloc(1, sizeof(array_t));
+  a->num_buckets = num_buckets;
+  a->size = num_buckets * BUCKET_SLOTS;
+  a->max_probes = (num_buckets - 1 < OAHTTSLFT_MAX_PROBES ?
+                   num_buckets - 1 : OAHTTSLFT_MAX_PROBES);
+  /* one extra bucket lets us align the buckets to cache lines */
+  a->mem_size = (size_t)(num_buckets + 1) * sizeof(bucket_t);
+  a->mem = bigmem_alloc(a->mem_size);
+  a->buckets = (bucket_t *)
+    (((unsigned long)a->mem + OAHTTSLFT_BUCKET_BYTES - 1) &
+     ~(unsigned long)(OAHTTSLFT_BUCKET_BYTES - 1));
+  if (EMPTY_KEY != 0 || EMPTY_VALUE != 0)
+    clear_array(a);
+  return a;
+}
+
+
+/*
+ * free_array()
+ *
+ * Free an array allocated with new_array()
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+void oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::free_array(array_t *a)
+{
+  bigmem_free(a->mem, a->mem_size);
+  free(a);
+}
+
+
+/*
+ * bucket_find()
+ *
+ * Find the slot for a key in one bucket: the first slot that has the key
+ * or is empty (empty slots are always after the occupied ones).
+ * Returns the index in the bucket, or -1 if all slots have other keys.
+ * vacant is set TRUE if the slot returned is empty.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+int oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::bucket_find(
+  volatile bucket_t *b, K key, bool *vacant)
+{
+  int i;
+  K entkey;
+
+  for (i = 0; i < BUCKET_SLOTS; i++)
+  {
+    entkey = b->key[i];
+    if (entkey == key || entkey == EMPTY_KEY)
+    {
+      *vacant = (entkey == EMPTY_KEY);
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+/*
+ * getent()
+ *
+ * Get the bucket and slot for a key (or for it, but empty) in one array,
+ * or NULL if neither within max_probes buckets of the home bucket.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+volatile typename oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::bucket_t *
+oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::getent(array_t *a, K key, int *slot,
+                                                bool *vacant)
+{
+  unsigned int h;
+  volatile bucket_t *b;
+  unsigned int probes = 0;
+
+  h = hash_function(a, key);
+  for (;;)
+  {
+    b = &a->buckets[h];
+    if ((*slot = bucket_find(b, key, vacant)) >= 0)
+      return b;
+    if (++probes > a->max_probes)
+      return NULL;
+    h = (h + 1) & (a->num_buckets - 1);
+  }
+}
+
+
+/*
+ * array_lookup()
+ *
+ * Get the value for a key from one array. TRUE if found (and value set).
+ * A key whose value is not yet set counts as not there.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+bool oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::array_lookup(array_t *a,
+                                                           K key, V *value)
+{
+  volatile bucket_t *b;
+  int slot;
+  bool vacant;
+  V val;
+
+  b = getent(a, key, &slot, &vacant);
+  if (b && !vacant)
+  {
+    val = b->value[slot];
+    if (val != EMPTY_VALUE)
+    {
+      *value = val;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+
+/*
+ * grow()
+ *
+ * Make sure array a has a successor, allocating it if necessary, and
+ * return it. If several threads do this at once only one is installed.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+typename oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::array_t *
+oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::grow(array_t *a)
+{
+  static const char *funcname = "oahttslft::grow";
+  array_t *newa;
+
+  if (!a->next)
+  {
+    if (a->num_buckets >= OAHTTSLFT_GROW_LIMIT / BUCKET_SLOTS)
+      bpa_fatal_error(funcname, "hash table full\n");
+    newa = new_array(a->num_buckets * 2);
+    if (CASPTR(&a->next, (array_t *)NULL, newa) != NULL)
+      free_array(newa); /* another thread beat us to it */
+  }
+  return a->next;
+}
+
+
+/*
+ * put()
+ *
+ * Put a key/value pair into one array. If the key already has a value
+ * it is replaced only if overwrite is TRUE. oldvalue is set to the value
+ * before the put (EMPTY_VALUE if none) and newkey to TRUE if we claimed
+ * the slot. Returns FALSE if no slot within max_probes (caller must grow).
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+bool oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::put(array_t *a, K key, V value,
+                                                  bool overwrite, V *oldvalue,
+                                                  bool *newkey, int thread_id)
+{
+  volatile bucket_t *b;
+  int slot;
+  V oldval;
+  bool vacant;
+
+  (void)thread_id; /* only for instrumentation */
+  *newkey = FALSE;
+  for (;;)
+  {
+    b = getent(a, key, &slot, &vacant);
+    if (!b)
+      return FALSE;
+    if (!vacant)
+      break;
+    if (oahttslft_cas(&b->key[slot], EMPTY_KEY, key) == EMPTY_KEY)
+    {
+      *newkey = TRUE;
+      break;
+    }
+#ifdef USE_CONTENTION_INSTRUMENT
+    SHARDCOUNT_INC(&counts, thread_id, COUNT_RETRIES);
+#endif
+  }
+
+  /* the value is always set with CAS so that it is ordered before we
+     check the next pointer in insert() */
+  do
+  {
+    oldval = b->value[slot];
+    if (oldval != EMPTY_VALUE && (!overwrite || oldval == value))
+      break;  /* shortcut to avoid expense of CAS instruction */
+  }
+  while (oahttslft_cas(&b->value[slot], oldval, value) != oldval);
+
+  *oldvalue = oldval;
+  return TRUE;
+}
+
+
+/*
+ * copy_slot()
+ *
+ * Copy slot i of an array being migrated into the newer arrays, unless
+ * the key is already there.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+void oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::copy_slot(array_t *a,
+                                                        unsigned int i,
+                                                        int thread_id)
+{
+  volatile bucket_t *bucket = &a->buckets[i / BUCKET_SLOTS];
+  array_t *b;
+  K key;
+  V value, oldvalue;
+  bool newkey;
+
+  key = bucket->key[i % BUCKET_SLOTS];
+  if (key == EMPTY_KEY)
+    return;
+  value = bucket->value[i % BUCKET_SLOTS];
+  if (value == EMPTY_VALUE)
+    return; /* insert in progress: the inserter will see a->next and copy */
+
+  b = a->next;
+  for (;;)
+  {
+    if (!put(b, key, value, FALSE, &oldvalue, &newkey, thread_id))
+    {
+      b = grow(b);
+      continue;
+    }
+    /* if the key was already in b, whoever put it there is responsible
+       for it reaching any newer array */
+    if (oldvalue != EMPTY_VALUE || !b->next)
+      break;
+    b = b->next;
+  }
+}
+
+
+/*
+ * help_migrate()
+ *
+ * If the oldest array is being migrated, claim a chunk of it and copy
+ * it. The thread that finishes the last chunk moves current on.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+void oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::help_migrate(int thread_id)
+{
+  array_t *a = current;
+  unsigned int start, end, i;
+
+  if (!a->next || a->copy_idx >= a->size)
+    return;
+  start = ATOMIC_ADD_32_NV(&a->copy_idx, OAHTTSLFT_COPY_CHUNK)
+          - OAHTTSLFT_COPY_CHUNK;
+  if (start >= a->size)
+    return;
+  end = (a->size - start < OAHTTSLFT_COPY_CHUNK ? a->size :
+         start + OAHTTSLFT_COPY_CHUNK);
+  for (i = start; i < end; i++)
+    copy_slot(a, i, thread_id);
+
+  if (ATOMIC_ADD_32_NV(&a->copy_done, end - start) == a->size)
+  {
+    while ((a = current)->next && a->copy_done == a->size)
+      (void)CASPTR(&current, a, a->next);
+  }
+}
+
+
+/*****************************************************************************
+ *
+ * public member functions
+ *
+ *****************************************************************************/
+
+
+/*
+ * Create a new empty hashtable. As oahttslf_create(), the initial size
+ * keeps it at most half full with max_keys keys, clamped to
+ * [OAHTTSLF_MIN_SIZE, OAHTTSLF_MAX_SIZE] slots; it grows if it fills.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::oahttslft(uint64_t max_keys)
+{
+  uint64_t num_buckets = 1;
+
+  while (num_buckets * BUCKET_SLOTS < OAHTTSLF_MIN_SIZE ||
+         (num_buckets * BUCKET_SLOTS < OAHTTSLF_MAX_SIZE &&
+          num_buckets * BUCKET_SLOTS < 2 * max_keys))
+    num_buckets <<= 1;
+  first = current = new_array((unsigned int)num_buckets);
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+  shardcount_reset(&counts);
+#endif
+}
+
+
+/*
+ * Free all memory used by the hashtable.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::~oahttslft()
+{
+  array_t *a, *next;
+
+  for (a = first; a; a = next)
+  {
+    next = a->next;
+    free_array(a);
+  }
+}
+
+
+/*
+ * insert()
+ *
+ * Insert a key/value pair into the newest array, and again into any newer
+ * array that appears while we are doing it. Key must not be EMPTY_KEY and
+ * value must not be EMPTY_VALUE. Returns the value for the key prior to
+ * the insertion (EMPTY_VALUE for a new key).
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+V oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::insert(K key, V value,
+                                                  int thread_id)
+{
+  array_t *start, *a, *b;
+  V oldvalue = EMPTY_VALUE, prevvalue;
+  bool newkey, first_put = TRUE;
+#ifdef ALLOW_UPDATE
+  const bool overwrite = TRUE;
+#else
+  const bool overwrite = FALSE;
+#endif
+
+  assert(key != EMPTY_KEY);
+  assert(value != EMPTY_VALUE);
+
+  help_migrate(thread_id);
+
+  start = current;
+  for (a = start; a->next; a = a->next)
+    /* new keys always go in the newest array */ ;
+
+  for (;;)
+  {
+    if (!put(a, key, value, overwrite, &prevvalue, &newkey, thread_id))
+    {
+      a = grow(a);
+      continue;
+    }
+    if (first_put)
+    {
+      first_put = FALSE;
+      oldvalue = prevvalue;
+      if (oldvalue == EMPTY_VALUE)
+      {
+        /* key may still be in an older array that is not migrated yet */
+        for (b = start; b != a; b = b->next)
+          if (array_lookup(b, key, &prevvalue))
+            oldvalue = prevvalue;
+      }
+#ifdef USE_INSTRUMENT
+      if (newkey && oldvalue == EMPTY_VALUE)
+        SHARDCOUNT_INC(&counts, thread_id, COUNT_KEYS);
+#endif
+    }
+    /* if a newer array appeared while we were writing, the migration
+       may already have passed our slot, so repeat the write there */
+    if (!a->next)
+      break;
+    a = a->next;
+  }
+  return oldvalue;
+}
+
+
+/*
+ * lookup()
+ *
+ * Get the value for a key: the newest array that has it has the latest
+ * value. Returns TRUE if found (and value set), FALSE otherwise.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+bool oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::lookup(K key, V *value)
+{
+  array_t *a;
+  V val;
+  bool found = FALSE;
+
+  for (a = current; a; a = a->next)
+  {
+    if (array_lookup(a, key, &val))
+    {
+      *value = val;
+      found = TRUE;
+    }
+  }
+  return found;
+}
+
+
+/*
+ * reset()
+ *
+ * Set all entries to empty, keeping only the newest (largest) array.
+ * Not thread-safe: no other thread may be using the table.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+void oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::reset()
+{
+  array_t *a, *next;
+
+  for (a = first; a->next; a = next)
+  {
+    next = a->next;
+    free_array(a);
+  }
+  a->copy_idx = a->copy_done = 0;
+  clear_array(a);
+  first = current = a;
+#if defined(USE_INSTRUMENT) || defined(USE_CONTENTION_INSTRUMENT)
+  shardcount_reset(&counts);
+#endif
+}
+
+
+/*
+ * total_key_count()
+ *
+ * Number of keys inserted, summed over the per-thread counts. Only
+ * counts anything if compiled with USE_INSTRUMENT.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+unsigned int oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::total_key_count()
+{
+#ifdef USE_INSTRUMENT
+  return (unsigned int)shardcount_total(&counts, COUNT_KEYS);
+#else
+  return 0;
+#endif
+}
+
+
+/*
+ * total_retry_count()
+ *
+ * Number of CAS failures claiming a slot, summed over the per-thread
+ * counts. Only counts anything if compiled with USE_CONTENTION_INSTRUMENT.
+ */
+template <typename K, typename V, K EMPTY_KEY, V EMPTY_VALUE>
+unsigned int oahttslft<K, V, EMPTY_KEY, EMPTY_VALUE>::total_retry_count()
+{
+#ifdef USE_CONTENTION_INSTRUMENT
+  return (unsigned int)shardcount_total(&counts, COUNT_RETRIES);
+#else
+  return 0;
+#endif
+}
+
+#endif /* OAHTTSLFT_H */
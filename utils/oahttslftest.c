@@ -18,8 +18,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <assert.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
 #include <sys/time.h>
 
 #include "oahttslf.h"
@@ -28,6 +31,38 @@
 
 #define NUM_INSERTIONS  10000000
 
+/* number of keys each of max and min are tested on in test_combine() */
+#define NUM_COMBINE_KEYS 1000
+
+/* keys given values with oahttslf_find_or_reserve()/oahttslf_publish(),
+   and how many reservations each thread holds at once */
+#define NUM_RESERVE_KEYS 200000
+#define NUM_OUTSTANDING  64
+
+/* number of keys put into a table loaded from a snapshot, enough to
+   make it grow out of the mapped array */
+#define NUM_SNAPSHOT_NEW_KEYS 1000000
+
+/* problem id the snapshot of test_snapshot() is saved for */
+#define SNAPSHOT_PROBLEM_ID 0x5eed0f7e57ULL
+
+/* memory for the cache in test_cache(), and the number of keys put in
+   it, far more than fit */
+#define CACHE_BYTES     (1 << 20)
+#define NUM_CACHE_KEYS  400000
+
+/* length of the two sequences in test_cache_dp(), which has CACHE_DP_N^2
+   states, and the memory for its cache, room for 1/8 of them. It fails
+   if it takes more than CACHE_DP_SECONDS (it takes well under 1) */
+#define CACHE_DP_N       1024
+#define CACHE_DP_BYTES   (1 << 22)
+#define CACHE_DP_SECONDS 60
+
+/* keys (i << 32 | w) in test_delete(), as knapsack states of item i and
+   weight w */
+#define NUM_DELETE_ITEMS   100
+#define NUM_DELETE_WEIGHTS 2000
+
 
 /*
  *TODO FIXME 
@@ -137,6 +172,8 @@ typedef struct thread_data_s
 
 static thread_data_t thread_data[MAX_NUM_THREADS];
 
+static oahttslf_t *hashtable;  /* the table shared by all threads */
+
 
 
 /***************************************************************************
@@ -224,7 +261,7 @@ static void *actions_fromlist(void *threadarg)
 #ifdef DEBUG
           printf("lookup(%16llX)", actions[q].key);
 #endif
-          found = oahttslf_lookup(actions[q].key, &ivalue);
+          found = oahttslf_lookup(hashtable, actions[q].key, &ivalue);
 #ifdef DEBUG
           if (found)
               printf(" = %llu\n", ivalue);
@@ -237,7 +274,7 @@ static void *actions_fromlist(void *threadarg)
 #ifdef DEBUG
           printf("insert(%16llX, %llu)\n", actions[q].key, actions[q].value);
 #endif
-          oahttslf_insert(actions[q].key, actions[q].value, mydata->thread_id);
+          oahttslf_insert(hashtable, actions[q].key, actions[q].value, mydata->thread_id);
           break;
 
       default:
@@ -263,14 +300,14 @@ static void *insert_random(void *threadarg)
     if (s.low == 0)
         s.low = 1;
     s.high = 0;
-    if (!oahttslf_lookup(s.low, &value))
+    if (!oahttslf_lookup(hashtable, s.low, &value))
     {
 
       snew.low = ((uint32_t)rand_r(&seed) << 31 | (uint32_t)rand_r(&seed)) + 1;  
       if (snew.low == 0)
           snew.low = 1;
       snew.high = 0;
-      if (oahttslf_lookup(snew.low, &ivalue))
+      if (oahttslf_lookup(hashtable, snew.low, &ivalue))
       {
         if (ivalue != snew.low) {
           fprintf(stderr, "ASSERTION FAILURE: thread %d: ivalue=%llX snew.low=%llX\n",  mydata->thread_id, ivalue, snew.low);
@@ -279,7 +316,7 @@ static void *insert_random(void *threadarg)
       }
 
       value = (uint64_t)s.low;
-      oahttslf_insert(s.low, value, mydata->thread_id);
+      oahttslf_insert(hashtable, s.low, value, mydata->thread_id);
     }
     else
     {
@@ -294,6 +331,727 @@ static void *insert_random(void *threadarg)
 }
 
 
+/* check that after a reset nothing is in the table, including a key we
+   put there just before, and that the table works again after it
+   (blocks are cleared as threads insert into them) */
+static void test_reset(int num_threads)
+{
+  const uint64_t key = 0x123456789ULL;
+  pthread_t threads[MAX_NUM_THREADS];
+  uint64_t value;
+  int t, rc;
+
+  oahttslf_insert(hashtable, key, 1, 0);
+  oahttslf_reset(hashtable);
+  if (oahttslf_num_entries(hashtable) != 0 ||
+      oahttslf_lookup(hashtable, key, &value))
+  {
+    fprintf(stderr, "table not empty after reset\n");
+    exit(EXIT_FAILURE);
+  }
+  if (oahttslf_insert(hashtable, key, 2, 0) != OAHTTSLF_EMPTY_VALUE ||
+      !oahttslf_lookup(hashtable, key, &value) || value != 2)
+  {
+    fprintf(stderr, "bad insert after reset\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    thread_data[t].num_insertions = NUM_INSERTIONS / 10 / num_threads;
+    if ((rc = pthread_create(&threads[t], NULL, insert_random,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (!oahttslf_lookup(hashtable, key, &value) || value != 2)
+  {
+    fprintf(stderr, "lost key inserted after reset\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+/* value thread t contributes to a combining key on its q'th insert:
+   signed, spread about zero, never the empty value 0 */
+static uint64_t combine_value(int t, int q)
+{
+  long long v = (long long)((q * 2654435761U + t * 40503U) % 2000001) - 1000000;
+  return (uint64_t)(v == 0 ? 1 : v);
+}
+
+/* each thread puts its values into every combining key with max (keys
+   1..NUM_COMBINE_KEYS) and min (the next NUM_COMBINE_KEYS keys), plus
+   distinct filler keys so the table grows while it does so */
+static void *combine_thread(void *threadarg)
+{
+  thread_data_t *mydata = (thread_data_t *)threadarg;
+  int t = mydata->thread_id;
+  int q;
+
+  for (q = 0; q < mydata->num_insertions; q++)
+  {
+    oahttslf_insert_max(hashtable, q % NUM_COMBINE_KEYS + 1,
+                        combine_value(t, q), t);
+    oahttslf_insert_min(hashtable, q % NUM_COMBINE_KEYS + 1 + NUM_COMBINE_KEYS,
+                        combine_value(t, q), t);
+    oahttslf_insert(hashtable, ((uint64_t)(t + 1) << 32) | (uint64_t)(q + 1),
+                    1, t);
+  }
+  return NULL;
+}
+
+/* check that concurrent max/min inserts leave the max/min of all the
+   values put into each key, in a new table that grows meanwhile */
+static void test_combine(int num_threads)
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  long long maxval[NUM_COMBINE_KEYS], minval[NUM_COMBINE_KEYS], v;
+  uint64_t value;
+  int t, q, k, rc;
+
+  oahttslf_destroy(hashtable);
+  hashtable = oahttslf_create(0);
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    thread_data[t].num_insertions = NUM_INSERTIONS / 10 / num_threads;
+    if ((rc = pthread_create(&threads[t], NULL, combine_thread,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (k = 0; k < NUM_COMBINE_KEYS; k++)
+  {
+    maxval[k] = LLONG_MIN;
+    minval[k] = LLONG_MAX;
+  }
+  for (t = 0; t < num_threads; t++)
+  {
+    for (q = 0; q < thread_data[t].num_insertions; q++)
+    {
+      v = (long long)combine_value(t, q);
+      k = q % NUM_COMBINE_KEYS;
+      if (v > maxval[k])
+        maxval[k] = v;
+      if (v < minval[k])
+        minval[k] = v;
+    }
+  }
+  for (k = 0; k < NUM_COMBINE_KEYS; k++)
+  {
+    if (!oahttslf_lookup(hashtable, k + 1, &value) ||
+        (long long)value != maxval[k])
+    {
+      fprintf(stderr, "bad max for key %d\n", k + 1);
+      exit(EXIT_FAILURE);
+    }
+    if (!oahttslf_lookup(hashtable, k + 1 + NUM_COMBINE_KEYS, &value) ||
+        (long long)value != minval[k])
+    {
+      fprintf(stderr, "bad min for key %d\n", k + 1 + NUM_COMBINE_KEYS);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/* each thread reserves the keys 1..NUM_RESERVE_KEYS (in a different
+   order in each thread) NUM_OUTSTANDING at a time, then publishes the
+   ones it reserved, so the table grows while handles are outstanding */
+static void *reserve_thread(void *threadarg)
+{
+  thread_data_t *mydata = (thread_data_t *)threadarg;
+  oahttslf_handle_t handles[NUM_OUTSTANDING];
+  uint64_t keys[NUM_OUTSTANDING];
+  uint64_t key, value;
+  int t = mydata->thread_id;
+  int q, n = 0, x;
+
+  for (q = 0; q < NUM_RESERVE_KEYS; q++)
+  {
+    key = (uint64_t)((q + t * (NUM_RESERVE_KEYS / 7)) % NUM_RESERVE_KEYS) + 1;
+    if (oahttslf_find_or_reserve(hashtable, key, &value, &handles[n], t))
+    {
+      if (value != key * 3)
+      {
+        fprintf(stderr, "bad value %llX for reserved key %llX\n", value, key);
+        exit(EXIT_FAILURE);
+      }
+    }
+    else
+      keys[n++] = key;
+    if (n == NUM_OUTSTANDING || q == NUM_RESERVE_KEYS - 1)
+    {
+      for (x = 0; x < n; x++)
+        oahttslf_publish(hashtable, &handles[x], keys[x] * 3, t);
+      n = 0;
+    }
+  }
+  return NULL;
+}
+
+/* check that keys given values with find_or_reserve and publish by
+   several threads at once, in a new table that grows meanwhile, are all
+   there once each with the right value */
+static void test_reserve(int num_threads)
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  uint64_t key, value;
+  int t, rc;
+
+  oahttslf_destroy(hashtable);
+  hashtable = oahttslf_create(0);
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    if ((rc = pthread_create(&threads[t], NULL, reserve_thread,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (key = 1; key <= NUM_RESERVE_KEYS; key++)
+  {
+    if (!oahttslf_lookup(hashtable, key, &value) || value != key * 3)
+    {
+      fprintf(stderr, "bad value for published key %llX\n", key);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (oahttslf_num_entries(hashtable) != NUM_RESERVE_KEYS)
+  {
+    fprintf(stderr, "%u keys in table after publish not %d\n",
+            oahttslf_num_entries(hashtable), NUM_RESERVE_KEYS);
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+/* check the states a key goes through when claimed and published */
+static void test_claim(void)
+{
+  const uint64_t key = 0xc1a1aedULL;
+  oahttslf_handle_t handle, handle2;
+  uint64_t value;
+
+  if (oahttslf_lookup_state(hashtable, key, &value) != OAHTTSLF_ABSENT ||
+      oahttslf_find_or_claim(hashtable, key, &value, &handle, 0) !=
+      OAHTTSLF_CLAIMED ||
+      oahttslf_lookup_state(hashtable, key, &value) != OAHTTSLF_PENDING ||
+      oahttslf_lookup(hashtable, key, &value) ||
+      oahttslf_find_or_claim(hashtable, key, &value, &handle2, 1) !=
+      OAHTTSLF_PENDING)
+  {
+    fprintf(stderr, "bad state for claimed key\n");
+    exit(EXIT_FAILURE);
+  }
+  oahttslf_publish(hashtable, &handle2, 7, 1);
+  if (oahttslf_lookup_state(hashtable, key, &value) != OAHTTSLF_FOUND ||
+      value != 7 ||
+      oahttslf_find_or_claim(hashtable, key, &value, &handle, 0) !=
+      OAHTTSLF_FOUND || value != 7)
+  {
+    fprintf(stderr, "bad state for published key\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+/* check that a snapshot of the table left by test_reserve() and
+   test_claim() loads with the same keys and values, that the loaded
+   table can grow, that changing it leaves the file as it was, and that
+   it will not load for another problem */
+static void test_snapshot(int num_threads)
+{
+  char filename[64];
+  oahttslf_t *loaded;
+  uint64_t key, value;
+
+  sprintf(filename, "/tmp/oahttslftest.%d.snapshot", (int)getpid());
+  if (oahttslf_save(hashtable, filename, SNAPSHOT_PROBLEM_ID,
+                    num_threads) != 0 ||
+      !(loaded = oahttslf_load(filename, SNAPSHOT_PROBLEM_ID)))
+  {
+    fprintf(stderr, "cannot save and load snapshot %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  for (key = 1; key <= NUM_RESERVE_KEYS; key++)
+  {
+    if (!oahttslf_lookup(loaded, key, &value) || value != key * 3)
+    {
+      fprintf(stderr, "bad value for key %llX in snapshot\n", key);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (oahttslf_num_entries(loaded) != oahttslf_num_entries(hashtable))
+  {
+    fprintf(stderr, "%u keys in snapshot not %u\n",
+            oahttslf_num_entries(loaded), oahttslf_num_entries(hashtable));
+    exit(EXIT_FAILURE);
+  }
+
+  if (!oahttslf_validate_par(loaded, num_threads))
+  {
+    fprintf(stderr, "snapshot validation failed\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (key = NUM_RESERVE_KEYS + 1;
+       key <= NUM_RESERVE_KEYS + NUM_SNAPSHOT_NEW_KEYS; key++)
+    oahttslf_insert(loaded, key, key * 5, 0);
+  for (key = 1; key <= NUM_RESERVE_KEYS + NUM_SNAPSHOT_NEW_KEYS; key++)
+  {
+    if (!oahttslf_lookup(loaded, key, &value) ||
+        value != key * (key <= NUM_RESERVE_KEYS ? 3 : 5))
+    {
+      fprintf(stderr, "bad value for key %llX after growing snapshot\n", key);
+      exit(EXIT_FAILURE);
+    }
+  }
+  oahttslf_destroy(loaded);
+
+  if (!(loaded = oahttslf_load(filename, SNAPSHOT_PROBLEM_ID)) ||
+      oahttslf_lookup(loaded, NUM_RESERVE_KEYS + 1, &value))
+  {
+    fprintf(stderr, "snapshot %s changed by changing the table\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  oahttslf_destroy(loaded);
+
+  if ((loaded = oahttslf_load(filename, SNAPSHOT_PROBLEM_ID + 1)))
+  {
+    fprintf(stderr, "snapshot %s loaded for another problem\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  unlink(filename);
+}
+
+
+/* key of item i weight w in test_delete(), value it is first given, and
+   the value it has at the end (0 if deleted): every third weight is
+   deleted, and every ninth put back again with another value */
+#define DELETE_KEY(i, w) ((uint64_t)(i) << 32 | (uint64_t)(w))
+#define DELETE_FINAL(i, w) \
+  ((w) % 9 == 0 ? DELETE_KEY(i, w) * 7 : (w) % 3 == 0 ? 0 : \
+   DELETE_KEY(i, w) * 3)
+
+/* each thread puts in the states of its items, deleting and putting back
+   some of each item's keys as it goes, so the table grows meanwhile */
+static void *delete_thread(void *threadarg)
+{
+  thread_data_t *mydata = (thread_data_t *)threadarg;
+  int t = mydata->thread_id;
+  uint64_t key;
+  int i, w;
+
+  for (i = t + 1; i <= NUM_DELETE_ITEMS; i += mydata->num_insertions)
+  {
+    for (w = 1; w <= NUM_DELETE_WEIGHTS; w++)
+      oahttslf_insert(hashtable, DELETE_KEY(i, w), DELETE_KEY(i, w) * 3, t);
+    for (w = 3; w <= NUM_DELETE_WEIGHTS; w += 3)
+    {
+      key = DELETE_KEY(i, w);
+      if (!oahttslf_delete(hashtable, key, t) ||
+          oahttslf_delete(hashtable, key, t))
+      {
+        fprintf(stderr, "bad delete of key %llX\n", key);
+        exit(EXIT_FAILURE);
+      }
+      if (w % 9 == 0)
+        oahttslf_insert(hashtable, key, key * 7, t);
+    }
+  }
+  return NULL;
+}
+
+/* TRUE for a key of one of the first arg items, to compact away */
+static bool delete_below(uint64_t key, uint64_t value, void *arg)
+{
+  (void)value;
+  return (key >> 32) <= *(uint64_t *)arg;
+}
+
+/* check the keys of items from item first on (and none before) are
+   there with their final value, and the table is valid */
+static void check_deleted(int first, int num_threads, const char *when)
+{
+  uint64_t key, value, expect;
+  unsigned int num_keys = 0;
+  int i, w;
+
+  for (i = 1; i <= NUM_DELETE_ITEMS; i++)
+  {
+    for (w = 1; w <= NUM_DELETE_WEIGHTS; w++)
+    {
+      key = DELETE_KEY(i, w);
+      expect = (i >= first ? DELETE_FINAL(i, w) : 0);
+      if (expect)
+        num_keys++;
+      if (oahttslf_lookup(hashtable, key, &value) ?
+          value != expect : expect != 0)
+      {
+        fprintf(stderr, "bad value for key %llX %s\n", key, when);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  if (oahttslf_num_entries(hashtable) != num_keys)
+  {
+    fprintf(stderr, "%u keys in table %s not %u\n",
+            oahttslf_num_entries(hashtable), when, num_keys);
+    exit(EXIT_FAILURE);
+  }
+  if (!oahttslf_validate_par(hashtable, num_threads))
+  {
+    fprintf(stderr, "hash table validation failed %s\n", when);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* check that keys deleted by several threads at once, in a new table
+   that grows meanwhile, are gone and can be put back, that a deleted key
+   can be claimed again, and that compacting the table removes the keys
+   picked and keeps the rest */
+static void test_delete(int num_threads)
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  oahttslf_handle_t handle;
+  uint64_t key = DELETE_KEY(1, 3), value, below;
+  int t, rc;
+
+  oahttslf_destroy(hashtable);
+  hashtable = oahttslf_create(0);
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    thread_data[t].num_insertions = num_threads; /* item stride */
+    if ((rc = pthread_create(&threads[t], NULL, delete_thread,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  check_deleted(1, num_threads, "after delete");
+
+  if (oahttslf_lookup_state(hashtable, key, &value) != OAHTTSLF_ABSENT ||
+      oahttslf_find_or_claim(hashtable, key, &value, &handle, 0) !=
+      OAHTTSLF_CLAIMED ||
+      oahttslf_publish(hashtable, &handle, 5, 0) != 0 ||
+      !oahttslf_lookup(hashtable, key, &value) || value != 5 ||
+      !oahttslf_delete(hashtable, key, 0))
+  {
+    fprintf(stderr, "bad claim of deleted key\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (oahttslf_compact(hashtable, NULL, NULL, num_threads) != 0)
+  {
+    fprintf(stderr, "compact without predicate removed keys\n");
+    exit(EXIT_FAILURE);
+  }
+  check_deleted(1, num_threads, "after compact");
+  below = NUM_DELETE_ITEMS / 2;
+  if (oahttslf_compact(hashtable, delete_below, &below, num_threads) !=
+      (uint64_t)below * (NUM_DELETE_WEIGHTS - NUM_DELETE_WEIGHTS / 3 +
+                         NUM_DELETE_WEIGHTS / 9))
+  {
+    fprintf(stderr, "compact removed wrong number of keys\n");
+    exit(EXIT_FAILURE);
+  }
+  check_deleted((int)below + 1, num_threads, "after compacting items away");
+}
+
+
+/* cost of a key in test_cache(): odd keys are expensive */
+static unsigned int cache_cost(uint64_t key)
+{
+  return key % 2 ? OAHTTSLF_MAX_COST : 0;
+}
+
+/* each thread puts the keys 1..NUM_CACHE_KEYS (in a different order in
+   each thread) into the cache, some with find_or_claim and publish and
+   some with insert, checking the value of every key it finds there */
+static void *cache_thread(void *threadarg)
+{
+  thread_data_t *mydata = (thread_data_t *)threadarg;
+  oahttslf_handle_t handle;
+  uint64_t key, value;
+  int t = mydata->thread_id;
+  int q;
+
+  for (q = 0; q < NUM_CACHE_KEYS; q++)
+  {
+    key = (uint64_t)((q + t * (NUM_CACHE_KEYS / 7)) % NUM_CACHE_KEYS) + 1;
+    if (key % 3 == 0)
+    {
+      if (!oahttslf_lookup(hashtable, key, &value))
+        oahttslf_insert(hashtable, key, key * 3, t);
+      else if (value != key * 3)
+      {
+        fprintf(stderr, "bad value %llX for cached key %llX\n", value, key);
+        exit(EXIT_FAILURE);
+      }
+    }
+    else if (oahttslf_find_or_claim(hashtable, key, &value, &handle, t) ==
+             OAHTTSLF_FOUND)
+    {
+      if (value != key * 3)
+      {
+        fprintf(stderr, "bad value %llX for claimed cached key %llX\n",
+                value, key);
+        exit(EXIT_FAILURE);
+      }
+    }
+    else
+      oahttslf_publish(hashtable, &handle, key * 3, t);
+  }
+  return NULL;
+}
+
+/* check that a cache with room for only some of the keys put in it by
+   several threads at once never gives a wrong value, and keeps more of
+   the expensive keys than the cheap ones */
+static void test_cache(int num_threads)
+{
+  pthread_t threads[MAX_NUM_THREADS];
+  uint64_t key, value;
+  unsigned int num_odd = 0, num_even = 0;
+  int t, rc;
+
+  oahttslf_destroy(hashtable);
+  hashtable = oahttslf_create_cache(CACHE_BYTES, cache_cost);
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    if ((rc = pthread_create(&threads[t], NULL, cache_thread,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (key = 1; key <= NUM_CACHE_KEYS; key++)
+  {
+    if (oahttslf_lookup(hashtable, key, &value))
+    {
+      if (value != key * 3)
+      {
+        fprintf(stderr, "bad value for cached key %llX\n", key);
+        exit(EXIT_FAILURE);
+      }
+      if (key % 2)
+        num_odd++;
+      else
+        num_even++;
+    }
+  }
+  if (num_odd + num_even == 0 ||
+      (uint64_t)(num_odd + num_even) * 16 > CACHE_BYTES ||
+      num_odd <= num_even)
+  {
+    fprintf(stderr, "cache kept %u expensive and %u cheap keys\n",
+            num_odd, num_even);
+    exit(EXIT_FAILURE);
+  }
+  if (!oahttslf_validate_par(hashtable, num_threads))
+  {
+    fprintf(stderr, "cache validation failed\n");
+    exit(EXIT_FAILURE);
+  }
+#ifdef USE_INSTRUMENT
+  if (oahttslf_total_eviction_count(hashtable) == 0)
+  {
+    fprintf(stderr, "nothing evicted from full cache\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+}
+
+
+/* key for the state (i,j) of test_cache_dp() with i,j > 0, and its cost:
+   as for the span in bpalign, the work under (i,j) grows with i + j */
+static uint64_t cache_dp_key(unsigned int i, unsigned int j)
+{
+  return (uint64_t)i << 32 | j;
+}
+
+static unsigned int cache_dp_cost(uint64_t key)
+{
+  return ((unsigned int)(key >> 32) + (unsigned int)(key & 0xffffffff)) *
+    OAHTTSLF_MAX_COST / (2 * CACHE_DP_N);
+}
+
+/* cost of matching i with j in test_cache_dp() */
+static uint64_t cache_dp_weight(unsigned int i, unsigned int j)
+{
+  return (i * 7 + j * 13) % 101;
+}
+
+/* edit distance of the prefixes of length i and j, with costs of 1 to
+   skip a position and cache_dp_weight() to match two, memoized top down
+   in the cache (values are stored plus one, since 0 is empty) */
+static uint64_t cache_dp(unsigned int i, unsigned int j)
+{
+  oahttslf_handle_t handle;
+  uint64_t value, best;
+
+  if (i == 0 || j == 0)
+    return i + j;
+  if (oahttslf_find_or_claim(hashtable, cache_dp_key(i, j), &value, &handle,
+                             0) == OAHTTSLF_FOUND)
+    return value - 1;
+  best = cache_dp(i - 1, j) + 1;
+  if ((value = cache_dp(i, j - 1) + 1) < best)
+    best = value;
+  if ((value = cache_dp(i - 1, j - 1) + cache_dp_weight(i, j)) < best)
+    best = value;
+  oahttslf_publish(hashtable, &handle, best + 1, 0);
+  return best;
+}
+
+static void cache_dp_timeout(int sig)
+{
+  static const char msg[] = "cache dynamic program did not finish\n";
+
+  (void)sig;
+  (void)write(STDERR_FILENO, msg, sizeof(msg) - 1);
+  _exit(EXIT_FAILURE);
+}
+
+/* check that a top-down dynamic program with a cache that holds only a
+   small part of its states still finishes in reasonable time (evicting
+   the wrong states makes the recomputation exponential), and gets the
+   same answer as computing it bottom up */
+static void test_cache_dp(void)
+{
+  uint64_t *row, diag, up, value;
+  unsigned int i, j;
+
+  if (!(row = (uint64_t *)malloc((CACHE_DP_N + 1) * sizeof(uint64_t))))
+  {
+    fprintf(stderr, "malloc failed\n");
+    exit(EXIT_FAILURE);
+  }
+  for (j = 0; j <= CACHE_DP_N; j++)
+    row[j] = j;
+  for (i = 1; i <= CACHE_DP_N; i++)
+  {
+    diag = row[0];
+    row[0] = i;
+    for (j = 1; j <= CACHE_DP_N; j++)
+    {
+      up = row[j];
+      value = up + 1;
+      if (row[j - 1] + 1 < value)
+        value = row[j - 1] + 1;
+      if (diag + cache_dp_weight(i, j) < value)
+        value = diag + cache_dp_weight(i, j);
+      row[j] = value;
+      diag = up;
+    }
+  }
+
+  oahttslf_destroy(hashtable);
+  hashtable = oahttslf_create_cache(CACHE_DP_BYTES, cache_dp_cost);
+  signal(SIGALRM, cache_dp_timeout);
+  alarm(CACHE_DP_SECONDS);
+  value = cache_dp(CACHE_DP_N, CACHE_DP_N);
+  alarm(0);
+  if (value != row[CACHE_DP_N])
+  {
+    fprintf(stderr, "cache dynamic program got %llu not %llu\n",
+            value, row[CACHE_DP_N]);
+    exit(EXIT_FAILURE);
+  }
+  free(row);
+}
+
+
+/* check that a batch lookup of keys left by test_combine(), some there
+   and some not, gives the same answers as looking them up one at a time */
+static void test_lookup_batch(void)
+{
+  uint64_t keys[2 * NUM_COMBINE_KEYS], values[2 * NUM_COMBINE_KEYS];
+  bool found[2 * NUM_COMBINE_KEYS];
+  uint64_t value;
+  unsigned int k, n = 2 * NUM_COMBINE_KEYS, num_found = 0;
+
+  /* every other key is past the max and min keys so is not there */
+  for (k = 0; k < n; k++)
+    keys[k] = (k % 2 ? k + 1 : k + 1 + 2 * NUM_COMBINE_KEYS);
+  if (oahttslf_lookup_batch(hashtable, keys, n, values, found) != n / 2)
+  {
+    fprintf(stderr, "wrong number of keys found by batch lookup\n");
+    exit(EXIT_FAILURE);
+  }
+  for (k = 0; k < n; k++)
+  {
+    if (found[k] != oahttslf_lookup(hashtable, keys[k], &value) ||
+        (found[k] && values[k] != value))
+    {
+      fprintf(stderr, "bad batch lookup for key %llX\n", keys[k]);
+      exit(EXIT_FAILURE);
+    }
+    if (found[k])
+      num_found++;
+  }
+  if (num_found != n / 2)
+  {
+    fprintf(stderr, "found %u keys in batch not %u\n", num_found, n / 2);
+    exit(EXIT_FAILURE);
+  }
+}
+
 
 /***************************************************************************
  *
@@ -352,7 +1110,12 @@ int main(int argc, char *argv[])
   }
 
   if (readstdin)
+  {
     num_actions = read_actions(stdin, actions);
+    hashtable = oahttslf_create(num_actions);
+  }
+  else
+    hashtable = oahttslf_create(0); /* start small so the test also grows it */
 
 
   gettimeofday(&start_timeval, NULL);
@@ -404,20 +1167,38 @@ int main(int argc, char *argv[])
   etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
   printf("elapsed time %d ms\n", etime);
 
-#ifdef DEBUG 
-  if (!oahttslf_validate())
+  if (!oahttslf_validate_par(hashtable, num_threads))
   {
       fprintf(stderr, "hash table validation failed\n");
       exit(EXIT_FAILURE);
   }
 
-  oahttslf_printstats();
+#ifdef DEBUG 
+  oahttslf_printstats_par(hashtable, num_threads);
 #endif
 
 #ifdef USE_CONTENTION_INSTRUMENT
-  printf("total retry count = %ld\n", oahttslf_total_retry_count());
+  printf("total retry count = %ld\n", oahttslf_total_retry_count(hashtable));
 #endif
 
+  if (!readstdin)
+  {
+    test_reset(num_threads);
+    if (!oahttslf_validate(hashtable))
+    {
+      fprintf(stderr, "hash table validation failed after reset\n");
+      exit(EXIT_FAILURE);
+    }
+    test_combine(num_threads);
+    test_lookup_batch();
+    test_reserve(num_threads);
+    test_claim();
+    test_snapshot(num_threads);
+    test_delete(num_threads);
+    test_cache(num_threads);
+    test_cache_dp();
+  }
+
 
   pthread_exit(NULL);
 }
@@ -0,0 +1,225 @@
+/*****************************************************************************
+ *
+ * File:    oahttslfttest.cpp
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Test harness for the oahttslft template lock-free hash table. Runs the
+ * same concurrent insert/lookup test on each of the key/value widths,
+ * starting small so the tables also grow. The table with non-zero
+ * empty sentinels also gets the key 0 and the value 0. The values
+ * differ from the keys in the high bits, so the test fails if a value
+ * is truncated or goes in the wrong slot.
+ *
+ * Usage:
+ *    oahttslfttest [numthreads]
+ *
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "oahttslft.h"
+
+#define NUM_INSERTIONS  4000000
+
+/* keys are (first + n) for n in [0,NUM_KEYS) so there are lots of
+   repeated keys */
+#define NUM_KEYS        200000
+
+
+typedef oahttslft<uint64_t, uint64_t, 0, 0> table6464_t;
+typedef oahttslft<uint64_t, uint32_t, 0xffffffffffffffffULL, 0xffffffffU>
+        table6432_t;
+typedef oahttslft<uint32_t, uint32_t, 0, 0> table3232_t;
+
+
+/***************************************************************************
+ *
+ * thread data
+ *
+ ***************************************************************************/
+
+
+template <typename T> struct thread_data_s
+{
+    int thread_id;
+    int num_insertions;
+    T *table;
+    unsigned int first;  /* smallest key (0 only if 0 is not EMPTY_KEY) */
+};
+
+
+/***************************************************************************
+ *
+ * test functions
+ *
+ ***************************************************************************/
+
+/* the value we store for key n (0 for n = 0) */
+template <typename V> static V value_for_key(unsigned int n)
+{
+  return n == 0 ? (V)0 : (V)(0x5a000000U | n);
+}
+
+
+template <typename T, typename K, typename V>
+static void *insert_random(void *threadarg)
+{
+  thread_data_s<T> *mydata = (thread_data_s<T> *)threadarg;
+  unsigned int seed = mydata->thread_id * time(NULL);
+  unsigned int n;
+  V value;
+  int q;
+
+  for (q = 0; q < mydata->num_insertions; q++)
+  {
+    n = rand_r(&seed) % NUM_KEYS + mydata->first;
+    if (!mydata->table->lookup((K)n, &value))
+    {
+      mydata->table->insert((K)n, value_for_key<V>(n), mydata->thread_id);
+    }
+    else if (value != value_for_key<V>(n))
+    {
+      fprintf(stderr, "ASSERTION FAILURE: thread %d: key=%u value=%llX\n",
+              mydata->thread_id, n, (unsigned long long)value);
+      exit(101);
+    }
+  }
+  return NULL;
+}
+
+
+/*
+ * test_table()
+ *
+ * Run the insert test in num_threads threads on a new table of type T,
+ * then check that every key in it has the right value, that they all
+ * got in, and that reset() empties it.
+ */
+template <typename T, typename K, typename V>
+static void test_table(const char *name, int num_threads, unsigned int first)
+{
+  static thread_data_s<T> thread_data[MAX_NUM_THREADS];
+  pthread_t threads[MAX_NUM_THREADS];
+  struct timeval start_timeval,end_timeval,elapsed_timeval;
+  int etime;
+  T *table;
+  unsigned int n, num_found = 0;
+  V value;
+  int t, rc;
+
+  table = new T(0); /* start small so the test also grows it */
+
+  gettimeofday(&start_timeval, NULL);
+
+  for (t = 0; t < num_threads; t++)
+  {
+    thread_data[t].thread_id = t;
+    thread_data[t].num_insertions = NUM_INSERTIONS / num_threads;
+    thread_data[t].table = table;
+    thread_data[t].first = first;
+
+    if ((rc = pthread_create(&threads[t], NULL, insert_random<T, K, V>,
+                             (void *)&thread_data[t])))
+    {
+      fprintf(stderr, "pthread_create() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* wait for threads */
+  for (t = 0; t < num_threads; t++)
+  {
+    if ((rc = pthread_join(threads[t], NULL)))
+    {
+      fprintf(stderr, "pthread_join() failed (%d)\n", rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+
+  /* every key that is in the table must have the right value */
+  for (n = first; n < first + NUM_KEYS; n++)
+  {
+    if (table->lookup((K)n, &value))
+    {
+      if (value != value_for_key<V>(n))
+      {
+        fprintf(stderr, "%s: bad value for key %u\n", name, n);
+        exit(EXIT_FAILURE);
+      }
+      num_found++;
+    }
+  }
+  /* with this many insertions every key is almost certainly chosen */
+  if (num_found != NUM_KEYS)
+  {
+    fprintf(stderr, "%s: found %u keys not %u\n", name, num_found, NUM_KEYS);
+    exit(EXIT_FAILURE);
+  }
+#ifdef USE_INSTRUMENT
+  /* can overcount if the same key is inserted by two threads while
+     migrating, but never undercount */
+  if (table->total_key_count() < num_found)
+  {
+    fprintf(stderr, "%s: key count %u < %u keys found\n", name,
+            table->total_key_count(), num_found);
+    exit(EXIT_FAILURE);
+  }
+#endif
+
+  table->reset();
+  for (n = first; n < first + NUM_KEYS; n++)
+  {
+    if (table->lookup((K)n, &value))
+    {
+      fprintf(stderr, "%s: key %u still there after reset\n", name, n);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  printf("%s: %u keys, %u bytes/slot, elapsed time %d ms\n", name,
+         num_found, (unsigned int)T::slot_bytes(), etime);
+  delete table;
+}
+
+
+/***************************************************************************
+ *
+ * main
+ *
+ ***************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  int num_threads;
+
+  if (argc == 1)
+    num_threads = 2;
+  else if (argc == 2)
+    num_threads = atoi(argv[1]);
+  else
+  {
+    fprintf(stderr, "usage: %s [numthreads]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_threads < 1 || num_threads >  MAX_NUM_THREADS)
+  {
+    fprintf(stderr, "number of threads must be 1..%d\n", MAX_NUM_THREADS);
+    exit(1);
+  }
+
+  test_table<table6464_t, uint64_t, uint64_t>("64/64", num_threads, 1);
+  test_table<table6432_t, uint64_t, uint32_t>("64/32", num_threads, 0);
+  test_table<table3232_t, uint32_t, uint32_t>("32/32", num_threads, 1);
+
+  exit(0);
+}
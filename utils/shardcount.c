@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *
+ * File:    shardcount.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Per-thread (sharded) instrumentation counters. See shardcount.h.
+ *
+ *
+ *****************************************************************************/
+
+#include <string.h>
+
+#include "shardcount.h"
+
+
+/*
+ * shardcount_total()
+ *
+ * Add up one counter over all threads. This is exact if no threads are
+ * adding to the counter, otherwise only approximate (but does not
+ * disturb them).
+ *
+ * Parameters:
+ *    sc - set of counters
+ *    counter - index of counter (0..SHARDCOUNT_MAX_COUNTERS-1)
+ *
+ * Return value:
+ *    Total of counter over all threads.
+ */
+shardcount_counter_t shardcount_total(const shardcount_t *sc, int counter)
+{
+  shardcount_counter_t total = 0;
+  int t;
+
+  for (t = 0; t < MAX_NUM_THREADS; t++)
+    total += sc->shard[t].count[counter];
+  return total;
+}
+
+
+/*
+ * shardcount_reset()
+ *
+ * Set all counters for all threads to zero. Must not be called while
+ * other threads are counting.
+ *
+ * Parameters:
+ *    sc - set of counters to reset
+ *
+ * Return value:
+ *    None.
+ */
+void shardcount_reset(shardcount_t *sc)
+{
+  memset(sc, 0, sizeof(shardcount_t));
+}
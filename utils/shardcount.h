@@ -0,0 +1,86 @@
+#ifndef SHARDCOUNT_H
+#define SHARDCOUNT_H
+/*****************************************************************************
+ *
+ * File:    shardcount.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Declarations for per-thread (sharded) instrumentation counters.
+ *
+ * Each thread only ever adds to its own counters, and they are in their
+ * own cache line(s), so counting costs no more than a plain increment:
+ * no CAS and no 'false sharing' with other threads' counters (which
+ * adjacent per-thread counters in a plain array suffer from on every
+ * increment). Totals are summed over the threads when wanted, usually
+ * at the end in the master thread; while threads are running the total
+ * is only approximate.
+ *
+ * Usage: define an enum of counter indices (at most SHARDCOUNT_MAX_COUNTERS)
+ * and a shardcount_t, e.g.
+ *
+ *   enum { STATS_REUSE, STATS_HASHCOUNT };
+ *   static shardcount_t stats;
+ *   ...
+ *   SHARDCOUNT_INC(&stats, thread_id, STATS_REUSE);
+ *   ...
+ *   total_reuse = shardcount_total(&stats, STATS_REUSE);
+ *
+ * A static (or calloc()ed) shardcount_t starts with all counters 0.
+ *
+ *
+ *****************************************************************************/
+
+#include "bpautils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* number of counters each thread has */
+#define SHARDCOUNT_MAX_COUNTERS 8
+
+/* each thread's counters are aligned and padded to this. Two 64 byte
+   lines since x86 prefetches the adjacent line too, so counters even
+   in neighbouring lines can still interfere */
+#define SHARDCOUNT_ALIGN 128
+
+typedef unsigned long shardcount_counter_t;
+
+/* one thread's counters */
+typedef struct shardcount_shard_s
+{
+    shardcount_counter_t count[SHARDCOUNT_MAX_COUNTERS];
+} __attribute__((aligned(SHARDCOUNT_ALIGN))) shardcount_shard_t;
+
+/* a set of counters for all threads */
+typedef struct shardcount_s
+{
+    shardcount_shard_t shard[MAX_NUM_THREADS];
+} shardcount_t;
+
+
+/* add n to counter for thread_id (0,1,2,.. NOT pthread_t) */
+#define SHARDCOUNT_ADD(sc, thread_id, counter, n) \
+  ((sc)->shard[(thread_id)].count[(counter)] += (n))
+
+/* add one to counter for thread_id */
+#define SHARDCOUNT_INC(sc, thread_id, counter) \
+  SHARDCOUNT_ADD(sc, thread_id, counter, 1)
+
+/* value of counter for thread_id */
+#define SHARDCOUNT_GET(sc, thread_id, counter) \
+  ((sc)->shard[(thread_id)].count[(counter)])
+
+
+/* add up counter over all threads */
+shardcount_counter_t shardcount_total(const shardcount_t *sc, int counter);
+
+/* set all counters for all threads to zero */
+void shardcount_reset(shardcount_t *sc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHARDCOUNT_H */
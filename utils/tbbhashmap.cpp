@@ -25,6 +25,7 @@
 #include "tbb/scalable_allocator.h"
 #include <pthread.h>
 #include "tbbhashmap.h"
+#include "hashfn.h"
 
 using namespace tbb;
 using namespace std;
@@ -39,28 +40,6 @@ using namespace std;
  ***************************************************************************/
 
 
-#ifdef USE_GOOD_HASH
-/*
-  hash a 64 bit value into 32 bits. From:
-  (Thomas Wang, Jan 1997, Last update Mar 2007, Version 3.1)
-  http://www.concentric.net/~Ttwang/tech/inthash.htm
-  (found by reference in NIST Dictionary of Algorithms and Data Structures)
-*/
-static unsigned long hash6432shift(unsigned long long key)
-{
-  key = (~key) + (key << 18); /* key = (key << 18) - key - 1; */
-  key = key ^ (key >> 31);
-  key = key * 21; /* key = (key + (key << 2)) + (key << 4); */
-  key = key ^ (key >> 11);
-  key = key + (key << 6);
-  key = key ^ (key >> 22);
-  return (unsigned long) key;
-}
-
-#endif
-
-
-
 //! Structure that defines hashing and comparison operations for user's type.
 struct MyHashCompare {
     static size_t hash( const _SET& x ) {
@@ -69,8 +48,8 @@ struct MyHashCompare {
         unsigned long highhash,lowhash,q;
         
 #ifdef USE_GOOD_HASH
-        highhash = hash6432shift(x.high);
-        lowhash = hash6432shift(x.low);
+        highhash = hashfn_wang(x.high);
+        lowhash = hashfn_wang(x.low);
         q = lowhash ^ highhash; /* FIXME: should have a hash12832shift() instead */
 #else
         q = x.low;